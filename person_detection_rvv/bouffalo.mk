@@ -29,7 +29,66 @@ CXXFLAGS += -DTF_LITE_STRIP_ERROR_STRINGS
 CPPFLAGS += -DTF_LITE_STATIC_MEMORY
 CXXFLAGS += -fno-threadsafe-statics
 
-# Test Image
+# The tensor arena is sized by model_arena_size.h, which a host build with
+# the same options as below generates (see README.md); the build stops if the
+# options differ from those the header was made for.
+
+# Repack the conv and depthwise weights into the tensor arena in Prepare, so
+# the RVV kernels stream every block of output channels contiguously. The
+# arena then grows from 96368 to 304784 bytes (model_arena_size.h), so the
+# weights stay in the model data unless MODEL_FILTER_PACKING is 1, as in the
+# host build (PD_FILTER_PACKING).
+#MODEL_FILTER_PACKING := 1
+ifneq ($(MODEL_FILTER_PACKING),1)
+CXXFLAGS += -DTF_LITE_MICRO_NO_FILTER_PACKING
+endif
+
+# Run the first 4 layers, down to the 24x24 activations, in bands of 4 rows
+# of their output instead of layer by layer. The 48x48 activations are then
+# never held whole, which saves about 18 KB of arena for the same scores at
+# the cost of recomputing the rows where bands overlap (see README.md).
+#CXXFLAGS += -DMODEL_PATCH_OPS=4 -DMODEL_PATCH_ROWS=4
+
+# Plan the arena with the search memory planner instead of the greedy one.
+# It tries several layouts of the activations and keeps the smallest, which
+# makes AllocateTensors() slower (see README.md for the sizes it finds).
+#CXXFLAGS += -DMODEL_SEARCH_MEMORY_PLANNER
+
+# Per-op timing: every 16 inferences, print the per-operator ticks (rdcycle,
+# core clock cycles), MAC counts and MACs per cycle. Add
+# -DPROFILE_MODEL_OPS_CSV for a CSV dump as well. The profiler hooks are
+# compiled out with TF_LITE_STRIP_ERROR_STRINGS unless
+# TF_LITE_MICRO_ENABLE_PROFILER is set.
+#CXXFLAGS += -DPROFILE_MODEL_OPS -DTF_LITE_MICRO_ENABLE_PROFILER
+
+# Skip inference on frames that match the last classified one within a mean
+# absolute difference of MOTION_GATE_THRESHOLD / 256 gray levels per pixel,
+# for at most MOTION_GATE_MAX_SKIP frames in a row (defaults in
+# motion_gate.h).
+#CFLAGS += -DMOTION_GATING
+#CFLAGS += -DMOTION_GATE_THRESHOLD=512 -DMOTION_GATE_MAX_SKIP=15
+
+# Smoothing of the camera scores and the person-present debounce (defaults
+# in score_filter.h): weight of a new frame in 1/256, the smoothed person
+# score at or above which a person enters and below which they leave, and the
+# frames in a row either takes.
+#CFLAGS += -DSCORE_FILTER_ALPHA=64
+#CFLAGS += -DSCORE_FILTER_ENTER_THRESHOLD=32 -DSCORE_FILTER_EXIT_THRESHOLD=-32
+#CFLAGS += -DSCORE_FILTER_ENTER_FRAMES=2 -DSCORE_FILTER_EXIT_FRAMES=4
+
+# Write the deferred log (deferred_log.h) as hex records instead of
+# formatting it on the board; decode the console capture on the host with
+# person_detection_rvv/host/decode_log.py.
+#CFLAGS += -DDEFERRED_LOG_HEX
+
+# Search the whole 400x300 frame with 300, 200 and 150 px sliding windows
+# and print the best window and a person heat map instead of classifying the
+# centre crop.
+#CFLAGS += -DCAMERA_LOCALIZE
+
+# Test Image: classify g_test_image_data on the board. To score many
+# images, convert them to PGM with test_pictures/jpeg_to_raw.py and run the
+# host tool person_detection_offline on the directory instead (see README.md).
 #CPPFLAGS += -DRUN_MODEL_ON_TEST_IMAGES
 #CFLAGS += -DRUN_MODEL_ON_TEST_IMAGES
 #CXXFLAGS += -DRUN_MODEL_ON_TEST_IMAGES
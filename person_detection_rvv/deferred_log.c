@@ -0,0 +1,240 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "deferred_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipeline_os.h"
+
+#if (DEFERRED_LOG_WORDS & (DEFERRED_LOG_WORDS - 1)) != 0
+#error "DEFERRED_LOG_WORDS must be a power of two"
+#endif
+
+// A record is a header word, a timestamp word (os_time_us() truncated to 32
+// bits) and its payload: the arguments, or for DLOG_TEXT the byte count and
+// the bytes packed four to a word. The header holds the ID in bits 0 to 15,
+// the payload words in bits 16 to 23 and the valid bit, which tells the
+// drain the record is complete.
+#define RECORD_VALID (0x80000000u)
+#define RECORD_ID(header) ((header) & 0xffffu)
+#define RECORD_PAYLOAD(header) (((header) >> 16) & 0xffu)
+#define RECORD_HEADER_WORDS (2)
+#define RING_MASK (DEFERRED_LOG_WORDS - 1)
+
+static const char* const kFormats[DEFERRED_LOG_FORMAT_COUNT] = {
+#define DEFERRED_LOG_FORMAT(id, format) format,
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_FORMAT)
+#undef DEFERRED_LOG_FORMAT
+};
+
+// Words are only cleared by the drain, so a record whose header is not
+// written yet reads as invalid.
+static uint32_t ring[DEFERRED_LOG_WORDS];
+// Free-running word counts: reserved by writers and consumed by the drain.
+static uint32_t ring_head;
+static uint32_t ring_tail;
+static uint32_t dropped;
+// Dropped count the drain has reported.
+static uint32_t dropped_reported;
+
+// Reserves words for a record and stores the position of its header in
+// start. Counts a drop and returns -1 if the ring is full.
+static int8_t reserve(uint32_t words, uint32_t* start)
+{
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    do {
+        const uint32_t tail = __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+        if (head - tail + words > DEFERRED_LOG_WORDS) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&ring_head, &head, head + words, 1, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+    *start = head;
+    return 0;
+}
+
+// Publishes a record whose payload is written: the release store orders the
+// payload before the header.
+static void commit(uint32_t start, uint32_t id, uint32_t payload)
+{
+    ring[(start + 1) & RING_MASK] = (uint32_t)os_time_us();
+    __atomic_store_n(&ring[start & RING_MASK], RECORD_VALID | (payload << 16) | id,
+                     __ATOMIC_RELEASE);
+}
+
+int8_t deferred_log_write(uint32_t id, uint32_t argc, const uint32_t* args)
+{
+    if ((id >= DEFERRED_LOG_FORMAT_COUNT) || (id == DLOG_TEXT) ||
+        (argc > DEFERRED_LOG_MAX_ARGS) || ((args == NULL) && (argc > 0))) {
+        return -1;
+    }
+    uint32_t start = 0;
+    if (reserve(RECORD_HEADER_WORDS + argc, &start) != 0) {
+        return -2;
+    }
+    for (uint32_t i = 0; i < argc; i++) {
+        ring[(start + RECORD_HEADER_WORDS + i) & RING_MASK] = args[i];
+    }
+    commit(start, id, argc);
+    return 0;
+}
+
+int8_t deferred_log_text(const char* text)
+{
+    if (text == NULL) {
+        return -1;
+    }
+    size_t remaining = strlen(text);
+    int8_t status = 0;
+    while (remaining > 0) {
+        const uint32_t length =
+            remaining > DEFERRED_LOG_MAX_TEXT ? DEFERRED_LOG_MAX_TEXT : (uint32_t)remaining;
+        const uint32_t payload = 1 + (length + 3) / 4;
+        uint32_t start = 0;
+        if (reserve(RECORD_HEADER_WORDS + payload, &start) != 0) {
+            status = -2;
+        } else {
+            const uint32_t first = start + RECORD_HEADER_WORDS;
+            ring[first & RING_MASK] = length;
+            for (uint32_t i = 0; i < payload - 1; i++) {
+                uint32_t word = 0;
+                for (uint32_t b = 0; (b < 4) && (i * 4 + b < length); b++) {
+                    word |= (uint32_t)(uint8_t)text[i * 4 + b] << (8 * b);
+                }
+                ring[(first + 1 + i) & RING_MASK] = word;
+            }
+            commit(start, DLOG_TEXT, payload);
+        }
+        text += length;
+        remaining -= length;
+    }
+    return status;
+}
+
+// Copies the oldest complete record out of the ring and frees its words.
+// Returns its word count, 0 if there is none.
+static uint32_t take_record(uint32_t record[RECORD_HEADER_WORDS + 255])
+{
+    const uint32_t tail = ring_tail;
+    const uint32_t header = __atomic_load_n(&ring[tail & RING_MASK], __ATOMIC_ACQUIRE);
+    if ((header & RECORD_VALID) == 0) {
+        return 0;
+    }
+    const uint32_t words = RECORD_HEADER_WORDS + RECORD_PAYLOAD(header);
+    for (uint32_t i = 0; i < words; i++) {
+        record[i] = ring[(tail + i) & RING_MASK];
+        ring[(tail + i) & RING_MASK] = 0;
+    }
+    // Writers may reuse the words once they see the new tail.
+    __atomic_store_n(&ring_tail, tail + words, __ATOMIC_RELEASE);
+    return words;
+}
+
+static uint32_t format_record(const uint32_t* record, char* line)
+{
+    const uint32_t id = RECORD_ID(record[0]);
+    const uint32_t payload = RECORD_PAYLOAD(record[0]);
+    if (id == DLOG_TEXT) {
+        const uint32_t length = record[RECORD_HEADER_WORDS];
+        for (uint32_t i = 0; i < length; i++) {
+            line[i] = (char)(record[RECORD_HEADER_WORDS + 1 + i / 4] >> (8 * (i % 4)));
+        }
+        return length;
+    }
+    uint32_t args[DEFERRED_LOG_MAX_ARGS] = {0};
+    for (uint32_t i = 0; (i < payload) && (i < DEFERRED_LOG_MAX_ARGS); i++) {
+        args[i] = record[RECORD_HEADER_WORDS + i];
+    }
+    const int length = snprintf(line, DEFERRED_LOG_MAX_LINE, kFormats[id], args[0], args[1],
+                                args[2], args[3], args[4], args[5], args[6], args[7]);
+    if (length < 0) {
+        return 0;
+    }
+    return length < DEFERRED_LOG_MAX_LINE ? (uint32_t)length : DEFERRED_LOG_MAX_LINE - 1;
+}
+
+static uint32_t format_hex(const uint32_t* record, uint32_t words, char* line)
+{
+    static const char kDigits[] = "0123456789abcdef";
+    uint32_t length = 0;
+    line[length++] = '~';
+    for (uint32_t i = 0; i < words; i++) {
+        if (i > 0) {
+            line[length++] = ' ';
+        }
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            line[length++] = kDigits[(record[i] >> shift) & 0xf];
+        }
+    }
+    line[length++] = '\r';
+    line[length++] = '\n';
+    return length;
+}
+
+static uint32_t drain(deferred_log_sink_t sink, void* context, uint32_t max_records, int hex)
+{
+    // Large enough for a hex line of the longest record.
+    static char line[1 + (RECORD_HEADER_WORDS + 255) * 9 + 2];
+    static uint32_t record[RECORD_HEADER_WORDS + 255];
+    uint32_t lines = 0;
+    uint32_t words = 0;
+    while ((max_records == 0) || (lines < max_records)) {
+        words = take_record(record);
+        if (words == 0) {
+            break;
+        }
+        sink(context, line, hex ? format_hex(record, words, line) : format_record(record, line));
+        lines++;
+    }
+    // Drops are reported once the records before them are out.
+    const uint32_t dropped_now = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    if ((words == 0) && (dropped_now != dropped_reported)) {
+        record[0] = RECORD_VALID | (1u << 16) | DLOG_DROPPED;
+        record[1] = (uint32_t)os_time_us();
+        record[2] = dropped_now - dropped_reported;
+        dropped_reported = dropped_now;
+        sink(context, line, hex ? format_hex(record, 3, line) : format_record(record, line));
+        lines++;
+    }
+    return lines;
+}
+
+uint32_t deferred_log_drain_text(deferred_log_sink_t sink, void* context, uint32_t max_records)
+{
+    return drain(sink, context, max_records, 0);
+}
+
+uint32_t deferred_log_drain_hex(deferred_log_sink_t sink, void* context, uint32_t max_records)
+{
+    return drain(sink, context, max_records, 1);
+}
+
+uint32_t deferred_log_dropped(void)
+{
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+void deferred_log_reset(void)
+{
+    memset(ring, 0, sizeof(ring));
+    ring_head = 0;
+    ring_tail = 0;
+    dropped = 0;
+    dropped_reported = 0;
+}
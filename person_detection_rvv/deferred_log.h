@@ -0,0 +1,146 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef DEFERRED_LOG_H_
+#define DEFERRED_LOG_H_
+
+#include <stdint.h>
+
+#include "deferred_log_formats.h"
+
+// Deferred log: a hot path records the ID of a format string
+// (deferred_log_formats.h), a timestamp and the raw integer arguments into a
+// ring buffer instead of formatting and writing them to the UART, and a low
+// priority task drains the ring later. It either formats the records on the
+// board or writes them as hex lines that host/decode_log.py formats on the
+// host, so the board does no formatting at all.
+//
+// Any number of tasks may write at the same time: a writer reserves its words
+// with a compare-and-swap on the ring head and publishes the record by
+// writing its header last, so writers never block or take a lock. A writer
+// that finds the ring full drops its record and counts it. Only one task may
+// drain.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Ring capacity in 32 bit words, a power of two.
+#ifndef DEFERRED_LOG_WORDS
+#define DEFERRED_LOG_WORDS (2048)
+#endif
+
+// Most arguments of a record.
+#define DEFERRED_LOG_MAX_ARGS (8)
+
+// Longest text record; deferred_log_text() splits longer strings.
+#define DEFERRED_LOG_MAX_TEXT (128)
+
+// Longest line the drain functions hand to the sink.
+#define DEFERRED_LOG_MAX_LINE (256)
+
+enum {
+#define DEFERRED_LOG_ID(id, format) id,
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_ID)
+#undef DEFERRED_LOG_ID
+    DEFERRED_LOG_FORMAT_COUNT,
+};
+
+/**
+ * Receives drained lines; text is not NUL terminated.
+ */
+typedef void (*deferred_log_sink_t)(void* context, const char* text, uint32_t length);
+
+/**
+ * Records a format ID and its arguments, see DLOG().
+ *
+ * @param id Format ID from deferred_log_formats.h.
+ * @param argc Number of arguments, at most DEFERRED_LOG_MAX_ARGS.
+ * @param args Arguments, each converted to 32 bits.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the ring was
+ *         full and the record dropped.
+ */
+int8_t deferred_log_write(uint32_t id, uint32_t argc, const uint32_t* args);
+
+/**
+ * Records a copy of a string, in pieces of DEFERRED_LOG_MAX_TEXT bytes.
+ *
+ * @param text NUL terminated string.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the ring was
+ *         full and (part of) the string dropped.
+ */
+int8_t deferred_log_text(const char* text);
+
+/**
+ * Formats up to max_records records, oldest first, and hands every line to
+ * sink. Records dropped since the last drain show up as a DLOG_DROPPED line
+ * once the ring is empty. Must only be called from one task at a time.
+ *
+ * @param sink Receives the lines.
+ * @param context Passed to sink.
+ * @param max_records Most records to drain, 0 for all.
+ *
+ * @return Number of lines handed to sink.
+ */
+uint32_t deferred_log_drain_text(deferred_log_sink_t sink, void* context, uint32_t max_records);
+
+/**
+ * Like deferred_log_drain_text(), but hands sink every record unformatted as
+ * one line of '~' and its words in hex, for host/decode_log.py.
+ *
+ * @param sink Receives the lines.
+ * @param context Passed to sink.
+ * @param max_records Most records to drain, 0 for all.
+ *
+ * @return Number of lines handed to sink.
+ */
+uint32_t deferred_log_drain_hex(deferred_log_sink_t sink, void* context, uint32_t max_records);
+
+/**
+ * Records dropped since start-up because the ring was full.
+ *
+ * @param none
+ *
+ * @return The count.
+ */
+uint32_t deferred_log_dropped(void);
+
+/**
+ * Empties the ring and clears the dropped count. No task may write or drain
+ * at the same time.
+ *
+ * @param none
+ *
+ * @return none
+ */
+void deferred_log_reset(void);
+
+// Records DLOG(id, arguments...) from C; every argument is converted to
+// uint32_t, so %d arguments keep their sign bits.
+#define DLOG(...)                                                                      \
+    do {                                                                               \
+        const uint32_t dlog_words_[] = {__VA_ARGS__};                                  \
+        deferred_log_write(dlog_words_[0],                                             \
+                           (uint32_t)(sizeof(dlog_words_) / sizeof(dlog_words_[0])) - 1, \
+                           dlog_words_ + 1);                                           \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DEFERRED_LOG_H_
@@ -0,0 +1,40 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef DEFERRED_LOG_FORMATS_H_
+#define DEFERRED_LOG_FORMATS_H_
+
+// Format strings of the deferred log (deferred_log.h). A record carries the
+// position of its format in this table as ID, so host/decode_log.py reads the
+// table from this file: add new formats at the end and do not reorder or
+// remove old ones, or existing captures decode wrongly. A format takes up to
+// DEFERRED_LOG_MAX_ARGS 32 bit integer arguments (%d, %i, %u, %x, %X or %c
+// with flags and a width); DLOG_TEXT alone carries a string.
+#define DEFERRED_LOG_FORMATS(X)                                                            \
+    X(DLOG_TEXT, "%s")                                                                     \
+    X(DLOG_DROPPED, "[%u log records dropped]\r\n")                                        \
+    X(DLOG_FRAME_RESULT,                                                                   \
+      "frame %u: person score:%d no person score %d, present %d, %u ms since the last "    \
+      "frame\r\n")                                                                         \
+    X(DLOG_PERSON_ENTERED, "frame %u: person entered\r\n")                                 \
+    X(DLOG_PERSON_LEFT, "frame %u: person left\r\n")                                       \
+    X(DLOG_PIPELINE_STATS,                                                                 \
+      "pipeline: %u frames in %u ms, %u.%02u fps, %u inferences, %u skipped\r\n")          \
+    X(DLOG_PIPELINE_CAPTURE, "  capture    %3u%% busy, %u us per frame\r\n")               \
+    X(DLOG_PIPELINE_PREPROCESS, "  preprocess %3u%% busy, %u us per frame\r\n")            \
+    X(DLOG_PIPELINE_INFERENCE, "  inference  %3u%% busy, %u us per frame\r\n")
+
+#endif  // DEFERRED_LOG_FORMATS_H_
@@ -0,0 +1,253 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "host/arena_profile.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/recording_micro_interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace host {
+namespace {
+
+// Large enough for any configuration of the model, filter packing included.
+constexpr size_t kOversizedArena = 2 * 1024 * 1024;
+constexpr size_t kArenaStep = 16;
+
+// Drops the errors of the arenas that are too small.
+class SilentErrorReporter : public tflite::ErrorReporter {
+public:
+    int Report(const char *, va_list) override
+    {
+        return 0;
+    }
+};
+
+void AddOps(tflite::MicroMutableOpResolver<5> *resolver)
+{
+    resolver->AddAveragePool2D();
+    resolver->AddConv2D(tflite::Register_CONV_2D());
+    resolver->AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver->AddReshape();
+    resolver->AddSoftmax(tflite::Register_SOFTMAX());
+}
+
+TfLiteStatus Configure(tflite::MicroInterpreter *interpreter, const ArenaConfig &config)
+{
+    if (config.patch_ops > 0) {
+        TF_LITE_ENSURE_STATUS(interpreter->SetPatchExecution(config.patch_ops, config.patch_rows));
+    }
+    return interpreter->SetMemoryPlanner(config.planner_type);
+}
+
+// Allocates the model as init_model() does, in arena_size bytes; used, if
+// not null, receives arena_used_bytes().
+bool Allocates(const uint8_t *model_data, const ArenaConfig &config, uint8_t *arena,
+               size_t arena_size, size_t *used)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    AddOps(&resolver);
+    SilentErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(model_data), resolver, arena,
+                                         arena_size, &error_reporter);
+    if (Configure(&interpreter, config) != kTfLiteOk ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return false;
+    }
+    if (used != nullptr) {
+        *used = interpreter.arena_used_bytes();
+    }
+    return true;
+}
+
+} // namespace
+
+bool ProfileArena(const uint8_t *model_data, const ArenaConfig &config, ArenaProfile *profile,
+                  std::string *error)
+{
+    std::vector<uint8_t> arena_buffer(kOversizedArena + kArenaStep);
+    uint8_t *arena = reinterpret_cast<uint8_t *>(
+        (reinterpret_cast<uintptr_t>(arena_buffer.data()) + kArenaStep - 1) &
+        ~uintptr_t(kArenaStep - 1));
+
+    {
+        tflite::MicroMutableOpResolver<5> resolver;
+        AddOps(&resolver);
+        static tflite::MicroErrorReporter error_reporter;
+        tflite::RecordingMicroInterpreter interpreter(tflite::GetModel(model_data), resolver,
+                                                      arena, kOversizedArena, &error_reporter);
+        if (Configure(&interpreter, config) != kTfLiteOk ||
+            interpreter.AllocateTensors() != kTfLiteOk) {
+            *error = "AllocateTensors() failed in the oversized arena";
+            return false;
+        }
+        const tflite::RecordingMicroAllocator &allocator = interpreter.GetMicroAllocator();
+        auto used = [&allocator](tflite::RecordedAllocationType type) {
+            return allocator.GetRecordedAllocation(type).used_bytes;
+        };
+        profile->head_bytes = allocator.GetSimpleMemoryAllocator()->GetHeadUsedBytes();
+        profile->tail_bytes = allocator.GetSimpleMemoryAllocator()->GetTailUsedBytes();
+        profile->eval_tensor_bytes = used(tflite::RecordedAllocationType::kTfLiteEvalTensorData);
+        profile->persistent_tensor_bytes =
+            used(tflite::RecordedAllocationType::kPersistentTfLiteTensorData);
+        profile->quantization_bytes =
+            used(tflite::RecordedAllocationType::kPersistentTfLiteTensorQuantizationData);
+        profile->persistent_buffer_bytes =
+            used(tflite::RecordedAllocationType::kPersistentBufferData);
+        profile->variable_buffer_bytes =
+            used(tflite::RecordedAllocationType::kTfLiteTensorVariableBufferData);
+        profile->node_and_registration_bytes =
+            used(tflite::RecordedAllocationType::kNodeAndRegistrationArray);
+        profile->other_tail_bytes =
+            profile->tail_bytes - profile->eval_tensor_bytes - profile->persistent_tensor_bytes -
+            profile->quantization_bytes - profile->persistent_buffer_bytes -
+            profile->variable_buffer_bytes - profile->node_and_registration_bytes;
+    }
+
+    // The recording allocator is larger than the plain one, so the firmware
+    // numbers come from the plain interpreter. AllocateTensors() also needs
+    // room for temporaries it frees again, so the smallest arena is found by
+    // bisection between the bytes it ends up using and the oversized arena.
+    if (!Allocates(model_data, config, arena, kOversizedArena, &profile->used_bytes)) {
+        *error = "AllocateTensors() failed in the oversized arena";
+        return false;
+    }
+    size_t low = (profile->used_bytes / kArenaStep) * kArenaStep;
+    size_t high = kOversizedArena;
+    if (Allocates(model_data, config, arena, low, nullptr)) {
+        high = low;
+    }
+    while (high - low > kArenaStep) {
+        const size_t middle = low + ((high - low) / 2 / kArenaStep) * kArenaStep;
+        if (Allocates(model_data, config, arena, middle, nullptr)) {
+            high = middle;
+        } else {
+            low = middle;
+        }
+    }
+    profile->minimum_arena_bytes = high;
+    return true;
+}
+
+int BuildFilterPacking()
+{
+#if defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+bool WriteArenaHeader(const ArenaConfig &config, const ArenaProfile &profile,
+                      const std::string &path, std::string *error)
+{
+    ArenaHeader header;
+    std::string read_error;
+    const bool keep = ReadArenaHeader(path, &header, &read_error) &&
+                      header.config.patch_ops == config.patch_ops &&
+                      (config.patch_ops == 0 || header.config.patch_rows == config.patch_rows) &&
+                      header.config.planner_type == config.planner_type;
+    if (!keep) {
+        header.arena_size[0] = header.arena_size[1] = 0;
+    }
+    const int packing = BuildFilterPacking();
+    char note[128];
+    snprintf(note, sizeof(note), "// Filter packing %s: head %zu bytes, tail %zu bytes.",
+             packing ? "on" : "off", profile.head_bytes, profile.tail_bytes);
+    header.arena_size[packing] = ArenaSize(profile);
+    header.note[packing] = note;
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        *error = "cannot write " + path;
+        return false;
+    }
+    fprintf(file,
+            "// Generated by person_detection_arena_size (host/arena_profile.h), do not edit.\n"
+            "// Tensor arena of init_model(): the smallest arena AllocateTensors() succeeds\n"
+            "// in, plus %zu bytes of alignment slack.\n"
+            "#ifndef MODEL_ARENA_SIZE_H_\n"
+            "#define MODEL_ARENA_SIZE_H_\n"
+            "\n"
+            "// The configuration the sizes hold for.\n"
+            "#define MODEL_ARENA_PATCH_OPS %d\n"
+            "#define MODEL_ARENA_PATCH_ROWS %d\n"
+            "#define MODEL_ARENA_SEARCH_MEMORY_PLANNER %d\n"
+            "\n",
+            kArenaAlignmentSlack, config.patch_ops, config.patch_ops > 0 ? config.patch_rows : 0,
+            config.planner_type == tflite::MemoryPlannerType::kSearch ? 1 : 0);
+    const char *names[2] = {"MODEL_ARENA_SIZE_NO_FILTER_PACKING", "MODEL_ARENA_SIZE_FILTER_PACKING"};
+    for (int i = 1; i >= 0; --i) {
+        if (header.arena_size[i] > 0) {
+            fprintf(file, "%s\n#define %s %zu\n", header.note[i].c_str(), names[i],
+                    header.arena_size[i]);
+        }
+    }
+    fprintf(file, "\n#endif  // MODEL_ARENA_SIZE_H_\n");
+    if (fclose(file) != 0) {
+        *error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool ReadArenaHeader(const std::string &path, ArenaHeader *header, std::string *error)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        *error = "cannot read " + path;
+        return false;
+    }
+    header->config = {-1, 0, tflite::MemoryPlannerType::kGreedy};
+    header->arena_size[0] = header->arena_size[1] = 0;
+    int search = -1;
+    char line[256];
+    std::string previous;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        line[strcspn(line, "\n")] = '\0';
+        sscanf(line, "#define MODEL_ARENA_PATCH_OPS %d", &header->config.patch_ops);
+        sscanf(line, "#define MODEL_ARENA_PATCH_ROWS %d", &header->config.patch_rows);
+        sscanf(line, "#define MODEL_ARENA_SEARCH_MEMORY_PLANNER %d", &search);
+        // Each size follows its note.
+        if (sscanf(line, "#define MODEL_ARENA_SIZE_NO_FILTER_PACKING %zu",
+                   &header->arena_size[0]) == 1) {
+            header->note[0] = previous;
+        }
+        if (sscanf(line, "#define MODEL_ARENA_SIZE_FILTER_PACKING %zu",
+                   &header->arena_size[1]) == 1) {
+            header->note[1] = previous;
+        }
+        previous = line;
+    }
+    fclose(file);
+    if (header->config.patch_ops < 0 || search < 0) {
+        *error = "no arena configuration in " + path;
+        return false;
+    }
+    header->config.planner_type =
+        search ? tflite::MemoryPlannerType::kSearch : tflite::MemoryPlannerType::kGreedy;
+    return true;
+}
+
+} // namespace host
@@ -0,0 +1,117 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef PERSON_DETECTION_HOST_ARENA_PROFILE_H_
+#define PERSON_DETECTION_HOST_ARENA_PROFILE_H_
+
+// Tensor arena sizing: the model is allocated on the host in an oversized
+// arena through a RecordingMicroAllocator, which tells where the bytes go,
+// and then in ever smaller arenas to find the smallest one AllocateTensors()
+// succeeds in. The result is written as model_arena_size.h, which sizes the
+// arena of the firmware (main_functions.cc).
+//
+// The host and the C906 are both LP64 targets and the kernels size their
+// buffers in Prepare() independently of the vector length, so the arena the
+// host measures is the arena the firmware needs for the same configuration.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "tensorflow/lite/micro/micro_allocator.h"
+
+namespace host {
+
+// Slack on top of the smallest arena, for an arena that does not start on
+// the 16 byte alignment of the arena buffers.
+constexpr size_t kArenaAlignmentSlack = 16;
+
+// The options of init_model() that change the arena.
+struct ArenaConfig {
+    // MODEL_PATCH_OPS and MODEL_PATCH_ROWS, 0 ops for layer by layer.
+    int patch_ops;
+    int patch_rows;
+    // MODEL_SEARCH_MEMORY_PLANNER.
+    tflite::MemoryPlannerType planner_type;
+};
+
+struct ArenaProfile {
+    // Head: the memory plan of the activations and scratch buffers.
+    size_t head_bytes;
+    // Tail: what the allocator and the kernels keep, by kind.
+    size_t tail_bytes;
+    size_t eval_tensor_bytes;
+    size_t persistent_tensor_bytes;
+    size_t quantization_bytes;
+    // Op data and the repacked filters and folded biases of the kernels.
+    size_t persistent_buffer_bytes;
+    size_t variable_buffer_bytes;
+    size_t node_and_registration_bytes;
+    // Everything else: the allocator itself, scratch buffer handles and
+    // alignment.
+    size_t other_tail_bytes;
+    // MicroInterpreter::arena_used_bytes() in the plain interpreter.
+    size_t used_bytes;
+    // The smallest 16 byte aligned arena AllocateTensors() succeeds in,
+    // which also covers the temporary allocations it frees again.
+    size_t minimum_arena_bytes;
+};
+
+/**
+ * Profiles the arena model_data needs with the kernels of this build, which
+ * repack filters unless TF_LITE_MICRO_NO_FILTER_PACKING is defined.
+ *
+ * @return false with the reason in error if the model cannot be allocated.
+ */
+bool ProfileArena(const uint8_t *model_data, const ArenaConfig &config, ArenaProfile *profile,
+                  std::string *error);
+
+/** @return the arena size for profile: the smallest arena plus the slack. */
+inline size_t ArenaSize(const ArenaProfile &profile)
+{
+    return profile.minimum_arena_bytes + kArenaAlignmentSlack;
+}
+
+// The contents of model_arena_size.h: the configuration and the arena size
+// with and without filter packing, which two host builds measure.
+struct ArenaHeader {
+    ArenaConfig config;
+    // Indexed by filter packing, 0 for off and 1 for on; 0 bytes if missing.
+    size_t arena_size[2];
+    // The comment above each size.
+    std::string note[2];
+};
+
+/** @return 1 if the kernels of this build repack filters, else 0. */
+int BuildFilterPacking();
+
+/**
+ * Writes the size for profile into the header at path, under the filter
+ * packing of this build. The size for the other filter packing is kept if
+ * the header was written for the same configuration.
+ */
+bool WriteArenaHeader(const ArenaConfig &config, const ArenaProfile &profile,
+                      const std::string &path, std::string *error);
+
+/**
+ * Reads a header written by WriteArenaHeader().
+ */
+bool ReadArenaHeader(const std::string &path, ArenaHeader *header, std::string *error);
+
+} // namespace host
+
+#endif // PERSON_DETECTION_HOST_ARENA_PROFILE_H_
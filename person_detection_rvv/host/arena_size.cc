@@ -0,0 +1,126 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// Tensor arena sizing (host/arena_profile.h): allocates the model in an
+// oversized arena, prints where the bytes go, finds the smallest arena
+// AllocateTensors() succeeds in, and writes model_arena_size.h with -o.
+// -T OPS, -R ROWS and -s select the firmware options MODEL_PATCH_OPS,
+// MODEL_PATCH_ROWS and MODEL_SEARCH_MEMORY_PLANNER; filter packing follows
+// the build (PD_FILTER_PACKING).
+//
+// The header holds the size with and without filter packing for one
+// configuration; -o updates the size of this build and keeps the other if
+// the header is for the same configuration. With -c HEADER it checks an
+// existing header instead and exits with status 2 if it is for another
+// configuration or sizes the arena of this build too small.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "host/arena_profile.h"
+#include "person_detect_model_data.h"
+
+namespace {
+
+void PrintUsage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [-T ops] [-R rows] [-s] [-o header | -c header]\n", prog);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    host::ArenaConfig config = {0, 4, tflite::MemoryPlannerType::kGreedy};
+    const char* output_path = nullptr;
+    const char* check_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-T") == 0) && (i + 1 < argc)) {
+            config.patch_ops = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-R") == 0) && (i + 1 < argc)) {
+            config.patch_rows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            config.planner_type = tflite::MemoryPlannerType::kSearch;
+        } else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+            output_path = argv[++i];
+        } else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+            check_path = argv[++i];
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.patch_ops < 0 || config.patch_rows <= 0 ||
+        (output_path != nullptr && check_path != nullptr)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::string error;
+    host::ArenaProfile profile;
+    if (!host::ProfileArena(g_person_detect_model_data, config, &profile, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+#if defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+    printf("filter packing:           off\n");
+#else
+    printf("filter packing:           on\n");
+#endif
+    printf("head (memory plan):       %zu bytes\n", profile.head_bytes);
+    printf("tail:                     %zu bytes\n", profile.tail_bytes);
+    printf("  eval tensors:           %zu bytes\n", profile.eval_tensor_bytes);
+    printf("  persistent tensors:     %zu bytes\n", profile.persistent_tensor_bytes);
+    printf("  quantization:           %zu bytes\n", profile.quantization_bytes);
+    printf("  persistent buffers:     %zu bytes\n", profile.persistent_buffer_bytes);
+    printf("  variable buffers:       %zu bytes\n", profile.variable_buffer_bytes);
+    printf("  nodes, registrations:   %zu bytes\n", profile.node_and_registration_bytes);
+    printf("  other:                  %zu bytes\n", profile.other_tail_bytes);
+    printf("arena used:               %zu bytes\n", profile.used_bytes);
+    printf("smallest arena:           %zu bytes\n", profile.minimum_arena_bytes);
+    printf("arena size:               %zu bytes\n", host::ArenaSize(profile));
+
+    if (check_path != nullptr) {
+        host::ArenaHeader header;
+        if (!host::ReadArenaHeader(check_path, &header, &error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (header.config.patch_ops != config.patch_ops ||
+            (config.patch_ops > 0 && header.config.patch_rows != config.patch_rows) ||
+            header.config.planner_type != config.planner_type) {
+            fprintf(stderr, "%s is for another configuration\n", check_path);
+            return 2;
+        }
+        const size_t arena_size = header.arena_size[host::BuildFilterPacking()];
+        if (arena_size < profile.minimum_arena_bytes) {
+            fprintf(stderr, "%s sizes the arena to %zu bytes, %zu are needed\n", check_path,
+                    arena_size, profile.minimum_arena_bytes);
+            return 2;
+        }
+        printf("%s: %zu bytes, %zu spare\n", check_path, arena_size,
+               arena_size - profile.minimum_arena_bytes);
+    }
+    if (output_path != nullptr && !host::WriteArenaHeader(config, profile, output_path, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1291 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// Host benchmark for the person detection model. Runs image_tester() over the
+// built-in test images and reports per-invoke latency percentiles, so kernel
+// changes can be measured without flashing the board. Exits with status 2 if
+// a labelled image is misclassified, so it doubles as a correctness check.
+//
+// With -l it instead times every layer of the graph twice, once with the
+// reference int8 convolution kernels and once with the optimized ones, and
+// prints the per-layer before/after table; it exits with status 2 if the two
+// score the person image differently. With -m it prints the arena usage
+// recorded by RecordingMicroAllocator, including the persistent buffers that
+// hold the repacked filters. With -p it prints the AggregatingProfiler report
+// of the optimized kernels (per-node min/mean/max, MACs and MACs per tick)
+// to stderr through DebugLog, and with -c its CSV form as well.
+//
+// With -f FORMAT it runs the camera path instead: frames in FORMAT (rgba,
+// yuv420, yuyv, uyvy, gray or all) are preprocessed straight into the bound
+// model input and classified, and the preprocessing and inference times are
+// reported per frame. The frames are synthetic unless -i names a file of
+// recorded raw frames, back to back, in that format.
+//
+// With -P (and -f FORMAT) the same frames go through the staged pipeline of
+// pipeline.h, with capture and preprocessing in their own threads, and are
+// also run stage after stage for comparison. -r FPS paces the frame source
+// like a sensor streaming at FPS frames per second. -g THRESHOLD puts the
+// motion gate of motion_gate.h in front of inference (threshold in 1/256
+// gray levels per pixel) and reports the time of its SAD kernel; -H FRAMES
+// holds every position of the synthetic scene for FRAMES frames, so that
+// only the sensor noise changes in between. -S smooths the scores with the
+// score filter of score_filter.h and reports how often the raw decision and
+// the debounced person-present state changed, and the time of an update.
+//
+// With -L (and -f FORMAT) every frame is localized by localize.h instead:
+// the pyramid is built once per frame and every sliding window classified.
+// It prints frames per second, the pyramid time against preprocessing each
+// window on its own, and the latency per window.
+//
+// With -B it times run_model_batch() for batches of 1, 2, 4 and 8 images and
+// prints the arena each batch size needs, the latency per batch and per
+// image, and the images per second against batch 1.
+//
+// With -T OPS the first OPS layers run in patches (see
+// MicroInterpreter::SetPatchExecution()) of 1 to 24 rows: it prints the
+// arena each patch height needs and saves against running layer by layer,
+// and the latency and its overhead from recomputing the halo rows.
+//
+// With -M it plans the arena with the greedy and the search memory planner
+// (see MicroInterpreter::SetMemoryPlanner()) for the model layer by layer,
+// batched and in patches, and prints the arena each planner needs and the
+// time AllocateTensors() takes with it.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "host/synthetic_frame.h"
+#include "image_preprocess.h"
+#include "localize.h"
+#include "main_functions.h"
+#include "model_settings.h"
+#include "deferred_log.h"
+#include "motion_gate.h"
+#include "score_filter.h"
+#include "no_person_image_data.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "pipeline.h"
+#include "pipeline_os.h"
+#include "tensorflow/lite/micro/aggregating_profiler.h"
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/kernels/depthwise_conv.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/micro_profiler.h"
+#include "tensorflow/lite/micro/recording_micro_interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "test_image_data.h"
+
+namespace {
+
+struct BenchImage {
+    const char* name;
+    const uint8_t* data;
+    // 1 if the image shows a person, 0 if not, -1 if unknown.
+    int expected_person;
+};
+
+const BenchImage kImages[] = {
+    {"test_image", g_test_image_data, -1},
+    {"person", g_person_image_data, 1},
+    {"no_person", g_no_person_image_data, 0},
+};
+
+uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/**
+ * Nearest-rank percentile of an already sorted sample set.
+ *
+ * @param sorted Sorted latencies.
+ * @param pct Percentile in the range [0, 100].
+ *
+ * @return Latency at the requested percentile.
+ */
+uint64_t Percentile(const std::vector<uint64_t>& sorted, int pct)
+{
+    size_t rank = (sorted.size() * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+void PrintUsage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n iterations] [-w warmup] [-l] [-m] [-p [-c]]"
+            " [-f rgba|yuv420|yuyv|uyvy|gray|all [-i frames.raw]"
+            " [-P [-r fps] [-g threshold] [-H frames] [-S] | -L]] [-B] [-T ops] [-M]\n",
+            prog);
+}
+
+// Large enough for the model plus the scratch and repacked filter buffers of
+// either kernel set; each layer-timing interpreter gets its own.
+constexpr int kLayerArenaSize = 512 * 1024;
+constexpr int kMaxLayers = 64;
+
+/**
+ * Profiler that accumulates the wall time of every operator, keyed by the
+ * position of the operator in the graph. The interpreter opens exactly one
+ * event per node, in execution order, on every Invoke().
+ */
+class LayerProfiler : public tflite::MicroProfiler {
+public:
+    uint32_t BeginEvent(const char* tag) override
+    {
+        const uint32_t handle = next_;
+        if (handle < kMaxLayers) {
+            tags_[handle] = tag;
+            start_ns_[handle] = NowNs();
+        }
+        ++next_;
+        return handle;
+    }
+
+    void EndEvent(uint32_t handle) override
+    {
+        if (handle < kMaxLayers) {
+            total_ns_[handle] += NowNs() - start_ns_[handle];
+        }
+    }
+
+    // Called before every Invoke() so that node i always maps to slot i.
+    void StartInvoke()
+    {
+        layers_ = std::max(layers_, next_);
+        next_ = 0;
+    }
+
+    void Clear()
+    {
+        memset(total_ns_, 0, sizeof(total_ns_));
+        next_ = 0;
+        layers_ = 0;
+    }
+
+    int layers() const
+    {
+        return std::min<int>(std::max(layers_, next_), kMaxLayers);
+    }
+    const char* tag(int layer) const { return tags_[layer]; }
+    uint64_t total_ns(int layer) const { return total_ns_[layer]; }
+
+private:
+    const char* tags_[kMaxLayers] = {};
+    uint64_t start_ns_[kMaxLayers] = {};
+    uint64_t total_ns_[kMaxLayers] = {};
+    uint32_t next_ = 0;
+    uint32_t layers_ = 0;
+
+    TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+/**
+ * Runs the model on one image with the given resolver and accumulates the
+ * per-layer time of the timed iterations into profiler.
+ *
+ * @return 0 on success, 1 if the interpreter could not be set up or failed.
+ */
+int ProfileLayers(const tflite::MicroOpResolver& resolver, uint8_t* arena,
+                  const uint8_t* image, int iterations, int warmup,
+                  LayerProfiler* profiler, int8_t* scores)
+{
+    static tflite::MicroErrorReporter error_reporter;
+    const tflite::Model* model = tflite::GetModel(g_person_detect_model_data);
+    tflite::MicroInterpreter interpreter(model, resolver, arena, kLayerArenaSize,
+                                         &error_reporter, profiler);
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+    TfLiteTensor* input = interpreter.input(0);
+    memcpy(input->data.int8, image, kNumCols * kNumRows * kNumChannels);
+
+    for (int i = 0; i < warmup + iterations; ++i) {
+        if (i == warmup) {
+            profiler->Clear();
+        }
+        profiler->StartInvoke();
+        if (interpreter.Invoke() != kTfLiteOk) {
+            fprintf(stderr, "Invoke() failed\n");
+            return 1;
+        }
+    }
+    memcpy(scores, interpreter.output(0)->data.int8, kCategoryCount);
+    return 0;
+}
+
+/**
+ * Prints the mean time of every layer with the reference and the optimized
+ * int8 kernels.
+ *
+ * @return 2 if the two kernels score the image differently.
+ */
+int RunLayerBenchmark(int iterations, int warmup)
+{
+    alignas(16) static uint8_t reference_arena[kLayerArenaSize];
+    alignas(16) static uint8_t optimized_arena[kLayerArenaSize];
+
+    tflite::MicroMutableOpResolver<5> reference_resolver;
+    reference_resolver.AddAveragePool2D();
+    reference_resolver.AddConv2D(tflite::Register_CONV_2D_INT8REF());
+    reference_resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D_INT8REF());
+    reference_resolver.AddReshape();
+    reference_resolver.AddSoftmax(tflite::Register_SOFTMAX());
+
+    tflite::MicroMutableOpResolver<5> optimized_resolver;
+    optimized_resolver.AddAveragePool2D();
+    optimized_resolver.AddConv2D(tflite::Register_CONV_2D());
+    optimized_resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    optimized_resolver.AddReshape();
+    optimized_resolver.AddSoftmax(tflite::Register_SOFTMAX());
+
+    static LayerProfiler reference;
+    static LayerProfiler optimized;
+    int8_t reference_scores[kCategoryCount];
+    int8_t optimized_scores[kCategoryCount];
+    if (ProfileLayers(reference_resolver, reference_arena, g_person_image_data,
+                      iterations, warmup, &reference, reference_scores) != 0 ||
+        ProfileLayers(optimized_resolver, optimized_arena, g_person_image_data,
+                      iterations, warmup, &optimized, optimized_scores) != 0) {
+        return 1;
+    }
+
+    printf("%-5s %-18s %10s %10s %8s\n", "layer", "op", "ref_us", "opt_us", "speedup");
+    uint64_t reference_total = 0;
+    uint64_t optimized_total = 0;
+    const int layers = std::min(reference.layers(), optimized.layers());
+    for (int i = 0; i < layers; ++i) {
+        const double reference_us = reference.total_ns(i) / 1e3 / iterations;
+        const double optimized_us = optimized.total_ns(i) / 1e3 / iterations;
+        reference_total += reference.total_ns(i);
+        optimized_total += optimized.total_ns(i);
+        printf("%-5d %-18s %10.1f %10.1f %7.2fx\n", i, optimized.tag(i),
+               reference_us, optimized_us,
+               (optimized_us > 0.0) ? reference_us / optimized_us : 0.0);
+    }
+    const double reference_us = reference_total / 1e3 / iterations;
+    const double optimized_us = optimized_total / 1e3 / iterations;
+    printf("%-5s %-18s %10.1f %10.1f %7.2fx\n", "total", "", reference_us,
+           optimized_us, (optimized_us > 0.0) ? reference_us / optimized_us : 0.0);
+    if (memcmp(reference_scores, optimized_scores, kCategoryCount) != 0) {
+        printf("optimized kernels score %d/%d, reference kernels %d/%d\n",
+               optimized_scores[kPersonIndex], optimized_scores[kNotAPersonIndex],
+               reference_scores[kPersonIndex], reference_scores[kNotAPersonIndex]);
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * Sets the model up with the optimized kernels through a
+ * RecordingMicroInterpreter and prints how the arena is used.
+ */
+int RunMemoryReport()
+{
+    alignas(16) static uint8_t arena[kLayerArenaSize];
+    static tflite::MicroErrorReporter error_reporter;
+
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+
+    const tflite::Model* model = tflite::GetModel(g_person_detect_model_data);
+    tflite::RecordingMicroInterpreter interpreter(model, resolver, arena,
+                                                  kLayerArenaSize, &error_reporter);
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+
+    const tflite::RecordingMicroAllocator& allocator = interpreter.GetMicroAllocator();
+    allocator.PrintAllocations();
+    const tflite::RecordedAllocation persistent = allocator.GetRecordedAllocation(
+        tflite::RecordedAllocationType::kPersistentBufferData);
+#if defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+    printf("filter packing:           off\n");
+#else
+    printf("filter packing:           on\n");
+#endif
+    printf("persistent buffers:       %zu bytes in %zu allocations\n",
+           persistent.used_bytes, persistent.count);
+    printf("arena used:               %zu bytes\n", interpreter.arena_used_bytes());
+    return 0;
+}
+
+/**
+ * Runs the model with the optimized kernels under an AggregatingProfiler and
+ * prints its report.
+ */
+int RunProfileReport(int iterations, int warmup, bool csv)
+{
+    alignas(16) static uint8_t arena[kLayerArenaSize];
+    static tflite::MicroErrorReporter error_reporter;
+
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+
+    const tflite::Model* model = tflite::GetModel(g_person_detect_model_data);
+    static tflite::AggregatingProfiler profiler;
+    profiler.Init(model);
+    tflite::MicroInterpreter interpreter(model, resolver, arena, kLayerArenaSize,
+                                         &error_reporter, &profiler);
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+    memcpy(interpreter.input(0)->data.int8, g_person_image_data,
+           kNumCols * kNumRows * kNumChannels);
+
+    for (int i = 0; i < warmup + iterations; ++i) {
+        if (i == warmup) {
+            profiler.Reset();
+        }
+        if (interpreter.Invoke() != kTfLiteOk) {
+            fprintf(stderr, "Invoke() failed\n");
+            return 1;
+        }
+    }
+    profiler.LogTable();
+    if (csv) {
+        profiler.LogCsv();
+    }
+    return profiler.num_invokes() == iterations ? 0 : 1;
+}
+
+// Frame size of the camera mode used by main.c.
+constexpr int kCameraWidth = 400;
+constexpr int kCameraHeight = 300;
+constexpr int kSyntheticFrames = 8;
+
+struct FrameFormat {
+    const char* name;
+    preprocess_format_t format;
+    // Bytes read per bilinear tap.
+    int tap_bytes;
+};
+
+const FrameFormat kFrameFormats[] = {
+    {"rgba", PREPROCESS_FORMAT_RGBA8888, 4},
+    {"yuv420", PREPROCESS_FORMAT_YUV420, 1},
+    {"yuyv", PREPROCESS_FORMAT_YUYV, 1},
+    {"uyvy", PREPROCESS_FORMAT_UYVY, 1},
+    {"gray", PREPROCESS_FORMAT_GRAY8, 1},
+};
+
+/**
+ * Loads recorded raw frames, or renders kSyntheticFrames synthetic ones when
+ * path is null, in which the scene moves every hold frames.
+ *
+ * @return Number of frames, 0 if the file holds no complete frame.
+ */
+int LoadFrames(const char* path, const preprocess_frame_t& layout,
+               std::vector<uint8_t>* frames, int hold = 1)
+{
+    const size_t frame_size = preprocess_frame_size(&layout);
+    if (path == nullptr) {
+        std::vector<uint32_t> scene(kCameraWidth * kCameraHeight);
+        frames->assign(frame_size * kSyntheticFrames, 0);
+        for (int i = 0; i < kSyntheticFrames; ++i) {
+            host::RenderScene(kCameraWidth, kCameraHeight, i, scene.data(), hold);
+            host::PackFrame(scene.data(), layout, frames->data() + i * frame_size);
+        }
+        return kSyntheticFrames;
+    }
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 0;
+    }
+    frames->clear();
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        frames->insert(frames->end(), chunk, chunk + read);
+    }
+    fclose(file);
+    return static_cast<int>(frames->size() / frame_size);
+}
+
+/**
+ * Feeds frames of one format through preprocessing and inference and prints
+ * the latency of both stages.
+ */
+int RunFrameFormat(const FrameFormat& format, const char* path, int iterations,
+                   int warmup)
+{
+    model_input_t model_input;
+    if (get_model_input(&model_input) != 0) {
+        return 1;
+    }
+    const preprocess_frame_t layout = {format.format, kCameraWidth, kCameraHeight, 0};
+    preprocess_plan_t plan;
+    if (preprocess_plan_init(&plan, &layout, (kCameraWidth - kCameraHeight) / 2, 0,
+                             kCameraHeight, kCameraHeight, model_input.width,
+                             model_input.height) != 0) {
+        fprintf(stderr, "preprocess_plan_init() failed\n");
+        return 1;
+    }
+    std::vector<uint8_t> frames;
+    const int frame_count = LoadFrames(path, layout, &frames);
+    if (frame_count == 0) {
+        fprintf(stderr, "no %s frames of %dx%d\n", format.name, kCameraWidth, kCameraHeight);
+        return 1;
+    }
+    const size_t frame_size = preprocess_frame_size(&layout);
+
+    std::vector<uint64_t> preprocess_ns(iterations);
+    uint64_t preprocess_total = 0;
+    uint64_t invoke_total = 0;
+    int persons = 0;
+    for (int i = 0; i < warmup + iterations; ++i) {
+        const uint8_t* frame = frames.data() + (i % frame_count) * frame_size;
+        const uint64_t start = NowNs();
+        preprocess_frame_to_input(&plan, frame, model_input.data);
+        const uint64_t preprocessed = NowNs();
+        int8_t person_score = 0;
+        int8_t no_person_score = 0;
+        if (run_model(&person_score, &no_person_score) != 0) {
+            return 1;
+        }
+        const uint64_t end = NowNs();
+        if (i >= warmup) {
+            preprocess_ns[i - warmup] = preprocessed - start;
+            preprocess_total += preprocessed - start;
+            invoke_total += end - preprocessed;
+            persons += person_score > no_person_score;
+        }
+    }
+    std::sort(preprocess_ns.begin(), preprocess_ns.end());
+
+    const int tap_bytes = model_input.width * model_input.height * 4 * format.tap_bytes;
+    printf("%-8s %7d %9zu %9d %9.1f %9.1f %9.1f %9.1f %8d\n", format.name, frame_count,
+           frame_size, tap_bytes, preprocess_ns.front() / 1e3,
+           Percentile(preprocess_ns, 50) / 1e3, (preprocess_total / iterations) / 1e3,
+           (invoke_total / iterations) / 1e3, persons);
+    return 0;
+}
+
+/**
+ * Runs the camera path on one frame format, or on all of them.
+ */
+int RunFrameBenchmark(const char* format_name, const char* path, int iterations,
+                      int warmup)
+{
+    init_model();
+    printf("%-8s %7s %9s %9s %9s %9s %9s %9s %8s\n", "format", "frames", "frame_B",
+           "tap_B", "pre_min", "pre_p50", "pre_mean", "inv_mean", "persons");
+    bool found = false;
+    for (const FrameFormat& format : kFrameFormats) {
+        if ((strcmp(format_name, "all") != 0) && (strcmp(format_name, format.name) != 0)) {
+            continue;
+        }
+        found = true;
+        if (RunFrameFormat(format, path, iterations, warmup) != 0) {
+            return 1;
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "unknown frame format %s\n", format_name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Replays loaded frames as a pipeline_source_t, optionally paced like a
+ * sensor: frame i is not handed out before i * period_us.
+ */
+struct ReplaySource {
+    const uint8_t* frames;
+    size_t frame_size;
+    int frame_count;
+    int total;
+    int next;
+    uint32_t period_us;
+    uint64_t start_us;
+};
+
+int8_t ReplayGetFrame(void* context, const void** frame)
+{
+    ReplaySource* source = static_cast<ReplaySource*>(context);
+    if (source->next >= source->total) {
+        return -1;
+    }
+    if (source->period_us > 0) {
+        if (source->next == 0) {
+            source->start_us = os_time_us();
+        }
+        const uint64_t due = source->start_us +
+                             static_cast<uint64_t>(source->next) * source->period_us;
+        const uint64_t now = os_time_us();
+        if (due > now) {
+            os_sleep_us(static_cast<uint32_t>(due - now));
+        }
+    }
+    *frame = source->frames + (source->next % source->frame_count) * source->frame_size;
+    ++source->next;
+    return 0;
+}
+
+void ReplayReleaseFrame(void* context, const void* frame)
+{
+    (void)context;
+    (void)frame;
+}
+
+struct PersonCount {
+    uint32_t warmup;
+    int persons;
+};
+
+// Sink of the deferred log.
+void WriteStdout(void* context, const char* text, uint32_t length)
+{
+    (void)context;
+    fwrite(text, 1, length, stdout);
+}
+
+void CountPersons(void* context, uint32_t frame_index, int8_t person_score,
+                  int8_t no_person_score)
+{
+    PersonCount* count = static_cast<PersonCount*>(context);
+    if (frame_index >= count->warmup) {
+        count->persons += person_score > no_person_score;
+    }
+}
+
+/**
+ * Runs the frames of one format through capture, preprocessing and inference
+ * one stage after the other, then through the pipeline, and prints the
+ * steady-state throughput of both and the occupancy of every pipeline stage.
+ */
+int RunPipelineBenchmark(const char* format_name, const char* path, int iterations,
+                         int warmup, int sensor_fps, int gate_threshold, int hold, bool smooth)
+{
+    const FrameFormat* format = nullptr;
+    for (const FrameFormat& candidate : kFrameFormats) {
+        if (strcmp(format_name, candidate.name) == 0) {
+            format = &candidate;
+        }
+    }
+    if (format == nullptr) {
+        fprintf(stderr, "unknown frame format %s\n", format_name);
+        return 1;
+    }
+    init_model();
+    model_input_t model_input;
+    if (get_model_input(&model_input) != 0) {
+        return 1;
+    }
+    const preprocess_frame_t layout = {format->format, kCameraWidth, kCameraHeight, 0};
+    preprocess_plan_t plan;
+    if (preprocess_plan_init(&plan, &layout, (kCameraWidth - kCameraHeight) / 2, 0,
+                             kCameraHeight, kCameraHeight, model_input.width,
+                             model_input.height) != 0) {
+        fprintf(stderr, "preprocess_plan_init() failed\n");
+        return 1;
+    }
+    std::vector<uint8_t> frames;
+    const int frame_count = LoadFrames(path, layout, &frames, hold);
+    if (frame_count == 0) {
+        fprintf(stderr, "no %s frames of %dx%d\n", format->name, kCameraWidth, kCameraHeight);
+        return 1;
+    }
+    const uint32_t period_us = sensor_fps > 0 ? 1000000 / sensor_fps : 0;
+    const ReplaySource replay = {frames.data(), preprocess_frame_size(&layout), frame_count,
+                                 warmup + iterations, 0, period_us, 0};
+
+    const int input_size = kNumCols * kNumRows * kNumChannels;
+    std::vector<int8_t> gate_reference(input_size);
+    motion_gate_t gate;
+    if (gate_threshold >= 0) {
+        motion_gate_init(&gate, gate_reference.data(), input_size, gate_threshold,
+                         MOTION_GATE_DEFAULT_MAX_SKIP);
+    }
+    score_filter_config_t filter_config;
+    score_filter_default_config(&filter_config);
+    score_filter_t filter;
+    score_filter_init(&filter, &filter_config);
+
+    // Serial: every frame is captured, preprocessed and classified before the
+    // next one is taken.
+    ReplaySource serial_source = replay;
+    int serial_persons = 0;
+    int raw_changes = 0;
+    bool raw_person = false;
+    uint64_t serial_start = 0;
+    for (int i = 0; i < warmup + iterations; ++i) {
+        if (i == warmup) {
+            serial_start = os_time_us();
+        }
+        const void* frame = nullptr;
+        if (ReplayGetFrame(&serial_source, &frame) != 0) {
+            return 1;
+        }
+        preprocess_frame_to_input(&plan, frame, model_input.data);
+        int8_t person_score = 0;
+        int8_t no_person_score = 0;
+        if ((gate_threshold < 0) ||
+            motion_gate_check(&gate, model_input.data, &person_score, &no_person_score)) {
+            if (run_model(&person_score, &no_person_score) != 0) {
+                return 1;
+            }
+            if (gate_threshold >= 0) {
+                motion_gate_update(&gate, person_score, no_person_score);
+            }
+        }
+        if (i >= warmup) {
+            raw_changes += (person_score > no_person_score) != raw_person;
+        }
+        raw_person = person_score > no_person_score;
+        if (smooth) {
+            score_filter_update(&filter, person_score, no_person_score, &person_score,
+                                &no_person_score);
+        }
+        if (i >= warmup) {
+            serial_persons += person_score > no_person_score;
+        }
+    }
+    const uint64_t serial_us = os_time_us() - serial_start;
+
+    if (gate_threshold >= 0) {
+        motion_gate_init(&gate, gate_reference.data(), input_size, gate_threshold,
+                         MOTION_GATE_DEFAULT_MAX_SKIP);
+    }
+    const uint32_t serial_events = filter.events;
+    score_filter_init(&filter, &filter_config);
+    std::vector<int8_t> inputs(PIPELINE_INPUT_BUFFERS * input_size);
+    ReplaySource pipeline_source = replay;
+    PersonCount pipeline_persons = {static_cast<uint32_t>(warmup), 0};
+    pipeline_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.source.get_frame = ReplayGetFrame;
+    config.source.release_frame = ReplayReleaseFrame;
+    config.source.context = &pipeline_source;
+    config.plan = &plan;
+    for (int i = 0; i < PIPELINE_INPUT_BUFFERS; ++i) {
+        config.input_buffers[i] = inputs.data() + i * input_size;
+    }
+    config.gate = gate_threshold >= 0 ? &gate : nullptr;
+    config.filter = smooth ? &filter : nullptr;
+    config.on_result = CountPersons;
+    config.result_context = &pipeline_persons;
+    config.warmup_frames = warmup;
+    pipeline_stats_t stats;
+    if (pipeline_run(&config, &stats) != 0) {
+        fprintf(stderr, "pipeline_run() failed\n");
+        return 1;
+    }
+
+    printf("format %s, %d frames after %d warmup, sensor at %d fps (0: unpaced)\n",
+           format->name, iterations, warmup, sensor_fps);
+    printf("serial:   %.2f fps, %.1f us per frame\n", iterations * 1e6 / serial_us,
+           static_cast<double>(serial_us) / iterations);
+    pipeline_log_stats(&stats);
+    deferred_log_drain_text(WriteStdout, nullptr, 0);
+    printf("persons: serial %d, pipeline %d\n", serial_persons, pipeline_persons.persons);
+    if (gate_threshold >= 0) {
+        // Cost of the gate: one SAD over the model input per frame.
+        constexpr int kSadRuns = 1000;
+        uint32_t sink = 0;
+        const uint64_t start = NowNs();
+        for (int i = 0; i < kSadRuns; ++i) {
+            sink += motion_gate_sad(inputs.data(), inputs.data() + input_size, input_size);
+        }
+        const double sad_us = (NowNs() - start) / 1e3 / kSadRuns;
+        const double invoke_us =
+            stats.inferences > 0
+                ? static_cast<double>(stats.busy_us[PIPELINE_STAGE_INFERENCE]) / stats.inferences
+                : 0.0;
+        printf("gate: threshold %d, %u executed, %u skipped, SAD %.2f us (%.3f%% of an "
+               "inference, checksum %u)\n",
+               gate_threshold, gate.executed, gate.skipped, sad_us,
+               invoke_us > 0.0 ? 100.0 * sad_us / invoke_us : 0.0, sink & 0xff);
+    }
+    if (smooth) {
+        // Cost of the filter: one update per frame.
+        constexpr int kUpdates = 100000;
+        score_filter_t timed;
+        score_filter_init(&timed, &filter_config);
+        int8_t sink = 0;
+        const uint64_t start = NowNs();
+        for (int i = 0; i < kUpdates; ++i) {
+            const int8_t score = static_cast<int8_t>((i * 37) & 0xff);
+            int8_t smoothed = 0;
+            score_filter_update(&timed, score, static_cast<int8_t>(-1 - score), &smoothed,
+                                nullptr);
+            sink ^= smoothed;
+        }
+        const double update_ns = static_cast<double>(NowNs() - start) / kUpdates;
+        printf("filter: alpha %u/256, %d raw decision changes, %u person-present changes "
+               "(serial %u), update %.1f ns (checksum %d)\n",
+               filter_config.alpha, raw_changes, filter.events, serial_events, update_ns, sink);
+    }
+    return (stats.frames == static_cast<uint32_t>(iterations)) &&
+                   (serial_persons == pipeline_persons.persons) &&
+                   (!smooth || filter.events == serial_events)
+               ? 0
+               : 1;
+}
+
+/**
+ * Localizes people in every frame of one format with a three scale sliding
+ * window and prints throughput, pyramid cost and per-window latency.
+ */
+int RunLocalizeBenchmark(const char* format_name, const char* path, int iterations,
+                         int warmup)
+{
+    static const int kWindowSizes[] = {300, 200, 150};
+    const int scales = sizeof(kWindowSizes) / sizeof(kWindowSizes[0]);
+    const FrameFormat* format = nullptr;
+    for (const FrameFormat& candidate : kFrameFormats) {
+        if (strcmp(format_name, candidate.name) == 0) {
+            format = &candidate;
+        }
+    }
+    if (format == nullptr) {
+        fprintf(stderr, "unknown frame format %s\n", format_name);
+        return 1;
+    }
+    init_model();
+    model_input_t model_input;
+    if (get_model_input(&model_input) != 0) {
+        return 1;
+    }
+    const preprocess_frame_t layout = {format->format, kCameraWidth, kCameraHeight, 0};
+    std::vector<int8_t> pyramid(
+        localize_pyramid_size(&layout, kWindowSizes, scales, model_input.width));
+    static localize_t localize;
+    if (localize_init(&localize, &layout, kWindowSizes, scales, model_input.width,
+                      pyramid.data()) != 0) {
+        fprintf(stderr, "localize_init() failed\n");
+        return 1;
+    }
+    std::vector<uint8_t> frames;
+    const int frame_count = LoadFrames(path, layout, &frames);
+    if (frame_count == 0) {
+        fprintf(stderr, "no %s frames of %dx%d\n", format->name, kCameraWidth, kCameraHeight);
+        return 1;
+    }
+    const size_t frame_size = preprocess_frame_size(&layout);
+    const uint32_t windows = localize_window_count(&localize);
+
+    // Same windows, each preprocessed from the frame with its own plan.
+    static preprocess_plan_t window_plan;
+    uint64_t separate_ns = 0;
+    for (int i = 0; i < iterations; ++i) {
+        const uint8_t* frame = frames.data() + (i % frame_count) * frame_size;
+        for (int s = 0; s < scales; ++s) {
+            const localize_level_t& level = localize.levels[s];
+            for (int row = 0; row < level.rows; ++row) {
+                for (int column = 0; column < level.columns; ++column) {
+                    const int size = level.window_size;
+                    const int x = (level.columns > 1)
+                                      ? column * (kCameraWidth - size) / (level.columns - 1)
+                                      : 0;
+                    const int y = (level.rows > 1)
+                                      ? row * (kCameraHeight - size) / (level.rows - 1)
+                                      : 0;
+                    const uint64_t start = NowNs();
+                    preprocess_plan_init(&window_plan, &layout, x, y, size, size,
+                                         model_input.width, model_input.height);
+                    preprocess_frame_to_input(&window_plan, frame, model_input.data);
+                    separate_ns += NowNs() - start;
+                }
+            }
+        }
+    }
+
+    std::vector<uint64_t> frame_ns(iterations);
+    uint64_t pyramid_ns = 0;
+    uint64_t windows_ns = 0;
+    localize_result_t result;
+    for (int i = 0; i < warmup + iterations; ++i) {
+        const uint8_t* frame = frames.data() + (i % frame_count) * frame_size;
+        const uint64_t start = NowNs();
+        localize_build_pyramid(&localize, frame);
+        const uint64_t built = NowNs();
+        if (localize_run(&localize, &model_input, &result) != 0) {
+            return 1;
+        }
+        const uint64_t end = NowNs();
+        if (i >= warmup) {
+            frame_ns[i - warmup] = end - start;
+            pyramid_ns += built - start;
+            windows_ns += end - built;
+        }
+    }
+    std::sort(frame_ns.begin(), frame_ns.end());
+    uint64_t total_ns = 0;
+    for (uint64_t ns : frame_ns) {
+        total_ns += ns;
+    }
+
+    printf("format %s, %d scales, %u windows per frame\n", format->name, scales, windows);
+    for (int s = 0; s < scales; ++s) {
+        const localize_level_t& level = localize.levels[s];
+        printf("  window %3d px: level %dx%d, %dx%d windows\n", level.window_size,
+               level.width, level.height, level.columns, level.rows);
+    }
+    printf("frame:    %.2f fps, p50 %.1f us, mean %.1f us\n", iterations * 1e9 / total_ns,
+           Percentile(frame_ns, 50) / 1e3, total_ns / 1e3 / iterations);
+    printf("pyramid:  %.1f us per frame (each window preprocessed separately: %.1f us)\n",
+           pyramid_ns / 1e3 / iterations, separate_ns / 1e3 / iterations);
+    printf("window:   %.1f us mean latency (copy and inference)\n",
+           windows_ns / 1e3 / iterations / windows);
+    printf("best:     x %d y %d size %d, person %d no_person %d\n", result.best.x,
+           result.best.y, result.best.size, result.best.person_score,
+           result.best.no_person_score);
+    return 0;
+}
+
+// Arena of the batched interpreter, enough for a batch of kMaxBenchBatch.
+constexpr int kMaxBenchBatch = 8;
+constexpr int kBatchArenaSize = 1024 * 1024;
+
+/**
+ * Arena bytes the model needs for a batch, from an interpreter of its own.
+ */
+size_t BatchArenaUsed(int batch_size, uint8_t* arena)
+{
+    static tflite::MicroErrorReporter error_reporter;
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+
+    const tflite::Model* model = tflite::GetModel(g_person_detect_model_data);
+    tflite::MicroInterpreter interpreter(model, resolver, arena, kBatchArenaSize,
+                                         &error_reporter);
+    if (interpreter.SetBatchSize(batch_size) != kTfLiteOk ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return 0;
+    }
+    return interpreter.arena_used_bytes();
+}
+
+/**
+ * Classifies batches of 1, 2, 4 and 8 images with run_model_batch() and
+ * prints latency and throughput per batch size. The batches alternate the
+ * person and no person images, whose labels are checked.
+ */
+int RunBatchBenchmark(int iterations, int warmup)
+{
+    static const int kBatchSizes[] = {1, 2, 4, kMaxBenchBatch};
+    alignas(16) static uint8_t arena[kBatchArenaSize];
+    const int image_size = kNumCols * kNumRows * kNumChannels;
+    init_model();
+
+    std::vector<int8_t> images(kMaxBenchBatch * image_size);
+    for (int i = 0; i < kMaxBenchBatch; ++i) {
+        memcpy(images.data() + i * image_size,
+               (i % 2 == 0) ? g_person_image_data : g_no_person_image_data, image_size);
+    }
+
+    printf("%5s %9s %9s %9s %10s %9s\n", "batch", "arena_kb", "p50_us", "image_us",
+           "images/s", "speedup");
+    int mismatches = 0;
+    double single_rate = 0.0;
+    std::vector<uint64_t> latencies(iterations);
+    for (int batch_size : kBatchSizes) {
+        const size_t arena_used = BatchArenaUsed(batch_size, arena);
+        if (init_model_batch(batch_size, arena, kBatchArenaSize) != 0) {
+            return 1;
+        }
+        int8_t person[kMaxBenchBatch];
+        int8_t no_person[kMaxBenchBatch];
+        for (int i = 0; i < warmup + iterations; ++i) {
+            const uint64_t start = NowNs();
+            if (run_model_batch(images.data(), batch_size, person, no_person) != 0) {
+                return 1;
+            }
+            if (i >= warmup) {
+                latencies[i - warmup] = NowNs() - start;
+            }
+        }
+        for (int i = 0; i < batch_size; ++i) {
+            if ((person[i] > no_person[i]) != (i % 2 == 0)) {
+                ++mismatches;
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        uint64_t total_ns = 0;
+        for (uint64_t ns : latencies) {
+            total_ns += ns;
+        }
+        const double rate = static_cast<double>(iterations) * batch_size * 1e9 / total_ns;
+        if (batch_size == 1) {
+            single_rate = rate;
+        }
+        printf("%5d %9.1f %9.1f %9.1f %10.1f %8.2fx\n", batch_size, arena_used / 1024.0,
+               Percentile(latencies, 50) / 1e3, total_ns / 1e3 / iterations / batch_size,
+               rate, rate / single_rate);
+    }
+    if (mismatches != 0) {
+        printf("%d misclassified images\n", mismatches);
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * Runs the first num_ops layers in patches of several heights, and layer by
+ * layer for comparison, and prints the arena each needs and the latency of a
+ * person and a no person image. The scores must not change.
+ */
+int RunPatchBenchmark(int num_ops, int iterations, int warmup)
+{
+    // 0 rows is layer by layer.
+    static const int kPatchRows[] = {0, 1, 2, 4, 8, 12, 24};
+    alignas(16) static uint8_t arena[kLayerArenaSize];
+    static tflite::MicroErrorReporter error_reporter;
+    const int image_size = kNumCols * kNumRows * kNumChannels;
+
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    const tflite::Model* model = tflite::GetModel(g_person_detect_model_data);
+
+    printf("%d ops in patches\n", num_ops);
+    printf("%7s %9s %9s %9s %9s %9s\n", "rows", "arena_kb", "saved_kb", "p50_us", "mean_us",
+           "overhead");
+    int8_t scores[2][2] = {};
+    size_t layered_arena = 0;
+    double layered_mean = 0.0;
+    int mismatches = 0;
+    std::vector<uint64_t> latencies(2 * iterations);
+    for (int patch_rows : kPatchRows) {
+        tflite::MicroInterpreter interpreter(model, resolver, arena, kLayerArenaSize,
+                                             &error_reporter);
+        if (interpreter.SetPatchExecution(patch_rows > 0 ? num_ops : 0, patch_rows) !=
+                kTfLiteOk ||
+            interpreter.AllocateTensors() != kTfLiteOk) {
+            fprintf(stderr, "AllocateTensors() failed\n");
+            return 1;
+        }
+        TfLiteTensor* output = interpreter.output(0);
+        uint64_t total_ns = 0;
+        int samples = 0;
+        for (int i = 0; i < warmup + iterations; ++i) {
+            for (int image = 0; image < 2; ++image) {
+                // The input is consumed by each inference.
+                memcpy(interpreter.input(0)->data.int8,
+                       image == 0 ? g_person_image_data : g_no_person_image_data, image_size);
+                const uint64_t start = NowNs();
+                if (interpreter.Invoke() != kTfLiteOk) {
+                    fprintf(stderr, "Invoke() failed\n");
+                    return 1;
+                }
+                if (i >= warmup) {
+                    latencies[samples] = NowNs() - start;
+                    total_ns += latencies[samples++];
+                }
+                const int8_t person = output->data.int8[kPersonIndex];
+                const int8_t no_person = output->data.int8[kNotAPersonIndex];
+                if (patch_rows == 0) {
+                    scores[image][0] = person;
+                    scores[image][1] = no_person;
+                } else if (person != scores[image][0] || no_person != scores[image][1]) {
+                    ++mismatches;
+                }
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        const size_t arena_used = interpreter.arena_used_bytes();
+        const double mean = total_ns / 1e3 / samples;
+        if (patch_rows == 0) {
+            layered_arena = arena_used;
+            layered_mean = mean;
+            printf("%7s", "layer");
+        } else {
+            printf("%7d", patch_rows);
+        }
+        printf(" %9.1f %9.1f %9.1f %9.1f %8.1f%%\n", arena_used / 1024.0,
+               (static_cast<double>(layered_arena) - arena_used) / 1024.0,
+               Percentile(latencies, 50) / 1e3, mean, (mean / layered_mean - 1.0) * 100.0);
+    }
+    if (mismatches != 0) {
+        printf("%d inferences scored differently in patches\n", mismatches);
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * Plans the arena of several configurations of the model with both memory
+ * planners and prints the arena each needs and the AllocateTensors() time.
+ * The scores of the search planner's arena must match the greedy one's.
+ */
+int RunPlannerReport(int iterations)
+{
+    struct Config {
+        const char* name;
+        int batch_size;
+        int patch_ops;
+        int patch_rows;
+    };
+    static const Config kConfigs[] = {
+        {"layer", 1, 0, 0},   {"batch2", 2, 0, 0},    {"batch4", 4, 0, 0},
+        {"patch4x1", 1, 4, 1}, {"patch4x4", 1, 4, 4}, {"patch8x4", 1, 8, 4},
+    };
+    static const tflite::MemoryPlannerType kPlanners[] = {
+        tflite::MemoryPlannerType::kGreedy,
+        tflite::MemoryPlannerType::kSearch,
+    };
+    alignas(16) static uint8_t arena[kBatchArenaSize];
+    static tflite::MicroErrorReporter error_reporter;
+    const int image_size = kNumCols * kNumRows * kNumChannels;
+
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    const tflite::Model* model = tflite::GetModel(g_person_detect_model_data);
+
+    printf("%-9s %10s %10s %9s %10s %10s\n", "config", "greedy_kb", "search_kb", "saved_kb",
+           "greedy_us", "search_us");
+    int mismatches = 0;
+    for (const Config& config : kConfigs) {
+        size_t arena_used[2] = {};
+        double allocate_us[2] = {};
+        int8_t scores[2][2] = {};
+        for (int planner = 0; planner < 2; ++planner) {
+            uint64_t total_ns = 0;
+            for (int i = 0; i < iterations; ++i) {
+                tflite::MicroInterpreter interpreter(model, resolver, arena, kBatchArenaSize,
+                                                     &error_reporter);
+                if (interpreter.SetBatchSize(config.batch_size) != kTfLiteOk ||
+                    interpreter.SetPatchExecution(config.patch_ops, config.patch_rows) !=
+                        kTfLiteOk ||
+                    interpreter.SetMemoryPlanner(kPlanners[planner]) != kTfLiteOk) {
+                    fprintf(stderr, "Cannot configure %s\n", config.name);
+                    return 1;
+                }
+                const uint64_t start = NowNs();
+                if (interpreter.AllocateTensors() != kTfLiteOk) {
+                    fprintf(stderr, "AllocateTensors() failed\n");
+                    return 1;
+                }
+                total_ns += NowNs() - start;
+                if (i > 0) {
+                    continue;
+                }
+                arena_used[planner] = interpreter.arena_used_bytes();
+                // A person image first in the batch, the other images are
+                // whatever the arena holds.
+                memcpy(interpreter.input(0)->data.int8, g_person_image_data, image_size);
+                if (interpreter.Invoke() != kTfLiteOk) {
+                    fprintf(stderr, "Invoke() failed\n");
+                    return 1;
+                }
+                scores[planner][0] = interpreter.output(0)->data.int8[kPersonIndex];
+                scores[planner][1] = interpreter.output(0)->data.int8[kNotAPersonIndex];
+            }
+            allocate_us[planner] = total_ns / 1e3 / iterations;
+        }
+        if (scores[0][0] != scores[1][0] || scores[0][1] != scores[1][1]) {
+            ++mismatches;
+        }
+        printf("%-9s %10.1f %10.1f %9.1f %10.1f %10.1f\n", config.name, arena_used[0] / 1024.0,
+               arena_used[1] / 1024.0,
+               (static_cast<double>(arena_used[0]) - arena_used[1]) / 1024.0, allocate_us[0],
+               allocate_us[1]);
+    }
+    if (mismatches != 0) {
+        printf("%d configurations scored differently with the search planner\n", mismatches);
+        return 2;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    int iterations = 50;
+    int warmup = 2;
+    bool layers = false;
+    bool memory = false;
+    bool profile = false;
+    bool csv = false;
+    const char* frame_format = nullptr;
+    const char* frame_path = nullptr;
+    bool pipeline = false;
+    int sensor_fps = 0;
+    int gate_threshold = -1;
+    int hold = 1;
+    bool smooth = false;
+    bool localize = false;
+    bool batch = false;
+    int patch_ops = 0;
+    bool planners = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+            iterations = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            layers = true;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            memory = true;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            csv = true;
+        } else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc)) {
+            frame_format = argv[++i];
+        } else if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc)) {
+            frame_path = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0) {
+            pipeline = true;
+        } else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+            sensor_fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-L") == 0) {
+            localize = true;
+        } else if (strcmp(argv[i], "-B") == 0) {
+            batch = true;
+        } else if ((strcmp(argv[i], "-T") == 0) && (i + 1 < argc)) {
+            patch_ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-M") == 0) {
+            planners = true;
+        } else if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc)) {
+            gate_threshold = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-H") == 0) && (i + 1 < argc)) {
+            hold = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-S") == 0) {
+            smooth = true;
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0 || warmup < 0 || hold <= 0 || patch_ops < 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (layers) {
+        return RunLayerBenchmark(iterations, warmup);
+    }
+    if (memory) {
+        return RunMemoryReport();
+    }
+    if (profile) {
+        return RunProfileReport(iterations, warmup, csv);
+    }
+    if (batch) {
+        return RunBatchBenchmark(iterations, warmup);
+    }
+    if (planners) {
+        return RunPlannerReport(iterations);
+    }
+    if (patch_ops > 0) {
+        return RunPatchBenchmark(patch_ops, iterations, warmup);
+    }
+    if (localize) {
+        return RunLocalizeBenchmark(frame_format != nullptr ? frame_format : "yuv420",
+                                    frame_path, iterations, warmup);
+    }
+    if (pipeline) {
+        return RunPipelineBenchmark(frame_format != nullptr ? frame_format : "yuv420",
+                                    frame_path, iterations, warmup, sensor_fps,
+                                    gate_threshold, hold, smooth);
+    }
+    if (frame_format != nullptr) {
+        return RunFrameBenchmark(frame_format, frame_path, iterations, warmup);
+    }
+
+    init_model();
+
+    printf("%-12s %7s %9s %9s %9s %9s %9s %9s %9s\n", "image", "person", "no_person",
+           "min_us", "p50_us", "p90_us", "p99_us", "max_us", "mean_us");
+
+    int mismatches = 0;
+    std::vector<uint64_t> latencies(iterations);
+    for (const BenchImage& image : kImages) {
+        int8_t person_score = 0;
+        int8_t no_person_score = 0;
+
+        // test_image_data.cc only holds a placeholder until an image is
+        // converted into it, in which case image_tester() rejects it.
+        int8_t status = image_tester(image.data, &person_score, &no_person_score);
+        if (status == -2) {
+            printf("%-12s skipped (no image data)\n", image.name);
+            continue;
+        } else if (status != 0) {
+            return 1;
+        }
+        for (int i = 0; i < warmup; ++i) {
+            if (image_tester(image.data, &person_score, &no_person_score) != 0) {
+                return 1;
+            }
+        }
+
+        uint64_t total = 0;
+        for (int i = 0; i < iterations; ++i) {
+            const uint64_t start = NowNs();
+            if (image_tester(image.data, &person_score, &no_person_score) != 0) {
+                return 1;
+            }
+            latencies[i] = NowNs() - start;
+            total += latencies[i];
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        printf("%-12s %7d %9d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", image.name,
+               person_score, no_person_score,
+               latencies.front() / 1e3, Percentile(latencies, 50) / 1e3,
+               Percentile(latencies, 90) / 1e3, Percentile(latencies, 99) / 1e3,
+               latencies.back() / 1e3, (total / iterations) / 1e3);
+
+        if ((image.expected_person >= 0) &&
+            ((person_score > no_person_score) != (image.expected_person == 1))) {
+            printf("%-12s misclassified\n", image.name);
+            ++mismatches;
+        }
+    }
+
+    return (mismatches == 0) ? 0 : 2;
+}
@@ -1,4 +1,4 @@
-/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+/* Copyright 2024 All Rights Reserved.
 
 Licensed under the Apache License, Version 2.0 (the "License");
 you may not use this file except in compliance with the License.
@@ -13,17 +13,15 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "image_provider.h"
+// POSIX implementation of DebugLog() for the host build. Log output goes to
+// stderr so that it never interleaves with the results a host tool writes to
+// stdout.
 
-#include "model_settings.h"
+#include "tensorflow/lite/micro/debug_log.h"
 
-extern uint32_t g_image_buf[];
+#include <cstdio>
 
-TfLiteStatus GetImage(int image_width, int image_height, int channels,
-                      int8_t* image_data) {
-  memcpy(image_data, g_image_buf, image_width * image_height * channels);
-  return kTfLiteOk;
+extern "C" void DebugLog(const char *s)
+{
+    fputs(s, stderr);
 }
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Decodes the hex records of the deferred log in a console capture.
+
+Firmware built with DEFERRED_LOG_HEX writes every deferred log record
+(deferred_log.h) as a line of '~' and its 32 bit words in hex instead of
+formatting it on the board. This script formats those lines with the format
+strings of deferred_log_formats.h and passes every other line through, so a
+capture of the serial console reads like the formatted log.
+
+Usage:
+    python3 decode_log.py [-f deferred_log_formats.h] [-t] [-o decoded.txt] [capture.txt]
+
+The capture is read from stdin if no file is given. With -t every decoded
+line starts with the record's timestamp in milliseconds.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+RECORD_VALID = 0x80000000
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)([diouxXcs%])")
+ESCAPES = {"n": "\n", "r": "\r", "t": "\t", "\\": "\\", '"': '"', "'": "'", "0": "\0"}
+
+
+def load_formats(path):
+    """Returns the format strings of the DEFERRED_LOG_FORMATS table in order."""
+    with open(path) as header:
+        source = header.read().replace("\\\n", "\n")
+    formats = []
+    for match in re.finditer(r"X\(\s*(\w+)\s*,((?:\s*\"(?:[^\"\\]|\\.)*\")+)\s*\)", source):
+        literals = re.findall(r"\"((?:[^\"\\]|\\.)*)\"", match.group(2))
+        text = "".join(literals)
+        formats.append(re.sub(r"\\(.)", lambda m: ESCAPES.get(m.group(1), m.group(1)), text))
+    if not formats:
+        sys.exit("no formats in %s" % path)
+    return formats
+
+
+def format_record(formats, words):
+    """Formats one record: header, timestamp and payload words."""
+    header = words[0]
+    record_id = header & 0xFFFF
+    payload = words[2:2 + ((header >> 16) & 0xFF)]
+    if record_id == 0:
+        # DLOG_TEXT: byte count, then the bytes four to a word.
+        length = payload[0]
+        data = b"".join(word.to_bytes(4, "little") for word in payload[1:])
+        return data[:length].decode("utf-8", "replace")
+    if record_id >= len(formats):
+        return "[unknown log record %d]\r\n" % record_id
+    args = iter(payload)
+
+    def convert(match):
+        flags, kind = match.groups()
+        if kind == "%":
+            return "%"
+        value = next(args, 0)
+        if kind in "di" and value >= 0x80000000:
+            value -= 1 << 32
+        if kind == "u":
+            kind = "d"
+        return ("%" + flags + kind) % value
+
+    return CONVERSION.sub(convert, formats[record_id])
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="console capture, stdin if omitted")
+    parser.add_argument("-f", "--formats",
+                        default=os.path.join(here, "..", "deferred_log_formats.h"),
+                        help="deferred_log_formats.h of the firmware")
+    parser.add_argument("-t", "--timestamps", action="store_true",
+                        help="prefix decoded lines with their timestamp")
+    parser.add_argument("-o", "--output", help="output file, stdout if omitted")
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+    capture = open(args.capture, "rb") if args.capture else sys.stdin.buffer
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    for raw in capture:
+        line = raw.decode("utf-8", "replace")
+        words = None
+        if line.startswith("~"):
+            try:
+                words = [int(word, 16) for word in line[1:].split()]
+            except ValueError:
+                words = None
+        if not words or len(words) < 2 or not words[0] & RECORD_VALID:
+            output.write(line)
+            continue
+        text = format_record(formats, words)
+        if args.timestamps:
+            text = "[%10.3f ms] %s" % (words[1] / 1000.0, text)
+        output.write(text)
+    if args.output:
+        output.close()
+
+
+if __name__ == "__main__":
+    main()
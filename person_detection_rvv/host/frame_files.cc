@@ -0,0 +1,276 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "host/frame_files.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace host {
+
+MappedFile::MappedFile(MappedFile &&other) : data_(other.data_), size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+    if (this != &other) {
+        Close();
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Close()
+{
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedFile::Open(const char *path, bool sequential)
+{
+    Close();
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, st.st_size, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+    data_ = static_cast<const uint8_t *>(data);
+    size_ = st.st_size;
+    return true;
+}
+
+namespace {
+
+// Reads the next decimal header field of a PGM, skipping whitespace and
+// comments. Returns false at the end of data or on anything but digits.
+bool NextPgmField(const uint8_t *data, size_t size, size_t *pos, int *value)
+{
+    while (*pos < size) {
+        if (data[*pos] == '#') {
+            while (*pos < size && data[*pos] != '\n') {
+                ++*pos;
+            }
+        } else if (isspace(data[*pos])) {
+            ++*pos;
+        } else {
+            break;
+        }
+    }
+    if (*pos >= size || !isdigit(data[*pos])) {
+        return false;
+    }
+    long parsed = 0;
+    while (*pos < size && isdigit(data[*pos]) && parsed <= 65535) {
+        parsed = parsed * 10 + (data[*pos] - '0');
+        ++*pos;
+    }
+    *value = static_cast<int>(parsed);
+    return parsed <= 65535;
+}
+
+bool HasSuffix(const std::string &name, const char *suffix)
+{
+    const size_t length = strlen(suffix);
+    return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+}
+
+std::string BaseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash != nullptr ? slash + 1 : path;
+}
+
+// Adds the frames of one mapped file. A .pgm is one image; otherwise the
+// file holds one raw frame (as_video false) or as many as fit.
+bool AddFile(const char *path, bool as_video, const preprocess_frame_t &raw_layout,
+             std::vector<MappedFile> *files, std::vector<Frame> *frames, std::string *error)
+{
+    const std::string name = BaseName(path);
+    const bool pgm = HasSuffix(name, ".pgm");
+    MappedFile file;
+    if (!file.Open(path, as_video && !pgm)) {
+        *error = std::string("cannot map ") + path;
+        return false;
+    }
+    if (pgm) {
+        int width = 0;
+        int height = 0;
+        const size_t offset = ParsePgmHeader(file.data(), file.size(), &width, &height);
+        if (offset == 0) {
+            *error = std::string("not an 8 bit binary PGM: ") + path;
+            return false;
+        }
+        frames->push_back({name, file.data() + offset,
+                           {PREPROCESS_FORMAT_GRAY8, width, height, 0}});
+    } else {
+        const size_t frame_size = preprocess_frame_size(&raw_layout);
+        const size_t count = file.size() / frame_size;
+        if (count == 0) {
+            *error = std::string("no complete frame in ") + path;
+            return false;
+        }
+        if (!as_video) {
+            frames->push_back({name, file.data(), raw_layout});
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                frames->push_back({name + "#" + std::to_string(i),
+                                   file.data() + i * frame_size, raw_layout});
+            }
+        }
+    }
+    files->push_back(std::move(file));
+    return true;
+}
+
+} // namespace
+
+size_t ParsePgmHeader(const uint8_t *data, size_t size, int *width, int *height)
+{
+    if (size < 2 || data[0] != 'P' || data[1] != '5') {
+        return 0;
+    }
+    size_t pos = 2;
+    int max_value = 0;
+    if (!NextPgmField(data, size, &pos, width) || !NextPgmField(data, size, &pos, height) ||
+        !NextPgmField(data, size, &pos, &max_value)) {
+        return 0;
+    }
+    // A single whitespace byte separates the header from the pixels.
+    if (pos >= size || !isspace(data[pos]) || max_value < 1 || max_value > 255 ||
+        *width <= 0 || *height <= 0) {
+        return 0;
+    }
+    ++pos;
+    if (size - pos < static_cast<size_t>(*width) * static_cast<size_t>(*height)) {
+        return 0;
+    }
+    return pos;
+}
+
+bool CollectFrames(const char *path, const preprocess_frame_t &raw_layout,
+                   std::vector<MappedFile> *files, std::vector<Frame> *frames,
+                   std::string *error)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        *error = std::string("cannot open ") + path;
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return AddFile(path, true, raw_layout, files, frames, error);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == nullptr) {
+        *error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (HasSuffix(name, ".pgm") || HasSuffix(name, ".raw")) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const std::string &name : names) {
+        const std::string file_path = std::string(path) + "/" + name;
+        if (!AddFile(file_path.c_str(), false, raw_layout, files, frames, error)) {
+            return false;
+        }
+    }
+    if (frames->empty()) {
+        *error = std::string("no .pgm or .raw files in ") + path;
+        return false;
+    }
+    return true;
+}
+
+bool LoadLabels(const char *path, std::map<std::string, int> *labels, std::string *error)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        *error = std::string("cannot open ") + path;
+        return false;
+    }
+    char line[512];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != nullptr) {
+        ++line_number;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        char *comma = strrchr(line, ',');
+        const char *label = comma != nullptr ? comma + 1 : "";
+        int value = -1;
+        if (strcmp(label, "1") == 0 || strcmp(label, "person") == 0) {
+            value = 1;
+        } else if (strcmp(label, "0") == 0 || strcmp(label, "no_person") == 0) {
+            value = 0;
+        }
+        if (value < 0) {
+            // The first line may name the columns.
+            if (line_number == 1) {
+                continue;
+            }
+            *error = std::string(path) + ":" + std::to_string(line_number) + ": no label";
+            ok = false;
+            break;
+        }
+        *comma = '\0';
+        (*labels)[line] = value;
+    }
+    fclose(file);
+    return ok;
+}
+
+} // namespace host
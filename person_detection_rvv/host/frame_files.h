@@ -0,0 +1,111 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef PERSON_DETECTION_HOST_FRAME_FILES_H_
+#define PERSON_DETECTION_HOST_FRAME_FILES_H_
+
+// Recorded frames on disk for the offline runner: binary PGM images, raw
+// frames of a known layout, and raw videos of such frames back to back. Files
+// are memory-mapped read only, so frames are preprocessed straight from the
+// page cache without being read into buffers first.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "image_preprocess.h"
+
+namespace host {
+
+// Read-only mapping of a whole file, unmapped on destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile &&other);
+    MappedFile &operator=(MappedFile &&other);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    // Maps path; sequential tells the kernel the pages are read in order,
+    // as for a video, so it reads ahead.
+    bool Open(const char *path, bool sequential);
+
+    const uint8_t *data() const
+    {
+        return data_;
+    }
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    void Close();
+
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// One frame to classify.
+struct Frame {
+    // File name, with "#index" appended for the frames of a video.
+    std::string name;
+    const uint8_t *pixels;
+    preprocess_frame_t layout;
+};
+
+/**
+ * Parses the header of a binary (P5) PGM image with 8 bit samples.
+ *
+ * @return Offset of the first pixel, or 0 if data is no such image or holds
+ *         fewer than width * height pixels.
+ */
+size_t ParsePgmHeader(const uint8_t *data, size_t size, int *width, int *height);
+
+/**
+ * Maps the frames under path. A directory contributes its .pgm and .raw
+ * files in name order, one frame each. A .pgm file is one gray image; any
+ * other file is a raw video of frames in raw_layout back to back, and a
+ * trailing partial frame is ignored. Raw frames must hold
+ * preprocess_frame_size(raw_layout) bytes.
+ *
+ * @param path Directory or file.
+ * @param raw_layout Layout of .raw files and videos.
+ * @param files Receives the mappings, which must outlive frames.
+ * @param frames Receives the frames in order.
+ * @param error Receives the reason on failure.
+ *
+ * @return true if at least one frame was found.
+ */
+bool CollectFrames(const char *path, const preprocess_frame_t &raw_layout,
+                   std::vector<MappedFile> *files, std::vector<Frame> *frames,
+                   std::string *error);
+
+/**
+ * Loads "name,label" lines; a label is 1 or person, 0 or no_person. Empty
+ * lines, lines starting with '#' and a header line are skipped.
+ *
+ * @return false if the file cannot be read or a line has no valid label.
+ */
+bool LoadLabels(const char *path, std::map<std::string, int> *labels, std::string *error);
+
+} // namespace host
+
+#endif // PERSON_DETECTION_HOST_FRAME_FILES_H_
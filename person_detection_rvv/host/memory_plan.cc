@@ -0,0 +1,182 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "host/memory_plan.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/offline_memory_plan.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace host {
+namespace {
+
+// Room for the activations and the repacked filters of the model.
+constexpr size_t kArenaSize = 1024 * 1024;
+
+std::vector<uint8_t> Pack(const tflite::ModelT &model)
+{
+    flatbuffers::FlatBufferBuilder builder;
+    tflite::FinishModelBuffer(builder, tflite::Model::Pack(builder, &model));
+    return std::vector<uint8_t>(builder.GetBufferPointer(),
+                                builder.GetBufferPointer() + builder.GetSize());
+}
+
+// Allocates the tensors of model_data in arena; record, if not null, receives
+// the memory plan.
+bool Allocate(const uint8_t *model_data, tflite::MemoryPlannerType planner_type,
+              tflite::MemoryPlanRecord *record, uint8_t *arena, bool *offline_plan_used)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    static tflite::MicroErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(model_data), resolver, arena,
+                                         kArenaSize, &error_reporter);
+    if (interpreter.SetMemoryPlanner(planner_type) != kTfLiteOk ||
+        interpreter.SetMemoryPlanRecord(record) != kTfLiteOk ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return false;
+    }
+    *offline_plan_used = interpreter.offline_memory_plan_used();
+    return true;
+}
+
+} // namespace
+
+bool PlanModel(const uint8_t *model_data, tflite::MemoryPlannerType planner_type,
+               PlannedModel *planned, std::string *error)
+{
+    std::unique_ptr<tflite::ModelT> model = tflite::UnPackModel(model_data);
+    if (!model || model->subgraphs.size() != 1) {
+        *error = "not a model with one subgraph";
+        return false;
+    }
+    // Drop the plan the model may have, so that it is planned afresh.
+    for (size_t i = 0; i < model->metadata.size();) {
+        if (model->metadata[i]->name == tflite::kOfflineMemoryPlanMetadata) {
+            // PlanModel() appends the plan as the last buffer; any other
+            // buffer is only emptied, so that no buffer index changes.
+            const uint32_t buffer = model->metadata[i]->buffer;
+            if (buffer + 1 == model->buffers.size()) {
+                model->buffers.pop_back();
+            } else {
+                model->buffers[buffer]->data.clear();
+            }
+            model->metadata.erase(model->metadata.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+    const std::vector<uint8_t> unplanned = Pack(*model);
+
+    std::vector<uint8_t> arena_buffer(kArenaSize + 16);
+    uint8_t *arena = reinterpret_cast<uint8_t *>(
+        (reinterpret_cast<uintptr_t>(arena_buffer.data()) + 15) & ~uintptr_t(15));
+    const int tensor_count = static_cast<int>(model->subgraphs[0]->tensors.size());
+    const int scratch_capacity = static_cast<int>(model->subgraphs[0]->operators.size()) * 12;
+    std::vector<int32_t> tensor_offsets(tensor_count);
+    std::vector<int32_t> scratch_buffers(2 * scratch_capacity);
+    tflite::MemoryPlanRecord record = {tensor_offsets.data(), tensor_count,
+                                       scratch_buffers.data(), scratch_capacity, 0, 0, 0};
+    bool offline_plan_used = false;
+    if (!Allocate(unplanned.data(), planner_type, &record, arena, &offline_plan_used)) {
+        *error = "AllocateTensors() failed";
+        return false;
+    }
+
+    std::vector<uint32_t> words;
+    words.reserve(tflite::OfflineMemoryPlanWords(tensor_count, record.scratch_count));
+    words.push_back(tflite::kOfflineMemoryPlanVersion);
+    words.push_back(0);
+    words.push_back(tensor_count);
+    words.insert(words.end(), tensor_offsets.begin(), tensor_offsets.end());
+    words.push_back(tflite::kOfflineMemoryPlanMagic);
+    words.push_back(record.head_bytes);
+    words.push_back(record.scratch_count);
+    words.insert(words.end(), scratch_buffers.begin(),
+                 scratch_buffers.begin() + 2 * record.scratch_count);
+
+    std::unique_ptr<tflite::BufferT> buffer(new tflite::BufferT());
+    buffer->data.resize(words.size() * sizeof(uint32_t));
+    memcpy(buffer->data.data(), words.data(), buffer->data.size());
+    std::unique_ptr<tflite::MetadataT> metadata(new tflite::MetadataT());
+    metadata->name = tflite::kOfflineMemoryPlanMetadata;
+    metadata->buffer = static_cast<uint32_t>(model->buffers.size());
+    model->buffers.push_back(std::move(buffer));
+    model->metadata.push_back(std::move(metadata));
+    planned->data = Pack(*model);
+    planned->tensor_count = tensor_count;
+    planned->scratch_count = record.scratch_count;
+    planned->head_bytes = record.head_bytes;
+
+    // The planned model must take the fast path on this build.
+    if (!Allocate(planned->data.data(), tflite::MemoryPlannerType::kGreedy, nullptr, arena,
+                  &offline_plan_used) ||
+        !offline_plan_used) {
+        *error = "the planned model does not take its offline plan";
+        return false;
+    }
+    return true;
+}
+
+bool WriteModelSource(const std::vector<uint8_t> &model, const std::string &dir,
+                      std::string *error)
+{
+    const std::string header_path = dir + "/person_detect_model_data.h";
+    const std::string source_path = dir + "/person_detect_model_data.cc";
+    FILE *header = fopen(header_path.c_str(), "w");
+    if (header == nullptr) {
+        *error = "cannot write " + header_path;
+        return false;
+    }
+    fprintf(header,
+            "#include <cstdint>\n\n"
+            "constexpr unsigned int g_person_detect_model_data_size = %zu;\n"
+            "extern const unsigned char g_person_detect_model_data[];\n",
+            model.size());
+    bool ok = fclose(header) == 0;
+
+    FILE *source = fopen(source_path.c_str(), "w");
+    if (source == nullptr) {
+        *error = "cannot write " + source_path;
+        return false;
+    }
+    fprintf(source,
+            "#include <cstdint>\n\n"
+            "#include \"person_detect_model_data.h\"\n\n"
+            "__attribute__((aligned(16)))  const unsigned char g_person_detect_model_data[] = {");
+    for (size_t i = 0; i < model.size(); ++i) {
+        fprintf(source, i == 0 ? "0x%x" : ",0x%x", model[i]);
+    }
+    fprintf(source, "};\n");
+    ok = (fclose(source) == 0) && ok;
+    if (!ok) {
+        *error = "cannot write the model source to " + dir;
+    }
+    return ok;
+}
+
+} // namespace host
@@ -0,0 +1,66 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef PERSON_DETECTION_HOST_MEMORY_PLAN_H_
+#define PERSON_DETECTION_HOST_MEMORY_PLAN_H_
+
+// Offline memory planning: the arena of the model is planned on the host,
+// where planning time does not matter, and the plan is embedded in the model
+// as a complete offline memory plan (tensorflow/lite/micro/offline_memory_plan.h),
+// so that AllocateTensors() on the device places the buffers without
+// computing lifetimes or running a planner.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/micro/micro_allocator.h"
+
+namespace host {
+
+// A model with its memory plan embedded.
+struct PlannedModel {
+    std::vector<uint8_t> data;
+    int tensor_count;
+    int scratch_count;
+    // Bytes of the arena head the plan needs.
+    int head_bytes;
+};
+
+/**
+ * Plans the arena of a model with planner_type and embeds the plan in a copy
+ * of it, replacing any offline plan the model had. The scratch buffers are
+ * those the kernels of this build request, which the firmware kernels share
+ * since they come from the same Prepare() code; a device whose kernels
+ * request more ignores the plan and plans online.
+ *
+ * @return false with the reason in error if the model cannot be planned.
+ */
+bool PlanModel(const uint8_t *model_data, tflite::MemoryPlannerType planner_type,
+               PlannedModel *planned, std::string *error);
+
+/**
+ * Writes model as person_detect_model_data.cc and person_detect_model_data.h
+ * into dir, in the layout of the files of the firmware.
+ */
+bool WriteModelSource(const std::vector<uint8_t> &model, const std::string &dir,
+                      std::string *error);
+
+} // namespace host
+
+#endif // PERSON_DETECTION_HOST_MEMORY_PLAN_H_
@@ -0,0 +1,116 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// Tiered memory placement (host/region_placement.h): allocates the model
+// with every placement of the persistent data between the arena (fast, on-chip
+// RAM) and a slow region (PSRAM), prints how much of each region it takes and
+// the estimated memory time of one inference, and exits with status 2 if a
+// placement scores differently. -F, -S and -M set the cost of a 64 byte line
+// of the fast region, the slow region and the model in ns; -l N lists where
+// the buffers of placement N (0 to 3) landed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "host/region_placement.h"
+#include "person_detect_model_data.h"
+
+namespace {
+
+void PrintUsage(const char* prog)
+{
+    fprintf(stderr, "usage: %s [-F ns] [-S ns] [-M ns] [-l placement]\n", prog);
+}
+
+void PrintBuffers(const host::PlacementReport& report)
+{
+    printf("\n%s:\n%-28s %9s %6s %9s\n", host::PlacementName(report.placement), "buffer", "bytes",
+           "region", "offset");
+    for (const host::BufferPlacement& buffer : report.buffers) {
+        printf("%-28s %9zu %6s %9zu\n", buffer.name.c_str(), buffer.bytes,
+               host::RegionName(buffer.region), buffer.offset);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    host::RegionCost cost = host::kDefaultRegionCost;
+    int list = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-F") == 0) && (i + 1 < argc)) {
+            cost.line_ns[static_cast<int>(host::Region::kFast)] = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-S") == 0) && (i + 1 < argc)) {
+            cost.line_ns[static_cast<int>(host::Region::kSlow)] = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-M") == 0) && (i + 1 < argc)) {
+            cost.line_ns[static_cast<int>(host::Region::kModel)] = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc)) {
+            list = atoi(argv[++i]);
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (list >= host::kPlacementCount) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+#if defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+    printf("filter packing off; ns per 64 byte line: fast %.1f, slow %.1f, model %.1f\n",
+#else
+    printf("filter packing on; ns per 64 byte line: fast %.1f, slow %.1f, model %.1f\n",
+#endif
+           cost.line_ns[0], cost.line_ns[1], cost.line_ns[2]);
+    printf("%-21s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "placement", "arena_kb", "min_kb",
+           "slow_kb", "fast_rw", "slow_rw", "model_rd", "fast_us", "slow_us", "total_us");
+
+    host::PlacementReport reports[host::kPlacementCount];
+    int mismatches = 0;
+    for (int i = 0; i < host::kPlacementCount; ++i) {
+        host::PlacementReport& report = reports[i];
+        std::string error;
+        if (!host::ProfilePlacement(g_person_detect_model_data, static_cast<host::Placement>(i),
+                                    cost, &report, &error)) {
+            fprintf(stderr, "%s: %s\n", host::PlacementName(static_cast<host::Placement>(i)),
+                    error.c_str());
+            return 1;
+        }
+        if (memcmp(report.scores, reports[0].scores, sizeof(report.scores)) != 0) {
+            ++mismatches;
+        }
+        // Traffic in KB per inference; the model time is part of the total.
+        printf("%-21s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+               host::PlacementName(report.placement), report.arena_used_bytes / 1024.0,
+               report.minimum_arena_bytes / 1024.0, report.slow_used_bytes / 1024.0,
+               report.traffic_bytes[0] / 1024.0, report.traffic_bytes[1] / 1024.0,
+               report.traffic_bytes[2] / 1024.0, report.memory_us[0], report.memory_us[1],
+               report.total_memory_us);
+    }
+    if (list >= 0) {
+        PrintBuffers(reports[list]);
+    }
+    if (mismatches != 0) {
+        printf("%d placements scored differently\n", mismatches);
+        return 2;
+    }
+    return 0;
+}
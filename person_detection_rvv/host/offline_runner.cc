@@ -0,0 +1,285 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// Offline runner for recorded frames, built from the same runtime sources as
+// the firmware. Streams a directory of PGM or raw frames, or one raw video of
+// frames back to back, through the camera preprocessing (centre square crop
+// resized to the model input) and run_model(), straight from memory-mapped
+// files (host/frame_files.h).
+//
+// Every frame becomes one CSV row with its scores, the prediction, its label
+// if known, and the preprocessing and inference time. The CSV goes to stdout
+// or to the file given with -o; the summary goes to stderr: frame count,
+// throughput, latency percentiles and, for labelled frames, the accuracy and
+// confusion counts. Labels come from a "name,label" file given with -l, where
+// the frames of a video are named file#index.
+//
+// As a regression gate it exits with status 2 if the accuracy is below -a
+// PERCENT and with status 3 if the mean latency is above -t MICROSECONDS.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host/frame_files.h"
+#include "image_preprocess.h"
+#include "main_functions.h"
+
+namespace {
+
+struct FrameFormat {
+    const char* name;
+    preprocess_format_t format;
+};
+
+const FrameFormat kFrameFormats[] = {
+    {"gray", PREPROCESS_FORMAT_GRAY8},
+    {"rgba", PREPROCESS_FORMAT_RGBA8888},
+    {"yuv420", PREPROCESS_FORMAT_YUV420},
+    {"yuyv", PREPROCESS_FORMAT_YUYV},
+    {"uyvy", PREPROCESS_FORMAT_UYVY},
+};
+
+uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, int pct)
+{
+    size_t rank = (sorted.size() * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+void PrintUsage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-f gray|rgba|yuv420|yuyv|uyvy] [-s WIDTHxHEIGHT] [-l labels.csv]"
+            " [-o scores.csv] [-w warmup] [-a min_accuracy_pct] [-t max_mean_us]"
+            " DIRECTORY|FILE\n",
+            prog);
+}
+
+bool SameLayout(const preprocess_frame_t& a, const preprocess_frame_t& b)
+{
+    return a.format == b.format && a.width == b.width && a.height == b.height &&
+           a.stride == b.stride;
+}
+
+// Centre square crop resized to the model input, as main.c does for the
+// camera.
+bool InitPlan(const preprocess_frame_t& layout, const model_input_t& input,
+              preprocess_plan_t* plan)
+{
+    const int side = std::min(layout.width, layout.height);
+    return preprocess_plan_init(plan, &layout, (layout.width - side) / 2,
+                                (layout.height - side) / 2, side, side, input.width,
+                                input.height) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    preprocess_frame_t raw_layout = {PREPROCESS_FORMAT_GRAY8, 96, 96, 0};
+    const char* labels_path = nullptr;
+    const char* output_path = nullptr;
+    const char* path = nullptr;
+    int warmup = 2;
+    double min_accuracy = -1.0;
+    double max_mean_us = -1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc)) {
+            const char* name = argv[++i];
+            bool found = false;
+            for (const FrameFormat& format : kFrameFormats) {
+                if (strcmp(name, format.name) == 0) {
+                    raw_layout.format = format.format;
+                    found = true;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "unknown frame format %s\n", name);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+            if (sscanf(argv[++i], "%dx%d", &raw_layout.width, &raw_layout.height) != 2 ||
+                raw_layout.width <= 0 || raw_layout.height <= 0) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc)) {
+            labels_path = argv[++i];
+        } else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+            output_path = argv[++i];
+        } else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) {
+            warmup = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-a") == 0) && (i + 1 < argc)) {
+            min_accuracy = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+            max_mean_us = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && path == nullptr) {
+            path = argv[i];
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (path == nullptr || warmup < 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::string error;
+    std::vector<host::MappedFile> files;
+    std::vector<host::Frame> frames;
+    if (!host::CollectFrames(path, raw_layout, &files, &frames, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::map<std::string, int> labels;
+    if (labels_path != nullptr && !host::LoadLabels(labels_path, &labels, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    FILE* csv = stdout;
+    if (output_path != nullptr) {
+        csv = fopen(output_path, "w");
+        if (csv == nullptr) {
+            fprintf(stderr, "cannot create %s\n", output_path);
+            return 1;
+        }
+    }
+
+    init_model();
+    model_input_t model_input;
+    if (get_model_input(&model_input) != 0) {
+        return 1;
+    }
+
+    static preprocess_plan_t plan;
+    preprocess_frame_t plan_layout = {};
+    bool have_plan = false;
+    auto prepare = [&](const preprocess_frame_t& layout) {
+        if (have_plan && SameLayout(layout, plan_layout)) {
+            return true;
+        }
+        have_plan = InitPlan(layout, model_input, &plan);
+        plan_layout = layout;
+        return have_plan;
+    };
+
+    // The first frame warms up caches and branch predictors.
+    for (int i = 0; i < warmup; ++i) {
+        int8_t person_score = 0;
+        int8_t no_person_score = 0;
+        if (!prepare(frames[0].layout)) {
+            fprintf(stderr, "cannot preprocess %s\n", frames[0].name.c_str());
+            return 1;
+        }
+        preprocess_frame_to_input(&plan, frames[0].pixels, model_input.data);
+        if (run_model(&person_score, &no_person_score) != 0) {
+            return 1;
+        }
+    }
+
+    fprintf(csv, "frame,name,person_score,no_person_score,person,label,preprocess_us,"
+                 "invoke_us\n");
+    std::vector<uint64_t> latencies;
+    latencies.reserve(frames.size());
+    uint64_t preprocess_total = 0;
+    uint64_t invoke_total = 0;
+    // Confusion counts, indexed [label][prediction].
+    int confusion[2][2] = {{0, 0}, {0, 0}};
+    const uint64_t run_start = NowNs();
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const host::Frame& frame = frames[i];
+        if (!prepare(frame.layout)) {
+            fprintf(stderr, "cannot preprocess %s\n", frame.name.c_str());
+            return 1;
+        }
+        const uint64_t start = NowNs();
+        preprocess_frame_to_input(&plan, frame.pixels, model_input.data);
+        const uint64_t preprocessed = NowNs();
+        int8_t person_score = 0;
+        int8_t no_person_score = 0;
+        if (run_model(&person_score, &no_person_score) != 0) {
+            return 1;
+        }
+        const uint64_t end = NowNs();
+
+        const int person = person_score > no_person_score;
+        const auto label = labels.find(frame.name);
+        const int expected = (label != labels.end()) ? label->second : -1;
+        if (expected >= 0) {
+            ++confusion[expected][person];
+        }
+        preprocess_total += preprocessed - start;
+        invoke_total += end - preprocessed;
+        latencies.push_back(end - start);
+        fprintf(csv, "%zu,%s,%d,%d,%d,%d,%.1f,%.1f\n", i, frame.name.c_str(), person_score,
+                no_person_score, person, expected, (preprocessed - start) / 1e3,
+                (end - preprocessed) / 1e3);
+    }
+    const uint64_t run_ns = NowNs() - run_start;
+    if (csv != stdout) {
+        fclose(csv);
+    }
+
+    const size_t count = frames.size();
+    std::sort(latencies.begin(), latencies.end());
+    const double mean_us = (preprocess_total + invoke_total) / 1e3 / count;
+    fprintf(stderr, "frames:     %zu from %zu files\n", count, files.size());
+    fprintf(stderr, "throughput: %.1f frames/s\n", count * 1e9 / run_ns);
+    fprintf(stderr, "latency:    mean %.1f us (preprocess %.1f, invoke %.1f), p50 %.1f us,"
+                    " p99 %.1f us\n",
+            mean_us, preprocess_total / 1e3 / count, invoke_total / 1e3 / count,
+            Percentile(latencies, 50) / 1e3, Percentile(latencies, 99) / 1e3);
+
+    const int labelled = confusion[0][0] + confusion[0][1] + confusion[1][0] + confusion[1][1];
+    double accuracy = 100.0;
+    if (labelled > 0) {
+        accuracy = 100.0 * (confusion[0][0] + confusion[1][1]) / labelled;
+        fprintf(stderr, "accuracy:   %.2f%% of %d labelled (tp %d fp %d tn %d fn %d)\n",
+                accuracy, labelled, confusion[1][1], confusion[0][1], confusion[0][0],
+                confusion[1][0]);
+    } else {
+        fprintf(stderr, "accuracy:   no labelled frames\n");
+    }
+
+    if (min_accuracy >= 0.0 && (labelled == 0 || accuracy < min_accuracy)) {
+        fprintf(stderr, "FAIL accuracy below %.2f%%\n", min_accuracy);
+        return 2;
+    }
+    if (max_mean_us >= 0.0 && mean_us > max_mean_us) {
+        fprintf(stderr, "FAIL mean latency above %.1f us\n", max_mean_us);
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// pthreads implementation of pipeline_os.h for the host build.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline_os.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct os_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint32_t length;
+    uint32_t head;
+    uint32_t count;
+    void* items[];
+};
+
+typedef struct {
+    os_task_fn_t fn;
+    void* arg;
+} task_start_t;
+
+os_queue_t* os_queue_create(uint32_t length)
+{
+    os_queue_t* queue = (os_queue_t*)malloc(sizeof(os_queue_t) + length * sizeof(void*));
+    if (queue == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    queue->length = length;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+void os_queue_delete(os_queue_t* queue)
+{
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+}
+
+void os_queue_push(os_queue_t* queue, void* item)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    queue->items[(queue->head + queue->count) % queue->length] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void* os_queue_pop(os_queue_t* queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    void* item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+static void* task_trampoline(void* param)
+{
+    task_start_t start = *(task_start_t*)param;
+    free(param);
+    start.fn(start.arg);
+    return NULL;
+}
+
+int8_t os_task_start(os_task_fn_t fn, void* arg, const char* name)
+{
+    (void)name;
+    task_start_t* start = (task_start_t*)malloc(sizeof(task_start_t));
+    if (start == NULL) {
+        return -1;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_trampoline, start) != 0) {
+        free(start);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+uint64_t os_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void os_sleep_us(uint32_t us)
+{
+    struct timespec ts;
+    ts.tv_sec = us / 1000000u;
+    ts.tv_nsec = (long)(us % 1000000u) * 1000;
+    nanosleep(&ts, NULL);
+}
@@ -0,0 +1,231 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// Offline memory planner: plans the arena of the model on the host with the
+// search planner (or the greedy one with -g) and embeds the plan in the model
+// (host/memory_plan.h), so that AllocateTensors() on the device only places
+// the buffers. The planned model is written as a .tflite file with -o, and
+// as person_detect_model_data.cc/.h with -c DIRECTORY; -c person_detection_rvv
+// embeds it in the firmware.
+//
+// It prints the plan and the time of the init_model() steps (GetModel(), the
+// interpreter and AllocateTensors()) for the model before and after planning,
+// the median of -n iterations, and exits with status 2 if the planned model
+// scores the sample images differently.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "host/memory_plan.h"
+#include "model_settings.h"
+#include "no_person_image_data.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+// Large enough for the model with and without filter packing, which adds
+// about 244 KB of packed filters to the arena of the firmware.
+constexpr int kTensorArenaSize = 512 * 1024;
+__attribute__((aligned(16))) uint8_t tensor_arena[kTensorArenaSize];
+
+struct InitResult {
+    size_t arena_used;
+    bool offline_plan_used;
+    int8_t scores[2][2];
+};
+
+uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void PrintUsage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [-i model.tflite] [-g] [-o planned.tflite] [-c DIRECTORY]"
+            " [-n iterations]\n",
+            prog);
+}
+
+bool ReadFile(const char* path, std::vector<uint8_t>* data)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data->insert(data->end(), chunk, chunk + read);
+    }
+    const bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+bool WriteFile(const char* path, const std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (fclose(file) == 0) && written;
+}
+
+// Runs the init_model() steps on model_data once and returns their time in
+// ns, or 0 on failure; with result it also scores the sample images.
+uint64_t Init(const uint8_t* model_data, InitResult* result)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    static tflite::MicroErrorReporter error_reporter;
+
+    const uint64_t start = NowNs();
+    tflite::MicroInterpreter interpreter(tflite::GetModel(model_data), resolver, tensor_arena,
+                                         kTensorArenaSize, &error_reporter);
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        return 0;
+    }
+    const uint64_t elapsed = NowNs() - start;
+    if (result == nullptr) {
+        return elapsed;
+    }
+    result->arena_used = interpreter.arena_used_bytes();
+    result->offline_plan_used = interpreter.offline_memory_plan_used();
+    const uint8_t* images[2] = {g_person_image_data, g_no_person_image_data};
+    TfLiteTensor* input = interpreter.input(0);
+    for (int image = 0; image < 2; ++image) {
+        memcpy(input->data.int8, images[image], input->bytes);
+        if (interpreter.Invoke() != kTfLiteOk) {
+            return 0;
+        }
+        result->scores[image][0] = interpreter.output(0)->data.int8[kPersonIndex];
+        result->scores[image][1] = interpreter.output(0)->data.int8[kNotAPersonIndex];
+    }
+    return elapsed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const char* input_path = nullptr;
+    const char* output_path = nullptr;
+    const char* source_dir = nullptr;
+    tflite::MemoryPlannerType planner_type = tflite::MemoryPlannerType::kSearch;
+    int iterations = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc)) {
+            input_path = argv[++i];
+        } else if (strcmp(argv[i], "-g") == 0) {
+            planner_type = tflite::MemoryPlannerType::kGreedy;
+        } else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+            output_path = argv[++i];
+        } else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+            source_dir = argv[++i];
+        } else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+            iterations = atoi(argv[++i]);
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (iterations <= 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> input;
+    if (input_path != nullptr) {
+        if (!ReadFile(input_path, &input)) {
+            fprintf(stderr, "cannot read %s\n", input_path);
+            return 1;
+        }
+    } else {
+        input.assign(g_person_detect_model_data,
+                     g_person_detect_model_data + g_person_detect_model_data_size);
+    }
+
+    std::string error;
+    host::PlannedModel planned;
+    if (!host::PlanModel(input.data(), planner_type, &planned, &error)) {
+        fprintf(stderr, "cannot plan the model: %s\n", error.c_str());
+        return 1;
+    }
+    printf("planner:        %s\n",
+           planner_type == tflite::MemoryPlannerType::kSearch ? "search" : "greedy");
+    printf("tensors:        %d\n", planned.tensor_count);
+    printf("scratch:        %d buffers\n", planned.scratch_count);
+    printf("head:           %d bytes\n", planned.head_bytes);
+    printf("model:          %zu -> %zu bytes\n", input.size(), planned.data.size());
+
+    // The two models take turns so that both see the same cache and clock
+    // state; the median hides the preemptions.
+    InitResult before;
+    InitResult after;
+    std::vector<uint64_t> before_ns;
+    std::vector<uint64_t> after_ns;
+    for (int i = 0; i < iterations; ++i) {
+        const bool last = i + 1 == iterations;
+        before_ns.push_back(Init(input.data(), last ? &before : nullptr));
+        after_ns.push_back(Init(planned.data.data(), last ? &after : nullptr));
+        if (before_ns.back() == 0 || after_ns.back() == 0) {
+            fprintf(stderr, "cannot initialize the model in %d bytes\n", kTensorArenaSize);
+            return 1;
+        }
+    }
+    std::sort(before_ns.begin(), before_ns.end());
+    std::sort(after_ns.begin(), after_ns.end());
+    printf("%-12s %10s %12s %8s\n", "model", "init_us", "arena_bytes", "offline");
+    printf("%-12s %10.1f %12zu %8s\n", "original", before_ns[iterations / 2] / 1000.0,
+           before.arena_used, before.offline_plan_used ? "yes" : "no");
+    printf("%-12s %10.1f %12zu %8s\n", "planned", after_ns[iterations / 2] / 1000.0,
+           after.arena_used, after.offline_plan_used ? "yes" : "no");
+
+    if (memcmp(before.scores, after.scores, sizeof(before.scores)) != 0) {
+        fprintf(stderr, "the planned model scores the sample images differently\n");
+        return 2;
+    }
+    if (output_path != nullptr && !WriteFile(output_path, planned.data)) {
+        fprintf(stderr, "cannot write %s\n", output_path);
+        return 1;
+    }
+    if (source_dir != nullptr && !host::WriteModelSource(planned.data, source_dir, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "host/region_placement.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "model_settings.h"
+#include "no_person_image_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_graph.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace host {
+namespace {
+
+// Large enough for any placement of the model, filter packing included.
+constexpr size_t kOversizedRegion = 2 * 1024 * 1024;
+constexpr size_t kArenaStep = 16;
+constexpr size_t kLineBytes = 64;
+
+// Drops the errors of the arenas that are too small.
+class SilentErrorReporter : public tflite::ErrorReporter {
+public:
+    int Report(const char *, va_list) override
+    {
+        return 0;
+    }
+};
+
+// Exposes the graph, which holds the nodes and eval tensors of the model.
+class TracingInterpreter : public tflite::MicroInterpreter {
+public:
+    using tflite::MicroInterpreter::MicroInterpreter;
+
+    // MicroInterpreter binds GetExecutionPlan() to its graph.
+    tflite::MicroGraph *graph()
+    {
+        TfLiteIntArray *args = nullptr;
+        context().GetExecutionPlan(const_cast<TfLiteContext *>(&context()), &args);
+        return reinterpret_cast<tflite::MicroGraph *>(args);
+    }
+};
+
+void AddOps(tflite::MicroMutableOpResolver<5> *resolver)
+{
+    resolver->AddAveragePool2D();
+    resolver->AddConv2D(tflite::Register_CONV_2D());
+    resolver->AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver->AddReshape();
+    resolver->AddSoftmax(tflite::Register_SOFTMAX());
+}
+
+uint8_t *Aligned(std::vector<uint8_t> *buffer)
+{
+    return reinterpret_cast<uint8_t *>(
+        (reinterpret_cast<uintptr_t>(buffer->data()) + kArenaStep - 1) &
+        ~uintptr_t(kArenaStep - 1));
+}
+
+TfLiteStatus Configure(tflite::MicroInterpreter *interpreter, Placement placement,
+                       uint8_t *slow_region)
+{
+    switch (placement) {
+    case Placement::kSlowMetadata:
+        return interpreter->SetSlowMemoryRegion(slow_region, kOversizedRegion,
+                                                tflite::SlowMemoryPolicy::kMetadata);
+    case Placement::kSlowMetadataAndKernelData:
+        return interpreter->SetSlowMemoryRegion(
+            slow_region, kOversizedRegion, tflite::SlowMemoryPolicy::kMetadataAndKernelData);
+    default:
+        return kTfLiteOk;
+    }
+}
+
+bool Allocates(const uint8_t *model_data, Placement placement, uint8_t *arena, size_t arena_size,
+               uint8_t *slow_region)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    AddOps(&resolver);
+    SilentErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(model_data), resolver, arena,
+                                         arena_size, &error_reporter);
+    return Configure(&interpreter, placement, slow_region) == kTfLiteOk &&
+           interpreter.AllocateTensors() == kTfLiteOk;
+}
+
+// Sorts the buffers of one inference into regions and prices them.
+class Tracer {
+public:
+    Tracer(Placement placement, const RegionCost &cost, const uint8_t *arena,
+           const uint8_t *slow_region, PlacementReport *report)
+        : placement_(placement), cost_(cost), arena_(arena), slow_region_(slow_region),
+          report_(report)
+    {
+    }
+
+    void Access(const std::string &name, const void *data, size_t bytes)
+    {
+        if (data == nullptr || bytes == 0) {
+            return;
+        }
+        const uint8_t *address = static_cast<const uint8_t *>(data);
+        Region region = Region::kModel;
+        size_t offset = 0;
+        if (address >= arena_ && address < arena_ + kOversizedRegion) {
+            region = placement_ == Placement::kSlowArena ? Region::kSlow : Region::kFast;
+            offset = address - arena_;
+        } else if (address >= slow_region_ && address < slow_region_ + kOversizedRegion) {
+            region = Region::kSlow;
+            offset = address - slow_region_;
+        }
+        const int index = static_cast<int>(region);
+        report_->traffic_bytes[index] += bytes;
+        report_->memory_us[index] +=
+            (bytes + kLineBytes - 1) / kLineBytes * cost_.line_ns[index] / 1e3;
+        if (names_.insert(name).second) {
+            report_->buffers.push_back({name, bytes, region, offset});
+        }
+    }
+
+private:
+    Placement placement_;
+    RegionCost cost_;
+    const uint8_t *arena_;
+    const uint8_t *slow_region_;
+    PlacementReport *report_;
+    std::set<std::string> names_;
+};
+
+size_t BuiltinDataBytes(int32_t builtin_code)
+{
+    switch (builtin_code) {
+    case tflite::BuiltinOperator_AVERAGE_POOL_2D:
+        return sizeof(TfLitePoolParams);
+    case tflite::BuiltinOperator_CONV_2D:
+        return sizeof(TfLiteConvParams);
+    case tflite::BuiltinOperator_DEPTHWISE_CONV_2D:
+        return sizeof(TfLiteDepthwiseConvParams);
+    case tflite::BuiltinOperator_RESHAPE:
+        return sizeof(TfLiteReshapeParams);
+    case tflite::BuiltinOperator_SOFTMAX:
+        return sizeof(TfLiteSoftmaxParams);
+    default:
+        return 0;
+    }
+}
+
+// What operator i accesses in one inference: its node and parameters, the
+// eval tensors and data of its inputs and outputs and, for the conv and
+// depthwise kernels, their op data and the copies of the weights they read
+// in place of the model. The op data of the other kernels is not known here.
+void TraceOperator(TracingInterpreter *interpreter, int i, Tracer *tracer)
+{
+    const tflite::NodeAndRegistration &node_and_registration =
+        interpreter->graph()->GetAllocations()[0].node_and_registrations[i];
+    const TfLiteNode &node = node_and_registration.node;
+    const int32_t code = node_and_registration.registration->builtin_code;
+    const std::string op = "op " + std::to_string(i);
+    tracer->Access(op + " node", &node_and_registration, sizeof(node_and_registration));
+    tracer->Access(op + " params", node.builtin_data, BuiltinDataBytes(code));
+
+    const bool conv =
+        code == tflite::BuiltinOperator_CONV_2D || code == tflite::BuiltinOperator_DEPTHWISE_CONV_2D;
+    const tflite::OpDataConv *data =
+        conv ? static_cast<const tflite::OpDataConv *>(node.user_data) : nullptr;
+    TfLiteEvalTensor *tensors = interpreter->graph()->GetAllocations()[0].tensors;
+    const TfLiteIntArray *lists[2] = {node.inputs, node.outputs};
+    for (int list = 0; list < 2; ++list) {
+        for (int j = 0; j < lists[list]->size; ++j) {
+            const int index = lists[list]->data[j];
+            if (index < 0) {
+                continue;
+            }
+            const TfLiteEvalTensor &tensor = tensors[index];
+            const std::string name = "tensor " + std::to_string(index);
+            size_t bytes = 0;
+            tflite::TfLiteEvalTensorByteLength(&tensor, &bytes);
+            tracer->Access(name + " eval", &tensor, sizeof(tensor));
+            if (data != nullptr && list == 0 && j == 1 && data->packed_filter != nullptr) {
+                tracer->Access(op + " packed filter", data->packed_filter, bytes);
+            } else if (data != nullptr && list == 0 && j == 2 && data->folded_bias != nullptr) {
+                tracer->Access(op + " folded bias", data->folded_bias, bytes);
+            } else {
+                tracer->Access(name, tensor.data.data, bytes);
+            }
+        }
+    }
+    if (data != nullptr) {
+        const TfLiteEvalTensor &output = tensors[node.outputs->data[0]];
+        const size_t channel_bytes =
+            output.dims->data[output.dims->size - 1] * sizeof(int32_t);
+        tracer->Access(op + " op data", data, sizeof(*data));
+        tracer->Access(op + " multipliers", data->per_channel_output_multiplier, channel_bytes);
+        tracer->Access(op + " shifts", data->per_channel_output_shift, channel_bytes);
+    }
+}
+
+} // namespace
+
+const char *RegionName(Region region)
+{
+    switch (region) {
+    case Region::kFast:
+        return "fast";
+    case Region::kSlow:
+        return "slow";
+    default:
+        return "model";
+    }
+}
+
+const char *PlacementName(Placement placement)
+{
+    switch (placement) {
+    case Placement::kFastArena:
+        return "fast arena";
+    case Placement::kSlowMetadata:
+        return "slow metadata";
+    case Placement::kSlowMetadataAndKernelData:
+        return "slow metadata+kernel";
+    default:
+        return "slow arena";
+    }
+}
+
+bool ProfilePlacement(const uint8_t *model_data, Placement placement, const RegionCost &cost,
+                      PlacementReport *report, std::string *error)
+{
+    std::vector<uint8_t> arena_buffer(kOversizedRegion + kArenaStep);
+    std::vector<uint8_t> slow_buffer(kOversizedRegion + kArenaStep);
+    uint8_t *arena = Aligned(&arena_buffer);
+    uint8_t *slow_region = Aligned(&slow_buffer);
+
+    report->placement = placement;
+    report->buffers.clear();
+    report->total_memory_us = 0;
+    for (int i = 0; i < kRegionCount; ++i) {
+        report->traffic_bytes[i] = 0;
+        report->memory_us[i] = 0;
+    }
+    {
+        tflite::MicroMutableOpResolver<5> resolver;
+        AddOps(&resolver);
+        static tflite::MicroErrorReporter error_reporter;
+        TracingInterpreter interpreter(tflite::GetModel(model_data), resolver, arena,
+                                       kOversizedRegion, &error_reporter);
+        if (Configure(&interpreter, placement, slow_region) != kTfLiteOk ||
+            interpreter.AllocateTensors() != kTfLiteOk) {
+            *error = "AllocateTensors() failed in the oversized regions";
+            return false;
+        }
+        report->arena_used_bytes = interpreter.arena_used_bytes();
+        report->slow_used_bytes = interpreter.slow_region_used_bytes();
+
+        const int image_size = kNumCols * kNumRows * kNumChannels;
+        const unsigned char *images[2] = {g_person_image_data, g_no_person_image_data};
+        for (int i = 0; i < 2; ++i) {
+            memcpy(interpreter.input(0)->data.int8, images[i], image_size);
+            if (interpreter.Invoke() != kTfLiteOk) {
+                *error = "Invoke() failed";
+                return false;
+            }
+            report->scores[2 * i] = interpreter.output(0)->data.int8[kPersonIndex];
+            report->scores[2 * i + 1] = interpreter.output(0)->data.int8[kNotAPersonIndex];
+        }
+
+        Tracer tracer(placement, cost, arena, slow_region, report);
+        for (size_t i = 0; i < interpreter.operators_size(); ++i) {
+            TraceOperator(&interpreter, static_cast<int>(i), &tracer);
+        }
+        for (int i = 0; i < kRegionCount; ++i) {
+            report->total_memory_us += report->memory_us[i];
+        }
+    }
+
+    // As in ProfileArena(): the smallest arena, by bisection.
+    size_t low = (report->arena_used_bytes / kArenaStep) * kArenaStep;
+    size_t high = kOversizedRegion;
+    if (Allocates(model_data, placement, arena, low, slow_region)) {
+        high = low;
+    }
+    while (high - low > kArenaStep) {
+        const size_t middle = low + ((high - low) / 2 / kArenaStep) * kArenaStep;
+        if (Allocates(model_data, placement, arena, middle, slow_region)) {
+            high = middle;
+        } else {
+            low = middle;
+        }
+    }
+    report->minimum_arena_bytes = high;
+    return true;
+}
+
+} // namespace host
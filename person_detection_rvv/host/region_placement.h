@@ -0,0 +1,115 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef PERSON_DETECTION_HOST_REGION_PLACEMENT_H_
+#define PERSON_DETECTION_HOST_REGION_PLACEMENT_H_
+
+// Tiered memory placement: the model is allocated with a fast region, the
+// tensor arena in on-chip RAM, and a slow region in external RAM (see
+// MicroInterpreter::SetSlowMemoryRegion()), once for every placement of the
+// persistent data. One inference is traced operator by operator to find which
+// region every buffer an operator reads or writes lies in, and the bytes each
+// region moves are priced with a cost per 64 byte line of that region.
+//
+// The host has one kind of memory, so the times are estimates from the cost
+// model and not measurements: every buffer of an operator counts once per
+// inference and scratch buffers are left out, which undercounts the
+// activations that the kernels read more than once.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace host {
+
+// Where a buffer lies.
+enum class Region {
+    kFast,
+    kSlow,
+    // The read-only model data, in flash.
+    kModel,
+};
+constexpr int kRegionCount = 3;
+
+const char *RegionName(Region region);
+
+// Nanoseconds to move a 64 byte line, indexed by Region.
+struct RegionCost {
+    double line_ns[kRegionCount];
+};
+
+// The default costs are assumptions, not measurements of the BL808: a cached
+// line from on-chip RAM, and a line from PSRAM or XIP flash.
+constexpr RegionCost kDefaultRegionCost = {{10.0, 80.0, 100.0}};
+
+enum class Placement {
+    // Everything in the arena, in the fast region.
+    kFastArena,
+    // The activations, scratch buffers and persistent buffers of the kernels
+    // in the arena, the metadata of the allocator in the slow region.
+    kSlowMetadata,
+    // Only the activations and scratch buffers in the arena.
+    kSlowMetadataAndKernelData,
+    // Everything in an arena in the slow region.
+    kSlowArena,
+};
+constexpr int kPlacementCount = 4;
+
+const char *PlacementName(Placement placement);
+
+// A buffer that an operator accesses.
+struct BufferPlacement {
+    // "tensor 3", "op 2 packed filter", ...
+    std::string name;
+    size_t bytes;
+    Region region;
+    // From the start of the region, 0 for the model.
+    size_t offset;
+};
+
+struct PlacementReport {
+    Placement placement;
+    // MicroInterpreter::arena_used_bytes() and slow_region_used_bytes().
+    size_t arena_used_bytes;
+    size_t slow_used_bytes;
+    // The smallest 16 byte aligned arena AllocateTensors() succeeds in with
+    // the slow region of this placement.
+    size_t minimum_arena_bytes;
+    // Bytes moved and estimated time per inference, indexed by Region.
+    size_t traffic_bytes[kRegionCount];
+    double memory_us[kRegionCount];
+    double total_memory_us;
+    // Person and no person scores of the person and no person images.
+    int8_t scores[4];
+    // Every buffer of every operator, in operator order without duplicates.
+    std::vector<BufferPlacement> buffers;
+};
+
+/**
+ * Allocates model_data with placement, runs the two test images and traces
+ * one inference.
+ *
+ * @return false with the reason in error if the model cannot be allocated or
+ *         run.
+ */
+bool ProfilePlacement(const uint8_t *model_data, Placement placement, const RegionCost &cost,
+                      PlacementReport *report, std::string *error);
+
+} // namespace host
+
+#endif // PERSON_DETECTION_HOST_REGION_PLACEMENT_H_
@@ -0,0 +1,161 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef PERSON_DETECTION_HOST_SYNTHETIC_FRAME_H_
+#define PERSON_DETECTION_HOST_SYNTHETIC_FRAME_H_
+
+// Synthetic camera frames for the host build, which has no sensor: a
+// deterministic RGBA scene and its packing into the YUV layouts of
+// image_preprocess.h. The Y samples are the BT.601 luma the RGBA path
+// computes, so both paths see the same gray image.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "image_preprocess.h"
+
+namespace host {
+
+inline int RgbaChannel(uint32_t pixel, int shift)
+{
+    return (pixel >> shift) & 0xff;
+}
+
+inline uint8_t RgbaLuma(uint32_t pixel)
+{
+    return static_cast<uint8_t>(
+        (PREPROCESS_LUMA_R * RgbaChannel(pixel, PREPROCESS_R_SHIFT) +
+         PREPROCESS_LUMA_G * RgbaChannel(pixel, PREPROCESS_G_SHIFT) +
+         PREPROCESS_LUMA_B * RgbaChannel(pixel, PREPROCESS_B_SHIFT) + 128) >> 8);
+}
+
+inline uint32_t RgbaPixel(int r, int g, int b)
+{
+    return (static_cast<uint32_t>(r) << PREPROCESS_R_SHIFT) |
+           (static_cast<uint32_t>(g) << PREPROCESS_G_SHIFT) |
+           (static_cast<uint32_t>(b) << PREPROCESS_B_SHIFT) | 0xff000000u;
+}
+
+// Colour gradients with a bright square that moves every hold frames and a
+// little deterministic sensor noise that changes every frame.
+inline void RenderScene(int width, int height, int frame_index, uint32_t *rgba, int hold = 1)
+{
+    const int size = height / 4;
+    const int position = frame_index / hold;
+    const int square_x = (position * 7) % (width - size);
+    const int square_y = (position * 3) % (height - size);
+    uint32_t noise = 0x9e3779b9u * static_cast<uint32_t>(frame_index + 1);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            noise ^= noise << 13;
+            noise ^= noise >> 17;
+            noise ^= noise << 5;
+            const int n = static_cast<int>(noise % 9) - 4;
+            int r = (x * 255) / width;
+            int g = (y * 255) / height;
+            int b = ((x + y) * 255) / (width + height);
+            if (x >= square_x && x < square_x + size && y >= square_y && y < square_y + size) {
+                r = 240;
+                g = 230;
+                b = 200;
+            }
+            rgba[y * width + x] = RgbaPixel(std::min(255, std::max(0, r + n)),
+                                            std::min(255, std::max(0, g + n)),
+                                            std::min(255, std::max(0, b - n)));
+        }
+    }
+}
+
+inline uint8_t ClampByte(int value)
+{
+    return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+inline uint8_t RgbaU(uint32_t pixel)
+{
+    return ClampByte(((-43 * RgbaChannel(pixel, PREPROCESS_R_SHIFT) -
+                       85 * RgbaChannel(pixel, PREPROCESS_G_SHIFT) +
+                       128 * RgbaChannel(pixel, PREPROCESS_B_SHIFT) + 128) >> 8) + 128);
+}
+
+inline uint8_t RgbaV(uint32_t pixel)
+{
+    return ClampByte(((128 * RgbaChannel(pixel, PREPROCESS_R_SHIFT) -
+                       107 * RgbaChannel(pixel, PREPROCESS_G_SHIFT) -
+                       21 * RgbaChannel(pixel, PREPROCESS_B_SHIFT) + 128) >> 8) + 128);
+}
+
+// Packs a width x height RGBA image into frame's layout. out must hold
+// preprocess_frame_size(&frame) bytes; row padding is left as it is. YUV420 is
+// written as I420 with chroma taken from the top left pixel of each 2x2
+// block.
+inline void PackFrame(const uint32_t *rgba, const preprocess_frame_t &frame, uint8_t *out)
+{
+    const int width = frame.width;
+    const int height = frame.height;
+    switch (frame.format) {
+        case PREPROCESS_FORMAT_RGBA8888: {
+            const int stride = frame.stride > 0 ? frame.stride : width * 4;
+            for (int y = 0; y < height; ++y) {
+                memcpy(out + y * stride, rgba + y * width, width * 4);
+            }
+            break;
+        }
+        case PREPROCESS_FORMAT_GRAY8: {
+            const int stride = frame.stride > 0 ? frame.stride : width;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    out[y * stride + x] = RgbaLuma(rgba[y * width + x]);
+                }
+            }
+            break;
+        }
+        case PREPROCESS_FORMAT_YUV420: {
+            const int stride = frame.stride > 0 ? frame.stride : width;
+            uint8_t *u_plane = out + stride * height;
+            uint8_t *v_plane = u_plane + (stride / 2) * (height / 2);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const uint32_t pixel = rgba[y * width + x];
+                    out[y * stride + x] = RgbaLuma(pixel);
+                    if ((x % 2 == 0) && (y % 2 == 0)) {
+                        u_plane[(y / 2) * (stride / 2) + x / 2] = RgbaU(pixel);
+                        v_plane[(y / 2) * (stride / 2) + x / 2] = RgbaV(pixel);
+                    }
+                }
+            }
+            break;
+        }
+        case PREPROCESS_FORMAT_YUYV:
+        case PREPROCESS_FORMAT_UYVY: {
+            const int stride = frame.stride > 0 ? frame.stride : width * 2;
+            const int y_first = frame.format == PREPROCESS_FORMAT_YUYV;
+            for (int y = 0; y < height; ++y) {
+                uint8_t *row = out + y * stride;
+                for (int x = 0; x < width; ++x) {
+                    const uint32_t pixel = rgba[y * width + x];
+                    row[2 * x + (y_first ? 0 : 1)] = RgbaLuma(pixel);
+                    row[2 * x + (y_first ? 1 : 0)] = (x % 2 == 0) ? RgbaU(pixel) : RgbaV(pixel);
+                }
+            }
+            break;
+        }
+    }
+}
+
+} // namespace host
+
+#endif // PERSON_DETECTION_HOST_SYNTHETIC_FRAME_H_
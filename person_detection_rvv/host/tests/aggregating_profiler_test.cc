@@ -0,0 +1,104 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Runs the person detection model under an AggregatingProfiler and checks
+// the node mapping, the per-node statistics and the MAC counts of the first
+// layers against their shapes.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "model_settings.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/micro/aggregating_profiler.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr int kArenaSize = 512 * 1024;
+constexpr int kInvokes = 3;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+} // namespace
+
+int main()
+{
+    alignas(16) static uint8_t arena[kArenaSize];
+    static tflite::MicroErrorReporter error_reporter;
+
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D();
+    resolver.AddDepthwiseConv2D();
+    resolver.AddReshape();
+    resolver.AddSoftmax();
+
+    const tflite::Model *model = tflite::GetModel(g_person_detect_model_data);
+    static tflite::AggregatingProfiler profiler;
+    profiler.Init(model);
+    tflite::MicroInterpreter interpreter(model, resolver, arena, kArenaSize,
+                                         &error_reporter, &profiler);
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        printf("FAIL AllocateTensors\n");
+        return 1;
+    }
+    memcpy(interpreter.input(0)->data.int8, g_person_image_data,
+           kNumCols * kNumRows * kNumChannels);
+    for (int i = 0; i < kInvokes; ++i) {
+        if (interpreter.Invoke() != kTfLiteOk) {
+            printf("FAIL Invoke\n");
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    ok = Expect(profiler.num_nodes() == static_cast<int>(interpreter.operators_size()),
+                "one node per operator") && ok;
+    ok = Expect(profiler.num_invokes() == kInvokes, "invoke count") && ok;
+    for (int i = 0; i < profiler.num_nodes(); ++i) {
+        const tflite::AggregatingProfiler::NodeStats &node = profiler.node(i);
+        ok = Expect(node.count == kInvokes, "event count per node") && ok;
+        ok = Expect(node.min_ticks <= profiler.MeanTicks(i) &&
+                        profiler.MeanTicks(i) <= node.max_ticks,
+                    "min <= mean <= max") && ok;
+        ok = Expect(strcmp(node.tag, tflite::EnumNameBuiltinOperator(node.op)) == 0,
+                    "event tag matches the node op") && ok;
+        const bool has_macs = node.op == tflite::BuiltinOperator_CONV_2D ||
+                              node.op == tflite::BuiltinOperator_DEPTHWISE_CONV_2D;
+        ok = Expect((node.macs > 0) == has_macs, "MACs only for conv layers") && ok;
+    }
+    // 3x3 stride 2 depthwise, 96x96x1 -> 48x48x8, and the 1x1 conv 8 -> 16
+    // that follows its 3x3 depthwise.
+    ok = Expect(profiler.node(0).macs == 48 * 48 * 8 * 9, "depthwise MACs") && ok;
+    ok = Expect(profiler.node(2).macs == 48 * 48 * 16 * 8, "pointwise MACs") && ok;
+
+    profiler.LogTable();
+    profiler.Reset();
+    ok = Expect(profiler.num_invokes() == 0 && profiler.node(0).count == 0, "reset") && ok;
+
+    printf("%s aggregating_profiler\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
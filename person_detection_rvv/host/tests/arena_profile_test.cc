@@ -0,0 +1,213 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks tensor arena sizing (host/arena_profile.h): the smallest arena is
+// exact (AllocateTensors() succeeds in it and fails 16 bytes below), the tail
+// categories add up, the generated header round trips and keeps the size of
+// the other filter packing only for the same configuration, and
+// get_model_arena_usage() reports the arena model_arena_size.h sized.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "host/arena_profile.h"
+#include "main_functions.h"
+#include "model_arena_size.h"
+#include "person_detect_model_data.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr char kHeaderPath[] = "arena_profile_test_model_arena_size.h";
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+class SilentErrorReporter : public tflite::ErrorReporter {
+public:
+    int Report(const char *, va_list) override
+    {
+        return 0;
+    }
+};
+
+bool Allocates(const host::ArenaConfig &config, size_t arena_size)
+{
+    std::vector<uint8_t> buffer(arena_size + 16);
+    uint8_t *arena =
+        reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(buffer.data()) + 15) & ~uintptr_t(15));
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    SilentErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(g_person_detect_model_data), resolver,
+                                         arena, arena_size, &error_reporter);
+    if (config.patch_ops > 0 &&
+        interpreter.SetPatchExecution(config.patch_ops, config.patch_rows) != kTfLiteOk) {
+        return false;
+    }
+    return interpreter.SetMemoryPlanner(config.planner_type) == kTfLiteOk &&
+           interpreter.AllocateTensors() == kTfLiteOk;
+}
+
+bool TestProfile(const host::ArenaConfig &config, const char *name, host::ArenaProfile *profile)
+{
+    std::string error;
+    bool ok = Expect(host::ProfileArena(g_person_detect_model_data, config, profile, &error),
+                     name);
+    if (!ok) {
+        printf("  %s\n", error.c_str());
+        return false;
+    }
+    ok = Expect(profile->minimum_arena_bytes % 16 == 0, "smallest arena is aligned") && ok;
+    ok = Expect(profile->used_bytes <= profile->minimum_arena_bytes,
+                "smallest arena holds the used bytes") &&
+         ok;
+    ok = Expect(Allocates(config, profile->minimum_arena_bytes),
+                "allocates in the smallest arena") &&
+         ok;
+    ok = Expect(!Allocates(config, profile->minimum_arena_bytes - 16),
+                "fails below the smallest arena") &&
+         ok;
+    ok = Expect(profile->eval_tensor_bytes + profile->persistent_tensor_bytes +
+                        profile->quantization_bytes + profile->persistent_buffer_bytes +
+                        profile->variable_buffer_bytes + profile->node_and_registration_bytes +
+                        profile->other_tail_bytes ==
+                    profile->tail_bytes,
+                "tail categories add up") &&
+         ok;
+    ok = Expect(profile->persistent_buffer_bytes > 0 && profile->head_bytes > 0,
+                "head and persistent buffers recorded") &&
+         ok;
+    return ok;
+}
+
+bool WriteText(const char *text)
+{
+    FILE *file = fopen(kHeaderPath, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fputs(text, file);
+    return fclose(file) == 0;
+}
+
+bool TestHeader(const host::ArenaConfig &config, const host::ArenaProfile &profile)
+{
+    const int packing = host::BuildFilterPacking();
+    const int other = 1 - packing;
+    std::string error;
+    host::ArenaHeader header;
+
+    bool ok = Expect(WriteText(""), "clear header");
+    ok = Expect(host::WriteArenaHeader(config, profile, kHeaderPath, &error), "write header") &&
+         ok;
+    ok = Expect(host::ReadArenaHeader(kHeaderPath, &header, &error), "read header") && ok;
+    ok = Expect(header.arena_size[packing] == host::ArenaSize(profile) &&
+                    header.arena_size[other] == 0,
+                "header holds the size of this build") &&
+         ok;
+    ok = Expect(header.config.patch_ops == 0 &&
+                    header.config.planner_type == tflite::MemoryPlannerType::kGreedy,
+                "header holds the configuration") &&
+         ok;
+
+    // The other filter packing, as written by a second build.
+    const char *names[2] = {"MODEL_ARENA_SIZE_NO_FILTER_PACKING",
+                            "MODEL_ARENA_SIZE_FILTER_PACKING"};
+    char text[512];
+    snprintf(text, sizeof(text),
+             "#define MODEL_ARENA_PATCH_OPS 0\n#define MODEL_ARENA_PATCH_ROWS 0\n"
+             "#define MODEL_ARENA_SEARCH_MEMORY_PLANNER 0\n// other build\n#define %s 1234\n",
+             names[other]);
+    ok = Expect(WriteText(text), "write other build") && ok;
+    ok = Expect(host::WriteArenaHeader(config, profile, kHeaderPath, &error) &&
+                    host::ReadArenaHeader(kHeaderPath, &header, &error),
+                "update header") &&
+         ok;
+    ok = Expect(header.arena_size[other] == 1234 && header.note[other] == "// other build" &&
+                    header.arena_size[packing] == host::ArenaSize(profile),
+                "same configuration keeps the other size") &&
+         ok;
+
+    const host::ArenaConfig patched = {4, 4, tflite::MemoryPlannerType::kGreedy};
+    ok = Expect(host::WriteArenaHeader(patched, profile, kHeaderPath, &error) &&
+                    host::ReadArenaHeader(kHeaderPath, &header, &error),
+                "rewrite header") &&
+         ok;
+    ok = Expect(header.arena_size[other] == 0 && header.config.patch_ops == 4 &&
+                    header.config.patch_rows == 4,
+                "other configuration drops the other size") &&
+         ok;
+
+    ok = Expect(WriteText("constexpr int kSomething = 1;\n") &&
+                    !host::ReadArenaHeader(kHeaderPath, &header, &error),
+                "header without configuration is rejected") &&
+         ok;
+    remove(kHeaderPath);
+    return ok;
+}
+
+bool TestUsage(const host::ArenaProfile &profile)
+{
+    model_arena_usage_t usage;
+    bool ok = Expect(get_model_arena_usage(&usage) == -2, "usage before init_model()");
+    init_model();
+    ok = Expect(get_model_arena_usage(nullptr) == -1, "usage without a pointer") && ok;
+    ok = Expect(get_model_arena_usage(&usage) == 0, "usage") && ok;
+#if defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+    ok = Expect(usage.size == MODEL_ARENA_SIZE_NO_FILTER_PACKING, "arena from the header") && ok;
+#else
+    ok = Expect(usage.size == MODEL_ARENA_SIZE_FILTER_PACKING, "arena from the header") && ok;
+#endif
+    ok = Expect(usage.used == profile.used_bytes, "used bytes") && ok;
+    ok = Expect(usage.headroom == usage.size - usage.used, "headroom") && ok;
+    ok = Expect(usage.size >= profile.minimum_arena_bytes, "arena is large enough") && ok;
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    const host::ArenaConfig layers = {0, 4, tflite::MemoryPlannerType::kGreedy};
+    const host::ArenaConfig patches = {4, 4, tflite::MemoryPlannerType::kSearch};
+    host::ArenaProfile layer_profile;
+    host::ArenaProfile patch_profile;
+
+    bool ok = TestProfile(layers, "layer by layer", &layer_profile);
+    ok = TestProfile(patches, "patches", &patch_profile) && ok;
+    ok = Expect(patch_profile.minimum_arena_bytes < layer_profile.minimum_arena_bytes,
+                "patches need less arena") &&
+         ok;
+    ok = TestHeader(layers, layer_profile) && ok;
+    ok = TestUsage(layer_profile) && ok;
+
+    printf("%s arena_profile\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
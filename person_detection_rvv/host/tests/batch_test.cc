@@ -0,0 +1,151 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the batched entry point of main_functions.h: every image of a batch
+// gets the same scores as when it runs alone, the batched input has the
+// single image shape with the batch size, the arena is re-planned for a new
+// batch size, short batches only report their own images, and bad arguments
+// or a too small arena are rejected.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "main_functions.h"
+#include "model_settings.h"
+#include "no_person_image_data.h"
+#include "person_image_data.h"
+
+namespace {
+
+constexpr int kImageSize = kNumCols * kNumRows * kNumChannels;
+constexpr int kImages = 8;
+constexpr size_t kArenaSize = 1024 * 1024;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+// Runs count images of a batch and compares them with the single image scores.
+bool CheckBatch(int32_t batch_size, int count, const std::vector<int8_t> &images,
+                const int8_t *person, const int8_t *no_person, uint8_t *arena)
+{
+    bool ok = Expect(init_model_batch(batch_size, arena, kArenaSize) == 0, "init_model_batch");
+    model_input_t input;
+    int32_t size = 0;
+    ok = Expect(get_model_batch_input(&input, &size) == 0, "get_model_batch_input") && ok;
+    ok = Expect(size == batch_size && input.width == kNumCols && input.height == kNumRows &&
+                    input.channels == kNumChannels,
+                "batched input shape") && ok;
+
+    int8_t batch_person[kImages];
+    int8_t batch_no_person[kImages];
+    memset(batch_person, 0, sizeof(batch_person));
+    memset(batch_no_person, 0, sizeof(batch_no_person));
+    ok = Expect(run_model_batch(images.data(), count, batch_person, batch_no_person) == 0,
+                "run_model_batch") && ok;
+    for (int i = 0; i < count; ++i) {
+        ok = Expect(batch_person[i] == person[i] && batch_no_person[i] == no_person[i],
+                    "same scores as a single image") && ok;
+    }
+
+    // Rendered straight into the batched input, in reverse order.
+    for (int i = 0; i < count; ++i) {
+        memcpy(input.data + i * kImageSize, images.data() + (count - 1 - i) * kImageSize,
+               kImageSize);
+    }
+    ok = Expect(run_model_batch(nullptr, count, batch_person, batch_no_person) == 0,
+                "run_model_batch on the batched input") && ok;
+    for (int i = 0; i < count; ++i) {
+        ok = Expect(batch_person[i] == person[count - 1 - i] &&
+                        batch_no_person[i] == no_person[count - 1 - i],
+                    "same scores from the batched input") && ok;
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    bool ok = true;
+    std::vector<uint8_t> arena(kArenaSize + 16);
+    uint8_t *aligned_arena =
+        reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(arena.data()) + 15) & ~uintptr_t(15));
+    int8_t person[kImages];
+    int8_t no_person[kImages];
+
+    ok = Expect(init_model_batch(4, aligned_arena, kArenaSize) == -2,
+                "batch before init rejected") && ok;
+    init_model();
+    ok = Expect(init_model_batch(0, aligned_arena, kArenaSize) == -1, "batch 0 rejected") && ok;
+    ok = Expect(init_model_batch(4, nullptr, kArenaSize) == -1, "null arena rejected") && ok;
+    ok = Expect(run_model_batch(nullptr, 1, person, no_person) == -2,
+                "run before init_model_batch rejected") && ok;
+
+    // The two sample images and random ones, each classified alone first.
+    std::vector<int8_t> images(kImages * kImageSize);
+    memcpy(images.data(), g_person_image_data, kImageSize);
+    memcpy(images.data() + kImageSize, g_no_person_image_data, kImageSize);
+    tflite::testing::TestRng rng(17);
+    for (int i = 2; i < kImages; ++i) {
+        std::vector<int8_t> image(kImageSize);
+        tflite::testing::FillInt8(&rng, &image);
+        memcpy(images.data() + i * kImageSize, image.data(), kImageSize);
+    }
+    model_input_t single;
+    if (get_model_input(&single) != 0) {
+        printf("FAIL get_model_input\n");
+        return 1;
+    }
+    for (int i = 0; i < kImages; ++i) {
+        memcpy(single.data, images.data() + i * kImageSize, kImageSize);
+        if (run_model(&person[i], &no_person[i]) != 0) {
+            printf("FAIL run_model\n");
+            return 1;
+        }
+    }
+    ok = Expect(person[0] > no_person[0] && person[1] < no_person[1], "sample images") && ok;
+
+    ok = CheckBatch(kImages, kImages, images, person, no_person, aligned_arena) && ok;
+    // Re-planned for a smaller batch, which is only partly filled.
+    ok = CheckBatch(3, 2, images, person, no_person, aligned_arena) && ok;
+    ok = CheckBatch(1, 1, images, person, no_person, aligned_arena) && ok;
+
+    ok = Expect(run_model_batch(images.data(), 2, person, no_person) == -1,
+                "more images than the batch rejected") && ok;
+    ok = Expect(run_model_batch(images.data(), 0, person, no_person) == -1,
+                "empty batch rejected") && ok;
+    ok = Expect(init_model_batch(kImages, aligned_arena, 64 * 1024) == -3,
+                "too small arena rejected") && ok;
+    ok = Expect(run_model_batch(images.data(), 1, person, no_person) == -2,
+                "failed init leaves no batched model") && ok;
+
+    // The single image interpreter is untouched.
+    int8_t person_score = 0;
+    int8_t no_person_score = 0;
+    memcpy(single.data, images.data(), kImageSize);
+    ok = Expect(run_model(&person_score, &no_person_score) == 0 && person_score == person[0],
+                "single image model unchanged") && ok;
+
+    printf("%s batch\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the optimized convolution bit-exact against the reference kernel,
+// for the pointwise layers of the person detection model (1x1 fast path,
+// including the stride 2 downsampling variant) and for general filters that
+// go through the packed im2col + GEMM path.
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/conv.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
+
+namespace {
+
+struct ConvCase {
+    const char *name;
+    int batches;
+    int height;
+    int width;
+    int in_depth;
+    int out_depth;
+    int filter;
+    int stride;
+    int dilation;
+    int pad;
+};
+
+bool RunCase(const ConvCase &c, tflite::testing::TestRng *rng)
+{
+    const int out_h = tflite::testing::ConvOutputSize(c.height, c.filter, c.stride, c.dilation, c.pad);
+    const int out_w = tflite::testing::ConvOutputSize(c.width, c.filter, c.stride, c.dilation, c.pad);
+
+    const tflite::RuntimeShape input_shape({c.batches, c.height, c.width, c.in_depth});
+    const tflite::RuntimeShape filter_shape({c.out_depth, c.filter, c.filter, c.in_depth});
+    const tflite::RuntimeShape bias_shape({c.out_depth});
+    const tflite::RuntimeShape output_shape({c.batches, out_h, out_w, c.out_depth});
+
+    std::vector<int8_t> input(input_shape.FlatSize());
+    std::vector<int8_t> filter(filter_shape.FlatSize());
+    std::vector<int32_t> bias(c.out_depth);
+    std::vector<int32_t> multiplier(c.out_depth);
+    std::vector<int32_t> shift(c.out_depth);
+    tflite::testing::FillInt8(rng, &input);
+    tflite::testing::FillInt8(rng, &filter);
+    for (int32_t &b : bias) {
+        b = rng->Uniform(-50000, 50000);
+    }
+    tflite::testing::FillQuantParams(rng, &multiplier, &shift);
+
+    tflite::ConvParams params = {};
+    params.padding_values.width = c.pad;
+    params.padding_values.height = c.pad;
+    params.stride_width = c.stride;
+    params.stride_height = c.stride;
+    params.dilation_width_factor = c.dilation;
+    params.dilation_height_factor = c.dilation;
+    params.input_offset = rng->Uniform(-127, 128);
+    params.output_offset = rng->Uniform(-128, 127);
+    params.quantized_activation_min = -128;
+    params.quantized_activation_max = 127;
+
+    std::vector<int32_t> folded_bias(c.out_depth);
+    tflite::optimized_integer_ops::ConvFoldInputOffset(
+        params.input_offset, filter_shape, filter.data(), bias.data(),
+        folded_bias.data());
+
+    std::vector<int8_t> im2col(
+        tflite::optimized_integer_ops::ConvIm2colBufferSize(params, filter_shape));
+    std::vector<int8_t> expected(output_shape.FlatSize());
+    std::vector<int8_t> actual(output_shape.FlatSize());
+    tflite::reference_integer_ops::ConvPerChannel(
+        params, multiplier.data(), shift.data(), input_shape, input.data(),
+        filter_shape, filter.data(), bias_shape, bias.data(), output_shape,
+        expected.data());
+    std::vector<int8_t> packed(
+        tflite::optimized_integer_ops::ConvPackedFilterSize(filter_shape));
+    tflite::optimized_integer_ops::ConvPackFilter(params, filter_shape,
+                                                  filter.data(), packed.data());
+
+    // Run with the weights read in place and with the weights repacked in
+    // Prepare, the two configurations of the kernel registration.
+    bool ok = true;
+    for (int use_packed = 0; use_packed < 2; ++use_packed) {
+        const int8_t *packed_filter = use_packed ? packed.data() : nullptr;
+        const std::string name = std::string(c.name) + (use_packed ? "/packed" : "");
+        tflite::optimized_integer_ops::ConvPerChannel(
+            params, multiplier.data(), shift.data(), input_shape, input.data(),
+            filter_shape, filter.data(), bias_shape, folded_bias.data(),
+            output_shape, actual.data(), im2col.empty() ? nullptr : im2col.data(),
+            packed_filter);
+        ok = tflite::testing::ExpectEqual(name.c_str(), expected, actual) && ok;
+
+        // The kernel registration calls the pointwise kernel directly when
+        // ConvPrepare detects a 1x1 layer, so check that entry point too.
+        if (tflite::optimized_integer_ops::IsPointwiseConv(params, filter_shape)) {
+            std::vector<int8_t> pointwise(output_shape.FlatSize());
+            tflite::optimized_integer_ops::PointwiseConvPerChannel(
+                params, multiplier.data(), shift.data(), input_shape, input.data(),
+                filter_shape, filter.data(), bias_shape, folded_bias.data(),
+                output_shape, pointwise.data(), packed_filter);
+            ok = tflite::testing::ExpectEqual((name + "/pointwise").c_str(),
+                                              expected, pointwise) && ok;
+        }
+    }
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    const ConvCase kCases[] = {
+        // name                 batch  h   w   cin cout k  s  d  p
+        {"pw_48x48x8_16",         1,  48, 48,   8,  16, 1, 1, 1, 0},
+        {"pw_24x24x32_32",        1,  24, 24,  32,  32, 1, 1, 1, 0},
+        {"pw_6x6x128_128",        1,   6,  6, 128, 128, 1, 1, 1, 0},
+        {"pw_3x3x256_256",        1,   3,  3, 256, 256, 1, 1, 1, 0},
+        {"pw_1x1x256_2",          1,   1,  1, 256,   2, 1, 1, 1, 0},
+        {"pw_3x3x64_64_batch4",   4,   3,  3,  64,  64, 1, 1, 1, 0},
+        {"pw_1x1x256_2_batch8",   8,   1,  1, 256,   2, 1, 1, 1, 0},
+        {"pw_odd_channels",       2,   7,  5,  13,  11, 1, 1, 1, 0},
+        {"pw_stride2",            1,  12, 12,  32,  64, 1, 2, 1, 0},
+        {"pw_stride2_odd",        2,  11,  9,  19,  13, 1, 2, 1, 0},
+        {"conv_3x3_s1_pad1",      1,  10, 10,   8,  12, 3, 1, 1, 1},
+        {"conv_3x3_s2_pad1",      2,  15, 13,   3,   8, 3, 2, 1, 1},
+        {"conv_3x3_s2_batch3",    3,  17, 11,   1,   8, 3, 2, 1, 1},
+        {"conv_3x3_dilation2",    1,   9,  9,   5,   7, 3, 1, 2, 2},
+        {"conv_5x5_s2_pad2",      1,  16, 16,   4,   6, 5, 2, 1, 2},
+        {"conv_5x5_on_4x4",       1,   4,  4,   3,   5, 5, 1, 1, 2},
+    };
+
+    tflite::testing::TestRng rng(0xc0ffee);
+    int failures = 0;
+    for (const ConvCase &c : kCases) {
+        if (!RunCase(c, &rng)) {
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the deferred log of deferred_log.h: drained records format like
+// printf, long strings come out whole, the ring wraps, a full ring drops and
+// reports records instead of blocking, and concurrent writers keep the order
+// of their records. It also compares the cost of a record with formatting
+// the same line. It leaves a hex capture and the text it must
+// decode to in the directory given as argument, deferred_log_samples by
+// default, for the host/decode_log.py test.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deferred_log.h"
+
+namespace {
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+void Collect(void *context, const char *text, uint32_t length)
+{
+    static_cast<std::string *>(context)->append(text, length);
+}
+
+void CollectLines(void *context, const char *text, uint32_t length)
+{
+    static_cast<std::vector<std::string> *>(context)->emplace_back(text, length);
+}
+
+std::string DrainText()
+{
+    std::string text;
+    deferred_log_drain_text(Collect, &text, 0);
+    return text;
+}
+
+// Records of every kind, including a negative argument and a text longer
+// than a record.
+void WriteSamples(const std::string &long_text)
+{
+    const int8_t person = -97;
+    const int8_t no_person = 96;
+    const uint32_t frame_args[] = {7, static_cast<uint32_t>(person),
+                                   static_cast<uint32_t>(no_person), 0, 41};
+    deferred_log_write(DLOG_FRAME_RESULT, 5, frame_args);
+    const uint32_t entered[] = {8};
+    deferred_log_write(DLOG_PERSON_ENTERED, 1, entered);
+    const uint32_t stats[] = {16, 520, 30, 76, 5, 11};
+    deferred_log_write(DLOG_PIPELINE_STATS, 6, stats);
+    const uint32_t stage[] = {95, 1125};
+    deferred_log_write(DLOG_PIPELINE_INFERENCE, 2, stage);
+    deferred_log_text("Node CONV_2D (number 3) failed to invoke\r\n");
+    deferred_log_text(long_text.c_str());
+}
+
+bool TestFormat(const std::string &long_text)
+{
+    bool ok = true;
+    deferred_log_reset();
+    WriteSamples(long_text);
+    char expected[512];
+    snprintf(expected, sizeof(expected),
+             "frame %u: person score:%d no person score %d, present %d, %u ms since the last "
+             "frame\r\n"
+             "frame %u: person entered\r\n"
+             "pipeline: %u frames in %u ms, %u.%02u fps, %u inferences, %u skipped\r\n"
+             "  inference  %3u%% busy, %u us per frame\r\n",
+             7u, -97, 96, 0, 41u, 8u, 16u, 520u, 30u, 76u, 5u, 11u, 95u, 1125u);
+    const std::string text = DrainText();
+    ok = Expect(text == std::string(expected) + "Node CONV_2D (number 3) failed to invoke\r\n" +
+                            long_text,
+                "records format like printf") && ok;
+    ok = Expect(DrainText().empty(), "drained ring is empty") && ok;
+
+    const uint32_t args[DEFERRED_LOG_MAX_ARGS + 1] = {};
+    ok = Expect(deferred_log_write(DEFERRED_LOG_FORMAT_COUNT, 0, args) == -1 &&
+                    deferred_log_write(DLOG_TEXT, 0, args) == -1 &&
+                    deferred_log_write(DLOG_PERSON_LEFT, DEFERRED_LOG_MAX_ARGS + 1, args) ==
+                        -1 &&
+                    deferred_log_write(DLOG_PERSON_LEFT, 1, nullptr) == -1 &&
+                    deferred_log_text(nullptr) == -1,
+                "invalid records rejected") && ok;
+    return ok;
+}
+
+bool TestWrapAndDrops()
+{
+    bool ok = true;
+    deferred_log_reset();
+    // Records of 3 words do not divide the ring, so they straddle its end.
+    bool same = true;
+    for (uint32_t i = 0; i < 5 * DEFERRED_LOG_WORDS; ++i) {
+        const uint32_t frame[] = {i};
+        deferred_log_write(DLOG_PERSON_LEFT, 1, frame);
+        if (i % 97 == 96) {
+            deferred_log_text("x");
+            std::vector<std::string> lines;
+            deferred_log_drain_text(CollectLines, &lines, 0);
+            char last[64];
+            snprintf(last, sizeof(last), "frame %u: person left\r\n", i);
+            same = same && lines.size() == 98 && lines[96] == last && lines[97] == "x";
+        }
+    }
+    ok = Expect(same, "records survive the ring wrapping") && ok;
+    DrainText();
+
+    // A full ring drops records without blocking; the drops are reported
+    // after the records written before them.
+    const uint32_t capacity = DEFERRED_LOG_WORDS / 3;
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < capacity + 10; ++i) {
+        const uint32_t frame[] = {i};
+        written += deferred_log_write(DLOG_PERSON_LEFT, 1, frame) == 0;
+    }
+    ok = Expect(written == capacity && deferred_log_dropped() == 10, "full ring drops") && ok;
+    std::vector<std::string> lines;
+    ok = Expect(deferred_log_drain_text(CollectLines, &lines, 0) == capacity + 1 &&
+                    lines.back() == "[10 log records dropped]\r\n",
+                "drops reported") && ok;
+    lines.clear();
+    ok = Expect(deferred_log_drain_text(CollectLines, &lines, 0) == 0,
+                "drops reported once") && ok;
+    return ok;
+}
+
+// Writers on several threads against one draining thread, through the hex
+// lines: every record arrives once and in the order of its thread.
+bool TestConcurrentWriters()
+{
+    constexpr int kThreads = 4;
+    constexpr uint32_t kRecords = 20000;
+    deferred_log_reset();
+    std::vector<uint32_t> next(kThreads, 0);
+    uint32_t received = 0;
+    bool in_order = true;
+    auto parse = [&](const std::vector<std::string> &lines) {
+        for (const std::string &line : lines) {
+            unsigned header = 0;
+            unsigned timestamp = 0;
+            unsigned thread = 0;
+            unsigned sequence = 0;
+            if (sscanf(line.c_str(), "~%x %x %x %x", &header, &timestamp, &thread, &sequence) !=
+                4) {
+                continue;
+            }
+            if ((header & 0xffff) != DLOG_PIPELINE_CAPTURE || thread >= kThreads ||
+                sequence < next[thread]) {
+                in_order = false;
+                continue;
+            }
+            next[thread] = sequence + 1;
+            received++;
+        }
+    };
+
+    std::atomic<int> finished(0);
+    std::vector<std::thread> writers;
+    for (uint32_t t = 0; t < kThreads; ++t) {
+        writers.emplace_back([t, &finished]() {
+            for (uint32_t i = 0; i < kRecords; ++i) {
+                const uint32_t args[] = {t, i};
+                // Retried until the drain made room, so nothing is lost.
+                while (deferred_log_write(DLOG_PIPELINE_CAPTURE, 2, args) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+            finished++;
+        });
+    }
+    for (;;) {
+        // Read before draining, so the last drain sees every record.
+        const bool done = finished == kThreads;
+        std::vector<std::string> lines;
+        deferred_log_drain_hex(CollectLines, &lines, 0);
+        parse(lines);
+        if (done) {
+            break;
+        }
+    }
+    for (std::thread &writer : writers) {
+        writer.join();
+    }
+    bool ok = Expect(in_order, "records in the order of their thread");
+    ok = Expect(received == kThreads * kRecords, "every record received") && ok;
+    printf("concurrent writers: %u records, %u retried after a full ring\n", received,
+           deferred_log_dropped());
+    return ok;
+}
+
+bool WriteFile(const std::string &path, const std::string &data)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (fclose(file) == 0) && ok;
+}
+
+// Time of recording a frame result against formatting it, which is what a
+// printf costs before the UART.
+void ReportCost()
+{
+    constexpr int kRuns = 100000;
+    deferred_log_reset();
+    std::vector<std::string> lines;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRuns; ++i) {
+        const uint32_t args[] = {static_cast<uint32_t>(i), static_cast<uint32_t>(-97), 96, 1,
+                                 41};
+        deferred_log_write(DLOG_FRAME_RESULT, 5, args);
+        if (i % 256 == 255) {
+            deferred_log_reset();
+        }
+    }
+    const double record_ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count() /
+        kRuns;
+    char line[DEFERRED_LOG_MAX_LINE];
+    int sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRuns; ++i) {
+        sink += snprintf(line, sizeof(line),
+                         "frame %u: person score:%d no person score %d, present %d, %u ms since "
+                         "the last frame\r\n",
+                         static_cast<unsigned>(i), -97, 96, 1, 41u);
+    }
+    const double format_ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count() /
+        kRuns;
+    printf("frame result: record %.1f ns, snprintf %.1f ns (checksum %d)\n", record_ns,
+           format_ns, sink & 0xff);
+    deferred_log_reset();
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::string long_text;
+    for (int i = 0; long_text.size() < 3 * DEFERRED_LOG_MAX_TEXT; ++i) {
+        long_text += "profile line " + std::to_string(i) + ", ";
+    }
+    long_text += "\r\n";
+
+    bool ok = TestFormat(long_text);
+    ok = TestWrapAndDrops() && ok;
+    ok = TestConcurrentWriters() && ok;
+    ReportCost();
+
+    // A console capture for the decoder: text around the hex records, as a
+    // serial terminal records it, and the text it decodes to.
+    const std::string dir = (argc > 1) ? argv[1] : "deferred_log_samples";
+    mkdir(dir.c_str(), 0755);
+    deferred_log_reset();
+    WriteSamples(long_text);
+    std::string capture = "model load successfully!!\r\n";
+    deferred_log_drain_hex(Collect, &capture, 0);
+    deferred_log_reset();
+    WriteSamples(long_text);
+    std::string expected = "model load successfully!!\r\n" + DrainText();
+    ok = Expect(WriteFile(dir + "/capture.txt", capture) &&
+                    WriteFile(dir + "/expected.txt", expected),
+                "samples written") && ok;
+
+    printf("%s deferred_log\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
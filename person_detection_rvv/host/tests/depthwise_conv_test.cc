@@ -0,0 +1,139 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the channel-vectorized depthwise kernel bit-exact against the
+// reference kernel over the layer shapes used by the person detection model
+// plus a few edge cases (channel tails, dilation, images where most or all
+// pixels are on the border and need the bias correction).
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/depthwise_conv.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/depthwise_conv.h"
+
+namespace {
+
+struct DepthwiseCase {
+    const char *name;
+    int batches;
+    int height;
+    int width;
+    int in_depth;
+    int depth_multiplier;
+    int filter;
+    int stride;
+    int dilation;
+    int pad;
+};
+
+bool RunCase(const DepthwiseCase &c, tflite::testing::TestRng *rng)
+{
+    const int out_depth = c.in_depth * c.depth_multiplier;
+    const int out_h = tflite::testing::ConvOutputSize(c.height, c.filter, c.stride, c.dilation, c.pad);
+    const int out_w = tflite::testing::ConvOutputSize(c.width, c.filter, c.stride, c.dilation, c.pad);
+
+    const tflite::RuntimeShape input_shape({c.batches, c.height, c.width, c.in_depth});
+    const tflite::RuntimeShape filter_shape({1, c.filter, c.filter, out_depth});
+    const tflite::RuntimeShape bias_shape({out_depth});
+    const tflite::RuntimeShape output_shape({c.batches, out_h, out_w, out_depth});
+
+    std::vector<int8_t> input(input_shape.FlatSize());
+    std::vector<int8_t> filter(filter_shape.FlatSize());
+    std::vector<int32_t> bias(out_depth);
+    std::vector<int32_t> multiplier(out_depth);
+    std::vector<int32_t> shift(out_depth);
+    tflite::testing::FillInt8(rng, &input);
+    tflite::testing::FillInt8(rng, &filter);
+    for (int32_t &b : bias) {
+        b = rng->Uniform(-20000, 20000);
+    }
+    tflite::testing::FillQuantParams(rng, &multiplier, &shift);
+
+    tflite::DepthwiseParams params = {};
+    params.padding_values.width = c.pad;
+    params.padding_values.height = c.pad;
+    params.stride_width = c.stride;
+    params.stride_height = c.stride;
+    params.dilation_width_factor = c.dilation;
+    params.dilation_height_factor = c.dilation;
+    params.depth_multiplier = c.depth_multiplier;
+    params.input_offset = rng->Uniform(-127, 128);
+    params.output_offset = rng->Uniform(-128, 127);
+    params.quantized_activation_min = -128;
+    params.quantized_activation_max = 127;
+
+    std::vector<int32_t> folded_bias(out_depth);
+    std::vector<int32_t> border_bias(out_depth);
+    tflite::optimized_integer_ops::DepthwiseConvFoldInputOffset(
+        params.input_offset, filter_shape, filter.data(), bias.data(),
+        folded_bias.data());
+
+    std::vector<int8_t> expected(output_shape.FlatSize());
+    std::vector<int8_t> actual(output_shape.FlatSize());
+    tflite::reference_integer_ops::DepthwiseConvPerChannel(
+        params, multiplier.data(), shift.data(), input_shape, input.data(),
+        filter_shape, filter.data(), bias_shape, bias.data(), output_shape,
+        expected.data());
+    std::vector<int8_t> packed(filter_shape.FlatSize());
+    tflite::optimized_integer_ops::DepthwiseConvPackFilter(
+        filter_shape, filter.data(), packed.data());
+
+    // Run with the weights read in place and with the weights repacked in
+    // Prepare, the two configurations of the kernel registration.
+    bool ok = true;
+    for (int use_packed = 0; use_packed < 2; ++use_packed) {
+        const std::string name = std::string(c.name) + (use_packed ? "/packed" : "");
+        tflite::optimized_integer_ops::DepthwiseConvPerChannel(
+            params, multiplier.data(), shift.data(), input_shape, input.data(),
+            filter_shape, filter.data(), bias_shape, folded_bias.data(),
+            output_shape, actual.data(), border_bias.data(),
+            use_packed ? packed.data() : nullptr);
+        ok = tflite::testing::ExpectEqual(name.c_str(), expected, actual) && ok;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    const DepthwiseCase kCases[] = {
+        // name                batch  h   w   c  dm  k  s  d  p
+        {"dw_48x48x8_s1",        1,  48, 48,  8, 1, 3, 1, 1, 1},
+        {"dw_48x48x16_s2",       1,  48, 48, 16, 1, 3, 2, 1, 1},
+        {"dw_12x12x128_s1",      1,  12, 12, 128, 1, 3, 1, 1, 1},
+        {"dw_6x6x256_s2",        1,   6,  6, 256, 1, 3, 2, 1, 0},
+        {"dw_channel_tail",      2,   9,  7, 70, 1, 3, 1, 1, 1},
+        {"dw_6x6x64_batch4",     4,   6,  6, 64, 1, 3, 1, 1, 1},
+        {"dw_dilation",          1,  11, 11, 24, 1, 3, 1, 2, 2},
+        {"dw_5x5_pad2",          1,  10, 13, 33, 1, 5, 2, 1, 2},
+        {"dw_3x3_all_border",    1,   3,  3, 40, 1, 3, 1, 1, 1},
+        {"dw_single_column",     2,   7,  1, 16, 1, 3, 1, 1, 1},
+        {"dw_5x5_on_4x4",        1,   4,  4, 12, 1, 5, 1, 1, 2},
+    };
+
+    tflite::testing::TestRng rng(0x5eed);
+    int failures = 0;
+    for (const DepthwiseCase &c : kCases) {
+        if (!RunCase(c, &rng)) {
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
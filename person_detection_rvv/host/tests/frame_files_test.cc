@@ -0,0 +1,214 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the recorded frame files of host/frame_files.h: PGM headers, label
+// files, and the frames mapped from a directory and from a raw video. The
+// samples it writes (the person and no person images as PGM, a YUV420 video
+// with the images in its centre crop, and their labels) stay in the
+// directory given as argument, offline_samples by default, for the
+// person_detection_offline tests.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host/frame_files.h"
+#include "image_preprocess.h"
+#include "no_person_image_data.h"
+#include "person_image_data.h"
+
+namespace {
+
+constexpr int kSide = 96;
+constexpr int kVideoWidth = 400;
+constexpr int kVideoHeight = 300;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+bool WriteFile(const std::string &path, const void *data, size_t size)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool ok = fwrite(data, 1, size, file) == size;
+    return (fclose(file) == 0) && ok;
+}
+
+// The sample images hold int8 model input pixels; files hold gray levels.
+std::vector<uint8_t> GrayImage(const unsigned char *image)
+{
+    std::vector<uint8_t> gray(kSide * kSide);
+    for (int i = 0; i < kSide * kSide; ++i) {
+        gray[i] = static_cast<uint8_t>(static_cast<int8_t>(image[i]) + 128);
+    }
+    return gray;
+}
+
+std::vector<uint8_t> Pgm(const std::vector<uint8_t> &gray, const char *header)
+{
+    std::vector<uint8_t> pgm(header, header + strlen(header));
+    pgm.insert(pgm.end(), gray.begin(), gray.end());
+    return pgm;
+}
+
+// One YUV420 frame with image scaled into its centre 300x300 crop.
+void VideoFrame(const std::vector<uint8_t> &gray, uint8_t *frame)
+{
+    memset(frame, 128, kVideoWidth * kVideoHeight * 3 / 2);
+    const int crop_x = (kVideoWidth - kVideoHeight) / 2;
+    for (int y = 0; y < kVideoHeight; ++y) {
+        for (int x = 0; x < kVideoHeight; ++x) {
+            frame[y * kVideoWidth + crop_x + x] =
+                gray[(y * kSide / kVideoHeight) * kSide + x * kSide / kVideoHeight];
+        }
+    }
+}
+
+bool TestPgmHeader()
+{
+    bool ok = true;
+    const std::vector<uint8_t> gray(6, 7);
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pgm = Pgm(gray, "P5\n# comment\n3 2\n255\n");
+    ok = Expect(host::ParsePgmHeader(pgm.data(), pgm.size(), &width, &height) ==
+                        pgm.size() - gray.size() &&
+                    width == 3 && height == 2,
+                "PGM header with comment") && ok;
+    pgm = Pgm(gray, "P5 3 2 255 ");
+    ok = Expect(host::ParsePgmHeader(pgm.data(), pgm.size(), &width, &height) == 11,
+                "PGM header on one line") && ok;
+    pgm = Pgm(gray, "P2\n3 2\n255\n");
+    ok = Expect(host::ParsePgmHeader(pgm.data(), pgm.size(), &width, &height) == 0,
+                "ASCII PGM rejected") && ok;
+    pgm = Pgm(gray, "P5\n3 2\n65535\n");
+    ok = Expect(host::ParsePgmHeader(pgm.data(), pgm.size(), &width, &height) == 0,
+                "16 bit PGM rejected") && ok;
+    pgm = Pgm(gray, "P5\n3 3\n255\n");
+    ok = Expect(host::ParsePgmHeader(pgm.data(), pgm.size(), &width, &height) == 0,
+                "truncated PGM rejected") && ok;
+    return ok;
+}
+
+bool TestLabels(const std::string &dir)
+{
+    bool ok = true;
+    const std::string path = dir + "/labels_test.csv";
+    const char kLabels[] = "name,label\n# comment\n\na.pgm,1\nb.pgm,no_person\nv.yuv#3,person\n";
+    std::map<std::string, int> labels;
+    std::string error;
+    ok = Expect(WriteFile(path, kLabels, strlen(kLabels)) &&
+                    host::LoadLabels(path.c_str(), &labels, &error),
+                "LoadLabels") && ok;
+    ok = Expect(labels.size() == 3 && labels["a.pgm"] == 1 && labels["b.pgm"] == 0 &&
+                    labels["v.yuv#3"] == 1,
+                "labels parsed") && ok;
+    const char kBad[] = "name,label\na.pgm,1\nb.pgm,maybe\n";
+    ok = Expect(WriteFile(path, kBad, strlen(kBad)) &&
+                    !host::LoadLabels(path.c_str(), &labels, &error),
+                "bad label rejected") && ok;
+    remove(path.c_str());
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    const std::string dir = (argc > 1) ? argv[1] : "offline_samples";
+    const std::string images = dir + "/images";
+    mkdir(dir.c_str(), 0755);
+    mkdir(images.c_str(), 0755);
+    bool ok = TestPgmHeader();
+    ok = TestLabels(dir) && ok;
+
+    const std::vector<uint8_t> person = GrayImage(g_person_image_data);
+    const std::vector<uint8_t> no_person = GrayImage(g_no_person_image_data);
+    const std::vector<uint8_t> person_pgm = Pgm(person, "P5\n96 96\n255\n");
+    const std::vector<uint8_t> no_person_pgm = Pgm(no_person, "P5\n96 96\n255\n");
+    const size_t frame_size = kVideoWidth * kVideoHeight * 3 / 2;
+    std::vector<uint8_t> video(3 * frame_size + 100);
+    VideoFrame(person, video.data());
+    VideoFrame(no_person, video.data() + frame_size);
+    VideoFrame(person, video.data() + 2 * frame_size);
+    const char kLabels[] =
+        "name,label\nno_person.pgm,0\nperson.pgm,1\nvideo.yuv#0,1\nvideo.yuv#1,0\n"
+        "video.yuv#2,1\n";
+    if (!WriteFile(images + "/person.pgm", person_pgm.data(), person_pgm.size()) ||
+        !WriteFile(images + "/no_person.pgm", no_person_pgm.data(), no_person_pgm.size()) ||
+        !WriteFile(images + "/notes.txt", "ignored", 7) ||
+        !WriteFile(dir + "/video.yuv", video.data(), video.size()) ||
+        !WriteFile(dir + "/labels.csv", kLabels, strlen(kLabels))) {
+        printf("FAIL cannot write the samples to %s\n", dir.c_str());
+        return 1;
+    }
+
+    // A directory gives its PGM files in name order, which preprocess back
+    // to the sample images.
+    const preprocess_frame_t raw_layout = {PREPROCESS_FORMAT_GRAY8, kSide, kSide, 0};
+    std::vector<host::MappedFile> files;
+    std::vector<host::Frame> frames;
+    std::string error;
+    ok = Expect(host::CollectFrames(images.c_str(), raw_layout, &files, &frames, &error),
+                "CollectFrames on a directory") && ok;
+    ok = Expect(frames.size() == 2 && files.size() == 2 && frames[0].name == "no_person.pgm" &&
+                    frames[1].name == "person.pgm",
+                "PGM files in name order") && ok;
+    if (frames.size() == 2) {
+        ok = Expect(frames[1].layout.format == PREPROCESS_FORMAT_GRAY8 &&
+                        frames[1].layout.width == kSide && frames[1].layout.height == kSide &&
+                        memcmp(frames[1].pixels, person.data(), person.size()) == 0,
+                    "PGM pixels mapped") && ok;
+        preprocess_plan_t plan;
+        std::vector<int8_t> input(kSide * kSide);
+        preprocess_plan_init(&plan, &frames[1].layout, 0, 0, kSide, kSide, kSide, kSide);
+        preprocess_frame_to_input(&plan, frames[1].pixels, input.data());
+        ok = Expect(memcmp(input.data(), g_person_image_data, input.size()) == 0,
+                    "PGM preprocesses to the sample image") && ok;
+    }
+
+    // A video is cut into frames, without the trailing partial one.
+    const preprocess_frame_t yuv = {PREPROCESS_FORMAT_YUV420, kVideoWidth, kVideoHeight, 0};
+    files.clear();
+    frames.clear();
+    const std::string video_path = dir + "/video.yuv";
+    ok = Expect(host::CollectFrames(video_path.c_str(), yuv, &files, &frames, &error),
+                "CollectFrames on a video") && ok;
+    ok = Expect(frames.size() == 3 && frames[2].name == "video.yuv#2" &&
+                    frames[2].pixels == files[0].data() + 2 * frame_size,
+                "video frames") && ok;
+
+    files.clear();
+    frames.clear();
+    ok = Expect(!host::CollectFrames((dir + "/missing").c_str(), yuv, &files, &frames, &error),
+                "missing path rejected") && ok;
+    mkdir((dir + "/empty").c_str(), 0755);
+    ok = Expect(!host::CollectFrames((dir + "/empty").c_str(), yuv, &files, &frames, &error),
+                "directory without frames rejected") && ok;
+
+    printf("%s frame_files\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef PERSON_DETECTION_HOST_TESTS_KERNEL_TEST_UTIL_H_
+#define PERSON_DETECTION_HOST_TESTS_KERNEL_TEST_UTIL_H_
+
+// Small helpers shared by the host kernel tests. Each test is a plain
+// executable that returns non-zero on failure so ctest can run it.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace tflite {
+namespace testing {
+
+// Deterministic xorshift generator so failures are reproducible.
+class TestRng {
+public:
+    explicit TestRng(uint32_t seed) : state_(seed ? seed : 1u) {}
+
+    uint32_t Next()
+    {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+    // Uniform value in [lo, hi].
+    int32_t Uniform(int32_t lo, int32_t hi)
+    {
+        return lo + static_cast<int32_t>(Next() % static_cast<uint32_t>(hi - lo + 1));
+    }
+
+private:
+    uint32_t state_;
+};
+
+inline void FillInt8(TestRng *rng, std::vector<int8_t> *data)
+{
+    for (int8_t &v : *data) {
+        v = static_cast<int8_t>(rng->Uniform(-128, 127));
+    }
+}
+
+// Per-channel requantization parameters in the range produced by
+// QuantizeMultiplier() for typical conv layers.
+inline void FillQuantParams(TestRng *rng, std::vector<int32_t> *multiplier,
+                            std::vector<int32_t> *shift)
+{
+    for (size_t i = 0; i < multiplier->size(); ++i) {
+        (*multiplier)[i] = rng->Uniform(1 << 30, 0x7fffffff);
+        (*shift)[i] = rng->Uniform(-10, -5);
+    }
+}
+
+// Compares two int8 buffers element by element. Prints the first mismatch.
+inline bool ExpectEqual(const char *name, const std::vector<int8_t> &expected,
+                        const std::vector<int8_t> &actual)
+{
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i] != actual[i]) {
+            printf("FAIL %s: index %zu expected %d got %d\n", name, i,
+                   expected[i], actual[i]);
+            return false;
+        }
+    }
+    printf("PASS %s\n", name);
+    return true;
+}
+
+// Output size of a convolution window along one dimension.
+inline int ConvOutputSize(int input, int filter, int stride, int dilation, int pad)
+{
+    const int effective_filter = (filter - 1) * dilation + 1;
+    return (input + 2 * pad - effective_filter) / stride + 1;
+}
+
+} // namespace testing
+} // namespace tflite
+
+#endif // PERSON_DETECTION_HOST_TESTS_KERNEL_TEST_UTIL_H_
@@ -0,0 +1,130 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the sliding window localization of localize.h: the pyramid sizes and
+// window grid, the pyramid levels against the preprocessing of the whole
+// frame, and that a person pasted into the side band, which the centre crop
+// only half sees, is found there and heats up its side of the map.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "localize.h"
+#include "main_functions.h"
+#include "no_person_image_data.h"
+#include "person_image_data.h"
+
+namespace {
+
+constexpr int kWidth = 400;
+constexpr int kHeight = 300;
+constexpr int kSide = 96;
+const int kWindowSizes[] = {300, 200, 150};
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+// Nearest neighbour copy of a 96x96 int8 model image into a w x h region of a
+// luma plane.
+void Paste(const unsigned char *image, int x0, int y0, int w, int h, uint8_t *plane)
+{
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const int8_t value =
+                static_cast<int8_t>(image[(y * kSide / h) * kSide + x * kSide / w]);
+            plane[(y0 + y) * kWidth + x0 + x] = static_cast<uint8_t>(value + 128);
+        }
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    bool ok = true;
+    init_model();
+    model_input_t model_input;
+    if (get_model_input(&model_input) != 0) {
+        printf("FAIL get_model_input\n");
+        return 1;
+    }
+
+    const preprocess_frame_t layout = {PREPROCESS_FORMAT_YUV420, kWidth, kHeight, 0};
+    const uint32_t pyramid_size = localize_pyramid_size(&layout, kWindowSizes, 3, kSide);
+    // 128x96, 192x144 and 256x192 levels.
+    ok = Expect(pyramid_size == 128 * 96 + 192 * 144 + 256 * 192, "pyramid size") && ok;
+    const int too_small[] = {64};
+    const int too_large[] = {301};
+    ok = Expect(localize_pyramid_size(&layout, too_small, 1, kSide) == 0,
+                "window smaller than the model rejected") && ok;
+    ok = Expect(localize_pyramid_size(&layout, too_large, 1, kSide) == 0,
+                "window taller than the frame rejected") && ok;
+
+    std::vector<int8_t> pyramid(pyramid_size);
+    localize_t localize;
+    ok = Expect(localize_init(&localize, &layout, kWindowSizes, 3, kSide, nullptr) == -1,
+                "null pyramid rejected") && ok;
+    if (localize_init(&localize, &layout, kWindowSizes, 3, kSide, pyramid.data()) != 0) {
+        printf("FAIL localize_init\n");
+        return 1;
+    }
+    // 2x1, 3x2 and 5x3 windows.
+    ok = Expect(localize_window_count(&localize) == 2 + 6 + 15, "window count") && ok;
+
+    // Background without a person, stretched over the frame, and a person in
+    // the right band, which the centre crop (x 50 to 350) only half sees.
+    std::vector<uint8_t> frame(preprocess_frame_size(&layout), 128);
+    Paste(g_no_person_image_data, 0, 0, kWidth, kHeight, frame.data());
+    Paste(g_person_image_data, kWidth - 150, 75, 150, 150, frame.data());
+
+    localize_build_pyramid(&localize, frame.data());
+    localize_result_t result;
+    ok = Expect(localize_run(&localize, &model_input, &result) == 0, "localize_run") && ok;
+    ok = Expect(result.windows == localize_window_count(&localize), "every window run") && ok;
+
+    // The finest level is the whole frame resized to 256x192.
+    preprocess_plan_t plan;
+    const localize_level_t &fine = localize.levels[2];
+    preprocess_plan_init(&plan, &layout, 0, 0, kWidth, kHeight, fine.width, fine.height);
+    std::vector<int8_t> level(fine.width * fine.height);
+    preprocess_frame_to_input(&plan, frame.data(), level.data());
+    ok = Expect(memcmp(level.data(), fine.image, level.size()) == 0, "pyramid level") && ok;
+
+    printf("best window x %d y %d size %d person %d no_person %d\n", result.best.x,
+           result.best.y, result.best.size, result.best.person_score,
+           result.best.no_person_score);
+    for (int y = 0; y < LOCALIZE_HEAT_HEIGHT; ++y) {
+        for (int x = 0; x < LOCALIZE_HEAT_WIDTH; ++x) {
+            printf("%5d", result.heat[y][x]);
+        }
+        printf("\n");
+    }
+    const int best_centre_x = result.best.x + result.best.size / 2;
+    ok = Expect(result.best.person_score > result.best.no_person_score, "person found") && ok;
+    ok = Expect(best_centre_x > kWidth / 2, "person found in the right half") && ok;
+    ok = Expect(result.heat[LOCALIZE_HEAT_HEIGHT / 2][LOCALIZE_HEAT_WIDTH - 1] >
+                    result.heat[LOCALIZE_HEAT_HEIGHT / 2][0],
+                "heat higher at the person") && ok;
+
+    printf("%s localize\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the SearchMemoryPlanner: on random buffer sets its plans never
+// overlap, never need more than the GreedyMemoryPlanner's nor less than the
+// lower bound, and beat the greedy plan on some sets; offline planned
+// buffers keep their offsets; and the model planned with it
+// (MicroInterpreter::SetMemoryPlanner()) scores as with the greedy planner.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "model_settings.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
+#include "tensorflow/lite/micro/memory_planner/search_memory_planner.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr int kScratchSize = 16 * 1024;
+// Large enough for the model with filter packing, as in the firmware.
+constexpr size_t kArenaSize = 512 * 1024;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+struct Buffer {
+    int size;
+    int first_time_used;
+    int last_time_used;
+    int offline_offset;
+};
+
+tflite::MicroErrorReporter error_reporter;
+
+template <typename Planner>
+bool AddBuffers(Planner *planner, const std::vector<Buffer> &buffers)
+{
+    for (const Buffer &buffer : buffers) {
+        const TfLiteStatus status =
+            buffer.offline_offset == tflite::kOnlinePlannedBuffer
+                ? planner->AddBuffer(&error_reporter, buffer.size, buffer.first_time_used,
+                                     buffer.last_time_used)
+                : planner->AddBuffer(&error_reporter, buffer.size, buffer.first_time_used,
+                                     buffer.last_time_used, buffer.offline_offset);
+        if (status != kTfLiteOk) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Buffer> RandomBuffers(tflite::testing::TestRng *rng)
+{
+    std::vector<Buffer> buffers(rng->Uniform(2, 40));
+    const int time_steps = rng->Uniform(2, 24);
+    for (Buffer &buffer : buffers) {
+        buffer.size = 16 * rng->Uniform(1, 64);
+        buffer.first_time_used = rng->Uniform(0, time_steps - 1);
+        buffer.last_time_used = buffer.first_time_used + rng->Uniform(0, 6);
+        buffer.offline_offset = tflite::kOnlinePlannedBuffer;
+    }
+    return buffers;
+}
+
+bool TestRandom()
+{
+    static unsigned char greedy_scratch[kScratchSize];
+    static unsigned char search_scratch[kScratchSize];
+    tflite::testing::TestRng rng(17);
+    bool ok = true;
+    int improved = 0;
+    int at_bound = 0;
+    size_t greedy_total = 0;
+    size_t search_total = 0;
+    constexpr int kSets = 300;
+    for (int set = 0; set < kSets; ++set) {
+        const std::vector<Buffer> buffers = RandomBuffers(&rng);
+        tflite::GreedyMemoryPlanner greedy(greedy_scratch, kScratchSize);
+        tflite::SearchMemoryPlanner search(search_scratch, kScratchSize);
+        if (!Expect(AddBuffers(&greedy, buffers) && AddBuffers(&search, buffers),
+                    "buffers added")) {
+            return false;
+        }
+        const size_t greedy_size = greedy.GetMaximumMemorySize();
+        const size_t search_size = search.GetMaximumMemorySize();
+        ok = Expect(!search.DoAnyBuffersOverlap(&error_reporter), "no overlaps") && ok;
+        ok = Expect(search_size <= greedy_size, "never worse than greedy") && ok;
+        ok = Expect(search_size >= search.GetLowerBound(), "not below the lower bound") && ok;
+        ok = Expect(search.search_steps_used() <=
+                        tflite::SearchMemoryPlanner::kDefaultSearchSteps,
+                    "search steps bounded") && ok;
+        size_t end = 0;
+        for (int i = 0; i < search.GetBufferCount(); ++i) {
+            int offset = -1;
+            search.GetOffsetForBuffer(&error_reporter, i, &offset);
+            end = std::max(end, static_cast<size_t>(offset + buffers[i].size));
+        }
+        ok = Expect(end == search_size, "size is the end of the last buffer") && ok;
+        improved += search_size < greedy_size;
+        at_bound += search_size == search.GetLowerBound();
+        greedy_total += greedy_size;
+        search_total += search_size;
+    }
+    printf("random sets: %d of %d smaller than greedy, %d at the lower bound, %zu bytes "
+           "against %zu\n",
+           improved, kSets, at_bound, search_total, greedy_total);
+    ok = Expect(improved > 0, "some sets smaller than greedy") && ok;
+    return ok;
+}
+
+// Largest first fails here: the 40 byte buffer used last goes to offset 0,
+// the other 40 byte buffer on top of it, and of the two 24 byte buffers
+// alive with that one only the first fits below it. 88 bytes are enough.
+bool TestAdversarial()
+{
+    static unsigned char scratch[kScratchSize];
+    const std::vector<Buffer> buffers = {
+        {24, 0, 1, tflite::kOnlinePlannedBuffer},
+        {40, 0, 2, tflite::kOnlinePlannedBuffer},
+        {24, 0, 1, tflite::kOnlinePlannedBuffer},
+        {40, 2, 4, tflite::kOnlinePlannedBuffer},
+    };
+    tflite::GreedyMemoryPlanner greedy(scratch, kScratchSize);
+    AddBuffers(&greedy, buffers);
+    const size_t greedy_size = greedy.GetMaximumMemorySize();
+    tflite::SearchMemoryPlanner search(scratch, kScratchSize);
+    AddBuffers(&search, buffers);
+    const size_t search_size = search.GetMaximumMemorySize();
+    printf("adversarial set: greedy %zu bytes, search %zu, lower bound %zu\n", greedy_size,
+           search_size, search.GetLowerBound());
+    bool ok = Expect(!search.DoAnyBuffersOverlap(&error_reporter), "adversarial no overlaps");
+    ok = Expect(greedy_size == 104 && search_size == 88 && search.GetLowerBound() == 88,
+                "adversarial set at the bound") && ok;
+    return ok;
+}
+
+bool TestOfflineAndLimits()
+{
+    static unsigned char scratch[kScratchSize];
+    bool ok = true;
+    {
+        const std::vector<Buffer> buffers = {
+            {64, 0, 4, 128},
+            {48, 0, 1, tflite::kOnlinePlannedBuffer},
+            {48, 2, 3, 0},
+            {80, 1, 2, tflite::kOnlinePlannedBuffer},
+            {32, 3, 4, tflite::kOnlinePlannedBuffer},
+        };
+        tflite::SearchMemoryPlanner search(scratch, kScratchSize);
+        AddBuffers(&search, buffers);
+        int offline[2] = {-1, -1};
+        search.GetOffsetForBuffer(&error_reporter, 0, &offline[0]);
+        search.GetOffsetForBuffer(&error_reporter, 2, &offline[1]);
+        ok = Expect(offline[0] == 128 && offline[1] == 0, "offline offsets kept") && ok;
+        ok = Expect(!search.DoAnyBuffersOverlap(&error_reporter), "offline no overlaps") && ok;
+        ok = Expect(search.GetMaximumMemorySize() >= 192, "offline buffers in the size") && ok;
+    }
+    {
+        tflite::SearchMemoryPlanner search(scratch, kScratchSize);
+        ok = Expect(search.GetMaximumMemorySize() == 0, "no buffers, no memory") && ok;
+        int offset = 0;
+        ok = Expect(search.GetOffsetForBuffer(&error_reporter, 0, &offset) != kTfLiteOk,
+                    "offset of a missing buffer rejected") && ok;
+    }
+    {
+        const int size = tflite::SearchMemoryPlanner::per_buffer_size() * 3 + sizeof(int);
+        tflite::SearchMemoryPlanner search(scratch, size);
+        const std::vector<Buffer> buffers(4, {16, 0, 0, tflite::kOnlinePlannedBuffer});
+        ok = Expect(!AddBuffers(&search, buffers) && search.GetBufferCount() == 3,
+                    "buffers beyond the scratch rejected") && ok;
+    }
+    {
+        // No search keeps the best heuristic layout, which is never smaller.
+        tflite::testing::TestRng rng(5);
+        static unsigned char other_scratch[kScratchSize];
+        bool never_smaller = true;
+        for (int set = 0; set < 50; ++set) {
+            const std::vector<Buffer> buffers = RandomBuffers(&rng);
+            tflite::SearchMemoryPlanner heuristic(scratch, kScratchSize, 0);
+            tflite::SearchMemoryPlanner search(other_scratch, kScratchSize);
+            AddBuffers(&heuristic, buffers);
+            AddBuffers(&search, buffers);
+            never_smaller = never_smaller && heuristic.search_steps_used() == 0 &&
+                            heuristic.GetMaximumMemorySize() >= search.GetMaximumMemorySize() &&
+                            !heuristic.DoAnyBuffersOverlap(&error_reporter);
+        }
+        ok = Expect(never_smaller, "search refines the heuristic layouts") && ok;
+    }
+    return ok;
+}
+
+struct Run {
+    bool ok;
+    size_t arena_used;
+    int8_t scores[2];
+};
+
+Run Classify(tflite::MemoryPlannerType planner_type, int patch_ops, uint8_t *arena)
+{
+    static tflite::MicroMutableOpResolver<5> resolver;
+    if (resolver.GetRegistrationLength() == 0) {
+        resolver.AddAveragePool2D();
+        resolver.AddConv2D(tflite::Register_CONV_2D());
+        resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+        resolver.AddReshape();
+        resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    }
+    const tflite::Model *model = tflite::GetModel(g_person_detect_model_data);
+    Run run = {};
+    tflite::MicroInterpreter interpreter(model, resolver, arena, kArenaSize, &error_reporter);
+    if (interpreter.SetMemoryPlanner(planner_type) != kTfLiteOk ||
+        interpreter.SetPatchExecution(patch_ops, 4) != kTfLiteOk ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return run;
+    }
+    run.arena_used = interpreter.arena_used_bytes();
+    memcpy(interpreter.input(0)->data.int8, g_person_image_data,
+           kNumCols * kNumRows * kNumChannels);
+    run.ok = interpreter.Invoke() == kTfLiteOk &&
+             interpreter.SetMemoryPlanner(tflite::MemoryPlannerType::kGreedy) != kTfLiteOk;
+    run.scores[0] = interpreter.output(0)->data.int8[kPersonIndex];
+    run.scores[1] = interpreter.output(0)->data.int8[kNotAPersonIndex];
+    return run;
+}
+
+bool TestModel(uint8_t *arena)
+{
+    bool ok = true;
+    for (int patch_ops : {0, 4}) {
+        const Run greedy = Classify(tflite::MemoryPlannerType::kGreedy, patch_ops, arena);
+        const Run search = Classify(tflite::MemoryPlannerType::kSearch, patch_ops, arena);
+        printf("model, %d ops in patches: arena %zu bytes greedy, %zu search\n", patch_ops,
+               greedy.arena_used, search.arena_used);
+        ok = Expect(greedy.ok && search.ok, "model planned and run") && ok;
+        ok = Expect(search.arena_used <= greedy.arena_used, "model arena not larger") && ok;
+        ok = Expect(search.scores[0] == greedy.scores[0] && search.scores[1] == greedy.scores[1],
+                    "model scores unchanged") && ok;
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<uint8_t> arena(kArenaSize + 16);
+    uint8_t *aligned_arena =
+        reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(arena.data()) + 15) & ~uintptr_t(15));
+
+    bool ok = TestRandom();
+    ok = TestAdversarial() && ok;
+    ok = TestOfflineAndLimits() && ok;
+    ok = TestModel(aligned_arena) && ok;
+
+    printf("%s memory_planner\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks tiered memory placement: SimpleMemoryAllocator puts persistent
+// allocations in its slow region unless asked for the fast one, the slow
+// memory policies of MicroInterpreter move the metadata and the kernel data
+// out of the arena without changing the scores, and the placement report
+// (host/region_placement.h) finds the buffers where the policy put them.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "host/region_placement.h"
+#include "model_settings.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/simple_memory_allocator.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr int kImageSize = kNumCols * kNumRows * kNumChannels;
+constexpr size_t kArenaSize = 512 * 1024;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+uint8_t *Aligned(std::vector<uint8_t> *buffer)
+{
+    return reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(buffer->data()) + 15) & ~uintptr_t(15));
+}
+
+bool Inside(const void *pointer, const uint8_t *region, size_t size)
+{
+    const uint8_t *address = static_cast<const uint8_t *>(pointer);
+    return address >= region && address < region + size;
+}
+
+bool TestSimpleMemoryAllocator()
+{
+    tflite::MicroErrorReporter error_reporter;
+    alignas(16) uint8_t arena[256];
+    alignas(16) uint8_t slow[128];
+    tflite::SimpleMemoryAllocator allocator(&error_reporter, arena, sizeof(arena));
+
+    bool ok = Expect(Inside(allocator.AllocateFromTail(16, 16), arena, sizeof(arena)),
+                     "tail without a slow region");
+    ok = Expect(allocator.SetSlowRegion(slow, sizeof(slow)) == kTfLiteOk, "set slow region") &&
+         ok;
+    ok = Expect(allocator.SetSlowRegion(slow, sizeof(slow)) == kTfLiteError,
+                "second slow region is rejected") &&
+         ok;
+    uint8_t *persistent = allocator.AllocateFromTail(20, 16);
+    ok = Expect(Inside(persistent, slow, sizeof(slow)), "persistent data in the slow region") &&
+         ok;
+    ok = Expect(reinterpret_cast<uintptr_t>(persistent) % 16 == 0, "slow region alignment") && ok;
+    ok = Expect(allocator.GetSlowUsedBytes() == 32, "slow used bytes") && ok;
+    ok = Expect(Inside(allocator.AllocateFromTail(16, 16, tflite::MemoryRegion::kFast), arena,
+                       sizeof(arena)),
+                "fast data in the arena") &&
+         ok;
+    ok = Expect(allocator.GetTailUsedBytes() == 32, "tail used bytes") && ok;
+    ok = Expect(allocator.AllocateFromTail(128, 16) == nullptr, "slow region runs out") && ok;
+    ok = Expect(allocator.GetSlowUsedBytes() == 32, "failed allocation takes nothing") && ok;
+    return ok;
+}
+
+struct Run {
+    bool ok;
+    size_t arena_used;
+    size_t slow_used;
+    int8_t scores[2];
+    const void *input;
+};
+
+Run RunModel(uint8_t *arena, uint8_t *slow, const tflite::SlowMemoryPolicy *policy)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    static tflite::MicroErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(g_person_detect_model_data), resolver,
+                                         arena, kArenaSize, &error_reporter);
+    Run run = {};
+    if ((policy != nullptr &&
+         interpreter.SetSlowMemoryRegion(slow, kArenaSize, *policy) != kTfLiteOk) ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return run;
+    }
+    memcpy(interpreter.input(0)->data.int8, g_person_image_data, kImageSize);
+    if (interpreter.Invoke() != kTfLiteOk) {
+        return run;
+    }
+    run.ok = true;
+    run.arena_used = interpreter.arena_used_bytes();
+    run.slow_used = interpreter.slow_region_used_bytes();
+    run.scores[0] = interpreter.output(0)->data.int8[kPersonIndex];
+    run.scores[1] = interpreter.output(0)->data.int8[kNotAPersonIndex];
+    run.input = interpreter.input(0)->data.raw;
+    run.ok = Expect(interpreter.SetSlowMemoryRegion(slow, kArenaSize,
+                                                    tflite::SlowMemoryPolicy::kMetadata) ==
+                        kTfLiteError,
+                    "slow region after AllocateTensors() is rejected");
+    return run;
+}
+
+bool TestPolicies(uint8_t *arena, uint8_t *slow)
+{
+    const tflite::SlowMemoryPolicy metadata = tflite::SlowMemoryPolicy::kMetadata;
+    const tflite::SlowMemoryPolicy kernel_data = tflite::SlowMemoryPolicy::kMetadataAndKernelData;
+    const Run fast = RunModel(arena, slow, nullptr);
+    const Run tiered = RunModel(arena, slow, &metadata);
+    const Run tiered_kernel = RunModel(arena, slow, &kernel_data);
+
+    bool ok = Expect(fast.ok && tiered.ok && tiered_kernel.ok, "runs");
+    ok = Expect(fast.slow_used == 0, "no slow region, no slow bytes") && ok;
+    ok = Expect(tiered.slow_used > 0 && tiered.arena_used < fast.arena_used,
+                "metadata leaves the arena") &&
+         ok;
+    ok = Expect(tiered_kernel.slow_used > tiered.slow_used &&
+                    tiered_kernel.arena_used < tiered.arena_used,
+                "kernel data leaves the arena") &&
+         ok;
+    ok = Expect(memcmp(tiered.scores, fast.scores, 2) == 0 &&
+                    memcmp(tiered_kernel.scores, fast.scores, 2) == 0,
+                "placements score the same") &&
+         ok;
+    ok = Expect(Inside(tiered_kernel.input, arena, kArenaSize), "activations stay in the arena") &&
+         ok;
+    return ok;
+}
+
+bool TestReport()
+{
+    host::PlacementReport reports[host::kPlacementCount];
+    bool ok = true;
+    for (int i = 0; i < host::kPlacementCount; ++i) {
+        std::string error;
+        if (!Expect(host::ProfilePlacement(g_person_detect_model_data,
+                                           static_cast<host::Placement>(i),
+                                           host::kDefaultRegionCost, &reports[i], &error),
+                    host::PlacementName(static_cast<host::Placement>(i)))) {
+            printf("  %s\n", error.c_str());
+            return false;
+        }
+        ok = Expect(memcmp(reports[i].scores, reports[0].scores, sizeof(reports[0].scores)) == 0,
+                    "report scores") &&
+             ok;
+        size_t traffic = 0;
+        size_t reference = 0;
+        for (int region = 0; region < host::kRegionCount; ++region) {
+            traffic += reports[i].traffic_bytes[region];
+            reference += reports[0].traffic_bytes[region];
+        }
+        ok = Expect(traffic == reference && traffic > 0, "same traffic in every placement") && ok;
+    }
+
+    const host::PlacementReport &fast = reports[0];
+    const host::PlacementReport &tiered = reports[1];
+    const host::PlacementReport &tiered_kernel = reports[2];
+    const host::PlacementReport &slow = reports[3];
+    ok = Expect(fast.traffic_bytes[static_cast<int>(host::Region::kSlow)] == 0 &&
+                    slow.traffic_bytes[static_cast<int>(host::Region::kFast)] == 0,
+                "single region placements") &&
+         ok;
+    ok = Expect(fast.total_memory_us < tiered.total_memory_us &&
+                    tiered.total_memory_us <= tiered_kernel.total_memory_us &&
+                    tiered_kernel.total_memory_us < slow.total_memory_us,
+                "memory time grows with the slow data") &&
+         ok;
+    ok = Expect(tiered_kernel.minimum_arena_bytes < tiered.minimum_arena_bytes &&
+                    tiered.minimum_arena_bytes < fast.minimum_arena_bytes &&
+                    slow.minimum_arena_bytes == fast.minimum_arena_bytes,
+                "smaller arenas") &&
+         ok;
+
+    // Activations stay fast; eval tensors and, with the kernel data, the op
+    // data of the conv kernels go slow.
+    const std::string input =
+        "tensor " + std::to_string(tflite::GetModel(g_person_detect_model_data)
+                                       ->subgraphs()
+                                       ->Get(0)
+                                       ->inputs()
+                                       ->Get(0));
+    bool activations = false;
+    bool eval_tensors = true;
+    bool op_data = false;
+    for (const host::BufferPlacement &buffer : tiered_kernel.buffers) {
+        const bool is_slow = buffer.region == host::Region::kSlow;
+        if (buffer.name == input) {
+            activations = buffer.region == host::Region::kFast;
+        } else if (buffer.name.find(" eval") != std::string::npos) {
+            eval_tensors = eval_tensors && is_slow;
+        } else if (buffer.name == "op 0 op data") {
+            op_data = is_slow;
+        }
+    }
+    ok = Expect(activations, "input tensor in the fast region") && ok;
+    ok = Expect(eval_tensors, "eval tensors in the slow region") && ok;
+    ok = Expect(op_data, "op data in the slow region") && ok;
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<uint8_t> arena(kArenaSize + 16);
+    std::vector<uint8_t> slow(kArenaSize + 16);
+
+    bool ok = TestSimpleMemoryAllocator();
+    ok = TestPolicies(Aligned(&arena), Aligned(&slow)) && ok;
+    ok = TestReport() && ok;
+
+    printf("%s memory_regions\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the motion gate of motion_gate.h: the SAD kernel against a plain
+// loop, and the skip decisions on synthetic frames, where sensor noise alone
+// must not trigger inference but a moving object must, and no more than
+// max_skip frames are skipped in a row.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "host/synthetic_frame.h"
+#include "host/tests/kernel_test_util.h"
+#include "motion_gate.h"
+
+namespace {
+
+constexpr int kWidth = 400;
+constexpr int kHeight = 300;
+constexpr int kSide = 96;
+constexpr int kPixels = kSide * kSide;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+uint32_t ReferenceSad(const int8_t *a, const int8_t *b, int length)
+{
+    uint32_t sad = 0;
+    for (int i = 0; i < length; ++i) {
+        sad += abs(a[i] - b[i]);
+    }
+    return sad;
+}
+
+// Model input of the synthetic scene; the square moves every hold frames.
+std::vector<int8_t> Render(const preprocess_plan_t &plan, const preprocess_frame_t &layout,
+                           int frame_index, int hold)
+{
+    std::vector<uint32_t> scene(kWidth * kHeight);
+    std::vector<uint8_t> frame(preprocess_frame_size(&layout));
+    host::RenderScene(kWidth, kHeight, frame_index, scene.data(), hold);
+    host::PackFrame(scene.data(), layout, frame.data());
+    std::vector<int8_t> input(kPixels);
+    preprocess_frame_to_input(&plan, frame.data(), input.data());
+    return input;
+}
+
+bool TestSad()
+{
+    bool ok = true;
+    tflite::testing::TestRng rng(7);
+    for (int length : {1, 15, 16, 17, 63, 64, 65, 1000, kPixels}) {
+        std::vector<int8_t> a(length);
+        std::vector<int8_t> b(length);
+        tflite::testing::FillInt8(&rng, &a);
+        tflite::testing::FillInt8(&rng, &b);
+        ok = Expect(motion_gate_sad(a.data(), b.data(), length) ==
+                        ReferenceSad(a.data(), b.data(), length),
+                    "SAD of random buffers") && ok;
+    }
+    // Largest difference of every byte.
+    std::vector<int8_t> low(kPixels, -128);
+    std::vector<int8_t> high(kPixels, 127);
+    ok = Expect(motion_gate_sad(low.data(), high.data(), kPixels) == 255u * kPixels,
+                "SAD of opposite extremes") && ok;
+    ok = Expect(motion_gate_sad(high.data(), high.data(), kPixels) == 0,
+                "SAD of equal buffers") && ok;
+    return ok;
+}
+
+bool TestGate()
+{
+    bool ok = true;
+    const preprocess_frame_t layout = {PREPROCESS_FORMAT_YUV420, kWidth, kHeight, 0};
+    preprocess_plan_t plan;
+    if (preprocess_plan_init(&plan, &layout, (kWidth - kHeight) / 2, 0, kHeight, kHeight,
+                             kSide, kSide) != 0) {
+        printf("FAIL preprocess_plan_init\n");
+        return false;
+    }
+
+    std::vector<int8_t> reference(kPixels);
+    motion_gate_t gate;
+    ok = Expect(motion_gate_init(nullptr, reference.data(), kPixels, 0, 0) == -1,
+                "null gate rejected") && ok;
+    ok = Expect(motion_gate_init(&gate, nullptr, kPixels, 0, 0) == -1,
+                "null reference rejected") && ok;
+    ok = Expect(motion_gate_init(&gate, reference.data(), kPixels,
+                                 MOTION_GATE_DEFAULT_THRESHOLD, 3) == 0,
+                "motion_gate_init") && ok;
+
+    int8_t person = 0;
+    int8_t no_person = 0;
+    // Frame 0 has no reference yet.
+    std::vector<int8_t> input = Render(plan, layout, 0, 8);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "first frame runs") && ok;
+    motion_gate_update(&gate, 40, -40);
+
+    // Frames 1 to 3 hold the scene and differ only by noise.
+    for (int i = 1; i <= 3; ++i) {
+        input = Render(plan, layout, i, 8);
+        ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 0,
+                    "noise only frame skipped") && ok;
+        ok = Expect(gate.last_sad > 0, "noise seen") && ok;
+        ok = Expect(person == 40 && no_person == -40, "scores reused") && ok;
+    }
+    printf("noise SAD %u (mean %.2f gray levels)\n", gate.last_sad,
+           static_cast<double>(gate.last_sad) / kPixels);
+    // The fourth unchanged frame in a row exceeds max_skip.
+    input = Render(plan, layout, 4, 8);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "max_skip forces inference") && ok;
+    motion_gate_update(&gate, 41, -41);
+
+    // The square moves.
+    input = Render(plan, layout, 8, 8);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "moving object runs") && ok;
+    printf("motion SAD %u (mean %.2f gray levels)\n", gate.last_sad,
+           static_cast<double>(gate.last_sad) / kPixels);
+    motion_gate_update(&gate, 42, -42);
+    ok = Expect(gate.executed == 3 && gate.skipped == 3, "counters") && ok;
+
+    // A threshold of 0 only skips identical frames.
+    motion_gate_configure(&gate, 0, 3);
+    input = Render(plan, layout, 9, 8);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "zero threshold runs on noise") && ok;
+    motion_gate_update(&gate, 43, -43);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 0 &&
+                    person == 43,
+                "zero threshold skips identical frame") && ok;
+
+    // max_skip 0 runs every frame.
+    motion_gate_configure(&gate, MOTION_GATE_DEFAULT_THRESHOLD, 0);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "max_skip 0 runs every frame") && ok;
+    motion_gate_update(&gate, 44, -44);
+    ok = Expect(gate.executed == 5 && gate.skipped == 4, "counters kept by configure") && ok;
+
+    // Without update() after a check that ran, nothing is reused.
+    motion_gate_configure(&gate, MOTION_GATE_DEFAULT_THRESHOLD, 3);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 0,
+                "skip after update") && ok;
+    input = Render(plan, layout, 16, 8);
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "moved again") && ok;
+    ok = Expect(motion_gate_check(&gate, input.data(), &person, &no_person) == 1,
+                "no reuse before update") && ok;
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    bool ok = TestSad();
+    ok = TestGate() && ok;
+    printf("%s motion_gate\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks offline memory plans (host/memory_plan.h): a model planned on the
+// host takes the AllocateTensors() fast path and scores exactly like the
+// original in no more arena; a plan that does not fit the scratch requests or
+// breaks the alignment is ignored; batched and patch execution plan online;
+// planning a planned model gives the same model; and the plan record cannot
+// be set once the tensors are allocated.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "host/memory_plan.h"
+#include "host/tests/kernel_test_util.h"
+#include "model_settings.h"
+#include "no_person_image_data.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/offline_memory_plan.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr int kImageSize = kNumCols * kNumRows * kNumChannels;
+constexpr size_t kArenaSize = 512 * 1024;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+struct RunResult {
+    bool allocated;
+    bool offline_plan_used;
+    size_t arena_used;
+    // Person and no person score of the first image of every batch.
+    std::vector<int8_t> scores;
+};
+
+RunResult Run(const uint8_t *model_data, const std::vector<std::vector<int8_t>> &images,
+              uint8_t *arena, int batch_size, int patch_ops)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    static tflite::MicroErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(model_data), resolver, arena,
+                                         kArenaSize, &error_reporter);
+    RunResult result = {false, false, 0, {}};
+    if (interpreter.SetBatchSize(batch_size) != kTfLiteOk ||
+        interpreter.SetPatchExecution(patch_ops, 4) != kTfLiteOk ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return result;
+    }
+    result.allocated = true;
+    result.offline_plan_used = interpreter.offline_memory_plan_used();
+    result.arena_used = interpreter.arena_used_bytes();
+    for (const std::vector<int8_t> &image : images) {
+        memcpy(interpreter.input(0)->data.int8, image.data(), kImageSize);
+        if (interpreter.Invoke() != kTfLiteOk) {
+            result.allocated = false;
+            return result;
+        }
+        result.scores.push_back(interpreter.output(0)->data.int8[kPersonIndex]);
+        result.scores.push_back(interpreter.output(0)->data.int8[kNotAPersonIndex]);
+    }
+    return result;
+}
+
+// The words of the plan in model, which is writable.
+uint32_t *PlanWords(std::vector<uint8_t> *model)
+{
+    const tflite::Model *parsed = tflite::GetModel(model->data());
+    for (size_t i = 0; i < parsed->metadata()->size(); ++i) {
+        const tflite::Metadata *metadata = parsed->metadata()->Get(i);
+        if (strcmp(metadata->name()->c_str(), tflite::kOfflineMemoryPlanMetadata) == 0) {
+            const uint8_t *data = parsed->buffers()->Get(metadata->buffer())->data()->data();
+            return reinterpret_cast<uint32_t *>(model->data() + (data - model->data()));
+        }
+    }
+    return nullptr;
+}
+
+bool TestFastPath(const std::vector<std::vector<int8_t>> &images, uint8_t *arena,
+                  tflite::MemoryPlannerType planner_type, const char *name)
+{
+    host::PlannedModel planned;
+    std::string error;
+    bool ok = Expect(host::PlanModel(g_person_detect_model_data, planner_type, &planned, &error),
+                     name);
+    if (!ok) {
+        printf("  %s\n", error.c_str());
+        return false;
+    }
+    const RunResult original = Run(g_person_detect_model_data, images, arena, 1, 0);
+    const RunResult fast = Run(planned.data.data(), images, arena, 1, 0);
+    ok = Expect(original.allocated && fast.allocated, "planned model allocates") && ok;
+    ok = Expect(!original.offline_plan_used, "original model plans online") && ok;
+    ok = Expect(fast.offline_plan_used, "planned model takes the fast path") && ok;
+    ok = Expect(fast.scores == original.scores, "planned model scores like the original") && ok;
+    ok = Expect(fast.arena_used <= original.arena_used, "planned model needs no more arena") &&
+         ok;
+
+    tflite::OfflineMemoryPlan plan;
+    ok = Expect(tflite::GetOfflineMemoryPlan(tflite::GetModel(planned.data.data()), &plan) &&
+                    plan.complete,
+                "planned model has a complete plan") &&
+         ok;
+    ok = Expect(plan.head_bytes == planned.head_bytes &&
+                    plan.scratch_count == planned.scratch_count &&
+                    plan.tensor_count == planned.tensor_count,
+                "plan matches the report") &&
+         ok;
+    return ok;
+}
+
+bool TestFallback(const std::vector<std::vector<int8_t>> &images, uint8_t *arena)
+{
+    host::PlannedModel planned;
+    std::string error;
+    if (!Expect(host::PlanModel(g_person_detect_model_data, tflite::MemoryPlannerType::kGreedy,
+                                &planned, &error),
+                "plan for fallback")) {
+        return false;
+    }
+    const RunResult original = Run(g_person_detect_model_data, images, arena, 1, 0);
+    bool ok = true;
+
+    // A scratch buffer smaller than the kernel requests.
+    std::vector<uint8_t> small_scratch = planned.data;
+    uint32_t *words = PlanWords(&small_scratch);
+    const int tensor_count = static_cast<int>(words[2]);
+    uint32_t *extension = &words[3 + tensor_count];
+    ok = Expect(extension[0] == tflite::kOfflineMemoryPlanMagic && extension[2] > 0,
+                "plan has scratch buffers") &&
+         ok;
+    extension[3 + 1] = 0;
+    RunResult result = Run(small_scratch.data(), images, arena, 1, 0);
+    ok = Expect(result.allocated && !result.offline_plan_used, "small scratch plans online") &&
+         ok;
+    ok = Expect(result.scores == original.scores, "small scratch scores") && ok;
+
+    // A tensor offset off the arena alignment.
+    std::vector<uint8_t> misaligned = planned.data;
+    words = PlanWords(&misaligned);
+    for (int i = 0; i < tensor_count; ++i) {
+        if (static_cast<int32_t>(words[3 + i]) > 0) {
+            words[3 + i] += 4;
+            break;
+        }
+    }
+    result = Run(misaligned.data(), images, arena, 1, 0);
+    ok = Expect(result.allocated && !result.offline_plan_used, "misaligned plans online") && ok;
+    ok = Expect(result.scores == original.scores, "misaligned scores") && ok;
+
+    // A head larger than the arena.
+    std::vector<uint8_t> large_head = planned.data;
+    words = PlanWords(&large_head);
+    words[3 + tensor_count + 1] = kArenaSize;
+    result = Run(large_head.data(), images, arena, 1, 0);
+    ok = Expect(result.allocated && !result.offline_plan_used, "large head plans online") && ok;
+    ok = Expect(result.scores == original.scores, "large head scores") && ok;
+    return ok;
+}
+
+bool TestOnlineConfigurations(const std::vector<std::vector<int8_t>> &images, uint8_t *arena)
+{
+    host::PlannedModel planned;
+    std::string error;
+    if (!Expect(host::PlanModel(g_person_detect_model_data, tflite::MemoryPlannerType::kSearch,
+                                &planned, &error),
+                "plan for online configurations")) {
+        return false;
+    }
+    bool ok = true;
+    const int configurations[2][2] = {{2, 0}, {1, 4}};
+    for (const auto &configuration : configurations) {
+        const RunResult original = Run(g_person_detect_model_data, images, arena,
+                                       configuration[0], configuration[1]);
+        const RunResult result =
+            Run(planned.data.data(), images, arena, configuration[0], configuration[1]);
+        ok = Expect(result.allocated && !result.offline_plan_used,
+                    configuration[0] > 1 ? "batch plans online" : "patches plan online") &&
+             ok;
+        ok = Expect(result.scores == original.scores,
+                    configuration[0] > 1 ? "batch scores" : "patches scores") &&
+             ok;
+        ok = Expect(result.arena_used == original.arena_used,
+                    configuration[0] > 1 ? "batch arena" : "patches arena") &&
+             ok;
+    }
+    return ok;
+}
+
+bool TestReplan()
+{
+    host::PlannedModel planned;
+    host::PlannedModel replanned;
+    std::string error;
+    bool ok = Expect(host::PlanModel(g_person_detect_model_data,
+                                     tflite::MemoryPlannerType::kSearch, &planned, &error),
+                     "plan");
+    ok = ok && Expect(host::PlanModel(planned.data.data(), tflite::MemoryPlannerType::kSearch,
+                                      &replanned, &error),
+                      "replan");
+    return ok && Expect(replanned.data == planned.data, "replanning gives the same model");
+}
+
+bool TestRecordAfterAllocation(uint8_t *arena)
+{
+    tflite::MicroMutableOpResolver<5> resolver;
+    resolver.AddAveragePool2D();
+    resolver.AddConv2D(tflite::Register_CONV_2D());
+    resolver.AddDepthwiseConv2D(tflite::Register_DEPTHWISE_CONV_2D());
+    resolver.AddReshape();
+    resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    tflite::MicroErrorReporter error_reporter;
+    tflite::MicroInterpreter interpreter(tflite::GetModel(g_person_detect_model_data), resolver,
+                                         arena, kArenaSize, &error_reporter);
+    bool ok = Expect(interpreter.AllocateTensors() == kTfLiteOk, "allocate");
+    tflite::MemoryPlanRecord record = {};
+    return Expect(interpreter.SetMemoryPlanRecord(&record) == kTfLiteError,
+                  "plan record after AllocateTensors() is rejected") &&
+           ok;
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<uint8_t> arena(kArenaSize + 16);
+    uint8_t *aligned_arena =
+        reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(arena.data()) + 15) & ~uintptr_t(15));
+
+    std::vector<std::vector<int8_t>> images(3, std::vector<int8_t>(kImageSize));
+    memcpy(images[0].data(), g_person_image_data, kImageSize);
+    memcpy(images[1].data(), g_no_person_image_data, kImageSize);
+    tflite::testing::TestRng rng(31);
+    tflite::testing::FillInt8(&rng, &images[2]);
+
+    bool ok = TestFastPath(images, aligned_arena, tflite::MemoryPlannerType::kGreedy, "greedy");
+    ok = TestFastPath(images, aligned_arena, tflite::MemoryPlannerType::kSearch, "search") && ok;
+    ok = TestFallback(images, aligned_arena) && ok;
+    ok = TestOnlineConfigurations(images, aligned_arena) && ok;
+    ok = TestReplan() && ok;
+    ok = TestRecordAfterAllocation(aligned_arena) && ok;
+
+    printf("%s offline_plan\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks patch execution (MicroInterpreter::SetPatchExecution()): for chains
+// of several lengths and patch heights, from one row to more rows than the
+// chain output has, the output of the chain and the scores are exactly those
+// of layer by layer execution, the arena shrinks, profilers still see one
+// event per node, and invalid configurations are rejected.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "model_settings.h"
+#include "no_person_image_data.h"
+#include "person_detect_model_data.h"
+#include "person_image_data.h"
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/kernels/depthwise_conv.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/micro_profiler.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr int kImageSize = kNumCols * kNumRows * kNumChannels;
+// Large enough for the model with filter packing, as in the firmware.
+constexpr size_t kArenaSize = 512 * 1024;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+// The conv and depthwise kernels, wrapped to copy the input of the operator
+// that reads capture_tensor: the output of the patch chain, whose buffer is
+// reused by later layers.
+int capture_tensor = -1;
+std::vector<int8_t> captured;
+TfLiteRegistration conv_registration;
+TfLiteRegistration depthwise_registration;
+TfLiteStatus (*conv_invoke)(TfLiteContext *, TfLiteNode *) = nullptr;
+TfLiteStatus (*depthwise_invoke)(TfLiteContext *, TfLiteNode *) = nullptr;
+
+void Capture(TfLiteContext *context, TfLiteNode *node)
+{
+    if (node->inputs->data[0] != capture_tensor) {
+        return;
+    }
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, 0);
+    size_t bytes = 0;
+    tflite::TfLiteEvalTensorByteLength(input, &bytes);
+    captured.assign(input->data.int8, input->data.int8 + bytes);
+}
+
+TfLiteStatus CaptureConv(TfLiteContext *context, TfLiteNode *node)
+{
+    Capture(context, node);
+    return conv_invoke(context, node);
+}
+
+TfLiteStatus CaptureDepthwise(TfLiteContext *context, TfLiteNode *node)
+{
+    Capture(context, node);
+    return depthwise_invoke(context, node);
+}
+
+class CountingProfiler : public tflite::MicroProfiler {
+public:
+    uint32_t BeginEvent(const char *tag) override
+    {
+        return events_++;
+    }
+    void EndEvent(uint32_t event_handle) override
+    {
+    }
+    uint32_t events() const
+    {
+        return events_;
+    }
+
+private:
+    uint32_t events_ = 0;
+
+    TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+struct Run {
+    bool ok;
+    size_t arena_used;
+    std::vector<int8_t> chain_output;
+    int8_t scores[2];
+};
+
+tflite::MicroMutableOpResolver<5> &GetResolver()
+{
+    static tflite::MicroMutableOpResolver<5> resolver;
+    if (resolver.GetRegistrationLength() == 0) {
+        conv_registration = tflite::Register_CONV_2D();
+        conv_invoke = conv_registration.invoke;
+        conv_registration.invoke = CaptureConv;
+        depthwise_registration = tflite::Register_DEPTHWISE_CONV_2D();
+        depthwise_invoke = depthwise_registration.invoke;
+        depthwise_registration.invoke = CaptureDepthwise;
+        resolver.AddAveragePool2D();
+        resolver.AddConv2D(conv_registration);
+        resolver.AddDepthwiseConv2D(depthwise_registration);
+        resolver.AddReshape();
+        resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    }
+    return resolver;
+}
+
+// Classifies image with the first num_ops operators run in patches of
+// patch_rows rows, or layer by layer for 0 ops, and keeps the input of
+// operator capture_op.
+Run Classify(int num_ops, int patch_rows, int capture_op, const int8_t *image, uint8_t *arena)
+{
+    static tflite::MicroErrorReporter error_reporter;
+    const tflite::Model *model = tflite::GetModel(g_person_detect_model_data);
+    Run run = {};
+    CountingProfiler profiler;
+    tflite::MicroInterpreter interpreter(model, GetResolver(), arena, kArenaSize,
+                                         &error_reporter, &profiler);
+    if (interpreter.SetPatchExecution(num_ops, patch_rows) != kTfLiteOk ||
+        interpreter.AllocateTensors() != kTfLiteOk) {
+        return run;
+    }
+    run.arena_used = interpreter.arena_used_bytes();
+    memcpy(interpreter.input(0)->data.int8, image, kImageSize);
+    capture_tensor =
+        model->subgraphs()->Get(0)->operators()->Get(capture_op)->inputs()->Get(0);
+    captured.clear();
+    const uint32_t nodes = model->subgraphs()->Get(0)->operators()->size();
+    run.ok = interpreter.Invoke() == kTfLiteOk;
+    run.ok = Expect(profiler.events() == nodes, "one profiler event per node") && run.ok;
+    run.chain_output = captured;
+    run.scores[0] = interpreter.output(0)->data.int8[kPersonIndex];
+    run.scores[1] = interpreter.output(0)->data.int8[kNotAPersonIndex];
+    capture_tensor = -1;
+    return run;
+}
+
+bool TestChains(const std::vector<std::vector<int8_t>> &images, uint8_t *arena)
+{
+    static const int kChainOps[] = {2, 3, 4, 6, 8};
+    static const int kPatchRows[] = {1, 2, 5, 12, 100};
+    bool ok = true;
+    for (int num_ops : kChainOps) {
+        size_t layered_arena = 0;
+        size_t one_row_arena = 0;
+        for (const std::vector<int8_t> &image : images) {
+            const Run layered = Classify(0, 0, num_ops, image.data(), arena);
+            ok = Expect(layered.ok && !layered.chain_output.empty(), "layer by layer") && ok;
+            layered_arena = layered.arena_used;
+            for (int patch_rows : kPatchRows) {
+                const Run patched = Classify(num_ops, patch_rows, num_ops, image.data(), arena);
+                char what[96];
+                snprintf(what, sizeof(what), "%d ops in patches of %d rows", num_ops,
+                         patch_rows);
+                ok = Expect(patched.ok && patched.chain_output == layered.chain_output &&
+                                patched.scores[0] == layered.scores[0] &&
+                                patched.scores[1] == layered.scores[1],
+                            what) && ok;
+                if (patch_rows == 1) {
+                    one_row_arena = patched.arena_used;
+                }
+            }
+        }
+        printf("%d ops: arena %zu bytes layer by layer, %zu in patches of one row\n", num_ops,
+               layered_arena, one_row_arena);
+        if (num_ops >= 3) {
+            ok = Expect(one_row_arena < layered_arena, "patches shrink the arena") && ok;
+        }
+    }
+    return ok;
+}
+
+bool TestInvalid(uint8_t *arena)
+{
+    static tflite::MicroErrorReporter error_reporter;
+    const tflite::Model *model = tflite::GetModel(g_person_detect_model_data);
+    bool ok = true;
+    {
+        tflite::MicroInterpreter interpreter(model, GetResolver(), arena, kArenaSize,
+                                             &error_reporter);
+        ok = Expect(interpreter.SetPatchExecution(4, 0) != kTfLiteOk, "0 rows rejected") && ok;
+        ok = Expect(interpreter.SetPatchExecution(9, 1) != kTfLiteOk,
+                    "too long chain rejected") && ok;
+        ok = Expect(interpreter.SetPatchExecution(1, 4) == kTfLiteOk &&
+                        interpreter.AllocateTensors() != kTfLiteOk,
+                    "chain of one op rejected") && ok;
+    }
+    {
+        tflite::MicroInterpreter interpreter(model, GetResolver(), arena, kArenaSize,
+                                             &error_reporter);
+        ok = Expect(interpreter.SetBatchSize(2) == kTfLiteOk &&
+                        interpreter.SetPatchExecution(4, 4) == kTfLiteOk &&
+                        interpreter.AllocateTensors() != kTfLiteOk,
+                    "patches of a batch rejected") && ok;
+    }
+    {
+        tflite::MicroInterpreter interpreter(model, GetResolver(), arena, kArenaSize,
+                                             &error_reporter);
+        ok = Expect(interpreter.AllocateTensors() == kTfLiteOk &&
+                        interpreter.SetPatchExecution(4, 4) != kTfLiteOk,
+                    "patches after AllocateTensors() rejected") && ok;
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<uint8_t> arena(kArenaSize + 16);
+    uint8_t *aligned_arena =
+        reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(arena.data()) + 15) & ~uintptr_t(15));
+
+    std::vector<std::vector<int8_t>> images(3, std::vector<int8_t>(kImageSize));
+    memcpy(images[0].data(), g_person_image_data, kImageSize);
+    memcpy(images[1].data(), g_no_person_image_data, kImageSize);
+    tflite::testing::TestRng rng(29);
+    tflite::testing::FillInt8(&rng, &images[2]);
+
+    bool ok = TestChains(images, aligned_arena);
+    ok = TestInvalid(aligned_arena) && ok;
+
+    printf("%s patch_execution\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the staged frame pipeline of pipeline.h: every frame of a finite
+// source is classified once and in order with the same scores as the serial
+// path, frames are released in order, the model inputs alternate, max_frames
+// stops the run, the arena input is bound again afterwards, frames the
+// motion gate skips reuse the last scores, and a score filter smooths the
+// scores handed to the result callback.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "host/synthetic_frame.h"
+#include "main_functions.h"
+#include "model_settings.h"
+#include "pipeline.h"
+
+namespace {
+
+constexpr int kWidth = 160;
+constexpr int kHeight = 120;
+constexpr int kFrames = 6;
+constexpr int kInputSize = kNumCols * kNumRows * kNumChannels;
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+struct Source {
+    const uint8_t *frames;
+    size_t frame_size;
+    int next;
+    int released;
+    bool released_in_order;
+};
+
+int8_t GetFrame(void *context, const void **frame)
+{
+    Source *source = static_cast<Source *>(context);
+    if (source->next >= kFrames) {
+        return -1;
+    }
+    *frame = source->frames + source->next * source->frame_size;
+    ++source->next;
+    return 0;
+}
+
+void ReleaseFrame(void *context, const void *frame)
+{
+    Source *source = static_cast<Source *>(context);
+    source->released_in_order =
+        source->released_in_order &&
+        (frame == source->frames + source->released * source->frame_size);
+    ++source->released;
+}
+
+struct Results {
+    int count;
+    bool in_order;
+    int8_t person[kFrames];
+    int8_t no_person[kFrames];
+    const int8_t *bound[kFrames];
+};
+
+void OnResult(void *context, uint32_t frame_index, int8_t person_score,
+              int8_t no_person_score)
+{
+    Results *results = static_cast<Results *>(context);
+    results->in_order = results->in_order && (frame_index == static_cast<uint32_t>(results->count));
+    if (results->count < kFrames) {
+        model_input_t input;
+        get_model_input(&input);
+        results->person[results->count] = person_score;
+        results->no_person[results->count] = no_person_score;
+        results->bound[results->count] = input.data;
+    }
+    ++results->count;
+}
+
+}  // namespace
+
+int main()
+{
+    bool ok = true;
+    init_model();
+    model_input_t arena_input;
+    if (get_model_input(&arena_input) != 0) {
+        printf("FAIL get_model_input\n");
+        return 1;
+    }
+
+    const preprocess_frame_t layout = {PREPROCESS_FORMAT_YUV420, kWidth, kHeight, 0};
+    preprocess_plan_t plan;
+    if (preprocess_plan_init(&plan, &layout, (kWidth - kHeight) / 2, 0, kHeight, kHeight,
+                             kNumCols, kNumRows) != 0) {
+        printf("FAIL preprocess_plan_init\n");
+        return 1;
+    }
+    const size_t frame_size = preprocess_frame_size(&layout);
+    std::vector<uint8_t> frames(frame_size * kFrames);
+    std::vector<uint32_t> scene(kWidth * kHeight);
+    for (int i = 0; i < kFrames; ++i) {
+        host::RenderScene(kWidth, kHeight, i, scene.data());
+        host::PackFrame(scene.data(), layout, frames.data() + i * frame_size);
+    }
+
+    // Serial reference.
+    int8_t person[kFrames];
+    int8_t no_person[kFrames];
+    for (int i = 0; i < kFrames; ++i) {
+        preprocess_frame_to_input(&plan, frames.data() + i * frame_size, arena_input.data);
+        if (run_model(&person[i], &no_person[i]) != 0) {
+            printf("FAIL run_model\n");
+            return 1;
+        }
+    }
+
+    std::vector<int8_t> inputs(PIPELINE_INPUT_BUFFERS * kInputSize);
+    Source source = {frames.data(), frame_size, 0, 0, true};
+    Results results = {};
+    results.in_order = true;
+    pipeline_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.source.get_frame = GetFrame;
+    config.source.release_frame = ReleaseFrame;
+    config.source.context = &source;
+    config.plan = &plan;
+    config.input_buffers[0] = inputs.data();
+    config.input_buffers[1] = inputs.data() + kInputSize;
+    config.on_result = OnResult;
+    config.result_context = &results;
+    config.warmup_frames = 2;
+
+    ok = Expect(pipeline_run(nullptr, nullptr) == -1, "null config rejected") && ok;
+    config.input_buffers[1] = nullptr;
+    ok = Expect(pipeline_run(&config, nullptr) == -1, "missing input buffer rejected") && ok;
+    config.input_buffers[1] = inputs.data() + kInputSize;
+
+    pipeline_stats_t stats;
+    ok = Expect(pipeline_run(&config, &stats) == 0, "pipeline_run") && ok;
+    ok = Expect(results.count == kFrames, "every frame classified") && ok;
+    ok = Expect(results.in_order, "frames classified in order") && ok;
+    ok = Expect(source.released == kFrames && source.released_in_order,
+                "frames released in order") && ok;
+    ok = Expect(stats.frames == kFrames - 2, "statistics exclude the warmup") && ok;
+    for (int i = 0; i < kFrames && i < results.count; ++i) {
+        ok = Expect(results.person[i] == person[i] && results.no_person[i] == no_person[i],
+                    "same scores as the serial path") && ok;
+        ok = Expect(results.bound[i] == config.input_buffers[i % PIPELINE_INPUT_BUFFERS],
+                    "model inputs alternate") && ok;
+    }
+    model_input_t after;
+    ok = Expect(get_model_input(&after) == 0 && after.data == arena_input.data,
+                "arena input bound after the run") && ok;
+
+    // Stops after max_frames and drains the frames in flight.
+    source.next = 0;
+    source.released = 0;
+    memset(&results, 0, sizeof(results));
+    results.in_order = true;
+    config.max_frames = 3;
+    config.warmup_frames = 0;
+    ok = Expect(pipeline_run(&config, &stats) == 0, "pipeline_run with max_frames") && ok;
+    ok = Expect(results.count == 3 && stats.frames == 3, "max_frames stops the run") && ok;
+    ok = Expect(source.released == source.next && source.released_in_order,
+                "frames in flight released") && ok;
+
+    // A gate that treats every frame as unchanged runs every third frame.
+    std::vector<int8_t> reference(kInputSize);
+    motion_gate_t gate;
+    motion_gate_init(&gate, reference.data(), kInputSize, UINT32_MAX, 2);
+    source.next = 0;
+    source.released = 0;
+    memset(&results, 0, sizeof(results));
+    results.in_order = true;
+    config.max_frames = 0;
+    config.gate = &gate;
+    ok = Expect(pipeline_run(&config, &stats) == 0, "pipeline_run with motion gate") && ok;
+    ok = Expect(results.count == kFrames && stats.frames == kFrames && stats.inferences == 2,
+                "gated frames counted") && ok;
+    ok = Expect(gate.executed == 2 && gate.skipped == kFrames - 2, "gate counters") && ok;
+    for (int i = 0; i < kFrames && i < results.count; ++i) {
+        const int ran = i - i % 3;
+        ok = Expect(results.person[i] == person[ran] && results.no_person[i] == no_person[ran],
+                    "skipped frames reuse the last scores") && ok;
+    }
+
+    // The filter sees the raw scores and the callback the smoothed ones.
+    score_filter_config_t filter_config;
+    score_filter_default_config(&filter_config);
+    score_filter_t filter;
+    score_filter_t expected;
+    score_filter_init(&filter, &filter_config);
+    score_filter_init(&expected, &filter_config);
+    source.next = 0;
+    source.released = 0;
+    memset(&results, 0, sizeof(results));
+    results.in_order = true;
+    config.gate = nullptr;
+    config.filter = &filter;
+    ok = Expect(pipeline_run(&config, &stats) == 0, "pipeline_run with score filter") && ok;
+    ok = Expect(results.count == kFrames, "filtered frames classified") && ok;
+    for (int i = 0; i < kFrames && i < results.count; ++i) {
+        int8_t smoothed_person = 0;
+        int8_t smoothed_no_person = 0;
+        score_filter_update(&expected, person[i], no_person[i], &smoothed_person,
+                            &smoothed_no_person);
+        ok = Expect(results.person[i] == smoothed_person &&
+                        results.no_person[i] == smoothed_no_person,
+                    "smoothed scores handed over") && ok;
+    }
+    ok = Expect(filter.present == expected.present && filter.events == expected.events,
+                "filter state") && ok;
+
+    printf("%s pipeline\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the channel-vectorized int8 average and max pooling kernels
+// bit-exact against the reference kernels, over the pooling layer of the
+// person detection model plus padded, strided and all-border windows.
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/pooling.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/pooling.h"
+
+namespace {
+
+struct PoolCase {
+    const char *name;
+    int batches;
+    int height;
+    int width;
+    int depth;
+    int filter;
+    int stride;
+    int pad;
+    int activation_min;
+    int activation_max;
+};
+
+bool RunCase(const PoolCase &c, tflite::testing::TestRng *rng)
+{
+    const int out_h = tflite::testing::ConvOutputSize(c.height, c.filter, c.stride, 1, c.pad);
+    const int out_w = tflite::testing::ConvOutputSize(c.width, c.filter, c.stride, 1, c.pad);
+
+    const tflite::RuntimeShape input_shape({c.batches, c.height, c.width, c.depth});
+    const tflite::RuntimeShape output_shape({c.batches, out_h, out_w, c.depth});
+
+    std::vector<int8_t> input(input_shape.FlatSize());
+    tflite::testing::FillInt8(rng, &input);
+
+    tflite::PoolParams params = {};
+    params.stride_height = c.stride;
+    params.stride_width = c.stride;
+    params.filter_height = c.filter;
+    params.filter_width = c.filter;
+    params.padding_values.height = c.pad;
+    params.padding_values.width = c.pad;
+    params.quantized_activation_min = c.activation_min;
+    params.quantized_activation_max = c.activation_max;
+
+    std::vector<int8_t> expected(output_shape.FlatSize());
+    std::vector<int8_t> actual(output_shape.FlatSize());
+    bool ok = true;
+
+    tflite::reference_integer_ops::AveragePool(params, input_shape, input.data(),
+                                               output_shape, expected.data());
+    tflite::optimized_integer_ops::AveragePool(params, input_shape, input.data(),
+                                               output_shape, actual.data());
+    ok = tflite::testing::ExpectEqual((std::string(c.name) + "/avg").c_str(),
+                                      expected, actual) && ok;
+
+    tflite::reference_integer_ops::MaxPool(params, input_shape, input.data(),
+                                           output_shape, expected.data());
+    tflite::optimized_integer_ops::MaxPool(params, input_shape, input.data(),
+                                           output_shape, actual.data());
+    ok = tflite::testing::ExpectEqual((std::string(c.name) + "/max").c_str(),
+                                      expected, actual) && ok;
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    const PoolCase kCases[] = {
+        // name                 batch  h   w    c  k  s  p   min  max
+        {"pool_3x3x256_global",   1,   3,  3, 256, 3, 1, 0, -128, 127},
+        {"pool_2x2_s2",           1,  12, 12,  32, 2, 2, 0, -128, 127},
+        {"pool_3x3_s1_pad1",      2,  10,  9,  70, 3, 1, 1, -128, 127},
+        {"pool_3x3_s2_pad1",      1,  15, 13,  16, 3, 2, 1, -128, 127},
+        {"pool_5x5_on_4x4",       1,   4,  4,  12, 5, 1, 2, -128, 127},
+        {"pool_single_column",    1,   7,  1,   8, 3, 1, 1, -128, 127},
+        {"pool_relu6_range",      1,   8,  8,  20, 3, 1, 1,  -40,  60},
+    };
+
+    tflite::testing::TestRng rng(0x9001);
+    int failures = 0;
+    for (const PoolCase &c : kCases) {
+        if (!RunCase(c, &rng)) {
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
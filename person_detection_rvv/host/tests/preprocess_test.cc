@@ -0,0 +1,247 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the fused camera preprocessing against the three-step pipeline it
+// replaces in main.c: in-place centre crop of the RGBA frame, bilinear resize
+// of all four channels to 96x96, RGBA to gray, then the uint8 -> int8 shift.
+// Resizing colour and converting afterwards rounds at different points than
+// blending the luma of the taps, so the two may differ by one level.
+//
+// The Y-plane path is fed synthetic YUV420, YUYV, UYVY and gray frames, with
+// and without row padding, whose Y samples are the luma of an RGBA frame; it
+// must match the RGBA path exactly.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmath>
+#include <vector>
+
+#include "host/synthetic_frame.h"
+#include "host/tests/kernel_test_util.h"
+#include "image_preprocess.h"
+
+namespace {
+
+constexpr int kFrameWidth = 400;
+constexpr int kFrameHeight = 300;
+constexpr int kCrop = kFrameHeight;
+constexpr int kCropX = (kFrameWidth - kCrop) / 2;
+constexpr int kOut = 96;
+
+using host::RgbaChannel;
+using host::RgbaLuma;
+using host::RgbaPixel;
+
+// Pixel-centre bilinear resize of a packed RGBA image, every channel rounded
+// on its own.
+void BilinearRgba(const uint32_t *src, int src_w, int src_h, uint32_t *dst,
+                  int dst_w, int dst_h)
+{
+    for (int y = 0; y < dst_h; ++y) {
+        const double fy = std::max(0.0, (y + 0.5) * src_h / dst_h - 0.5);
+        const int y0 = std::min(static_cast<int>(fy), src_h - 1);
+        const int y1 = std::min(y0 + 1, src_h - 1);
+        const double wy = (y0 == src_h - 1) ? 0.0 : fy - y0;
+        for (int x = 0; x < dst_w; ++x) {
+            const double fx = std::max(0.0, (x + 0.5) * src_w / dst_w - 0.5);
+            const int x0 = std::min(static_cast<int>(fx), src_w - 1);
+            const int x1 = std::min(x0 + 1, src_w - 1);
+            const double wx = (x0 == src_w - 1) ? 0.0 : fx - x0;
+            uint32_t out = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                const double top = RgbaChannel(src[y0 * src_w + x0], shift) * (1 - wx) +
+                                   RgbaChannel(src[y0 * src_w + x1], shift) * wx;
+                const double bottom = RgbaChannel(src[y1 * src_w + x0], shift) * (1 - wx) +
+                                      RgbaChannel(src[y1 * src_w + x1], shift) * wx;
+                const int value = static_cast<int>(std::lround(top * (1 - wy) + bottom * wy));
+                out |= static_cast<uint32_t>(value) << shift;
+            }
+            dst[y * dst_w + x] = out;
+        }
+    }
+}
+
+// The pipeline main.c used to run: crop in place, resize, convert, and the
+// zero point shift of the model input.
+std::vector<int8_t> ThreeStep(const std::vector<uint32_t> &frame)
+{
+    std::vector<uint32_t> picture = frame;
+    for (int y = 0; y < kCrop; ++y) {
+        memmove(&picture[y * kCrop], &picture[y * kFrameWidth + kCropX],
+                kCrop * sizeof(uint32_t));
+    }
+    std::vector<uint32_t> resized(kOut * kOut);
+    BilinearRgba(picture.data(), kCrop, kCrop, resized.data(), kOut, kOut);
+    std::vector<int8_t> output(kOut * kOut);
+    for (int i = 0; i < kOut * kOut; ++i) {
+        output[i] = static_cast<int8_t>(RgbaLuma(resized[i]) - PREPROCESS_INPUT_ZERO_SHIFT);
+    }
+    return output;
+}
+
+std::vector<int8_t> Fused(const preprocess_frame_t &layout, const void *frame)
+{
+    preprocess_plan_t plan;
+    if (preprocess_plan_init(&plan, &layout, kCropX, 0, kCrop, kCrop, kOut, kOut) != 0) {
+        printf("FAIL preprocess_plan_init\n");
+        exit(1);
+    }
+    std::vector<int8_t> output(kOut * kOut);
+    preprocess_frame_to_input(&plan, frame, output.data());
+    return output;
+}
+
+std::vector<int8_t> Fused(const std::vector<uint32_t> &frame)
+{
+    const preprocess_frame_t layout = {PREPROCESS_FORMAT_RGBA8888, kFrameWidth,
+                                       kFrameHeight, 0};
+    return Fused(layout, frame.data());
+}
+
+// Packs the scene into the given layout and runs the Y-plane path on it.
+bool TestLumaFormat(const char *name, preprocess_format_t format, int stride,
+                    const std::vector<uint32_t> &scene,
+                    const std::vector<int8_t> &expected)
+{
+    const preprocess_frame_t layout = {format, kFrameWidth, kFrameHeight, stride};
+    std::vector<uint8_t> packed(preprocess_frame_size(&layout), 0x55);
+    host::PackFrame(scene.data(), layout, packed.data());
+    return tflite::testing::ExpectEqual(name, expected, Fused(layout, packed.data()));
+}
+
+bool ExpectClose(const char *name, const std::vector<int8_t> &expected,
+                 const std::vector<int8_t> &actual, int tolerance)
+{
+    int max_diff = 0;
+    int64_t sum_diff = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const int diff = std::abs(expected[i] - actual[i]);
+        max_diff = std::max(max_diff, diff);
+        sum_diff += diff;
+    }
+    const bool ok = max_diff <= tolerance;
+    printf("%s %s: max diff %d, mean diff %.3f\n", ok ? "PASS" : "FAIL", name,
+           max_diff, static_cast<double>(sum_diff) / expected.size());
+    return ok;
+}
+
+// Smooth colour gradients with some noise, like a camera image.
+std::vector<uint32_t> NaturalFrame(tflite::testing::TestRng *rng)
+{
+    std::vector<uint32_t> frame(kFrameWidth * kFrameHeight);
+    for (int y = 0; y < kFrameHeight; ++y) {
+        for (int x = 0; x < kFrameWidth; ++x) {
+            const int noise = rng->Uniform(-12, 12);
+            const int r = std::min(255, std::max(0, (x * 255) / kFrameWidth + noise));
+            const int g = std::min(255, std::max(0, (y * 255) / kFrameHeight - noise));
+            const int b = std::min(255, std::max(0, ((x + y) * 255) / (kFrameWidth + kFrameHeight)));
+            frame[y * kFrameWidth + x] = RgbaPixel(r, g, b);
+        }
+    }
+    return frame;
+}
+
+std::vector<uint32_t> NoiseFrame(tflite::testing::TestRng *rng)
+{
+    std::vector<uint32_t> frame(kFrameWidth * kFrameHeight);
+    for (uint32_t &pixel : frame) {
+        pixel = rng->Next();
+    }
+    return frame;
+}
+
+}  // namespace
+
+int main()
+{
+    tflite::testing::TestRng rng(808);
+    bool ok = true;
+
+    const std::vector<uint32_t> natural = NaturalFrame(&rng);
+    ok = ExpectClose("natural frame", ThreeStep(natural), Fused(natural), 1) && ok;
+    const std::vector<uint32_t> noise = NoiseFrame(&rng);
+    ok = ExpectClose("noise frame", ThreeStep(noise), Fused(noise), 1) && ok;
+
+    // Flat colours are exact, including the ends of the int8 range.
+    const uint32_t flat_colours[] = {RgbaPixel(0, 0, 0), RgbaPixel(255, 255, 255),
+                                     RgbaPixel(200, 30, 90)};
+    for (uint32_t colour : flat_colours) {
+        const std::vector<uint32_t> frame(kFrameWidth * kFrameHeight, colour);
+        const std::vector<int8_t> expected(
+            kOut * kOut, static_cast<int8_t>(RgbaLuma(colour) - PREPROCESS_INPUT_ZERO_SHIFT));
+        ok = tflite::testing::ExpectEqual("flat colour", expected, Fused(frame)) && ok;
+    }
+
+    // Pixels outside the crop are never read.
+    std::vector<uint32_t> framed = noise;
+    for (int y = 0; y < kFrameHeight; ++y) {
+        for (int x = 0; x < kFrameWidth; ++x) {
+            if (x < kCropX || x >= kCropX + kCrop) {
+                framed[y * kFrameWidth + x] = RgbaPixel(255, 0, 255);
+            }
+        }
+    }
+    ok = tflite::testing::ExpectEqual("crop margins", Fused(noise), Fused(framed)) && ok;
+
+    // Without scaling the kernel is a plain crop and gray conversion.
+    const preprocess_frame_t rgba = {PREPROCESS_FORMAT_RGBA8888, kFrameWidth, kFrameHeight, 0};
+    preprocess_plan_t plan;
+    ok = (preprocess_plan_init(&plan, &rgba, 7, 11, kOut, kOut, kOut, kOut) == 0) && ok;
+    std::vector<int8_t> identity(kOut * kOut);
+    preprocess_frame_to_input(&plan, noise.data(), identity.data());
+    std::vector<int8_t> cropped(kOut * kOut);
+    for (int y = 0; y < kOut; ++y) {
+        for (int x = 0; x < kOut; ++x) {
+            cropped[y * kOut + x] = static_cast<int8_t>(
+                RgbaLuma(noise[(y + 11) * kFrameWidth + x + 7]) - PREPROCESS_INPUT_ZERO_SHIFT);
+        }
+    }
+    ok = tflite::testing::ExpectEqual("unscaled crop", cropped, identity) && ok;
+
+    // The Y plane of YUV frames gives the same input as the RGBA frame.
+    std::vector<uint32_t> scene(kFrameWidth * kFrameHeight);
+    host::RenderScene(kFrameWidth, kFrameHeight, 5, scene.data());
+    const std::vector<int8_t> from_rgba = Fused(scene);
+    ok = TestLumaFormat("yuv420", PREPROCESS_FORMAT_YUV420, 0, scene, from_rgba) && ok;
+    ok = TestLumaFormat("yuv420 padded rows", PREPROCESS_FORMAT_YUV420, kFrameWidth + 32,
+                        scene, from_rgba) && ok;
+    ok = TestLumaFormat("yuyv", PREPROCESS_FORMAT_YUYV, 0, scene, from_rgba) && ok;
+    ok = TestLumaFormat("uyvy", PREPROCESS_FORMAT_UYVY, 0, scene, from_rgba) && ok;
+    ok = TestLumaFormat("gray8", PREPROCESS_FORMAT_GRAY8, 0, scene, from_rgba) && ok;
+    ok = TestLumaFormat("gray8 padded rows", PREPROCESS_FORMAT_GRAY8, kFrameWidth + 16,
+                        scene, from_rgba) && ok;
+    ok = TestLumaFormat("rgba padded rows", PREPROCESS_FORMAT_RGBA8888, kFrameWidth * 4 + 64,
+                        scene, from_rgba) && ok;
+
+    const preprocess_frame_t bad_format = {static_cast<preprocess_format_t>(9), kFrameWidth,
+                                           kFrameHeight, 0};
+    const preprocess_frame_t bad_stride = {PREPROCESS_FORMAT_YUYV, kFrameWidth, kFrameHeight,
+                                           kFrameWidth};
+    const bool rejects =
+        preprocess_plan_init(&plan, &rgba, 200, 0, 300, 300, kOut, kOut) != 0 &&
+        preprocess_plan_init(&plan, &rgba, 0, 1, 300, 300, kOut, kOut) != 0 &&
+        preprocess_plan_init(&plan, &rgba, 0, 0, 300, 300, PREPROCESS_MAX_DIM + 1,
+                             kOut) != 0 &&
+        preprocess_plan_init(&plan, &bad_format, 0, 0, 300, 300, kOut, kOut) != 0 &&
+        preprocess_plan_init(&plan, &bad_stride, 0, 0, 300, 300, kOut, kOut) != 0 &&
+        preprocess_plan_init(nullptr, &rgba, 0, 0, 300, 300, kOut, kOut) != 0;
+    printf("%s invalid plans rejected\n", rejects ? "PASS" : "FAIL");
+    ok = rejects && ok;
+
+    printf("%s preprocess\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
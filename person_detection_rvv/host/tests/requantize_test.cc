@@ -0,0 +1,206 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the batched requantization primitives bit-exact against the scalar
+// MultiplyByQuantizedMultiplier tail of the reference kernels, over random
+// accumulators and the rounding edge cases (ties, extreme accumulators,
+// shifts from 0 to 31 bits), and the int8 fully connected kernel against the
+// reference.
+
+#include <stdio.h>
+
+#include <limits>
+#include <vector>
+
+#include "host/tests/kernel_test_util.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/fully_connected.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/requantize.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/fully_connected.h"
+
+namespace {
+
+int8_t ReferenceRequantize(int32_t acc, int32_t multiplier, int32_t shift,
+                           int32_t output_offset, int32_t activation_min,
+                           int32_t activation_max)
+{
+    int32_t value = tflite::MultiplyByQuantizedMultiplier(acc, multiplier, shift);
+    value += output_offset;
+    value = std::max(value, activation_min);
+    value = std::min(value, activation_max);
+    return static_cast<int8_t>(value);
+}
+
+bool TestPerChannel(tflite::testing::TestRng *rng)
+{
+    const int count = 1000;
+    std::vector<int32_t> acc(count);
+    std::vector<int32_t> bias(count);
+    std::vector<int32_t> multiplier(count);
+    std::vector<int32_t> shift(count);
+    for (int i = 0; i < count; ++i) {
+        // Mostly realistic conv accumulators, then full-range values.
+        acc[i] = (i < count / 2) ? rng->Uniform(-200000, 200000)
+                                 : static_cast<int32_t>(rng->Next());
+        bias[i] = rng->Uniform(-20000, 20000);
+        multiplier[i] = rng->Uniform(0, std::numeric_limits<int32_t>::max());
+        shift[i] = rng->Uniform(-31, 0);
+    }
+    // Edge cases: exact ties of the rounding divide, zero multiplier, the
+    // extreme accumulators and the largest right shift.
+    const int32_t kEdgeAcc[] = {0, 1, -1, 3, -3, 5, -5,
+                                std::numeric_limits<int32_t>::min(),
+                                std::numeric_limits<int32_t>::max()};
+    int i = 0;
+    for (int32_t a : kEdgeAcc) {
+        for (int32_t s : {0, -1, -2, -31}) {
+            acc[i] = a;
+            bias[i] = 0;
+            multiplier[i] = (s == -31) ? 0 : (1 << 30);
+            shift[i] = s;
+            ++i;
+        }
+    }
+    acc[i] = std::numeric_limits<int32_t>::min();
+    bias[i] = 0;
+    multiplier[i] = std::numeric_limits<int32_t>::max();
+    shift[i] = 0;
+
+    // Accumulators that fit after the shift, for the positive shifts.
+    std::vector<int32_t> small_acc(64);
+    std::vector<int32_t> left_shift(64);
+    std::vector<int32_t> left_multiplier(64);
+    for (int j = 0; j < 64; ++j) {
+        small_acc[j] = rng->Uniform(-20000, 20000);
+        left_shift[j] = rng->Uniform(1, 7);
+        left_multiplier[j] = rng->Uniform(1 << 30, std::numeric_limits<int32_t>::max());
+    }
+
+    bool ok = true;
+    const int32_t kOffsets[] = {-128, 0, 17};
+    for (int32_t offset : kOffsets) {
+        std::vector<int8_t> expected(count);
+        std::vector<int8_t> actual(count);
+        for (int j = 0; j < count; ++j) {
+            // The reference adds the bias before requantizing, with the same
+            // wrapping int32 arithmetic.
+            const int32_t value = static_cast<int32_t>(
+                static_cast<uint32_t>(acc[j]) + static_cast<uint32_t>(bias[j]));
+            expected[j] = ReferenceRequantize(value, multiplier[j], shift[j],
+                                              offset, -128, 127);
+        }
+        tflite::optimized_integer_ops::RequantizePerChannel(
+            acc.data(), count, bias.data(), multiplier.data(), shift.data(),
+            offset, -128, 127, actual.data());
+        ok = tflite::testing::ExpectEqual("per_channel", expected, actual) && ok;
+
+        std::vector<int8_t> expected_left(64);
+        std::vector<int8_t> actual_left(64);
+        for (int j = 0; j < 64; ++j) {
+            expected_left[j] = ReferenceRequantize(
+                small_acc[j], left_multiplier[j], left_shift[j], offset, -40, 90);
+        }
+        tflite::optimized_integer_ops::RequantizePerChannel(
+            small_acc.data(), 64, nullptr, left_multiplier.data(),
+            left_shift.data(), offset, -40, 90, actual_left.data());
+        ok = tflite::testing::ExpectEqual("per_channel_left_shift", expected_left,
+                                          actual_left) && ok;
+    }
+    return ok;
+}
+
+bool TestChannel(tflite::testing::TestRng *rng)
+{
+    // One column of a [rows][4] accumulator tile written to a strided
+    // output, as GemmRequantizeTile does.
+    const int rows = 37;
+    const int acc_stride = 4;
+    const int output_stride = 24;
+    std::vector<int32_t> acc(rows * acc_stride);
+    for (int32_t &a : acc) {
+        a = rng->Uniform(-500000, 500000);
+    }
+
+    bool ok = true;
+    for (int32_t shift = -12; shift <= 2; shift += 2) {
+        const int32_t multiplier = rng->Uniform(1 << 30, std::numeric_limits<int32_t>::max());
+        const int32_t bias = rng->Uniform(-20000, 20000);
+        std::vector<int8_t> expected(rows * output_stride, 0);
+        std::vector<int8_t> actual(rows * output_stride, 0);
+        // Keep the accumulators small enough for the left shifts.
+        std::vector<int32_t> column(acc);
+        for (int m = 0; m < rows; ++m) {
+            if (shift > 0) {
+                column[m * acc_stride] /= 64;
+            }
+            expected[m * output_stride] = ReferenceRequantize(
+                column[m * acc_stride] + bias, multiplier, shift, -5, -128, 127);
+        }
+        tflite::optimized_integer_ops::RequantizeChannel(
+            column.data(), acc_stride, rows, bias, multiplier, shift, -5, -128,
+            127, actual.data(), output_stride);
+        ok = tflite::testing::ExpectEqual("channel_strided", expected, actual) && ok;
+    }
+    return ok;
+}
+
+bool TestFullyConnected(tflite::testing::TestRng *rng, int batches,
+                        int accum_depth, int output_depth)
+{
+    const tflite::RuntimeShape input_shape({batches, accum_depth});
+    const tflite::RuntimeShape filter_shape({output_depth, accum_depth});
+    const tflite::RuntimeShape bias_shape({output_depth});
+    const tflite::RuntimeShape output_shape({batches, output_depth});
+
+    std::vector<int8_t> input(input_shape.FlatSize());
+    std::vector<int8_t> filter(filter_shape.FlatSize());
+    std::vector<int32_t> bias(output_depth);
+    tflite::testing::FillInt8(rng, &input);
+    tflite::testing::FillInt8(rng, &filter);
+    for (int32_t &b : bias) {
+        b = rng->Uniform(-20000, 20000);
+    }
+
+    tflite::FullyConnectedParams params = {};
+    params.input_offset = rng->Uniform(-127, 128);
+    params.weights_offset = rng->Uniform(-5, 5);
+    params.output_offset = rng->Uniform(-128, 127);
+    params.output_multiplier = rng->Uniform(1 << 30, std::numeric_limits<int32_t>::max());
+    params.output_shift = -9;
+    params.quantized_activation_min = -128;
+    params.quantized_activation_max = 127;
+
+    std::vector<int8_t> expected(output_shape.FlatSize());
+    std::vector<int8_t> actual(output_shape.FlatSize());
+    tflite::reference_integer_ops::FullyConnected(
+        params, input_shape, input.data(), filter_shape, filter.data(),
+        bias_shape, bias.data(), output_shape, expected.data());
+    tflite::optimized_integer_ops::FullyConnected(
+        params, input_shape, input.data(), filter_shape, filter.data(),
+        bias_shape, bias.data(), output_shape, actual.data());
+    return tflite::testing::ExpectEqual("fully_connected", expected, actual);
+}
+
+} // namespace
+
+int main()
+{
+    tflite::testing::TestRng rng(0x7e57);
+    int failures = 0;
+    failures += TestPerChannel(&rng) ? 0 : 1;
+    failures += TestChannel(&rng) ? 0 : 1;
+    failures += TestFullyConnected(&rng, 1, 256, 2) ? 0 : 1;
+    failures += TestFullyConnected(&rng, 3, 77, 130) ? 0 : 1;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the score filter of score_filter.h: the fixed-point moving average
+// against a floating point one and its convergence to a constant score, that
+// flickering scores raise no events, the hysteresis and debounce of the
+// person-present state, and that a new configuration keeps the state.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "host/tests/kernel_test_util.h"
+#include "score_filter.h"
+
+namespace {
+
+bool Expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL %s\n", what);
+    }
+    return condition;
+}
+
+score_filter_config_t Config(uint32_t alpha, int8_t enter, int8_t exit, uint32_t enter_frames,
+                             uint32_t exit_frames)
+{
+    score_filter_config_t config;
+    config.alpha = alpha;
+    config.enter_threshold = enter;
+    config.exit_threshold = exit;
+    config.enter_frames = enter_frames;
+    config.exit_frames = exit_frames;
+    return config;
+}
+
+bool TestConfig()
+{
+    bool ok = true;
+    score_filter_t filter;
+    score_filter_config_t config;
+    score_filter_default_config(&config);
+    ok = Expect(score_filter_init(&filter, &config) == 0, "default config") && ok;
+    ok = Expect(score_filter_init(nullptr, &config) == -1 &&
+                    score_filter_init(&filter, nullptr) == -1,
+                "null arguments rejected") && ok;
+    ok = Expect(score_filter_init(&filter, &(config = Config(0, 32, -32, 2, 4))) == -1,
+                "alpha 0 rejected") && ok;
+    ok = Expect(score_filter_init(&filter, &(config = Config(257, 32, -32, 2, 4))) == -1,
+                "alpha above 256 rejected") && ok;
+    ok = Expect(score_filter_init(&filter, &(config = Config(64, -32, 32, 2, 4))) == -1,
+                "exit threshold above enter threshold rejected") && ok;
+    ok = Expect(score_filter_init(&filter, &(config = Config(64, 32, -32, 0, 4))) == -1 &&
+                    score_filter_init(&filter, &(config = Config(64, 32, -32, 2, 0))) == -1,
+                "zero debounce rejected") && ok;
+    return ok;
+}
+
+bool TestAverage()
+{
+    bool ok = true;
+    tflite::testing::TestRng rng(19);
+    for (uint32_t alpha : {16u, 64u, 100u, 200u, 256u}) {
+        score_filter_t filter;
+        score_filter_config_t config = Config(alpha, 127, -128, 1, 1);
+        score_filter_init(&filter, &config);
+        double reference = 0.0;
+        int worst = 0;
+        for (int i = 0; i < 1000; ++i) {
+            const int8_t person = static_cast<int8_t>(rng.Uniform(-128, 127));
+            const int8_t no_person = static_cast<int8_t>(-1 - person);
+            int8_t smoothed_person = 0;
+            int8_t smoothed_no_person = 0;
+            score_filter_update(&filter, person, no_person, &smoothed_person,
+                                &smoothed_no_person);
+            reference = (i == 0) ? person : reference + (person - reference) * alpha / 256.0;
+            worst = std::max(worst, abs(smoothed_person - static_cast<int>(lround(reference))));
+            if (i == 0 || alpha == 256) {
+                ok = Expect(smoothed_person == person && smoothed_no_person == no_person,
+                            "unsmoothed scores passed through") && ok;
+            }
+        }
+        ok = Expect(worst <= 1, "average within one step of floating point") && ok;
+    }
+    return ok;
+}
+
+bool TestConstant()
+{
+    bool ok = true;
+    for (uint32_t alpha : {1u, 3u, 16u, 64u, 200u}) {
+        score_filter_t filter;
+        score_filter_config_t config = Config(alpha, 127, -128, 1, 1);
+        score_filter_init(&filter, &config);
+        score_filter_update(&filter, 127, -128, nullptr, nullptr);
+        int8_t smoothed_person = 0;
+        int8_t smoothed_no_person = 0;
+        for (int i = 0; i < 4000; ++i) {
+            score_filter_update(&filter, -100, 99, &smoothed_person, &smoothed_no_person);
+        }
+        ok = Expect(filter.person_q8 == -100 * 256 && filter.no_person_q8 == 99 * 256,
+                    "average reaches a constant score") && ok;
+        ok = Expect(smoothed_person == -100 && smoothed_no_person == 99,
+                    "smoothed constant score") && ok;
+    }
+    return ok;
+}
+
+bool TestFlicker()
+{
+    bool ok = true;
+    score_filter_t filter;
+    score_filter_config_t config;
+    score_filter_default_config(&config);
+    score_filter_init(&filter, &config);
+    // The raw decision flips every frame; the average stays near zero.
+    int events = 0;
+    for (int i = 0; i < 100; ++i) {
+        const int8_t person = (i & 1) ? 60 : -60;
+        events += score_filter_update(&filter, person, -1 - person, nullptr, nullptr) != 0;
+    }
+    ok = Expect(events == 0 && filter.events == 0 && !filter.present,
+                "flickering scores raise no events") && ok;
+    return ok;
+}
+
+bool TestHysteresis()
+{
+    bool ok = true;
+    score_filter_t filter;
+    // Without smoothing, so the thresholds apply to the raw scores.
+    score_filter_config_t config = Config(256, 32, -32, 2, 3);
+    score_filter_init(&filter, &config);
+
+    // One frame above the enter threshold is not enough.
+    ok = Expect(score_filter_update(&filter, 100, -101, nullptr, nullptr) ==
+                        SCORE_FILTER_EVENT_NONE &&
+                    score_filter_update(&filter, 0, -1, nullptr, nullptr) ==
+                        SCORE_FILTER_EVENT_NONE,
+                "single frame debounced") && ok;
+    ok = Expect(score_filter_update(&filter, 32, -33, nullptr, nullptr) ==
+                        SCORE_FILTER_EVENT_NONE &&
+                    score_filter_update(&filter, 40, -41, nullptr, nullptr) ==
+                        SCORE_FILTER_EVENT_ENTER &&
+                    filter.present && filter.event == SCORE_FILTER_EVENT_ENTER,
+                "enter after enter_frames") && ok;
+
+    // Scores between the thresholds keep the person present and restart the
+    // exit run.
+    ok = Expect(score_filter_update(&filter, -40, 39, nullptr, nullptr) == 0 &&
+                    score_filter_update(&filter, -40, 39, nullptr, nullptr) == 0 &&
+                    score_filter_update(&filter, -32, 31, nullptr, nullptr) == 0 &&
+                    score_filter_update(&filter, -40, 39, nullptr, nullptr) == 0 &&
+                    score_filter_update(&filter, -40, 39, nullptr, nullptr) == 0 &&
+                    filter.present && filter.event == SCORE_FILTER_EVENT_NONE,
+                "exit run restarts between the thresholds") && ok;
+    ok = Expect(score_filter_update(&filter, -40, 39, nullptr, nullptr) ==
+                        SCORE_FILTER_EVENT_EXIT &&
+                    !filter.present && filter.events == 2,
+                "exit after exit_frames") && ok;
+
+    // A new configuration keeps the averages and the state.
+    score_filter_init(&filter, &(config = Config(64, 32, -32, 1, 1)));
+    score_filter_update(&filter, 100, -101, nullptr, nullptr);
+    const int32_t person_q8 = filter.person_q8;
+    config = Config(64, 120, 110, 1, 1);
+    ok = Expect(score_filter_configure(&filter, &config) == 0, "configure") && ok;
+    ok = Expect(filter.present && filter.person_q8 == person_q8 &&
+                    filter.config.enter_threshold == 120,
+                "configure keeps the state") && ok;
+    ok = Expect(score_filter_configure(&filter, &(config = Config(64, 0, 1, 1, 1))) == -1 &&
+                    filter.config.enter_threshold == 120,
+                "invalid configuration ignored") && ok;
+    ok = Expect(score_filter_update(&filter, 100, -101, nullptr, nullptr) ==
+                        SCORE_FILTER_EVENT_EXIT,
+                "new thresholds apply") && ok;
+    return ok;
+}
+
+// A person walks in for 20 frames with noisy scores; the filter must report
+// exactly one visit.
+bool TestNoisyVisit()
+{
+    bool ok = true;
+    tflite::testing::TestRng rng(5);
+    score_filter_t filter;
+    score_filter_config_t config;
+    score_filter_default_config(&config);
+    score_filter_init(&filter, &config);
+    int raw_changes = 0;
+    int enter_frame = -1;
+    int exit_frame = -1;
+    bool raw_person = false;
+    for (int i = 0; i < 60; ++i) {
+        const int base = (i >= 20 && i < 40) ? 70 : -70;
+        const int8_t person = static_cast<int8_t>(base + rng.Uniform(-90, 90));
+        raw_changes += (person > 0) != raw_person;
+        raw_person = person > 0;
+        const int8_t event = score_filter_update(&filter, person, -1 - person, nullptr, nullptr);
+        if (event == SCORE_FILTER_EVENT_ENTER) {
+            enter_frame = i;
+        } else if (event == SCORE_FILTER_EVENT_EXIT) {
+            exit_frame = i;
+        }
+    }
+    ok = Expect(raw_changes > 2, "raw decisions flicker") && ok;
+    ok = Expect(filter.events == 2 && enter_frame >= 20 && enter_frame < 30 &&
+                    exit_frame >= 40 && exit_frame < 50,
+                "one debounced visit") && ok;
+    return ok;
+}
+
+}  // namespace
+
+int main()
+{
+    bool ok = TestConfig();
+    ok = TestAverage() && ok;
+    ok = TestConstant() && ok;
+    ok = TestFlicker() && ok;
+    ok = TestHysteresis() && ok;
+    ok = TestNoisyVisit() && ok;
+    printf("%s score_filter\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "image_preprocess.h"
+
+#include <stddef.h>
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+#define WEIGHT_ONE (1 << PREPROCESS_WEIGHT_BITS)
+
+/*
+ * Fills the taps of one axis. Positions are computed in Q8 from
+ * ((2 * i + 1) * in_size / (2 * out_size) - 0.5), rounded to nearest.
+ */
+static void plan_axis(int in_size, int out_size, uint32_t origin,
+                      uint32_t stride, uint32_t* offset0, uint32_t* offset1,
+                      uint32_t* weight)
+{
+    for (int i = 0; i < out_size; i++) {
+        int32_t pos = (int32_t)((((int64_t)(2 * i + 1) * in_size * WEIGHT_ONE) + out_size) /
+                                (2 * out_size)) - WEIGHT_ONE / 2;
+        if (pos < 0) {
+            pos = 0;
+        }
+        int32_t index = pos >> PREPROCESS_WEIGHT_BITS;
+        int32_t frac = pos & (WEIGHT_ONE - 1);
+        if (index >= in_size - 1) {
+            index = in_size - 1;
+            frac = 0;
+        }
+        const int32_t next = (index + 1 < in_size) ? index + 1 : index;
+        offset0[i] = (origin + index) * stride;
+        offset1[i] = (origin + next) * stride;
+        weight[i] = frac;
+    }
+}
+
+// Bytes per pixel and position of the luma byte in a pixel.
+static void format_layout(preprocess_format_t format, uint32_t* pixel_size,
+                          uint32_t* luma_offset)
+{
+    switch (format) {
+        case PREPROCESS_FORMAT_YUV420:
+        case PREPROCESS_FORMAT_GRAY8:
+            *pixel_size = 1;
+            *luma_offset = 0;
+            break;
+        case PREPROCESS_FORMAT_YUYV:
+            *pixel_size = 2;
+            *luma_offset = 0;
+            break;
+        case PREPROCESS_FORMAT_UYVY:
+            *pixel_size = 2;
+            *luma_offset = 1;
+            break;
+        case PREPROCESS_FORMAT_RGBA8888:
+        default:
+            *pixel_size = sizeof(uint32_t);
+            *luma_offset = 0;
+            break;
+    }
+}
+
+static uint32_t frame_stride(const preprocess_frame_t* frame)
+{
+    uint32_t pixel_size;
+    uint32_t luma_offset;
+    format_layout(frame->format, &pixel_size, &luma_offset);
+    return (frame->stride > 0) ? (uint32_t)frame->stride : pixel_size * frame->width;
+}
+
+int8_t preprocess_plan_init(preprocess_plan_t* plan, const preprocess_frame_t* frame,
+                            int crop_x, int crop_y, int crop_width,
+                            int crop_height, int out_width, int out_height)
+{
+    if ((plan == NULL) || (frame == NULL) || (frame->format < PREPROCESS_FORMAT_RGBA8888) ||
+        (frame->format > PREPROCESS_FORMAT_GRAY8) || (crop_width <= 0) ||
+        (crop_height <= 0) || (crop_x < 0) || (crop_y < 0) ||
+        (crop_x + crop_width > frame->width) || (crop_y + crop_height > frame->height) ||
+        (out_width <= 0) || (out_height <= 0) ||
+        (out_width > PREPROCESS_MAX_DIM) || (out_height > PREPROCESS_MAX_DIM)) {
+        return -1;
+    }
+    uint32_t pixel_size;
+    uint32_t luma_offset;
+    format_layout(frame->format, &pixel_size, &luma_offset);
+    const uint32_t stride = frame_stride(frame);
+    if (stride < pixel_size * frame->width) {
+        return -1;
+    }
+    plan->format = frame->format;
+    plan->out_width = out_width;
+    plan->out_height = out_height;
+    plan_axis(crop_width, out_width, crop_x, pixel_size, plan->x_offset[0],
+              plan->x_offset[1], plan->x_weight);
+    plan_axis(crop_height, out_height, crop_y, stride, plan->y_offset[0],
+              plan->y_offset[1], plan->y_weight);
+    // Point the taps of packed YUV at the Y byte of their pixel.
+    for (int x = 0; x < out_width; x++) {
+        plan->x_offset[0][x] += luma_offset;
+        plan->x_offset[1][x] += luma_offset;
+    }
+    return 0;
+}
+
+uint32_t preprocess_frame_size(const preprocess_frame_t* frame)
+{
+    const uint32_t size = frame_stride(frame) * frame->height;
+    // Two chroma planes (or one interleaved plane) at a quarter of the size.
+    return (frame->format == PREPROCESS_FORMAT_YUV420) ? size + size / 2 : size;
+}
+
+static inline uint32_t rgba_luma(uint32_t pixel)
+{
+    const uint32_t r = (pixel >> PREPROCESS_R_SHIFT) & 0xff;
+    const uint32_t g = (pixel >> PREPROCESS_G_SHIFT) & 0xff;
+    const uint32_t b = (pixel >> PREPROCESS_B_SHIFT) & 0xff;
+    return (PREPROCESS_LUMA_R * r + PREPROCESS_LUMA_G * g + PREPROCESS_LUMA_B * b + 128) >> 8;
+}
+
+#if defined(__riscv_vector)
+static inline vuint32m4_t rgba_luma_vector(vuint32m4_t pixel, size_t vl)
+{
+    vuint32m4_t r = vand_vx_u32m4(vsrl_vx_u32m4(pixel, PREPROCESS_R_SHIFT, vl), 0xff, vl);
+    vuint32m4_t g = vand_vx_u32m4(vsrl_vx_u32m4(pixel, PREPROCESS_G_SHIFT, vl), 0xff, vl);
+    vuint32m4_t b = vand_vx_u32m4(vsrl_vx_u32m4(pixel, PREPROCESS_B_SHIFT, vl), 0xff, vl);
+    vuint32m4_t y = vmul_vx_u32m4(r, PREPROCESS_LUMA_R, vl);
+    y = vmacc_vx_u32m4(y, PREPROCESS_LUMA_G, g, vl);
+    y = vmacc_vx_u32m4(y, PREPROCESS_LUMA_B, b, vl);
+    return vsrl_vx_u32m4(vadd_vx_u32m4(y, 128, vl), 8, vl);
+}
+
+// Gathers the luma bytes at the given offsets and zero-extends them.
+static inline vuint32m4_t gather_luma_vector(const uint8_t* row, vuint32m4_t offset,
+                                             size_t vl)
+{
+    vuint8m1_t y = vluxei32_v_u8m1(row, offset, vl);
+    return vwaddu_vx_u32m4(vwaddu_vx_u16m2(y, 0, vl), 0, vl);
+}
+
+// Blends a and b as a * (1 - weight) + b * weight, in Q8.
+static inline vuint32m4_t blend_vector(vuint32m4_t a, vuint32m4_t b,
+                                       vuint32m4_t weight, size_t vl)
+{
+    vuint32m4_t out = vmul_vv_u32m4(a, vrsub_vx_u32m4(weight, WEIGHT_ONE, vl), vl);
+    return vmacc_vv_u32m4(out, weight, b, vl);
+}
+
+// Blends the four taps of vl output pixels vertically, rounds the Q16 result
+// to 8 bits and stores it shifted to the int8 range.
+static inline void store_output_vector(vuint32m4_t top, vuint32m4_t bottom,
+                                       uint32_t y_weight, int8_t* output, size_t vl)
+{
+    vuint32m4_t value = blend_vector(top, bottom, vmv_v_x_u32m4(y_weight, vl), vl);
+    // The value is at most 255 << 16, so the narrowing shifts are exact.
+    value = vadd_vx_u32m4(value, 1 << (2 * PREPROCESS_WEIGHT_BITS - 1), vl);
+    vuint8m1_t gray = vnsrl_wx_u8m1(
+        vnsrl_wx_u16m2(value, 2 * PREPROCESS_WEIGHT_BITS, vl), 0, vl);
+    gray = vxor_vx_u8m1(gray, PREPROCESS_INPUT_ZERO_SHIFT, vl);
+    vse8_v_i8m1(output, vreinterpret_v_u8m1_i8m1(gray), vl);
+}
+#endif
+
+// Scalar form of the blends above for one output pixel.
+static inline int8_t blend_taps(uint32_t top_left, uint32_t top_right,
+                                uint32_t bottom_left, uint32_t bottom_right,
+                                uint32_t x_weight, uint32_t y_weight)
+{
+    const uint32_t top = top_left * (WEIGHT_ONE - x_weight) + top_right * x_weight;
+    const uint32_t bottom = bottom_left * (WEIGHT_ONE - x_weight) + bottom_right * x_weight;
+    const uint32_t value = top * (WEIGHT_ONE - y_weight) + bottom * y_weight;
+    const uint32_t gray = (value + (1 << (2 * PREPROCESS_WEIGHT_BITS - 1))) >>
+                          (2 * PREPROCESS_WEIGHT_BITS);
+    return (int8_t)((int32_t)gray - PREPROCESS_INPUT_ZERO_SHIFT);
+}
+
+/*
+ * One output row of an RGBA frame: gathers the four taps of every pixel from
+ * the two source rows, converts them to luma, blends horizontally and then
+ * vertically (Q16 in total) and rounds back to 8 bits.
+ */
+static void preprocess_rgba_row(const preprocess_plan_t* plan, const uint8_t* row0,
+                                const uint8_t* row1, uint32_t y_weight,
+                                int8_t* output)
+{
+#if defined(__riscv_vector)
+    for (size_t vl, x = 0; x < (size_t)plan->out_width; x += vl) {
+        // Set Vector length
+        vl = vsetvl_e32m4(plan->out_width - x);
+        vuint32m4_t left = vle32_v_u32m4(plan->x_offset[0] + x, vl);
+        vuint32m4_t right = vle32_v_u32m4(plan->x_offset[1] + x, vl);
+        vuint32m4_t x_weight = vle32_v_u32m4(plan->x_weight + x, vl);
+        vuint32m4_t top = blend_vector(
+            rgba_luma_vector(vluxei32_v_u32m4((const uint32_t*)row0, left, vl), vl),
+            rgba_luma_vector(vluxei32_v_u32m4((const uint32_t*)row0, right, vl), vl),
+            x_weight, vl);
+        vuint32m4_t bottom = blend_vector(
+            rgba_luma_vector(vluxei32_v_u32m4((const uint32_t*)row1, left, vl), vl),
+            rgba_luma_vector(vluxei32_v_u32m4((const uint32_t*)row1, right, vl), vl),
+            x_weight, vl);
+        store_output_vector(top, bottom, y_weight, output + x, vl);
+    }
+#else
+    for (int x = 0; x < plan->out_width; x++) {
+        const uint32_t left = plan->x_offset[0][x];
+        const uint32_t right = plan->x_offset[1][x];
+        output[x] = blend_taps(rgba_luma(*(const uint32_t*)(row0 + left)),
+                               rgba_luma(*(const uint32_t*)(row0 + right)),
+                               rgba_luma(*(const uint32_t*)(row1 + left)),
+                               rgba_luma(*(const uint32_t*)(row1 + right)),
+                               plan->x_weight[x], y_weight);
+    }
+#endif
+}
+
+/*
+ * One output row of a YUV frame: the same blend on the Y bytes, which the
+ * plan offsets already point at.
+ */
+static void preprocess_luma_row(const preprocess_plan_t* plan, const uint8_t* row0,
+                                const uint8_t* row1, uint32_t y_weight,
+                                int8_t* output)
+{
+#if defined(__riscv_vector)
+    for (size_t vl, x = 0; x < (size_t)plan->out_width; x += vl) {
+        // Set Vector length
+        vl = vsetvl_e32m4(plan->out_width - x);
+        vuint32m4_t left = vle32_v_u32m4(plan->x_offset[0] + x, vl);
+        vuint32m4_t right = vle32_v_u32m4(plan->x_offset[1] + x, vl);
+        vuint32m4_t x_weight = vle32_v_u32m4(plan->x_weight + x, vl);
+        vuint32m4_t top = blend_vector(gather_luma_vector(row0, left, vl),
+                                       gather_luma_vector(row0, right, vl),
+                                       x_weight, vl);
+        vuint32m4_t bottom = blend_vector(gather_luma_vector(row1, left, vl),
+                                          gather_luma_vector(row1, right, vl),
+                                          x_weight, vl);
+        store_output_vector(top, bottom, y_weight, output + x, vl);
+    }
+#else
+    for (int x = 0; x < plan->out_width; x++) {
+        const uint32_t left = plan->x_offset[0][x];
+        const uint32_t right = plan->x_offset[1][x];
+        output[x] = blend_taps(row0[left], row0[right], row1[left], row1[right],
+                               plan->x_weight[x], y_weight);
+    }
+#endif
+}
+
+void preprocess_frame_to_input(const preprocess_plan_t* plan, const void* frame,
+                               int8_t* output)
+{
+    const uint8_t* base = (const uint8_t*)frame;
+    const int rgba = plan->format == PREPROCESS_FORMAT_RGBA8888;
+    for (int y = 0; y < plan->out_height; y++) {
+        const uint8_t* row0 = base + plan->y_offset[0][y];
+        const uint8_t* row1 = base + plan->y_offset[1][y];
+        int8_t* out_row = output + y * plan->out_width;
+        if (rgba) {
+            preprocess_rgba_row(plan, row0, row1, plan->y_weight[y], out_row);
+        } else {
+            preprocess_luma_row(plan, row0, row1, plan->y_weight[y], out_row);
+        }
+    }
+}
@@ -0,0 +1,149 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef IMAGE_PREPROCESS_H_
+#define IMAGE_PREPROCESS_H_
+
+#include <stdint.h>
+
+// Fused camera preprocessing: crop, bilinear resize, grayscale conversion and
+// int8 quantization in a single pass over the camera frame.
+//
+// Every output pixel reads its four bilinear taps straight from the frame and
+// blends their luma only, so the frame is never copied, cropped in place or
+// resized in colour. RGBA frames are converted to luma tap by tap; YUV frames
+// are sampled on the Y plane directly, reading one byte per tap instead of
+// four and never touching chroma. All interpolation positions and weights
+// are computed once by preprocess_plan_init().
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Largest supported output width or height, enough for the finest level of
+// the localization pyramid (localize.h).
+#define PREPROCESS_MAX_DIM (256)
+
+// Bits of the fixed-point bilinear weights.
+#define PREPROCESS_WEIGHT_BITS (8)
+
+// Byte position of the colour channels in a little-endian RGBA8888 pixel.
+#define PREPROCESS_R_SHIFT (0)
+#define PREPROCESS_G_SHIFT (8)
+#define PREPROCESS_B_SHIFT (16)
+
+// BT.601 luma weights in Q8: Y = (77 R + 150 G + 29 B + 128) >> 8.
+#define PREPROCESS_LUMA_R (77)
+#define PREPROCESS_LUMA_G (150)
+#define PREPROCESS_LUMA_B (29)
+
+// The model input is int8 with scale 1/127.5 and zero point -1, i.e. it was
+// trained on pixel / 127.5 - 1, so a gray value p quantizes to p - 128.
+#define PREPROCESS_INPUT_ZERO_SHIFT (128)
+
+/**
+ * Pixel layouts of the camera frame.
+ */
+typedef enum {
+    // 32 bit RGBA, see PREPROCESS_*_SHIFT.
+    PREPROCESS_FORMAT_RGBA8888 = 0,
+    // YUV420 planar (I420, YV12) or semi-planar (NV12, NV21): the Y plane
+    // comes first with one byte per pixel.
+    PREPROCESS_FORMAT_YUV420,
+    // YUV422 packed as Y0 U Y1 V.
+    PREPROCESS_FORMAT_YUYV,
+    // YUV422 packed as U Y0 V Y1.
+    PREPROCESS_FORMAT_UYVY,
+    // A single 8 bit luma plane, as in recorded grayscale frames and PGM
+    // images.
+    PREPROCESS_FORMAT_GRAY8,
+} preprocess_format_t;
+
+/**
+ * Geometry of a camera frame.
+ */
+typedef struct {
+    preprocess_format_t format;
+    int width;
+    int height;
+    // Bytes from one row to the next (of the Y plane for YUV420), or 0 for
+    // rows without padding.
+    int stride;
+} preprocess_frame_t;
+
+/**
+ * Coefficient table of one crop + resize. Horizontal taps are byte offsets
+ * from the start of a frame row, vertical taps are byte offsets from the start
+ * of the frame, both with the crop origin already folded in. The weights are
+ * the Q8 share of the right (bottom) tap.
+ */
+typedef struct {
+    preprocess_format_t format;
+    int out_width;
+    int out_height;
+    uint32_t x_offset[2][PREPROCESS_MAX_DIM];
+    uint32_t x_weight[PREPROCESS_MAX_DIM];
+    uint32_t y_offset[2][PREPROCESS_MAX_DIM];
+    uint32_t y_weight[PREPROCESS_MAX_DIM];
+} preprocess_plan_t;
+
+/**
+ * Computes the coefficient table that maps the crop rectangle of a frame to
+ * an out_width x out_height image. Sample positions use pixel centres, as in
+ * (x + 0.5) * crop_width / out_width - 0.5, clamped to the crop.
+ *
+ * @param plan Table to fill.
+ * @param frame Layout and size of the camera frames.
+ * @param crop_x Left column of the crop in the frame.
+ * @param crop_y Top row of the crop in the frame.
+ * @param crop_width Width of the crop in pixels.
+ * @param crop_height Height of the crop in pixels.
+ * @param out_width Width of the output image.
+ * @param out_height Height of the output image.
+ *
+ * @return 0 if successfull, -1 for invalid arguments.
+ */
+int8_t preprocess_plan_init(preprocess_plan_t* plan, const preprocess_frame_t* frame,
+                            int crop_x, int crop_y, int crop_width,
+                            int crop_height, int out_width, int out_height);
+
+/**
+ * Renders one camera frame into an int8 grayscale model input. The Y samples
+ * of YUV frames are used as luma without range expansion.
+ *
+ * @param plan Table from preprocess_plan_init().
+ * @param frame Camera frame in the format of the plan, read only.
+ * @param output out_width x out_height int8 output, usually the input
+ *               tensor of the interpreter.
+ *
+ * @return none
+ */
+void preprocess_frame_to_input(const preprocess_plan_t* plan, const void* frame,
+                               int8_t* output);
+
+/**
+ * Bytes of one frame with the given layout, including chroma.
+ *
+ * @param frame Layout and size of the frame.
+ *
+ * @return Frame size in bytes.
+ */
+uint32_t preprocess_frame_size(const preprocess_frame_t* frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // IMAGE_PREPROCESS_H_
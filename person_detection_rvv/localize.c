@@ -0,0 +1,183 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "localize.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Size of a frame dimension in a level, rounded to nearest.
+static int level_dim(int frame_dim, int model_side, int window_size)
+{
+    return (frame_dim * model_side + window_size / 2) / window_size;
+}
+
+// Windows needed to cover length with windows of side pixels that overlap by
+// at least half.
+static int window_count(int length, int side)
+{
+    const int step = side / 2;
+    return (length - side + step - 1) / step + 1;
+}
+
+// Offset of window index of count along an axis of length pixels.
+static int window_offset(int index, int count, int length, int side)
+{
+    return (count > 1) ? index * (length - side) / (count - 1) : 0;
+}
+
+static int8_t check_scales(const preprocess_frame_t* frame, const int* window_sizes,
+                           int scales, int model_side)
+{
+    if ((frame == NULL) || (window_sizes == NULL) || (scales <= 0) ||
+        (scales > LOCALIZE_MAX_SCALES) || (model_side <= 0)) {
+        return -1;
+    }
+    for (int i = 0; i < scales; i++) {
+        const int size = window_sizes[i];
+        if ((size < model_side) || (size > frame->width) || (size > frame->height) ||
+            (level_dim(frame->width, model_side, size) > PREPROCESS_MAX_DIM) ||
+            (level_dim(frame->height, model_side, size) > PREPROCESS_MAX_DIM)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+uint32_t localize_pyramid_size(const preprocess_frame_t* frame, const int* window_sizes,
+                               int scales, int model_side)
+{
+    if (check_scales(frame, window_sizes, scales, model_side) != 0) {
+        return 0;
+    }
+    uint32_t size = 0;
+    for (int i = 0; i < scales; i++) {
+        size += (uint32_t)level_dim(frame->width, model_side, window_sizes[i]) *
+                (uint32_t)level_dim(frame->height, model_side, window_sizes[i]);
+    }
+    return size;
+}
+
+int8_t localize_init(localize_t* localize, const preprocess_frame_t* frame,
+                     const int* window_sizes, int scales, int model_side, int8_t* pyramid)
+{
+    if ((localize == NULL) || (pyramid == NULL) ||
+        (check_scales(frame, window_sizes, scales, model_side) != 0)) {
+        return -1;
+    }
+    localize->frame = *frame;
+    localize->model_side = model_side;
+    localize->scales = scales;
+    for (int i = 0; i < scales; i++) {
+        localize_level_t* level = &localize->levels[i];
+        level->window_size = window_sizes[i];
+        level->width = level_dim(frame->width, model_side, window_sizes[i]);
+        level->height = level_dim(frame->height, model_side, window_sizes[i]);
+        level->columns = window_count(level->width, model_side);
+        level->rows = window_count(level->height, model_side);
+        level->image = pyramid;
+        pyramid += level->width * level->height;
+        if (preprocess_plan_init(&level->plan, frame, 0, 0, frame->width, frame->height,
+                                 level->width, level->height) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+uint32_t localize_window_count(const localize_t* localize)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < localize->scales; i++) {
+        count += (uint32_t)(localize->levels[i].columns * localize->levels[i].rows);
+    }
+    return count;
+}
+
+void localize_build_pyramid(localize_t* localize, const void* frame)
+{
+    for (int i = 0; i < localize->scales; i++) {
+        preprocess_frame_to_input(&localize->levels[i].plan, frame, localize->levels[i].image);
+    }
+}
+
+// Raises the heat of every cell whose centre lies in the window.
+static void add_heat(const localize_t* localize, const localize_window_t* window,
+                     localize_result_t* result)
+{
+    const int width = localize->frame.width;
+    const int height = localize->frame.height;
+    for (int cy = 0; cy < LOCALIZE_HEAT_HEIGHT; cy++) {
+        const int centre_y = ((2 * cy + 1) * height) / (2 * LOCALIZE_HEAT_HEIGHT);
+        if ((centre_y < window->y) || (centre_y >= window->y + window->size)) {
+            continue;
+        }
+        for (int cx = 0; cx < LOCALIZE_HEAT_WIDTH; cx++) {
+            const int centre_x = ((2 * cx + 1) * width) / (2 * LOCALIZE_HEAT_WIDTH);
+            if ((centre_x >= window->x) && (centre_x < window->x + window->size) &&
+                (window->person_score > result->heat[cy][cx])) {
+                result->heat[cy][cx] = window->person_score;
+            }
+        }
+    }
+}
+
+int8_t localize_run(const localize_t* localize, const model_input_t* model_input,
+                    localize_result_t* result)
+{
+    if ((localize == NULL) || (model_input == NULL) || (result == NULL) ||
+        (model_input->width != localize->model_side) ||
+        (model_input->height != localize->model_side) || (model_input->channels != 1)) {
+        return -1;
+    }
+    const int side = localize->model_side;
+    memset(result->heat, -128, sizeof(result->heat));
+    result->windows = 0;
+    result->best.person_score = -128;
+    result->best.no_person_score = 127;
+
+    for (int i = 0; i < localize->scales; i++) {
+        const localize_level_t* level = &localize->levels[i];
+        for (int row = 0; row < level->rows; row++) {
+            const int y = window_offset(row, level->rows, level->height, side);
+            for (int column = 0; column < level->columns; column++) {
+                const int x = window_offset(column, level->columns, level->width, side);
+                // The input is consumed by every inference, so the window is
+                // copied in again each time.
+                const int8_t* source = level->image + y * level->width + x;
+                for (int line = 0; line < side; line++) {
+                    memcpy(model_input->data + line * side, source + line * level->width,
+                           side);
+                }
+                localize_window_t window;
+                if (run_model(&window.person_score, &window.no_person_score) != 0) {
+                    return -2;
+                }
+                // Back to frame pixels.
+                window.x = x * localize->frame.width / level->width;
+                window.y = y * localize->frame.height / level->height;
+                window.size = level->window_size;
+                add_heat(localize, &window, result);
+                if ((result->windows == 0) ||
+                    (window.person_score > result->best.person_score)) {
+                    result->best = window;
+                }
+                result->windows++;
+            }
+        }
+    }
+    return 0;
+}
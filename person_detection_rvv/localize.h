@@ -0,0 +1,154 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef LOCALIZE_H_
+#define LOCALIZE_H_
+
+#include <stdint.h>
+
+#include "image_preprocess.h"
+#include "main_functions.h"
+
+// Multi-scale sliding window localization over the full camera frame.
+//
+// Every scale is a square window size in frame pixels. The frame is
+// preprocessed once per scale into a pyramid level, the whole frame resized
+// so that one window becomes model_side x model_side pixels. The windows of
+// a level overlap by half and are copied row by row into the model input, so
+// the model runs on the already converted pixels through the interpreter
+// prepared by init_model(). Each window's person score is spread over the
+// cells of a coarse heat map of the frame, which keeps the highest score of
+// any window covering a cell.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOCALIZE_MAX_SCALES (3)
+
+// Heat map cells across and down the frame.
+#define LOCALIZE_HEAT_WIDTH (16)
+#define LOCALIZE_HEAT_HEIGHT (12)
+
+/**
+ * One window in frame pixels with its scores.
+ */
+typedef struct {
+    int x;
+    int y;
+    int size;
+    int8_t person_score;
+    int8_t no_person_score;
+} localize_window_t;
+
+/**
+ * One scale of the pyramid.
+ */
+typedef struct {
+    // Window size in frame pixels.
+    int window_size;
+    // Level image, width x height int8 model input pixels.
+    int8_t* image;
+    int width;
+    int height;
+    // Windows across and down, spread evenly from edge to edge so that
+    // neighbours overlap by at least half.
+    int columns;
+    int rows;
+    preprocess_plan_t plan;
+} localize_level_t;
+
+typedef struct {
+    preprocess_frame_t frame;
+    int model_side;
+    int scales;
+    localize_level_t levels[LOCALIZE_MAX_SCALES];
+} localize_t;
+
+typedef struct {
+    // Highest person score of the windows covering each cell, -128 if none.
+    int8_t heat[LOCALIZE_HEAT_HEIGHT][LOCALIZE_HEAT_WIDTH];
+    // Window with the highest person score.
+    localize_window_t best;
+    uint32_t windows;
+} localize_result_t;
+
+/**
+ * Bytes of the pyramid for a frame and a set of window sizes.
+ *
+ * @param frame Layout and size of the camera frames.
+ * @param window_sizes Window size of every scale in frame pixels.
+ * @param scales Number of scales.
+ * @param model_side Width and height of the model input.
+ *
+ * @return Pyramid size in bytes, 0 for invalid arguments.
+ */
+uint32_t localize_pyramid_size(const preprocess_frame_t* frame, const int* window_sizes,
+                               int scales, int model_side);
+
+/**
+ * Sets up the pyramid levels and window grids.
+ *
+ * @param localize Localizer to initialize.
+ * @param frame Layout and size of the camera frames.
+ * @param window_sizes Window size of every scale in frame pixels, at least
+ *                     model_side and at most the frame height.
+ * @param scales Number of scales, at most LOCALIZE_MAX_SCALES.
+ * @param model_side Width and height of the model input.
+ * @param pyramid Buffer of localize_pyramid_size() bytes for the levels.
+ *
+ * @return 0 if successfull, -1 for invalid arguments.
+ */
+int8_t localize_init(localize_t* localize, const preprocess_frame_t* frame,
+                     const int* window_sizes, int scales, int model_side, int8_t* pyramid);
+
+/**
+ * Number of windows of one frame.
+ *
+ * @param localize Initialized localizer.
+ *
+ * @return Window count.
+ */
+uint32_t localize_window_count(const localize_t* localize);
+
+/**
+ * Preprocesses a camera frame into every level of the pyramid.
+ *
+ * @param localize Initialized localizer.
+ * @param frame Camera frame, read only.
+ *
+ * @return none
+ */
+void localize_build_pyramid(localize_t* localize, const void* frame);
+
+/**
+ * Classifies every window of the pyramid built last and fills the heat map
+ * and the best window.
+ *
+ * @param localize Initialized localizer.
+ * @param model_input Model input from get_model_input().
+ * @param result Pointer to store the heat map and the best window.
+ *
+ * @return 0 if successfull, -1 for invalid arguments, -2 if inference
+ *         failed.
+ */
+int8_t localize_run(const localize_t* localize, const model_input_t* model_input,
+                    localize_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LOCALIZE_H_
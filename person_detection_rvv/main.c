@@ -16,11 +16,16 @@
 
 #include <stdio.h>
 #include <string.h>
+#include "deferred_log.h"
 #include "main_functions.h"
+#include "image_preprocess.h"
+#include "localize.h"
+#include "motion_gate.h"
+#include "pipeline.h"
+#include "pipeline_os.h"
+#include "score_filter.h"
 #include <bl_cam.h>
 #include <bl_timer.h>
-#include <imgtool/bilinear_interpolation.h>
-#include <imgtool/rgb_cvt.h>
 /* FreeRTOS */
 #include <FreeRTOS.h>
 #include <task.h>
@@ -34,9 +39,52 @@
 // Camera
 #define CAMERA_W (400)
 #define CAMERA_H (300)
-#define TARGET_WH (CAMERA_H)
-#define IMG_W (96)
-#define IMG_H (96)
+// Frames are fetched as RGBA. The preprocessing can also sample the Y plane
+// of YUV frames, but the SDK getter for those and the layout it returns have
+// not been checked on the board yet.
+#define CAMERA_FORMAT PREPROCESS_FORMAT_RGBA8888
+// Pipeline: print the steady-state frame rate and stage occupancy every
+// PIPELINE_REPORT_INTERVAL frames.
+#define PIPELINE_WARMUP_FRAMES (2)
+// kMaxImageSize of model_settings.h, which is C++ only.
+#define MODEL_INPUT_SIZE (96 * 96 * 1)
+#define PIPELINE_REPORT_INTERVAL (16)
+// With MOTION_GATING inference is skipped on frames that did not change
+// (see bouffalo.mk).
+#ifndef MOTION_GATE_THRESHOLD
+#define MOTION_GATE_THRESHOLD MOTION_GATE_DEFAULT_THRESHOLD
+#endif
+#ifndef MOTION_GATE_MAX_SKIP
+#define MOTION_GATE_MAX_SKIP MOTION_GATE_DEFAULT_MAX_SKIP
+#endif
+// The printed scores are smoothed and a person counts as present after
+// SCORE_FILTER_ENTER_FRAMES frames at or above SCORE_FILTER_ENTER_THRESHOLD
+// (see bouffalo.mk).
+#ifndef SCORE_FILTER_ALPHA
+#define SCORE_FILTER_ALPHA SCORE_FILTER_DEFAULT_ALPHA
+#endif
+#ifndef SCORE_FILTER_ENTER_THRESHOLD
+#define SCORE_FILTER_ENTER_THRESHOLD SCORE_FILTER_DEFAULT_ENTER_THRESHOLD
+#endif
+#ifndef SCORE_FILTER_EXIT_THRESHOLD
+#define SCORE_FILTER_EXIT_THRESHOLD SCORE_FILTER_DEFAULT_EXIT_THRESHOLD
+#endif
+#ifndef SCORE_FILTER_ENTER_FRAMES
+#define SCORE_FILTER_ENTER_FRAMES SCORE_FILTER_DEFAULT_ENTER_FRAMES
+#endif
+#ifndef SCORE_FILTER_EXIT_FRAMES
+#define SCORE_FILTER_EXIT_FRAMES SCORE_FILTER_DEFAULT_EXIT_FRAMES
+#endif
+// With CAMERA_LOCALIZE every frame is searched with a sliding window at three
+// scales instead of classifying the centre crop (see bouffalo.mk).
+#define LOCALIZE_SCALES (3)
+#define LOCALIZE_PYRAMID_SIZE (128 * 96 + 192 * 144 + 256 * 192)
+// The deferred log is drained by a task above idle priority, which formats
+// the records on the console, or with DEFERRED_LOG_HEX writes them as hex
+// lines for host/decode_log.py (see bouffalo.mk).
+#define LOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define LOG_TASK_STACK_WORDS (1024)
+#define LOG_DRAIN_INTERVAL_MS (20)
 // LCD
 #define BLACK_COLOR (0x000000)
 #define WHITE_COLOR (0xFFFFFF)
@@ -47,18 +95,173 @@
 // See https://alex-robenko.gitbook.io/bare_metal_cpp/compiler_output/static#custom-destructors
 void *__dso_handle = NULL;
 
-uint8_t g_image_buf[IMG_W * IMG_H] = {0};
+static void write_console(void* context, const char* text, uint32_t length)
+{
+    (void)context;
+    printf("%.*s", (int)length, text);
+}
 
-int main()
+// Writes out the deferred log whenever no frame work is ready to run.
+static void log_task(void* arg)
+{
+    (void)arg;
+    for (;;) {
+#if defined(DEFERRED_LOG_HEX)
+        deferred_log_drain_hex(write_console, NULL, 0);
+#else
+        deferred_log_drain_text(write_console, NULL, 0);
+#endif
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+#ifndef RUN_MODEL_ON_TEST_IMAGES
+// The driver hands out the oldest frame of its queue until it is popped, so
+// the next frame can only be taken once the previous one was released. The
+// token queue holds one item while no frame is out.
+static int8_t camera_get_frame(void* context, const void** frame)
 {
     uint8_t* picture = NULL;
     uint32_t length = 0;
+    os_queue_pop((os_queue_t*)context);
+    while (0 != bl_cam_mipi_rgb_frame_get(&picture, &length)) {
+        vTaskDelay(1);
+    }
+    *frame = picture;
+    return 0;
+}
+
+static void camera_release_frame(void* context, const void* frame)
+{
+    (void)frame;
+    bl_cam_mipi_frame_pop();
+    os_queue_push((os_queue_t*)context, NULL);
+}
+
+typedef struct {
+    uint32_t last_time;
+    const score_filter_t* filter;
+} result_context_t;
+
+// Gets the smoothed scores; the filter holds the person-present state.
+static void show_result(void* context, uint32_t frame_index, int8_t person_score,
+                        int8_t no_person_score)
+{
+    result_context_t* result = (result_context_t*)context;
+    uint8_t lcd_buff[128] = {0};
+    const uint32_t now = bl_timer_now_us() / 1000;
+    const uint32_t frame_time = now - result->last_time;
+    result->last_time = now;
+
+    // write on cli, through the deferred log
+    if (result->filter->event == SCORE_FILTER_EVENT_ENTER) {
+        DLOG(DLOG_PERSON_ENTERED, frame_index);
+    } else if (result->filter->event == SCORE_FILTER_EVENT_EXIT) {
+        DLOG(DLOG_PERSON_LEFT, frame_index);
+    }
+    DLOG(DLOG_FRAME_RESULT, frame_index, person_score, no_person_score,
+         result->filter->present, frame_time);
+
+    // write on lcd
+    lcd_clear(BLACK_COLOR); // clear lcd with all black
+    sprintf ( (char*) lcd_buff,
+            "Person Score: %d\r\nNo Person Score: %d\r\nPerson: %s\r\nTime Taken: %d",
+            person_score, no_person_score, result->filter->present ? "yes" : "no",
+            (int)frame_time);
+    lcd_draw_str_ascii16(X_OFFSET, Y_OFFSET, (lcd_color_t) WHITE_COLOR, (lcd_color_t) BLACK_COLOR, lcd_buff, 128);
+}
+
+#if defined(CAMERA_LOCALIZE)
+static void localize_camera(const preprocess_frame_t* camera_frame,
+                            const model_input_t* model_input)
+{
+    static const int window_sizes[LOCALIZE_SCALES] = {300, 200, 150};
+    static int8_t pyramid[LOCALIZE_PYRAMID_SIZE];
+    static localize_t localize;
+    static localize_result_t result;
+    uint8_t lcd_buff[128] = {0};
+    uint8_t* picture = NULL;
+    uint32_t length = 0;
+
+    if ((localize_pyramid_size(camera_frame, window_sizes, LOCALIZE_SCALES,
+                               model_input->width) > sizeof(pyramid)) ||
+        (localize_init(&localize, camera_frame, window_sizes, LOCALIZE_SCALES,
+                       model_input->width, pyramid) != 0)) {
+        printf("Localization setup failed\r\n");
+        return;
+    }
+    const uint32_t windows = localize_window_count(&localize);
+    while (1) {
+        while (0 != bl_cam_mipi_rgb_frame_get(&picture, &length)) {
+            vTaskDelay(1);
+        }
+        const uint32_t start_time = bl_timer_now_us();
+        localize_build_pyramid(&localize, picture);
+        bl_cam_mipi_frame_pop();
+        const uint32_t pyramid_time = bl_timer_now_us();
+        if (localize_run(&localize, model_input, &result) != 0) {
+            break;
+        }
+        const uint32_t end_time = bl_timer_now_us();
+
+        // write on cli
+        printf("best window x %d y %d size %d: person score:%d no person score %d\r\n",
+               result.best.x, result.best.y, result.best.size, result.best.person_score,
+               result.best.no_person_score);
+        printf("pyramid %u us, %u windows, %u us per window, %u ms per frame\r\n",
+               (unsigned)(pyramid_time - start_time), (unsigned)windows,
+               (unsigned)((end_time - pyramid_time) / windows),
+               (unsigned)((end_time - start_time) / 1000));
+        for (int y = 0; y < LOCALIZE_HEAT_HEIGHT; y++) {
+            for (int x = 0; x < LOCALIZE_HEAT_WIDTH; x++) {
+                // Person probability in tenths, from the int8 softmax output.
+                printf("%d", ((result.heat[y][x] + 128) * 10) >> 8);
+            }
+            printf("\r\n");
+        }
+
+        // write on lcd
+        lcd_clear(BLACK_COLOR); // clear lcd with all black
+        sprintf ( (char*) lcd_buff,
+                "Person Score: %d\r\nAt: %d,%d size %d\r\nTime Taken: %d",
+                result.best.person_score, result.best.x, result.best.y, result.best.size,
+                (int)((end_time - start_time) / 1000));
+        lcd_draw_str_ascii16(X_OFFSET, Y_OFFSET, (lcd_color_t) WHITE_COLOR, (lcd_color_t) BLACK_COLOR, lcd_buff, 128);
+    }
+}
+#endif /* CAMERA_LOCALIZE */
+#endif /* RUN_MODEL_ON_TEST_IMAGES */
+
+int main()
+{
     uint32_t start_time = 0;
     uint32_t end_time = 0;
-    static uint32_t g_image_buf_temp[IMG_W * IMG_H] = {0};
     uint8_t lcd_buff[128] = {0};
     int8_t person_score = 0;
     int8_t no_person_score = 0;
+    model_input_t model_input;
+    model_arena_usage_t arena_usage;
+#ifndef RUN_MODEL_ON_TEST_IMAGES
+    static preprocess_plan_t preprocess_plan;
+    const preprocess_frame_t camera_frame = {CAMERA_FORMAT, CAMERA_W, CAMERA_H, 0};
+    // Double-buffered model inputs: the next frame is rendered into one while
+    // the model reads the other.
+    static int8_t input_buffers[PIPELINE_INPUT_BUFFERS][MODEL_INPUT_SIZE];
+    pipeline_config_t pipeline_config;
+    os_queue_t* camera_token = NULL;
+    static score_filter_t score_filter;
+    score_filter_config_t score_filter_config;
+    result_context_t result_context;
+#if defined(MOTION_GATING)
+    static int8_t gate_reference[MODEL_INPUT_SIZE];
+    static motion_gate_t motion_gate;
+#endif
+#endif
+
+    if (xTaskCreate(log_task, "log", LOG_TASK_STACK_WORDS, NULL, LOG_TASK_PRIORITY, NULL) !=
+        pdPASS) {
+        printf("Log task creation failed\r\n");
+    }
 
     // init lcd
     if (lcd_init() == 0) {
@@ -71,6 +274,13 @@ int main()
     // init model
     init_model();
     printf("model load successfully!!\r\n");
+    if (get_model_arena_usage(&arena_usage) == 0) {
+        printf("tensor arena %u bytes, %u used, %u spare\r\n", (unsigned)arena_usage.size,
+               (unsigned)arena_usage.used, (unsigned)arena_usage.headroom);
+    }
+    if (get_model_input(&model_input) != 0) {
+        return 0;
+    }
 
 #ifndef RUN_MODEL_ON_TEST_IMAGES
     // init camera
@@ -79,52 +289,62 @@ int main()
         vTaskDelay(pdMS_TO_TICKS(5));
     }
     printf("Camera initialized!\r\n");
+    // The model sees the centred square crop of the frame.
+    if (preprocess_plan_init(&preprocess_plan, &camera_frame, (CAMERA_W - CAMERA_H) / 2, 0,
+                             CAMERA_H, CAMERA_H, model_input.width, model_input.height) != 0) {
+        printf("Preprocessing setup failed\r\n");
+        return 0;
+    }
 
-    while (1) 
-    {
-        printf("===>\r\n");
-        start_time = bl_timer_now_us() / 1000;
-        printf("Time in millisecond before acquirng frame: %d\r\n", start_time);
-        // get frame
-        while (0 != bl_cam_mipi_rgb_frame_get(&picture, &length)) {
-        }
-        // copy the bytes
-        for (uint16_t ih = 0; ih < CAMERA_H; ih++) {
-            memcpy(picture + sizeof(uint32_t) * ih * TARGET_WH,
-                   picture + sizeof(uint32_t) * (ih * CAMERA_W + (CAMERA_W - CAMERA_H) / 2),
-                   sizeof(uint32_t) * TARGET_WH);
-        }
-        // resize the image
-        BilinearInterpolation_RGBA8888((uint32_t*)picture, TARGET_WH, TARGET_WH, g_image_buf_temp, IMG_W, IMG_H);
-        // convert it to gray
-        RGBA88882GRAY(g_image_buf_temp, g_image_buf, IMG_W, IMG_H);
-        // run model
-        if ( run_model(&person_score, &no_person_score) != 0)
-        {
-            break;
-        }
-        // capture end time
-        end_time = bl_timer_now_us() / 1000;
-
-        // write on cli
-        printf("person score:%d no person score %d\r\n", person_score, no_person_score);
-        printf("Time in millisecond after running model: %d\r\n", end_time);
-        printf("Time difference: %d\r\n", end_time - start_time);
-        printf("<===\r\n");
+#if defined(CAMERA_LOCALIZE)
+    localize_camera(&camera_frame, &model_input);
+#else
+    if (model_input.width * model_input.height * model_input.channels >
+        (int32_t)sizeof(input_buffers[0])) {
+        printf("Model input does not fit the pipeline buffers\r\n");
+        return 0;
+    }
+    camera_token = os_queue_create(1);
+    if (camera_token == NULL) {
+        return 0;
+    }
+    os_queue_push(camera_token, NULL);
 
-        // write on lcd
-        lcd_clear(BLACK_COLOR); // clear lcd with all black
-        memset(lcd_buff, 0, sizeof(lcd_buff));
-        sprintf ( (char*) lcd_buff, 
-                "Person Score: %d\r\nNo Person Score: %d\r\nTime Taken: %d", 
-                person_score, no_person_score, (end_time - start_time));
-        lcd_draw_str_ascii16(X_OFFSET, Y_OFFSET, (lcd_color_t) WHITE_COLOR, (lcd_color_t) BLACK_COLOR, lcd_buff, 128);
+    score_filter_config.alpha = SCORE_FILTER_ALPHA;
+    score_filter_config.enter_threshold = SCORE_FILTER_ENTER_THRESHOLD;
+    score_filter_config.exit_threshold = SCORE_FILTER_EXIT_THRESHOLD;
+    score_filter_config.enter_frames = SCORE_FILTER_ENTER_FRAMES;
+    score_filter_config.exit_frames = SCORE_FILTER_EXIT_FRAMES;
+    if (score_filter_init(&score_filter, &score_filter_config) != 0) {
+        printf("Score filter setup failed\r\n");
+        return 0;
+    }
 
-        // pop the new frame
-        bl_cam_mipi_frame_pop();
-        // wait
-        vTaskDelay(5);
+    // Capture and preprocessing run in their own tasks, inference here.
+    result_context.last_time = bl_timer_now_us() / 1000;
+    result_context.filter = &score_filter;
+    memset(&pipeline_config, 0, sizeof(pipeline_config));
+    pipeline_config.source.get_frame = camera_get_frame;
+    pipeline_config.source.release_frame = camera_release_frame;
+    pipeline_config.source.context = camera_token;
+    pipeline_config.plan = &preprocess_plan;
+    pipeline_config.input_buffers[0] = input_buffers[0];
+    pipeline_config.input_buffers[1] = input_buffers[1];
+#if defined(MOTION_GATING)
+    motion_gate_init(&motion_gate, gate_reference, MODEL_INPUT_SIZE, MOTION_GATE_THRESHOLD,
+                     MOTION_GATE_MAX_SKIP);
+    pipeline_config.gate = &motion_gate;
+#endif
+    pipeline_config.filter = &score_filter;
+    pipeline_config.on_result = show_result;
+    pipeline_config.result_context = &result_context;
+    pipeline_config.warmup_frames = PIPELINE_WARMUP_FRAMES;
+    pipeline_config.report_interval = PIPELINE_REPORT_INTERVAL;
+    if (pipeline_run(&pipeline_config, NULL) != 0) {
+        printf("Pipeline failed\r\n");
     }
+    os_queue_delete(camera_token);
+#endif /* CAMERA_LOCALIZE */
 
     bl_cam_mipi_yuv_deinit();
 
@@ -15,11 +15,15 @@
  **/
 
 #include <stdio.h>
+#include <string.h>
+
+#include <new>
 
 #include "main_functions.h"
-#include "image_provider.h"
+#include "model_arena_size.h"
 #include "model_settings.h"
 #include "person_detect_model_data.h"
+#include "tensorflow/lite/micro/aggregating_profiler.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
@@ -32,6 +36,16 @@ tflite::ErrorReporter* error_reporter = nullptr;
 tflite::MicroInterpreter* interpreter = nullptr;
 const tflite::Model* model = nullptr;
 TfLiteTensor* input = nullptr;
+// Buffer handed out by get_model_input(). Frames are rendered into it
+// directly, so it must not move once bound.
+int8_t* bound_input = nullptr;
+// The input buffer the memory planner placed in the arena.
+int8_t* arena_input = nullptr;
+
+// Second interpreter for init_model_batch(), placed in static storage so
+// that it can be rebuilt for another batch size over the caller's arena.
+alignas(tflite::MicroInterpreter) uint8_t batch_interpreter_buffer[sizeof(tflite::MicroInterpreter)];
+tflite::MicroInterpreter* batch_interpreter = nullptr;
 
 // In order to use optimized tensorflow lite kernels, a signed int8_t quantized
 // model is preferred over the legacy unsigned model format. This means that
@@ -40,9 +54,91 @@ TfLiteTensor* input = nullptr;
 // signed 8-bit integers is to subtract 128 from the unsigned value to get a
 // signed value.
 
-// An area of memory to use for input, output, and intermediate arrays.
-constexpr int kTensorArenaSize = 136 * 1024;
+// Patch execution: with MODEL_PATCH_OPS the first MODEL_PATCH_OPS layers run
+// in bands of MODEL_PATCH_ROWS rows of their output instead of layer by
+// layer (see MicroInterpreter::SetPatchExecution()), so their large
+// activations are never held whole and the memory plan needs less arena.
+#if defined(MODEL_PATCH_OPS) && !defined(MODEL_PATCH_ROWS)
+#define MODEL_PATCH_ROWS (4)
+#endif
+
+// With MODEL_SEARCH_MEMORY_PLANNER the memory plan is made by the
+// SearchMemoryPlanner, which can pack the activations into less arena than
+// the greedy planner at the cost of a slower AllocateTensors().
+
+// An area of memory to use for input, output, and intermediate arrays. The
+// conv and depthwise kernels also keep a repacked copy of their weights in
+// it, unless TF_LITE_MICRO_NO_FILTER_PACKING is defined (the default, see
+// MODEL_FILTER_PACKING in bouffalo.mk). Its size is
+// measured on the host by person_detection_arena_size for the options above
+// (see README.md), so it must be regenerated when they change.
+#if defined(MODEL_PATCH_OPS)
+#if (MODEL_ARENA_PATCH_OPS != MODEL_PATCH_OPS) || (MODEL_ARENA_PATCH_ROWS != MODEL_PATCH_ROWS)
+#error "model_arena_size.h is for other MODEL_PATCH_OPS/MODEL_PATCH_ROWS, regenerate it"
+#endif
+#elif MODEL_ARENA_PATCH_OPS != 0
+#error "model_arena_size.h is for patch execution, regenerate it"
+#endif
+#if defined(MODEL_SEARCH_MEMORY_PLANNER) != (MODEL_ARENA_SEARCH_MEMORY_PLANNER != 0)
+#error "model_arena_size.h is for the other memory planner, regenerate it"
+#endif
+#if defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+#if !defined(MODEL_ARENA_SIZE_NO_FILTER_PACKING)
+#error "model_arena_size.h has no arena size without filter packing, regenerate it"
+#endif
+constexpr int kTensorArenaSize = MODEL_ARENA_SIZE_NO_FILTER_PACKING;
+#else
+#if !defined(MODEL_ARENA_SIZE_FILTER_PACKING)
+#error "model_arena_size.h has no arena size with filter packing, regenerate it"
+#endif
+constexpr int kTensorArenaSize = MODEL_ARENA_SIZE_FILTER_PACKING;
+#endif
 __attribute__((aligned(16))) static uint8_t tensor_arena[kTensorArenaSize];
+
+// Per-op timing mode: with PROFILE_MODEL_OPS the interpreter reports every
+// operator to an AggregatingProfiler, which prints per-node and per-op-type
+// ticks, MAC counts and MACs per tick every kProfileReportInterval
+// inferences (also as CSV with PROFILE_MODEL_OPS_CSV). The firmware strips
+// error strings, so this also needs TF_LITE_MICRO_ENABLE_PROFILER (see
+// bouffalo.mk).
+#if defined(PROFILE_MODEL_OPS)
+#if !defined(TF_LITE_MICRO_PROFILER_ENABLED)
+#error "PROFILE_MODEL_OPS needs TF_LITE_MICRO_ENABLE_PROFILER in builds that strip error strings"
+#endif
+constexpr int32_t kProfileReportInterval = 16;
+tflite::AggregatingProfiler* profiler = nullptr;
+
+// Prints and restarts the statistics once enough inferences were recorded.
+void ReportOpTimings()
+{
+    if (profiler->num_invokes() < kProfileReportInterval) {
+        return;
+    }
+    profiler->LogTable();
+#if defined(PROFILE_MODEL_OPS_CSV)
+    profiler->LogCsv();
+#endif
+    profiler->Reset();
+}
+#endif
+
+// Pull in only the operation implementations we need.
+// This relies on a complete list of all the ops needed by this graph.
+// Shared by the single image and the batched interpreter.
+tflite::MicroMutableOpResolver<5>& GetOpResolver()
+{
+    // NOLINTNEXTLINE(runtime-global-variables)
+    static tflite::MicroMutableOpResolver<5> micro_op_resolver;
+    if (micro_op_resolver.GetRegistrationLength() == 0)
+    {
+        micro_op_resolver.AddAveragePool2D();
+        micro_op_resolver.AddConv2D(tflite::Register_CONV_2D());
+        micro_op_resolver.AddDepthwiseConv2D();
+        micro_op_resolver.AddReshape();
+        micro_op_resolver.AddSoftmax(tflite::Register_SOFTMAX());
+    }
+    return micro_op_resolver;
+}
 }  // namespace
 
 // The name of this function is important for Arduino compatibility.
@@ -73,23 +169,34 @@ void init_model(void)
         return;
     }
 
-    // Pull in only the operation implementations we need.
-    // This relies on a complete list of all the ops needed by this graph.
-
-    // NOLINTNEXTLINE(runtime-global-variables)
-    static tflite::MicroMutableOpResolver<5> micro_op_resolver;
-    micro_op_resolver.AddAveragePool2D();
-    micro_op_resolver.AddConv2D(tflite::Register_CONV_2D());
-    micro_op_resolver.AddDepthwiseConv2D();
-    micro_op_resolver.AddReshape();
-    micro_op_resolver.AddSoftmax(tflite::Register_SOFTMAX());
-
     // Build an interpreter to run the model with.
     // NOLINTNEXTLINE(runtime-global-variables)
-    static tflite::MicroInterpreter static_interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize,
+#if defined(PROFILE_MODEL_OPS)
+    // NOLINTNEXTLINE(runtime-global-variables)
+    static tflite::AggregatingProfiler aggregating_profiler;
+    aggregating_profiler.Init(model);
+    profiler = &aggregating_profiler;
+    static tflite::MicroInterpreter static_interpreter(model, GetOpResolver(), tensor_arena, kTensorArenaSize,
+                                                       error_reporter, profiler);
+#else
+    static tflite::MicroInterpreter static_interpreter(model, GetOpResolver(), tensor_arena, kTensorArenaSize,
                                                        error_reporter);
+#endif
     interpreter = &static_interpreter;
 
+#if defined(MODEL_PATCH_OPS)
+    if (interpreter->SetPatchExecution(MODEL_PATCH_OPS, MODEL_PATCH_ROWS) != kTfLiteOk) {
+        printf("SetPatchExecution() failed\r\n");
+        return;
+    }
+#endif
+#if defined(MODEL_SEARCH_MEMORY_PLANNER)
+    if (interpreter->SetMemoryPlanner(tflite::MemoryPlannerType::kSearch) != kTfLiteOk) {
+        printf("SetMemoryPlanner() failed\r\n");
+        return;
+    }
+#endif
+
     // Allocate memory from the tensor_arena for the model's tensors.
     TfLiteStatus allocate_status = interpreter->AllocateTensors();
     if (allocate_status != kTfLiteOk) {
@@ -99,16 +206,104 @@ void init_model(void)
 
     // Get information about the memory area to use for the model's input.
     input = interpreter->input(0);
+    bound_input = input->data.int8;
+    arena_input = input->data.int8;
+}
+
+/**
+ * Gets the buffer, shape and quantization of the model input.
+ *
+ * @param model_input Pointer to store the input binding.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the model is
+ *         not initialized.
+ */
+int8_t get_model_input(model_input_t* model_input)
+{
+    if (model_input == NULL)
+    {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    if (bound_input == nullptr)
+    {
+        printf("Model not initialized\r\n");
+        return -2;
+    }
+    // NHWC with a batch of one.
+    model_input->data = bound_input;
+    model_input->height = input->dims->data[1];
+    model_input->width = input->dims->data[2];
+    model_input->channels = input->dims->data[3];
+    model_input->scale = input->params.scale;
+    model_input->zero_point = input->params.zero_point;
+    return 0;
+}
+
+/**
+ * Gets how much of the tensor arena the model uses.
+ *
+ * @param usage Pointer to store the arena usage.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the model is
+ *         not initialized.
+ */
+int8_t get_model_arena_usage(model_arena_usage_t* usage)
+{
+    if (usage == NULL)
+    {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    if (arena_input == nullptr)
+    {
+        printf("Model not initialized\r\n");
+        return -2;
+    }
+    usage->size = kTensorArenaSize;
+    usage->used = static_cast<uint32_t>(interpreter->arena_used_bytes());
+    usage->headroom = usage->size - usage->used;
+    return 0;
+}
+
+/**
+ * Makes the model read its input from buffer, for example to alternate
+ * between two buffers so the next frame can be rendered during inference.
+ *
+ * @param buffer Input buffer, or NULL for the buffer in the tensor arena.
+ *
+ * @return 0 if successfull, -2 if the model is not initialized.
+ */
+int8_t bind_model_input(int8_t* buffer)
+{
+    if (arena_input == nullptr)
+    {
+        printf("Model not initialized\r\n");
+        return -2;
+    }
+    int8_t* data = (buffer != NULL) ? buffer : arena_input;
+    if (data == bound_input)
+    {
+        return 0;
+    }
+    if (kTfLiteOk != interpreter->SetInputBuffer(0, data))
+    {
+        return -2;
+    }
+    bound_input = data;
+    return 0;
 }
 
 /**
- * Run one iteration of inference on single frame taken from camera feed. 
- * This should be called repeatedly from the application code.
+ * Run one iteration of inference on the frame rendered into the model input
+ * (see get_model_input()). This should be called repeatedly from the
+ * application code.
  * 
  * @param person_score Pointer to store person scrore.
  * @param no_person_score Pointer to store no person scrore.
  * 
- * @return 0 if successfull and else -1.
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the input
+ *         tensor moved away from the bound buffer.
  */
 int8_t run_model(int8_t* person_score, int8_t* no_person_score)
 {
@@ -117,15 +312,21 @@ int8_t run_model(int8_t* person_score, int8_t* no_person_score)
         printf("Invalid Arguments\r\n");
         return -1;
     }
-    // Get image from provider.
-    if (kTfLiteOk != GetImage(kNumCols, kNumRows, kNumChannels, input->data.int8)) {
-        MicroPrintf("Image capture failed.");
+    // The frame was rendered into the bound buffer; if the arena layout
+    // ever moved the input tensor, it would not be what the model reads.
+    if (interpreter->input(0)->data.int8 != bound_input)
+    {
+        printf("Input tensor moved\r\n");
+        return -2;
     }
 
     // Run the model on this input and make sure it succeeds.
     if (kTfLiteOk != interpreter->Invoke()) {
         printf("Invoke failed.\r\n");
     }
+#if defined(PROFILE_MODEL_OPS)
+    ReportOpTimings();
+#endif
 
     TfLiteTensor* output = interpreter->output(0);
 
@@ -158,13 +359,16 @@ int8_t image_tester(const uint8_t* test_image, int8_t* person_score, int8_t* no_
         printf("Invalid Test Image\r\n");
         return -2;
     }
-    // get test image
-    memcpy(input->data.int8, test_image, kNumCols * kNumRows * kNumChannels);
+    // The test images live in flash, so they are the one copy left.
+    memcpy(bound_input, test_image, kNumCols * kNumRows * kNumChannels);
     // Run the model on this input and make sure it succeeds.
     if (kTfLiteOk != interpreter->Invoke())
     {
         printf("Invoke failed.\r\n");
     }
+#if defined(PROFILE_MODEL_OPS)
+    ReportOpTimings();
+#endif
 
     TfLiteTensor *output = interpreter->output(0);
 
@@ -174,3 +378,136 @@ int8_t image_tester(const uint8_t* test_image, int8_t* person_score, int8_t* no_
 
     return 0;
 }
+
+/**
+ * Prepares a second interpreter that classifies batch_size images with one
+ * inference, planned in a caller-owned arena.
+ *
+ * @param batch_size Number of images per inference, at least 1.
+ * @param arena Tensor arena for the batched model, 16 byte aligned.
+ * @param arena_size Size of arena in bytes.
+ *
+ * @return 0 if successfull, -1 for invalid arguments, -2 if the model is not
+ *         initialized and -3 if the arena is too small.
+ */
+int8_t init_model_batch(int32_t batch_size, uint8_t* arena, uint32_t arena_size)
+{
+    if ( (batch_size < 1) || (arena == NULL) )
+    {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    if (model == nullptr)
+    {
+        printf("Model not initialized\r\n");
+        return -2;
+    }
+    // A new batch size is a new memory plan: the interpreter is rebuilt over
+    // the arena, which drops everything the previous one allocated in it.
+    if (batch_interpreter != nullptr)
+    {
+        batch_interpreter->~MicroInterpreter();
+        batch_interpreter = nullptr;
+    }
+    tflite::MicroInterpreter* interpreter_batch = new (batch_interpreter_buffer)
+        tflite::MicroInterpreter(model, GetOpResolver(), arena, arena_size, error_reporter);
+    if ( (kTfLiteOk != interpreter_batch->SetBatchSize(batch_size)) ||
+         (kTfLiteOk != interpreter_batch->AllocateTensors()) )
+    {
+        printf("AllocateTensors() failed for a batch of %d\r\n", (int)batch_size);
+        interpreter_batch->~MicroInterpreter();
+        return -3;
+    }
+    batch_interpreter = interpreter_batch;
+    return 0;
+}
+
+/**
+ * Gets the input of the batched model prepared by init_model_batch().
+ *
+ * @param model_input Pointer to store the input binding of the first image.
+ * @param batch_size Pointer to store the number of images, may be NULL.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the batched
+ *         model is not initialized.
+ */
+int8_t get_model_batch_input(model_input_t* model_input, int32_t* batch_size)
+{
+    if (model_input == NULL)
+    {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    if (batch_interpreter == nullptr)
+    {
+        printf("Batched model not initialized\r\n");
+        return -2;
+    }
+    TfLiteTensor* batch_input = batch_interpreter->input(0);
+    model_input->data = batch_input->data.int8;
+    model_input->height = batch_input->dims->data[1];
+    model_input->width = batch_input->dims->data[2];
+    model_input->channels = batch_input->dims->data[3];
+    model_input->scale = batch_input->params.scale;
+    model_input->zero_point = batch_input->params.zero_point;
+    if (batch_size != NULL)
+    {
+        *batch_size = batch_input->dims->data[0];
+    }
+    return 0;
+}
+
+/**
+ * Classifies up to a batch of preprocessed images with one inference.
+ *
+ * @param images count images of width * height * channels bytes back to
+ *               back, or NULL if they were rendered into the batched input
+ *               (see get_model_batch_input()).
+ * @param count Number of images, 1 to the batch size.
+ * @param person_scores Array to store count person scores.
+ * @param no_person_scores Array to store count no person scores.
+ *
+ * @return 0 if successfull, -1 for invalid arguments, -2 if the batched
+ *         model is not initialized and -3 if inference failed.
+ */
+int8_t run_model_batch(const int8_t* images, int32_t count, int8_t* person_scores,
+                       int8_t* no_person_scores)
+{
+    if ( (person_scores == NULL) || (no_person_scores == NULL) )
+    {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    if (batch_interpreter == nullptr)
+    {
+        printf("Batched model not initialized\r\n");
+        return -2;
+    }
+    TfLiteTensor* batch_input = batch_interpreter->input(0);
+    if ( (count < 1) || (count > batch_input->dims->data[0]) )
+    {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    // Like the single image input, the batched input is consumed by each
+    // inference. Unused slots of a short batch still run, on stale pixels.
+    if (images != NULL)
+    {
+        memcpy(batch_input->data.int8, images, count * (batch_input->bytes / batch_input->dims->data[0]));
+    }
+    if (kTfLiteOk != batch_interpreter->Invoke())
+    {
+        printf("Invoke failed.\r\n");
+        return -3;
+    }
+
+    // One row of scores per image.
+    TfLiteTensor* output = batch_interpreter->output(0);
+    const int32_t classes = output->dims->data[output->dims->size - 1];
+    for (int32_t i = 0; i < count; i++)
+    {
+        person_scores[i] = output->data.int8[i * classes + kPersonIndex];
+        no_person_scores[i] = output->data.int8[i * classes + kNotAPersonIndex];
+    }
+    return 0;
+}
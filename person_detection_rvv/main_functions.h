@@ -17,11 +17,48 @@
 #ifndef MAIN_FUNCTIONS_H_
 #define MAIN_FUNCTIONS_H_
 
+#include <stdint.h>
+
 // Expose a C friendly interface for main functions.
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Input tensor of the model, bound once after init_model(). Capture and
+ * preprocessing write the next frame straight into data, so run_model()
+ * needs no staging buffer or copy.
+ *
+ * By default the buffer lives in the tensor arena and is consumed by each
+ * inference: the memory planner reuses it for activations once the first
+ * layer has read it, so a frame must be rendered again before every
+ * run_model() call. bind_model_input() can swap in caller-owned buffers,
+ * which inference only reads.
+ */
+typedef struct {
+    int8_t* data;
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    // real = scale * (data - zero_point)
+    float scale;
+    int32_t zero_point;
+} model_input_t;
+
+/**
+ * Tensor arena of init_model(). The arena is sized at build time to what
+ * AllocateTensors() needs (model_arena_size.h), so the headroom is the
+ * alignment slack unless the model or the kernels changed since.
+ */
+typedef struct {
+    // Bytes of the arena.
+    uint32_t size;
+    // Bytes AllocateTensors() used: the memory plan and the persistent data.
+    uint32_t used;
+    // size - used.
+    uint32_t headroom;
+} model_arena_usage_t;
+
 /**
  * Initializes all data needed for the person detection example.
  * 
@@ -32,13 +69,52 @@ extern "C" {
 void init_model(void);
 
 /**
- * Run one iteration of inference on single frame taken from camera feed. 
- * This should be called repeatedly from the application code.
+ * Gets the buffer, shape and quantization of the model input.
+ *
+ * @param model_input Pointer to store the input binding.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the model is
+ *         not initialized.
+ */
+int8_t get_model_input(model_input_t* model_input);
+
+/**
+ * Gets how much of the tensor arena the model uses.
+ *
+ * @param usage Pointer to store the arena usage.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the model is
+ *         not initialized.
+ */
+int8_t get_model_arena_usage(model_arena_usage_t* usage);
+
+/**
+ * Makes the model read its input from buffer, for example to alternate
+ * between two buffers so the next frame can be rendered during inference.
+ * The buffer must hold width * height * channels bytes and stay valid while
+ * it is bound.
+ *
+ * The input buffer in the tensor arena stays planned while another one is
+ * bound, and is then never read. It costs arena only if it is live at the
+ * peak of the memory plan. Layer by layer it does not: the peak is at the
+ * third layer, whose activations reuse it, so binding saves no arena either.
+ *
+ * @param buffer Input buffer, or NULL for the buffer in the tensor arena.
+ *
+ * @return 0 if successfull, -2 if the model is not initialized.
+ */
+int8_t bind_model_input(int8_t* buffer);
+
+/**
+ * Run one iteration of inference on the frame rendered into the model input
+ * (see get_model_input()). This should be called repeatedly from the
+ * application code.
  * 
  * @param person_score Pointer to store person scrore.
  * @param no_person_score Pointer to store no person scrore.
  * 
- * @return 0 if successfull and else -1.
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the input
+ *         tensor moved away from the bound buffer.
  */
 int8_t run_model(int8_t* person_score, int8_t* no_person_score);
 
@@ -53,6 +129,55 @@ int8_t run_model(int8_t* person_score, int8_t* no_person_score);
  */
 int8_t image_tester(const uint8_t* test_image, int8_t* person_score, int8_t* no_person_score);
 
+/**
+ * Prepares a second interpreter that classifies batch_size images with one
+ * inference, for offline and multi-window workloads. The activations get
+ * batch_size as their leading dimension and are planned in a caller-owned
+ * arena, so every layer streams its weights once per batch rather than once
+ * per image. Calling it again with another batch size re-plans the arena.
+ * init_model() must have been called first.
+ *
+ * @param batch_size Number of images per inference, at least 1.
+ * @param arena Tensor arena for the batched model, 16 byte aligned. It
+ *              needs room for batch_size times the activations of one image
+ *              plus the repacked weights (see README.md).
+ * @param arena_size Size of arena in bytes.
+ *
+ * @return 0 if successfull, -1 for invalid arguments, -2 if the model is not
+ *         initialized and -3 if the arena is too small.
+ */
+int8_t init_model_batch(int32_t batch_size, uint8_t* arena, uint32_t arena_size);
+
+/**
+ * Gets the input of the batched model prepared by init_model_batch(). The
+ * images of the batch follow each other in data, each with the shape and
+ * quantization of the single image input, and are consumed by each
+ * inference like the arena buffer of get_model_input().
+ *
+ * @param model_input Pointer to store the input binding of the first image.
+ * @param batch_size Pointer to store the number of images, may be NULL.
+ *
+ * @return 0 if successfull, -1 for invalid arguments and -2 if the batched
+ *         model is not initialized.
+ */
+int8_t get_model_batch_input(model_input_t* model_input, int32_t* batch_size);
+
+/**
+ * Classifies up to a batch of preprocessed images with one inference.
+ *
+ * @param images count images of width * height * channels bytes back to
+ *               back, or NULL if they were rendered into the batched input
+ *               (see get_model_batch_input()).
+ * @param count Number of images, 1 to the batch size.
+ * @param person_scores Array to store count person scores.
+ * @param no_person_scores Array to store count no person scores.
+ *
+ * @return 0 if successfull, -1 for invalid arguments, -2 if the batched
+ *         model is not initialized and -3 if inference failed.
+ */
+int8_t run_model_batch(const int8_t* images, int32_t count, int8_t* person_scores,
+                       int8_t* no_person_scores);
+
 #ifdef __cplusplus
 }
 #endif
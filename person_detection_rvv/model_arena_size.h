@@ -0,0 +1,17 @@
+// Generated by person_detection_arena_size (host/arena_profile.h), do not edit.
+// Tensor arena of init_model(): the smallest arena AllocateTensors() succeeds
+// in, plus 16 bytes of alignment slack.
+#ifndef MODEL_ARENA_SIZE_H_
+#define MODEL_ARENA_SIZE_H_
+
+// The configuration the sizes hold for.
+#define MODEL_ARENA_PATCH_OPS 0
+#define MODEL_ARENA_PATCH_ROWS 0
+#define MODEL_ARENA_SEARCH_MEMORY_PLANNER 0
+
+// Filter packing on: head 55296 bytes, tail 249488 bytes.
+#define MODEL_ARENA_SIZE_FILTER_PACKING 304784
+// Filter packing off: head 55296 bytes, tail 41072 bytes.
+#define MODEL_ARENA_SIZE_NO_FILTER_PACKING 96368
+
+#endif  // MODEL_ARENA_SIZE_H_
@@ -0,0 +1,96 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "motion_gate.h"
+
+#include <stddef.h>
+#include <string.h>
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+int8_t motion_gate_init(motion_gate_t* gate, int8_t* reference, uint32_t pixels,
+                        uint32_t threshold, uint32_t max_skip)
+{
+    if ((gate == NULL) || (reference == NULL) || (pixels == 0)) {
+        return -1;
+    }
+    memset(gate, 0, sizeof(*gate));
+    gate->reference = reference;
+    gate->pixels = pixels;
+    gate->threshold = threshold;
+    gate->max_skip = max_skip;
+    return 0;
+}
+
+void motion_gate_configure(motion_gate_t* gate, uint32_t threshold, uint32_t max_skip)
+{
+    gate->threshold = threshold;
+    gate->max_skip = max_skip;
+}
+
+uint32_t motion_gate_sad(const int8_t* a, const int8_t* b, uint32_t length)
+{
+    uint32_t sad = 0;
+#if defined(__riscv_vector)
+    for (size_t vl, i = 0; i < length; i += vl) {
+        // Set Vector length
+        vl = vsetvl_e8m4(length - i);
+        vint8m4_t va = vle8_v_i8m4(a + i, vl);
+        vint8m4_t vb = vle8_v_i8m4(b + i, vl);
+        // max - min is at most 255, so it is exact as unsigned bytes.
+        vuint8m4_t diff = vreinterpret_v_i8m4_u8m4(
+            vsub_vv_i8m4(vmax_vv_i8m4(va, vb, vl), vmin_vv_i8m4(va, vb, vl), vl));
+        // A chunk sums to at most vl * 255, which fits in 16 bits.
+        vuint16m1_t zero = vmv_v_x_u16m1(0, vl);
+        sad += vmv_x_s_u16m1_u16(vwredsumu_vs_u8m4_u16m1(zero, diff, zero, vl));
+    }
+#else
+    for (uint32_t i = 0; i < length; i++) {
+        const int32_t diff = (int32_t)a[i] - (int32_t)b[i];
+        sad += (uint32_t)(diff < 0 ? -diff : diff);
+    }
+#endif
+    return sad;
+}
+
+int8_t motion_gate_check(motion_gate_t* gate, const int8_t* input,
+                         int8_t* person_score, int8_t* no_person_score)
+{
+    if (gate->valid && (gate->skip_run < gate->max_skip)) {
+        gate->last_sad = motion_gate_sad(input, gate->reference, gate->pixels);
+        // Mean difference below the threshold, compared without dividing.
+        if ((uint64_t)gate->last_sad * 256 <= (uint64_t)gate->threshold * gate->pixels) {
+            gate->skip_run++;
+            gate->skipped++;
+            *person_score = gate->person_score;
+            *no_person_score = gate->no_person_score;
+            return 0;
+        }
+    }
+    memcpy(gate->reference, input, gate->pixels);
+    gate->valid = 0;
+    gate->skip_run = 0;
+    gate->executed++;
+    return 1;
+}
+
+void motion_gate_update(motion_gate_t* gate, int8_t person_score, int8_t no_person_score)
+{
+    gate->person_score = person_score;
+    gate->no_person_score = no_person_score;
+    gate->valid = 1;
+}
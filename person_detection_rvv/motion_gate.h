@@ -0,0 +1,130 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef MOTION_GATE_H_
+#define MOTION_GATE_H_
+
+#include <stdint.h>
+
+// Motion gate: skips inference on frames that barely differ from the last
+// classified one. A fixed camera mostly sees the same scene, so the gate
+// compares every preprocessed model input with the input of the last
+// inference by their sum of absolute differences (SAD) and reuses the last
+// scores while the mean difference per pixel stays below a threshold. At most
+// max_skip frames in a row are skipped, so slow changes such as lighting are
+// still picked up.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default threshold: a mean absolute difference of 2 gray levels per pixel,
+// above the sensor noise left after downscaling.
+#define MOTION_GATE_DEFAULT_THRESHOLD (2 * 256)
+
+// Default longest run of skipped frames.
+#define MOTION_GATE_DEFAULT_MAX_SKIP (15)
+
+typedef struct {
+    // Model input of the last inference, pixels bytes.
+    int8_t* reference;
+    uint32_t pixels;
+    // Mean absolute difference per pixel in 1/256 gray levels above which a
+    // frame counts as changed.
+    uint32_t threshold;
+    // Longest run of skipped frames, 0 to run every frame.
+    uint32_t max_skip;
+    // Scores of the last inference.
+    int8_t person_score;
+    int8_t no_person_score;
+    // 1 once reference and scores hold an inference.
+    int8_t valid;
+    // Frames skipped since the last inference.
+    uint32_t skip_run;
+    // SAD of the last frame checked.
+    uint32_t last_sad;
+    // Frames that ran inference and frames that reused the last scores.
+    uint32_t executed;
+    uint32_t skipped;
+} motion_gate_t;
+
+/**
+ * Sets up a gate for model inputs of pixels bytes.
+ *
+ * @param gate Gate to initialize.
+ * @param reference Buffer of pixels bytes owned by the gate.
+ * @param pixels Bytes of a model input.
+ * @param threshold Change threshold, see motion_gate_t.
+ * @param max_skip Longest run of skipped frames.
+ *
+ * @return 0 if successfull, -1 for invalid arguments.
+ */
+int8_t motion_gate_init(motion_gate_t* gate, int8_t* reference, uint32_t pixels,
+                        uint32_t threshold, uint32_t max_skip);
+
+/**
+ * Changes threshold and max_skip at runtime; the counters are kept.
+ *
+ * @param gate Initialized gate.
+ * @param threshold Change threshold, see motion_gate_t.
+ * @param max_skip Longest run of skipped frames.
+ *
+ * @return none
+ */
+void motion_gate_configure(motion_gate_t* gate, uint32_t threshold, uint32_t max_skip);
+
+/**
+ * Decides whether a model input needs inference. If it does, the input is
+ * kept as the new reference, since inference may overwrite it, and the
+ * scores must be handed over with motion_gate_update() afterwards. If not,
+ * the scores of the last inference are returned.
+ *
+ * @param gate Initialized gate.
+ * @param input Model input of the current frame.
+ * @param person_score Pointer to store the reused person score.
+ * @param no_person_score Pointer to store the reused no person score.
+ *
+ * @return 1 if inference has to run, 0 if the last scores were reused.
+ */
+int8_t motion_gate_check(motion_gate_t* gate, const int8_t* input,
+                         int8_t* person_score, int8_t* no_person_score);
+
+/**
+ * Stores the scores of the inference motion_gate_check() asked for.
+ *
+ * @param gate Initialized gate.
+ * @param person_score Person score of the inference.
+ * @param no_person_score No person score of the inference.
+ *
+ * @return none
+ */
+void motion_gate_update(motion_gate_t* gate, int8_t person_score, int8_t no_person_score);
+
+/**
+ * Sum of absolute differences of two int8 buffers.
+ *
+ * @param a First buffer.
+ * @param b Second buffer.
+ * @param length Bytes of each buffer, at most 2^24.
+ *
+ * @return The SAD.
+ */
+uint32_t motion_gate_sad(const int8_t* a, const int8_t* b, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MOTION_GATE_H_
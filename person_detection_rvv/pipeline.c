@@ -0,0 +1,258 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "pipeline.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "deferred_log.h"
+#include "main_functions.h"
+#include "pipeline_os.h"
+
+typedef struct {
+    const pipeline_config_t* config;
+    // Captured frames, capture -> preprocessing. NULL ends the stream.
+    os_queue_t* frames;
+    // Model inputs ready to be rendered, inference -> preprocessing.
+    os_queue_t* free_inputs;
+    // Rendered model inputs, preprocessing -> inference. NULL ends the
+    // stream.
+    os_queue_t* ready_inputs;
+    // One item per finished task.
+    os_queue_t* done;
+    // Frames that ran inference, written and read by the inference stage.
+    uint32_t inferences;
+    // Set by inference to stop capturing.
+    volatile uint32_t stop;
+    // Each counter has a single writer, its stage; the periodic reports read
+    // them from the inference task and may see a value one frame old.
+    volatile uint64_t busy_us[PIPELINE_STAGES];
+} pipeline_t;
+
+static void capture_task(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*)arg;
+    const pipeline_source_t* source = &pipeline->config->source;
+    while (!pipeline->stop) {
+        const void* frame = NULL;
+        const uint64_t start = os_time_us();
+        if ((source->get_frame(source->context, &frame) != 0) || (frame == NULL)) {
+            break;
+        }
+        pipeline->busy_us[PIPELINE_STAGE_CAPTURE] += os_time_us() - start;
+        os_queue_push(pipeline->frames, (void*)frame);
+    }
+    os_queue_push(pipeline->frames, NULL);
+    os_queue_push(pipeline->done, NULL);
+}
+
+static void preprocess_task(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*)arg;
+    const pipeline_config_t* config = pipeline->config;
+    for (;;) {
+        const void* frame = os_queue_pop(pipeline->frames);
+        if (frame == NULL) {
+            break;
+        }
+        int8_t* input = (int8_t*)os_queue_pop(pipeline->free_inputs);
+        const uint64_t start = os_time_us();
+        preprocess_frame_to_input(config->plan, frame, input);
+        config->source.release_frame(config->source.context, frame);
+        pipeline->busy_us[PIPELINE_STAGE_PREPROCESS] += os_time_us() - start;
+        os_queue_push(pipeline->ready_inputs, input);
+    }
+    os_queue_push(pipeline->ready_inputs, NULL);
+    os_queue_push(pipeline->done, NULL);
+}
+
+static void take_snapshot(const pipeline_t* pipeline, uint32_t frames,
+                          pipeline_stats_t* snapshot)
+{
+    snapshot->frames = frames;
+    snapshot->inferences = pipeline->inferences;
+    snapshot->elapsed_us = os_time_us();
+    for (int i = 0; i < PIPELINE_STAGES; i++) {
+        snapshot->busy_us[i] = pipeline->busy_us[i];
+    }
+}
+
+// Statistics between two snapshots.
+static void stats_between(const pipeline_stats_t* from, const pipeline_stats_t* to,
+                          pipeline_stats_t* stats)
+{
+    stats->frames = to->frames - from->frames;
+    stats->inferences = to->inferences - from->inferences;
+    stats->elapsed_us = to->elapsed_us - from->elapsed_us;
+    for (int i = 0; i < PIPELINE_STAGES; i++) {
+        stats->busy_us[i] = to->busy_us[i] - from->busy_us[i];
+    }
+}
+
+static void delete_queues(pipeline_t* pipeline)
+{
+    os_queue_t* queues[] = {pipeline->frames, pipeline->free_inputs,
+                            pipeline->ready_inputs, pipeline->done};
+    for (uint32_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++) {
+        if (queues[i] != NULL) {
+            os_queue_delete(queues[i]);
+        }
+    }
+}
+
+int8_t pipeline_run(const pipeline_config_t* config, pipeline_stats_t* stats)
+{
+    if ((config == NULL) || (config->plan == NULL) || (config->source.get_frame == NULL) ||
+        (config->source.release_frame == NULL)) {
+        printf("Invalid Arguments\r\n");
+        return -1;
+    }
+    for (int i = 0; i < PIPELINE_INPUT_BUFFERS; i++) {
+        if (config->input_buffers[i] == NULL) {
+            printf("Invalid Arguments\r\n");
+            return -1;
+        }
+    }
+
+    pipeline_t pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.config = config;
+    pipeline.frames = os_queue_create(1);
+    pipeline.free_inputs = os_queue_create(PIPELINE_INPUT_BUFFERS);
+    pipeline.ready_inputs = os_queue_create(PIPELINE_INPUT_BUFFERS);
+    pipeline.done = os_queue_create(2);
+    if ((pipeline.frames == NULL) || (pipeline.free_inputs == NULL) ||
+        (pipeline.ready_inputs == NULL) || (pipeline.done == NULL)) {
+        delete_queues(&pipeline);
+        return -2;
+    }
+    for (int i = 0; i < PIPELINE_INPUT_BUFFERS; i++) {
+        os_queue_push(pipeline.free_inputs, config->input_buffers[i]);
+    }
+
+    if (os_task_start(preprocess_task, &pipeline, "preprocess") != 0) {
+        delete_queues(&pipeline);
+        return -2;
+    }
+    int tasks = 1;
+    int8_t status = 0;
+    if (os_task_start(capture_task, &pipeline, "capture") == 0) {
+        tasks++;
+    } else {
+        // Ends the stream so that the preprocessing task finishes.
+        pipeline.stop = 1;
+        os_queue_push(pipeline.frames, NULL);
+        status = -2;
+    }
+
+    uint32_t frame_index = 0;
+    pipeline_stats_t run_start;
+    take_snapshot(&pipeline, 0, &run_start);
+    pipeline_stats_t start = run_start;
+    pipeline_stats_t report = run_start;
+    for (;;) {
+        int8_t* input = (int8_t*)os_queue_pop(pipeline.ready_inputs);
+        if (input == NULL) {
+            break;
+        }
+        if (pipeline.stop) {
+            // Draining the frames still in flight.
+            os_queue_push(pipeline.free_inputs, input);
+            continue;
+        }
+        int8_t person_score = 0;
+        int8_t no_person_score = 0;
+        const uint64_t begin = os_time_us();
+        int8_t result = 0;
+        if ((config->gate == NULL) ||
+            motion_gate_check(config->gate, input, &person_score, &no_person_score)) {
+            result = bind_model_input(input);
+            if (result == 0) {
+                result = run_model(&person_score, &no_person_score);
+            }
+            if ((result == 0) && (config->gate != NULL)) {
+                motion_gate_update(config->gate, person_score, no_person_score);
+            }
+            pipeline.inferences++;
+        }
+        pipeline.busy_us[PIPELINE_STAGE_INFERENCE] += os_time_us() - begin;
+        os_queue_push(pipeline.free_inputs, input);
+        if (result != 0) {
+            status = -3;
+            pipeline.stop = 1;
+            continue;
+        }
+        if (config->filter != NULL) {
+            score_filter_update(config->filter, person_score, no_person_score, &person_score,
+                                &no_person_score);
+        }
+        if (config->on_result != NULL) {
+            config->on_result(config->result_context, frame_index, person_score,
+                              no_person_score);
+        }
+        frame_index++;
+
+        if (frame_index == config->warmup_frames) {
+            take_snapshot(&pipeline, frame_index, &start);
+            report = start;
+        }
+        if ((config->report_interval > 0) && (frame_index > config->warmup_frames) &&
+            ((frame_index - config->warmup_frames) % config->report_interval == 0)) {
+            pipeline_stats_t now;
+            pipeline_stats_t window;
+            take_snapshot(&pipeline, frame_index, &now);
+            stats_between(&report, &now, &window);
+            pipeline_log_stats(&window);
+            report = now;
+        }
+        if ((config->max_frames > 0) && (frame_index >= config->max_frames)) {
+            pipeline.stop = 1;
+        }
+    }
+    // Stop after the end of the stream as well, in case capture is blocked
+    // on a full queue behind the preprocessing task.
+    pipeline.stop = 1;
+
+    pipeline_stats_t end;
+    take_snapshot(&pipeline, frame_index, &end);
+    for (int i = 0; i < tasks; i++) {
+        os_queue_pop(pipeline.done);
+    }
+    delete_queues(&pipeline);
+    bind_model_input(NULL);
+
+    if (stats != NULL) {
+        // Runs too short to reach the steady state report all frames.
+        stats_between(frame_index > config->warmup_frames ? &start : &run_start, &end, stats);
+    }
+    return status;
+}
+
+void pipeline_log_stats(const pipeline_stats_t* stats)
+{
+    const uint64_t elapsed = stats->elapsed_us > 0 ? stats->elapsed_us : 1;
+    const uint32_t fps_x100 = (uint32_t)((uint64_t)stats->frames * 100000000u / elapsed);
+    DLOG(DLOG_PIPELINE_STATS, stats->frames, (uint32_t)(stats->elapsed_us / 1000),
+         fps_x100 / 100, fps_x100 % 100, stats->inferences, stats->frames - stats->inferences);
+    for (int i = 0; i < PIPELINE_STAGES; i++) {
+        const uint32_t per_frame =
+            stats->frames > 0 ? (uint32_t)(stats->busy_us[i] / stats->frames) : 0;
+        // One format per stage, in the order of the stages.
+        DLOG(DLOG_PIPELINE_CAPTURE + i, (uint32_t)(stats->busy_us[i] * 100 / elapsed),
+             per_frame);
+    }
+}
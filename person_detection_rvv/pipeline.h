@@ -0,0 +1,131 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdint.h>
+
+#include "image_preprocess.h"
+#include "motion_gate.h"
+#include "score_filter.h"
+
+// Staged camera pipeline: a capture task waits for frames, a preprocessing
+// task renders them into one of PIPELINE_INPUT_BUFFERS model inputs, and the
+// calling task runs inference on the other one. Frame N + 1 is captured and
+// preprocessed while frame N is classified; the stages hand frames and
+// buffers over through bounded queues (pipeline_os.h), so no stage runs more
+// than one frame ahead.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIPELINE_INPUT_BUFFERS (2)
+
+enum {
+    PIPELINE_STAGE_CAPTURE = 0,
+    PIPELINE_STAGE_PREPROCESS,
+    PIPELINE_STAGE_INFERENCE,
+    PIPELINE_STAGES,
+};
+
+/**
+ * Frame source of the capture stage, e.g. the camera driver or recorded
+ * frames. Frames are released in the order they were taken.
+ */
+typedef struct {
+    // Blocks until the next frame is ready. Returns 0 and the frame, or -1 at
+    // the end of the stream.
+    int8_t (*get_frame)(void* context, const void** frame);
+    // Hands a frame back once it has been preprocessed.
+    void (*release_frame)(void* context, const void* frame);
+    void* context;
+} pipeline_source_t;
+
+/**
+ * Called from the inference stage with the scores of every frame, which
+ * are the last scores again for frames the motion gate skipped. With a
+ * score filter they are the smoothed scores, and the filter's present and
+ * event fields hold the person-present state after this frame.
+ */
+typedef void (*pipeline_result_fn_t)(void* context, uint32_t frame_index,
+                                     int8_t person_score, int8_t no_person_score);
+
+typedef struct {
+    pipeline_source_t source;
+    // Crop and resize of the source frames into the model input.
+    const preprocess_plan_t* plan;
+    // Model inputs the preprocessing stage renders into, each of
+    // width * height * channels bytes (see get_model_input()).
+    int8_t* input_buffers[PIPELINE_INPUT_BUFFERS];
+    // Skips inference on frames without motion, NULL to classify every frame.
+    motion_gate_t* gate;
+    // Smooths the scores handed to on_result, NULL for the raw scores.
+    score_filter_t* filter;
+    pipeline_result_fn_t on_result;
+    void* result_context;
+    // Frames to classify, 0 to run until the source ends.
+    uint32_t max_frames;
+    // Frames excluded from the statistics while the stages fill up.
+    uint32_t warmup_frames;
+    // Print the statistics of the last report_interval frames every
+    // report_interval frames, 0 for no reports.
+    uint32_t report_interval;
+} pipeline_config_t;
+
+/**
+ * Throughput and per-stage load over a run of frames. A stage's busy time
+ * is the time spent on its own work (for capture, waiting for the sensor)
+ * and excludes waiting on the queues, so busy_us / elapsed_us is its
+ * occupancy. Frames skipped by the motion gate count as frames but not as
+ * inferences.
+ */
+typedef struct {
+    uint32_t frames;
+    uint32_t inferences;
+    uint64_t elapsed_us;
+    uint64_t busy_us[PIPELINE_STAGES];
+} pipeline_stats_t;
+
+/**
+ * Runs the pipeline until max_frames frames were classified or the source
+ * ends. Inference runs in the calling task, which must have called
+ * init_model(); capture and preprocessing get their own tasks.
+ *
+ * @param config Pipeline configuration.
+ * @param stats Pointer to store the statistics after the warmup frames, may
+ *              be NULL.
+ *
+ * @return 0 if successfull, -1 for invalid arguments, -2 if the tasks or
+ *         queues could not be created and -3 if inference failed.
+ */
+int8_t pipeline_run(const pipeline_config_t* config, pipeline_stats_t* stats);
+
+/**
+ * Logs frames per second and the occupancy of every stage to the deferred
+ * log (deferred_log.h).
+ *
+ * @param stats Statistics to print.
+ *
+ * @return none
+ */
+void pipeline_log_stats(const pipeline_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PIPELINE_H_
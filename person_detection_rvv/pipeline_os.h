@@ -0,0 +1,104 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef PIPELINE_OS_H_
+#define PIPELINE_OS_H_
+
+#include <stdint.h>
+
+// The few OS services the frame pipeline needs: tasks, bounded queues of
+// pointers and a microsecond clock. pipeline_os_freertos.c implements them
+// with FreeRTOS on the board, host/pipeline_os_posix.c with pthreads.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct os_queue os_queue_t;
+
+typedef void (*os_task_fn_t)(void* arg);
+
+/**
+ * Creates a queue of up to length pointers.
+ *
+ * @param length Capacity of the queue.
+ *
+ * @return The queue, or NULL if out of memory.
+ */
+os_queue_t* os_queue_create(uint32_t length);
+
+/**
+ * Deletes a queue that no task uses any more.
+ *
+ * @param queue Queue to delete.
+ *
+ * @return none
+ */
+void os_queue_delete(os_queue_t* queue);
+
+/**
+ * Appends item, blocking while the queue is full.
+ *
+ * @param queue Queue to append to.
+ * @param item Pointer to pass on, may be NULL.
+ *
+ * @return none
+ */
+void os_queue_push(os_queue_t* queue, void* item);
+
+/**
+ * Removes the oldest item, blocking while the queue is empty.
+ *
+ * @param queue Queue to take from.
+ *
+ * @return The item.
+ */
+void* os_queue_pop(os_queue_t* queue);
+
+/**
+ * Starts fn(arg) in a new task at the priority of the calling task. The task
+ * ends when fn returns.
+ *
+ * @param fn Task body.
+ * @param arg Argument of fn.
+ * @param name Task name for debugging.
+ *
+ * @return 0 if successfull, -1 if the task could not be created.
+ */
+int8_t os_task_start(os_task_fn_t fn, void* arg, const char* name);
+
+/**
+ * Monotonic time in microseconds.
+ *
+ * @param none
+ *
+ * @return Current time.
+ */
+uint64_t os_time_us(void);
+
+/**
+ * Blocks the calling task for at least us microseconds.
+ *
+ * @param us Time to sleep.
+ *
+ * @return none
+ */
+void os_sleep_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PIPELINE_OS_H_
@@ -0,0 +1,105 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+// FreeRTOS implementation of pipeline_os.h for the board.
+
+#include "pipeline_os.h"
+
+#include <bl_timer.h>
+/* FreeRTOS */
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <task.h>
+
+// Stack of the pipeline tasks in words. They only move frames between
+// queues and run the preprocessing kernel.
+#ifndef PIPELINE_OS_STACK_WORDS
+#define PIPELINE_OS_STACK_WORDS (1024)
+#endif
+
+typedef struct {
+    os_task_fn_t fn;
+    void* arg;
+} task_start_t;
+
+os_queue_t* os_queue_create(uint32_t length)
+{
+    return (os_queue_t*)xQueueCreate(length, sizeof(void*));
+}
+
+void os_queue_delete(os_queue_t* queue)
+{
+    vQueueDelete((QueueHandle_t)queue);
+}
+
+void os_queue_push(os_queue_t* queue, void* item)
+{
+    while (xQueueSend((QueueHandle_t)queue, &item, portMAX_DELAY) != pdTRUE) {
+    }
+}
+
+void* os_queue_pop(os_queue_t* queue)
+{
+    void* item = NULL;
+    while (xQueueReceive((QueueHandle_t)queue, &item, portMAX_DELAY) != pdTRUE) {
+    }
+    return item;
+}
+
+static void task_trampoline(void* param)
+{
+    task_start_t start = *(task_start_t*)param;
+    vPortFree(param);
+    start.fn(start.arg);
+    vTaskDelete(NULL);
+}
+
+int8_t os_task_start(os_task_fn_t fn, void* arg, const char* name)
+{
+    task_start_t* start = (task_start_t*)pvPortMalloc(sizeof(task_start_t));
+    if (start == NULL) {
+        return -1;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    if (xTaskCreate(task_trampoline, name, PIPELINE_OS_STACK_WORDS, start,
+                    uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+        vPortFree(start);
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t os_time_us(void)
+{
+    // Extends the 32 bit timer, which wraps after about 71 minutes.
+    static uint32_t last = 0;
+    static uint64_t high = 0;
+    taskENTER_CRITICAL();
+    const uint32_t now = bl_timer_now_us();
+    if (now < last) {
+        high += (uint64_t)1 << 32;
+    }
+    last = now;
+    const uint64_t time = high | now;
+    taskEXIT_CRITICAL();
+    return time;
+}
+
+void os_sleep_us(uint32_t us)
+{
+    vTaskDelay(pdMS_TO_TICKS((us + 999) / 1000));
+}
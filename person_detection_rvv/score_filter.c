@@ -0,0 +1,112 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#include "score_filter.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static int8_t config_valid(const score_filter_config_t* config)
+{
+    return (config != NULL) && (config->alpha >= 1) && (config->alpha <= 256) &&
+           (config->exit_threshold <= config->enter_threshold) && (config->enter_frames >= 1) &&
+           (config->exit_frames >= 1);
+}
+
+// Moves a Q8 average alpha / 256 of the way to score. The step rounds to
+// nearest and is at least one Q8 unit, so the average never overshoots and
+// reaches a constant score exactly, whatever alpha; the product stays below
+// 2^25.
+static int32_t average(int32_t q8, int8_t score, uint32_t alpha)
+{
+    const int32_t delta = ((int32_t)score * 256) - q8;
+    int32_t step = (delta * (int32_t)alpha + (delta >= 0 ? 128 : -128)) / 256;
+    if ((step == 0) && (delta != 0)) {
+        step = (delta > 0) ? 1 : -1;
+    }
+    return q8 + step;
+}
+
+// Q8 to the nearest score, halves away from zero.
+static int8_t round_q8(int32_t q8)
+{
+    return (int8_t)(q8 >= 0 ? (q8 + 128) / 256 : -((128 - q8) / 256));
+}
+
+void score_filter_default_config(score_filter_config_t* config)
+{
+    config->alpha = SCORE_FILTER_DEFAULT_ALPHA;
+    config->enter_threshold = SCORE_FILTER_DEFAULT_ENTER_THRESHOLD;
+    config->exit_threshold = SCORE_FILTER_DEFAULT_EXIT_THRESHOLD;
+    config->enter_frames = SCORE_FILTER_DEFAULT_ENTER_FRAMES;
+    config->exit_frames = SCORE_FILTER_DEFAULT_EXIT_FRAMES;
+}
+
+int8_t score_filter_init(score_filter_t* filter, const score_filter_config_t* config)
+{
+    if ((filter == NULL) || !config_valid(config)) {
+        return -1;
+    }
+    memset(filter, 0, sizeof(*filter));
+    filter->config = *config;
+    return 0;
+}
+
+int8_t score_filter_configure(score_filter_t* filter, const score_filter_config_t* config)
+{
+    if ((filter == NULL) || !config_valid(config)) {
+        return -1;
+    }
+    filter->config = *config;
+    filter->run = 0;
+    return 0;
+}
+
+int8_t score_filter_update(score_filter_t* filter, int8_t person_score,
+                           int8_t no_person_score, int8_t* smoothed_person,
+                           int8_t* smoothed_no_person)
+{
+    const score_filter_config_t* config = &filter->config;
+    if (filter->primed) {
+        filter->person_q8 = average(filter->person_q8, person_score, config->alpha);
+        filter->no_person_q8 = average(filter->no_person_q8, no_person_score, config->alpha);
+    } else {
+        filter->person_q8 = (int32_t)person_score * 256;
+        filter->no_person_q8 = (int32_t)no_person_score * 256;
+        filter->primed = 1;
+    }
+    const int8_t person = round_q8(filter->person_q8);
+    if (smoothed_person != NULL) {
+        *smoothed_person = person;
+    }
+    if (smoothed_no_person != NULL) {
+        *smoothed_no_person = round_q8(filter->no_person_q8);
+    }
+
+    // Count the frames in a row that argue for the other state; anything
+    // in between the thresholds breaks the run.
+    const int8_t leaving = filter->present ? (person < config->exit_threshold)
+                                           : (person >= config->enter_threshold);
+    filter->run = leaving ? filter->run + 1 : 0;
+    filter->event = SCORE_FILTER_EVENT_NONE;
+    if (filter->run >= (filter->present ? config->exit_frames : config->enter_frames)) {
+        filter->present = !filter->present;
+        filter->event = filter->present ? SCORE_FILTER_EVENT_ENTER : SCORE_FILTER_EVENT_EXIT;
+        filter->run = 0;
+        filter->events++;
+    }
+    return filter->event;
+}
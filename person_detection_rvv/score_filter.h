@@ -0,0 +1,136 @@
+/**
+ * Copyright 2024 All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ **/
+
+#ifndef SCORE_FILTER_H_
+#define SCORE_FILTER_H_
+
+#include <stdint.h>
+
+// Score filter: temporal smoothing of the per-frame scores of run_model().
+// Both scores go through an exponential moving average in Q8 fixed point,
+// and the smoothed person score drives a person-present state with
+// hysteresis: it turns on once the score stayed at or above enter_threshold
+// for enter_frames frames in a row and off once it stayed below
+// exit_threshold for exit_frames frames in a row. Every update is a handful
+// of integer operations and the filter allocates nothing.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default weight of a new frame: 64 / 256, a time constant of about four
+// frames.
+#define SCORE_FILTER_DEFAULT_ALPHA (64)
+
+// Default thresholds on the smoothed person score; with the output scale of
+// 1/256 they are probabilities of about 0.62 and 0.38.
+#define SCORE_FILTER_DEFAULT_ENTER_THRESHOLD (32)
+#define SCORE_FILTER_DEFAULT_EXIT_THRESHOLD (-32)
+
+// Default debounce, in frames.
+#define SCORE_FILTER_DEFAULT_ENTER_FRAMES (2)
+#define SCORE_FILTER_DEFAULT_EXIT_FRAMES (4)
+
+// Events of score_filter_update().
+enum {
+    SCORE_FILTER_EVENT_NONE = 0,
+    SCORE_FILTER_EVENT_ENTER = 1,
+    SCORE_FILTER_EVENT_EXIT = -1,
+};
+
+typedef struct {
+    // Weight of a new frame in 1/256, 1 to 256; 256 turns smoothing off.
+    uint32_t alpha;
+    // Person-present turns on at or above enter_threshold and off below
+    // exit_threshold, which must not be above enter_threshold.
+    int8_t enter_threshold;
+    int8_t exit_threshold;
+    // Frames in a row past a threshold before the state changes, at least 1.
+    uint32_t enter_frames;
+    uint32_t exit_frames;
+} score_filter_config_t;
+
+typedef struct {
+    score_filter_config_t config;
+    // Smoothed scores in Q8.
+    int32_t person_q8;
+    int32_t no_person_q8;
+    // 1 once the averages hold a frame.
+    int8_t primed;
+    // 1 while a person is present.
+    int8_t present;
+    // Event of the last update.
+    int8_t event;
+    // Frames in a row past the threshold that leaves the current state.
+    uint32_t run;
+    // Person-present state changes since init.
+    uint32_t events;
+} score_filter_t;
+
+/**
+ * Fills a configuration with the SCORE_FILTER_DEFAULT_* values.
+ *
+ * @param config Configuration to fill.
+ *
+ * @return none
+ */
+void score_filter_default_config(score_filter_config_t* config);
+
+/**
+ * Sets up a filter with no person present.
+ *
+ * @param filter Filter to initialize.
+ * @param config Configuration, see score_filter_config_t.
+ *
+ * @return 0 if successfull, -1 for invalid arguments.
+ */
+int8_t score_filter_init(score_filter_t* filter, const score_filter_config_t* config);
+
+/**
+ * Changes the configuration at runtime. The averages and the person-present
+ * state are kept; a debounce run in progress starts over.
+ *
+ * @param filter Initialized filter.
+ * @param config Configuration, see score_filter_config_t.
+ *
+ * @return 0 if successfull, -1 for invalid arguments.
+ */
+int8_t score_filter_configure(score_filter_t* filter, const score_filter_config_t* config);
+
+/**
+ * Adds the scores of one frame. The first frame after init sets the
+ * averages directly.
+ *
+ * @param filter Initialized filter.
+ * @param person_score Person score of the frame.
+ * @param no_person_score No person score of the frame.
+ * @param smoothed_person Pointer to store the smoothed person score, may be
+ *                        NULL.
+ * @param smoothed_no_person Pointer to store the smoothed no person score,
+ *                           may be NULL.
+ *
+ * @return SCORE_FILTER_EVENT_ENTER when a person became present,
+ *         SCORE_FILTER_EVENT_EXIT when they left, SCORE_FILTER_EVENT_NONE
+ *         otherwise.
+ */
+int8_t score_filter_update(score_filter_t* filter, int8_t person_score,
+                           int8_t no_person_score, int8_t* smoothed_person,
+                           int8_t* smoothed_no_person);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SCORE_FILTER_H_
@@ -0,0 +1,442 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_CONV_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_CONV_H_
+
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/gemm.h"
+#include "tensorflow/lite/kernels/internal/optimized/spatial_partition.h"
+
+namespace tflite {
+namespace optimized_integer_ops {
+
+// A 1x1 convolution without padding is a [pixels x input_depth] *
+// [input_depth x output_depth] matrix product over the NHWC input, for any
+// stride, so it never needs im2col or padding checks.
+inline bool IsPointwiseConv(const ConvParams &params,
+                            const RuntimeShape &filter_shape)
+{
+    return filter_shape.Dims(1) == 1 && filter_shape.Dims(2) == 1 &&
+           params.padding_values.width == 0 && params.padding_values.height == 0;
+}
+
+// Size in bytes of the im2col scratch buffer ConvPerChannel needs. Pointwise
+// layers are dispatched to PointwiseConvPerChannel and need none.
+inline int ConvIm2colBufferSize(const ConvParams &params,
+                                const RuntimeShape &filter_shape)
+{
+    if (IsPointwiseConv(params, filter_shape)) {
+        return 0;
+    }
+    return kGemmBlockRows * filter_shape.Dims(1) * filter_shape.Dims(2) *
+           filter_shape.Dims(3);
+}
+
+// Size in bytes of the filter repacked by ConvPackFilter().
+inline int ConvPackedFilterSize(const RuntimeShape &filter_shape)
+{
+    return GemmPackedFilterSize(
+        filter_shape.Dims(0),
+        filter_shape.Dims(1) * filter_shape.Dims(2) * filter_shape.Dims(3));
+}
+
+// Folds the input offset into the bias, so the kernels can multiply the raw
+// int8 inputs: sum_k (x_k + input_offset) * w_k = sum_k x_k * w_k +
+// input_offset * sum_k w_k. Writes output_depth values to folded_bias;
+// bias_data may be null.
+//
+// This is exact for the padded taps as well: im2col fills them with the input
+// zero point, -input_offset, whose product cancels the folded term.
+inline void ConvFoldInputOffset(int32_t input_offset,
+                                const RuntimeShape &filter_shape,
+                                const int8_t *filter_data,
+                                const int32_t *bias_data, int32_t *folded_bias)
+{
+    const int output_depth = filter_shape.Dims(0);
+    const int depth = filter_shape.Dims(1) * filter_shape.Dims(2) * filter_shape.Dims(3);
+    for (int channel = 0; channel < output_depth; ++channel) {
+        const int8_t *filter_row = filter_data + channel * depth;
+        int32_t filter_sum = 0;
+        for (int k = 0; k < depth; ++k) {
+            filter_sum += filter_row[k];
+        }
+        folded_bias[channel] =
+            (bias_data ? bias_data[channel] : 0) + input_offset * filter_sum;
+    }
+}
+
+#if defined(__riscv_vector)
+// Adds the dot products of one pixel with four filter rows over
+// [k_begin, k_end) to out[0..3], with k_end - k_begin a multiple of vl. b
+// points at the first chunk of every row and advances by b_step per chunk.
+// The products are accumulated in vector registers and reduced once at the
+// end.
+inline void PointwiseDotChunk(const int8_t *a, const int8_t *const *b,
+                              size_t b_step, size_t k_begin, size_t k_end,
+                              size_t vl, int32_t *out)
+{
+    vint32m4_t acc0 = vmv_v_x_i32m4(0, vl);
+    vint32m4_t acc1 = vmv_v_x_i32m4(0, vl);
+    vint32m4_t acc2 = vmv_v_x_i32m4(0, vl);
+    vint32m4_t acc3 = vmv_v_x_i32m4(0, vl);
+    for (size_t k = k_begin, i = 0; k < k_end; k += vl, i += b_step) {
+        // Input Vector
+        vint8m1_t vec_in = vle8_v_i8m1(a + k, vl);
+        // Input Filter, one row per output channel. The 16 bit products are
+        // exact and widen-added into the 32 bit accumulators.
+        acc0 = vwadd_wv_i32m4(acc0, vwmul_vv_i16m2(vec_in, vle8_v_i8m1(b[0] + i, vl), vl), vl);
+        acc1 = vwadd_wv_i32m4(acc1, vwmul_vv_i16m2(vec_in, vle8_v_i8m1(b[1] + i, vl), vl), vl);
+        acc2 = vwadd_wv_i32m4(acc2, vwmul_vv_i16m2(vec_in, vle8_v_i8m1(b[2] + i, vl), vl), vl);
+        acc3 = vwadd_wv_i32m4(acc3, vwmul_vv_i16m2(vec_in, vle8_v_i8m1(b[3] + i, vl), vl), vl);
+    }
+    vint32m1_t zero = vmv_v_x_i32m1(0, vl);
+    out[0] += vmv_x_s_i32m1_i32(vredsum_vs_i32m4_i32m1(zero, acc0, zero, vl));
+    out[1] += vmv_x_s_i32m1_i32(vredsum_vs_i32m4_i32m1(zero, acc1, zero, vl));
+    out[2] += vmv_x_s_i32m1_i32(vredsum_vs_i32m4_i32m1(zero, acc2, zero, vl));
+    out[3] += vmv_x_s_i32m1_i32(vredsum_vs_i32m4_i32m1(zero, acc3, zero, vl));
+}
+#endif
+
+// Depth chunk of the pointwise filter layout: the vector length on RVV,
+// where the kernel loads one chunk of every filter row per step, and a
+// single value for the scalar GEMM form.
+inline int PointwiseFilterChunk(int depth)
+{
+#if defined(__riscv_vector)
+    return vsetvl_e8m1(depth);
+#else
+    (void)depth;
+    return 1;
+#endif
+}
+
+// Micro-kernel for pointwise layers. Same contract as GemmInt8MicroKernel with
+// a pixel-major left hand side (lhs_depth_stride == 1): every pixel is a
+// contiguous run of depth values. rhs is either the first of cols OHWI filter
+// rows, or with packed_rhs a block packed by GemmPackFilter() with chunk
+// PointwiseFilterChunk(depth).
+inline void PointwiseMicroKernel(const int8_t *lhs, int lhs_row_stride,
+                                 const int8_t *rhs, bool packed_rhs, int rows,
+                                 int cols, int depth, int32_t *acc)
+{
+#if defined(__riscv_vector)
+    // Vectorized along the depth so both operands are unit-stride loads. The
+    // tail chunk is reduced on its own, so the result does not depend on how
+    // the hardware treats elements past a shorter vl.
+    const size_t vlmax = vsetvl_e8m1(depth);
+    const size_t full = (depth / vlmax) * vlmax;
+    const size_t tail = depth - full;
+    // Row n of chunk k0 starts at n * depth + k0 in OHWI order and at
+    // k0 * kGemmBlockCols + n * chunk_length in the packed block.
+    const int8_t *b[kGemmBlockCols];
+    const int8_t *b_tail[kGemmBlockCols];
+    for (int n = 0; n < kGemmBlockCols; ++n) {
+        if (packed_rhs) {
+            b[n] = rhs + n * vlmax;
+            b_tail[n] = rhs + full * kGemmBlockCols + n * tail;
+        } else {
+            b[n] = rhs + ((n < cols) ? n : 0) * depth;
+            b_tail[n] = b[n] + full;
+        }
+    }
+    const size_t b_step = packed_rhs ? kGemmBlockCols * vlmax : vlmax;
+    for (int m = 0; m < rows; ++m) {
+        const int8_t *a = lhs + m * lhs_row_stride;
+        int32_t *out = acc + m * kGemmBlockCols;
+        out[0] = out[1] = out[2] = out[3] = 0;
+        if (full > 0) {
+            PointwiseDotChunk(a, b, b_step, 0, full, vlmax, out);
+        }
+        if (tail > 0) {
+            const size_t vl = vsetvl_e8m1(tail);
+            PointwiseDotChunk(a, b_tail, 0, full, depth, vl, out);
+        }
+    }
+#else
+    GemmInt8MicroKernel(lhs, lhs_row_stride, 1, rhs,
+                        packed_rhs ? 1 : depth,
+                        packed_rhs ? kGemmBlockCols : 1, rows, cols, depth, acc);
+#endif
+}
+
+// Repacks an OHWI filter into the blocked layout of the GEMM micro-kernels
+// (see GemmPackFilter), so that every block of kGemmBlockCols output channels
+// is read as one contiguous stream instead of kGemmBlockCols rows that are a
+// whole filter apart. packed must hold ConvPackedFilterSize() bytes.
+inline void ConvPackFilter(const ConvParams &params,
+                           const RuntimeShape &filter_shape,
+                           const int8_t *filter_data, int8_t *packed)
+{
+    const int depth = filter_shape.Dims(1) * filter_shape.Dims(2) * filter_shape.Dims(3);
+    const int chunk =
+        IsPointwiseConv(params, filter_shape) ? PointwiseFilterChunk(depth) : 1;
+    GemmPackFilter(filter_data, filter_shape.Dims(0), depth, chunk, packed);
+}
+
+// Fixed-point per-channel-quantization 1x1 convolution. Produces the same
+// output as reference_integer_ops::ConvPerChannel for layers accepted by
+// IsPointwiseConv(). Pixels are walked with plain pointer strides: the whole
+// image is one contiguous matrix for stride 1, and each output row is a
+// strided run of input pixels for the 2x2-stride downsampling layers.
+// folded_bias is the bias with the input offset folded in, as computed by
+// ConvFoldInputOffset(); params.input_offset itself is not used.
+// packed_filter is the filter repacked by ConvPackFilter(), or null to read
+// filter_data directly.
+inline void PointwiseConvPerChannel(
+    const ConvParams &params, const int32_t *output_multiplier,
+    const int32_t *output_shift, const RuntimeShape &input_shape,
+    const int8_t *input_data, const RuntimeShape &filter_shape,
+    const int8_t *filter_data, const RuntimeShape &bias_shape,
+    const int32_t *folded_bias, const RuntimeShape &output_shape,
+    int8_t *output_data, const int8_t *packed_filter)
+{
+    // Get parameters.
+    const int32_t output_offset = params.output_offset;
+    const int stride_width = params.stride_width;
+    const int stride_height = params.stride_height;
+    const int32_t output_activation_min = params.quantized_activation_min;
+    const int32_t output_activation_max = params.quantized_activation_max;
+
+    // Consistency check.
+    TFLITE_DCHECK(IsPointwiseConv(params, filter_shape));
+    TFLITE_DCHECK(folded_bias != nullptr);
+    TFLITE_DCHECK_LE(output_activation_min, output_activation_max);
+    TFLITE_DCHECK_EQ(input_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(filter_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(output_shape.DimensionsCount(), 4);
+    const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+    const int input_depth = MatchingDim(input_shape, 3, filter_shape, 3);
+    const int output_depth = MatchingDim(filter_shape, 0, output_shape, 3);
+    if (bias_shape.DimensionsCount() > 0) {
+        TFLITE_DCHECK_EQ(bias_shape.FlatSize(), output_depth);
+    }
+
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int output_height = output_shape.Dims(1);
+    const int output_width = output_shape.Dims(2);
+
+    // With unit stride the images of the whole batch are a single run of
+    // pixels, so GEMM row blocks span image boundaries and each block of
+    // weights is streamed once per kGemmBlockRows pixels of the batch rather
+    // than of every image. The small late layers gain most: the 9 pixels of
+    // a 3x3 layer leave most of a row block empty on their own.
+    const bool contiguous = (stride_width == 1 && stride_height == 1);
+    const int runs = contiguous ? 1 : batches * output_height;
+    const int run_pixels =
+        contiguous ? batches * output_height * output_width : output_width;
+    const int input_pixel_stride = stride_width * input_depth;
+    const int input_run_stride = stride_height * input_width * input_depth;
+    const int input_image_size = input_height * input_width * input_depth;
+
+    // A packed block of kGemmBlockCols channels holds as many bytes as the
+    // same channels in OHWI order, so both start at channel * input_depth.
+    const bool packed = (packed_filter != nullptr);
+    const int8_t *rhs_data = packed ? packed_filter : filter_data;
+
+    int32_t acc[kGemmBlockRows * kGemmBlockCols];
+
+    for (int run = 0; run < runs; ++run) {
+        // Strided runs are output rows, which never cross an image.
+        const int batch = contiguous ? 0 : run / output_height;
+        const int row = contiguous ? 0 : run % output_height;
+        const int8_t *in_run =
+            input_data + batch * input_image_size + row * input_run_stride;
+        int8_t *out_run = output_data + run * output_width * output_depth;
+        for (int first_pixel = 0; first_pixel < run_pixels; first_pixel += kGemmBlockRows) {
+            const int rows = std::min(kGemmBlockRows, run_pixels - first_pixel);
+            const int8_t *lhs = in_run + first_pixel * input_pixel_stride;
+            int8_t *out = out_run + first_pixel * output_depth;
+            for (int channel = 0; channel < output_depth; channel += kGemmBlockCols) {
+                const int cols = std::min(kGemmBlockCols, output_depth - channel);
+                PointwiseMicroKernel(lhs, input_pixel_stride,
+                                     rhs_data + channel * input_depth,
+                                     packed, rows, cols, input_depth, acc);
+                GemmRequantizeTile(acc, rows, cols, channel, folded_bias,
+                                   output_multiplier, output_shift,
+                                   output_offset, output_activation_min,
+                                   output_activation_max, out, output_depth);
+            }
+        }
+    }
+}
+
+// Packs the receptive fields of rows consecutive output pixels, starting at
+// first_pixel, into a depth-major [filter_h * filter_w * depth][rows] tile.
+// Pixels are numbered across the whole batch, image after image, so a tile
+// may span the end of one image and the start of the next.
+// Pixels in the interior of partition are copied without bounds checks; on
+// the border, taps in the padding are filled with pad_value, the input zero
+// point, so that together with the folded input offset they contribute
+// nothing.
+inline void Im2colTile(const ConvParams &params,
+                       const optimized_ops::SpatialPartition &partition,
+                       const int8_t *input_data, int input_height,
+                       int input_width, int input_depth, int filter_height,
+                       int filter_width, int output_height, int output_width,
+                       int first_pixel, int rows, int8_t pad_value,
+                       int8_t *packed)
+{
+    const int tap_row_stride = params.dilation_height_factor * input_width * input_depth;
+    const int tap_col_stride = params.dilation_width_factor * input_depth;
+    const int pixels = output_height * output_width;
+    for (int m = 0; m < rows; ++m) {
+        const int batch = (first_pixel + m) / pixels;
+        const int pixel = (first_pixel + m) % pixels;
+        const int out_y = pixel / output_width;
+        const int out_x = pixel % output_width;
+        const int8_t *input_batch =
+            input_data + batch * input_height * input_width * input_depth;
+        const int in_y_origin = (out_y * params.stride_height) - params.padding_values.height;
+        const int in_x_origin = (out_x * params.stride_width) - params.padding_values.width;
+        int8_t *dst = packed + m;
+        if (partition.IsInterior(out_y, out_x)) {
+            const int8_t *origin =
+                input_batch + (in_y_origin * input_width + in_x_origin) * input_depth;
+            for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+                const int8_t *src = origin + filter_y * tap_row_stride;
+                for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+                    for (int c = 0; c < input_depth; ++c) {
+                        dst[c * rows] = src[c];
+                    }
+                    src += tap_col_stride;
+                    dst += input_depth * rows;
+                }
+            }
+            continue;
+        }
+        for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+            const int in_y = in_y_origin + params.dilation_height_factor * filter_y;
+            for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+                const int in_x = in_x_origin + params.dilation_width_factor * filter_x;
+                const bool is_point_inside_image =
+                    (in_x >= 0) && (in_x < input_width) && (in_y >= 0) &&
+                    (in_y < input_height);
+                if (is_point_inside_image) {
+                    const int8_t *src =
+                        input_batch + (in_y * input_width + in_x) * input_depth;
+                    for (int c = 0; c < input_depth; ++c) {
+                        dst[c * rows] = src[c];
+                    }
+                } else {
+                    for (int c = 0; c < input_depth; ++c) {
+                        dst[c * rows] = pad_value;
+                    }
+                }
+                dst += input_depth * rows;
+            }
+        }
+    }
+}
+
+// Fixed-point per-channel-quantization convolution as im2col + GEMM.
+// Produces the same output as reference_integer_ops::ConvPerChannel.
+// folded_bias is the bias with the input offset folded in, as computed by
+// ConvFoldInputOffset(). Pointwise layers are forwarded to
+// PointwiseConvPerChannel, any other layer needs im2col_data with
+// ConvIm2colBufferSize() bytes. packed_filter is the filter repacked by
+// ConvPackFilter(), or null to read filter_data directly.
+inline void ConvPerChannel(
+    const ConvParams &params, const int32_t *output_multiplier,
+    const int32_t *output_shift, const RuntimeShape &input_shape,
+    const int8_t *input_data, const RuntimeShape &filter_shape,
+    const int8_t *filter_data, const RuntimeShape &bias_shape,
+    const int32_t *folded_bias, const RuntimeShape &output_shape,
+    int8_t *output_data, int8_t *im2col_data, const int8_t *packed_filter)
+{
+    if (IsPointwiseConv(params, filter_shape)) {
+        PointwiseConvPerChannel(params, output_multiplier, output_shift,
+                                input_shape, input_data, filter_shape,
+                                filter_data, bias_shape, folded_bias,
+                                output_shape, output_data, packed_filter);
+        return;
+    }
+
+    // Get parameters.
+    const int32_t input_offset = params.input_offset;
+    const int32_t output_offset = params.output_offset;
+    const int32_t output_activation_min = params.quantized_activation_min;
+    const int32_t output_activation_max = params.quantized_activation_max;
+
+    // Consistency check.
+    TFLITE_DCHECK(folded_bias != nullptr);
+    TFLITE_DCHECK(im2col_data != nullptr);
+    TFLITE_DCHECK_LE(output_activation_min, output_activation_max);
+    TFLITE_DCHECK_EQ(input_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(filter_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(output_shape.DimensionsCount(), 4);
+    const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+    const int input_depth = MatchingDim(input_shape, 3, filter_shape, 3);
+    const int output_depth = MatchingDim(filter_shape, 0, output_shape, 3);
+    if (bias_shape.DimensionsCount() > 0) {
+        TFLITE_DCHECK_EQ(bias_shape.FlatSize(), output_depth);
+    }
+
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int filter_height = filter_shape.Dims(1);
+    const int filter_width = filter_shape.Dims(2);
+    const int output_height = output_shape.Dims(1);
+    const int output_width = output_shape.Dims(2);
+
+    // GEMM dimensions: [pixels x depth] * [depth x output_depth]. The OHWI
+    // filter is already the row-major transpose of the right hand side.
+    const int depth = filter_height * filter_width * input_depth;
+    const int pixels = output_height * output_width;
+    const int8_t pad_value = static_cast<int8_t>(-input_offset);
+    const optimized_ops::SpatialPartition partition = optimized_ops::PartitionOutput(
+        input_height, input_width, output_height, output_width, filter_height,
+        filter_width, params.stride_height, params.stride_width,
+        params.dilation_height_factor, params.dilation_width_factor,
+        params.padding_values.height, params.padding_values.width);
+
+    int32_t acc[kGemmBlockRows * kGemmBlockCols];
+
+    // The NHWC output of the batch is one [batches * pixels x output_depth]
+    // matrix; tiles run over it without regard to image boundaries so the
+    // filter is streamed once per tile of the batch.
+    const int batch_pixels = batches * pixels;
+    for (int first_pixel = 0; first_pixel < batch_pixels; first_pixel += kGemmBlockRows) {
+        const int rows = std::min(kGemmBlockRows, batch_pixels - first_pixel);
+
+        Im2colTile(params, partition, input_data, input_height, input_width,
+                   input_depth, filter_height, filter_width, output_height,
+                   output_width, first_pixel, rows, pad_value, im2col_data);
+
+        int8_t *out = output_data + first_pixel * output_depth;
+        for (int channel = 0; channel < output_depth; channel += kGemmBlockCols) {
+            const int cols = std::min(kGemmBlockCols, output_depth - channel);
+            // The packed tile is depth-major: one row of pixels per tap.
+            if (packed_filter) {
+                GemmInt8MicroKernel(im2col_data, 1, rows,
+                                    packed_filter + channel * depth, 1,
+                                    kGemmBlockCols, rows, cols, depth, acc);
+            } else {
+                GemmInt8MicroKernel(im2col_data, 1, rows,
+                                    filter_data + channel * depth, depth, 1,
+                                    rows, cols, depth, acc);
+            }
+            GemmRequantizeTile(acc, rows, cols, channel, folded_bias,
+                               output_multiplier, output_shift, output_offset,
+                               output_activation_min, output_activation_max,
+                               out, output_depth);
+        }
+    }
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_CONV_H_
@@ -0,0 +1,351 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_DEPTHWISE_CONV_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_DEPTHWISE_CONV_H_
+
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/requantize.h"
+#include "tensorflow/lite/kernels/internal/optimized/spatial_partition.h"
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+namespace tflite {
+namespace optimized_integer_ops {
+
+// Number of channels accumulated together. Bounds the size of the on-stack
+// accumulator block; the RVV path strip-mines each block by the vector length.
+constexpr int kDepthwiseChannelBlock = 64;
+
+// Folds the input offset into the bias of a depth_multiplier == 1 layer, so
+// the kernel can multiply the raw int8 inputs: folded_bias[c] = bias[c] +
+// input_offset * sum of the filter taps of channel c. bias_data may be null.
+inline void DepthwiseConvFoldInputOffset(int32_t input_offset,
+                                         const RuntimeShape &filter_shape,
+                                         const int8_t *filter_data,
+                                         const int32_t *bias_data,
+                                         int32_t *folded_bias)
+{
+    const int depth = filter_shape.Dims(3);
+    const int taps = filter_shape.Dims(1) * filter_shape.Dims(2);
+    for (int c = 0; c < depth; ++c) {
+        folded_bias[c] = 0;
+    }
+    for (int tap = 0; tap < taps; ++tap) {
+        const int8_t *fl = filter_data + tap * depth;
+        for (int c = 0; c < depth; ++c) {
+            folded_bias[c] += fl[c];
+        }
+    }
+    for (int c = 0; c < depth; ++c) {
+        folded_bias[c] = (bias_data ? bias_data[c] : 0) + input_offset * folded_bias[c];
+    }
+}
+
+// Repacks a 1HWC depthwise filter into blocks of kDepthwiseChannelBlock
+// channels, each block stored tap by tap ([taps][block]), so the filter of
+// one channel block is a single contiguous stream instead of one short run
+// per tap strided by the full depth. The packed filter has the same size as
+// the original one.
+inline void DepthwiseConvPackFilter(const RuntimeShape &filter_shape,
+                                    const int8_t *filter_data, int8_t *packed)
+{
+    const int depth = filter_shape.Dims(3);
+    const int taps = filter_shape.Dims(1) * filter_shape.Dims(2);
+    for (int c0 = 0; c0 < depth; c0 += kDepthwiseChannelBlock) {
+        const int block = std::min(kDepthwiseChannelBlock, depth - c0);
+        for (int tap = 0; tap < taps; ++tap) {
+            const int8_t *src = filter_data + tap * depth + c0;
+            for (int c = 0; c < block; ++c) {
+                *packed++ = src[c];
+            }
+        }
+    }
+}
+
+// Bias for an output pixel on the image border, whose receptive field is
+// clipped to the taps [filter_y_start, filter_y_end) x [filter_x_start,
+// filter_x_end). The folded bias counts the input offset of every tap, so the
+// offset of each tap that falls into the padding is taken out again.
+inline void DepthwiseBorderBias(const int8_t *filter_data, int depth,
+                                int filter_height, int filter_width,
+                                int32_t input_offset, const int32_t *folded_bias,
+                                int filter_y_start, int filter_y_end,
+                                int filter_x_start, int filter_x_end,
+                                int32_t *border_bias)
+{
+    for (int c = 0; c < depth; ++c) {
+        border_bias[c] = folded_bias[c];
+    }
+    for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+        const bool row_inside = (filter_y >= filter_y_start) && (filter_y < filter_y_end);
+        for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+            if (row_inside && (filter_x >= filter_x_start) && (filter_x < filter_x_end)) {
+                continue;
+            }
+            const int8_t *fl = filter_data + (filter_y * filter_width + filter_x) * depth;
+            for (int c = 0; c < depth; ++c) {
+                border_bias[c] -= input_offset * fl[c];
+            }
+        }
+    }
+}
+
+// Accumulates the raw int8 products of one block of channels for a single
+// output pixel over all filter taps that fall inside the image. input_data
+// and filter_data point at the first channel of the block at tap (0, 0); the
+// tap ranges are already clipped against the padding, so no bounds check is
+// needed here. Interior pixels pass the filter size as template arguments,
+// which turns the tap loops into constant trip counts the compiler unrolls
+// completely; the default 0 takes the tap ranges from the arguments.
+template <int kFilterHeight = 0, int kFilterWidth = 0>
+inline void DepthwiseAccumulateBlock(
+    const int8_t *input_data, const int8_t *filter_data, int block,
+    int tap_y_start, int tap_y_end, int tap_x_start, int tap_x_end,
+    int input_row_stride, int input_col_stride, int filter_row_stride,
+    int filter_col_stride, int32_t *acc)
+{
+    const int filter_y_start = kFilterHeight ? 0 : tap_y_start;
+    const int filter_y_end = kFilterHeight ? kFilterHeight : tap_y_end;
+    const int filter_x_start = kFilterWidth ? 0 : tap_x_start;
+    const int filter_x_end = kFilterWidth ? kFilterWidth : tap_x_end;
+#if defined(__riscv_vector)
+    for (size_t vl, c = 0; c < (size_t)block; c += vl) {
+        // Set Vector length
+        vl = vsetvl_e8m1(block - c);
+        vint32m4_t vec_acc = vmv_v_x_i32m4(0, vl);
+        for (int filter_y = filter_y_start; filter_y < filter_y_end; ++filter_y) {
+            const int8_t *in_row = input_data + filter_y * input_row_stride + c;
+            const int8_t *fl_row = filter_data + filter_y * filter_row_stride + c;
+            for (int filter_x = filter_x_start; filter_x < filter_x_end; ++filter_x) {
+                // Input Vector
+                vint8m1_t vec_in = vle8_v_i8m1(in_row + filter_x * input_col_stride, vl);
+                // Input Filter
+                vint8m1_t vec_fl = vle8_v_i8m1(fl_row + filter_x * filter_col_stride, vl);
+                // The 16 bit product of two int8 values is exact; widen-add
+                // it into the 32 bit accumulators.
+                vec_acc = vwadd_wv_i32m4(vec_acc, vwmul_vv_i16m2(vec_in, vec_fl, vl), vl);
+            }
+        }
+        vse32_v_i32m4(acc + c, vec_acc, vl);
+    }
+#else
+    for (int c = 0; c < block; ++c) {
+        acc[c] = 0;
+    }
+    for (int filter_y = filter_y_start; filter_y < filter_y_end; ++filter_y) {
+        const int8_t *in_row = input_data + filter_y * input_row_stride;
+        const int8_t *fl_row = filter_data + filter_y * filter_row_stride;
+        for (int filter_x = filter_x_start; filter_x < filter_x_end; ++filter_x) {
+            const int8_t *in = in_row + filter_x * input_col_stride;
+            const int8_t *fl = fl_row + filter_x * filter_col_stride;
+            for (int c = 0; c < block; ++c) {
+                acc[c] += fl[c] * in[c];
+            }
+        }
+    }
+#endif
+}
+
+// Fixed-point per-channel-quantization depthwise convolution, vectorized
+// across channels. Produces the same output as
+// reference_integer_ops::DepthwiseConvPerChannel for depth_multiplier == 1.
+// folded_bias is the bias with the input offset folded in, as computed by
+// DepthwiseConvFoldInputOffset(), and border_bias is scratch space for one
+// bias per channel, used for the output pixels on the image border.
+// packed_filter is the filter repacked by DepthwiseConvPackFilter(), or null
+// to read filter_data directly.
+inline void DepthwiseConvPerChannel(
+    const DepthwiseParams &params, const int32_t *output_multiplier,
+    const int32_t *output_shift, const RuntimeShape &input_shape,
+    const int8_t *input_data, const RuntimeShape &filter_shape,
+    const int8_t *filter_data, const RuntimeShape &bias_shape,
+    const int32_t *folded_bias, const RuntimeShape &output_shape,
+    int8_t *output_data, int32_t *border_bias, const int8_t *packed_filter)
+{
+    TFLITE_DCHECK_EQ(params.depth_multiplier, 1);
+    TFLITE_DCHECK(folded_bias != nullptr);
+    TFLITE_DCHECK(border_bias != nullptr);
+
+    // Get parameters.
+    const int stride_width = params.stride_width;
+    const int stride_height = params.stride_height;
+    const int dilation_width_factor = params.dilation_width_factor;
+    const int dilation_height_factor = params.dilation_height_factor;
+    const int pad_width = params.padding_values.width;
+    const int pad_height = params.padding_values.height;
+    const int32_t input_offset = params.input_offset;
+    const int32_t output_offset = params.output_offset;
+    const int32_t output_activation_min = params.quantized_activation_min;
+    const int32_t output_activation_max = params.quantized_activation_max;
+
+    // Check dimensions of the tensors.
+    TFLITE_DCHECK_EQ(input_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(filter_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(output_shape.DimensionsCount(), 4);
+
+    TFLITE_DCHECK_LE(output_activation_min, output_activation_max);
+    const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+    const int depth = MatchingDim(filter_shape, 3, output_shape, 3);
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int filter_height = filter_shape.Dims(1);
+    const int filter_width = filter_shape.Dims(2);
+    const int output_height = output_shape.Dims(1);
+    const int output_width = output_shape.Dims(2);
+    TFLITE_DCHECK_EQ(depth, input_shape.Dims(3));
+    if (bias_shape.DimensionsCount() > 0) {
+        TFLITE_DCHECK_EQ(bias_shape.FlatSize(), depth);
+    }
+
+    // Strides in elements. NHWC input and 1HWC filter keep channels
+    // contiguous, which is the dimension that is vectorized.
+    const int input_col_stride = depth;
+    const int input_row_stride = input_width * depth;
+    const int filter_col_stride = depth;
+    const int filter_row_stride = filter_width * depth;
+
+    // Filter pointer and strides of channel block c0, in the packed or the
+    // original layout.
+    const int taps = filter_height * filter_width;
+    auto block_filter = [&](int c0, int block, int *row_stride, int *col_stride) {
+        if (packed_filter) {
+            *row_stride = filter_width * block;
+            *col_stride = block;
+            return packed_filter + c0 * taps;
+        }
+        *row_stride = filter_row_stride;
+        *col_stride = filter_col_stride;
+        return filter_data + c0;
+    };
+
+    int32_t acc[kDepthwiseChannelBlock];
+
+    // Accumulates and requantizes all channels of one output pixel over the
+    // given tap range, with bias already adjusted to that range.
+    auto run_pixel = [&](const int8_t *in_origin, int8_t *out, const int32_t *bias,
+                         int filter_y_start, int filter_y_end,
+                         int filter_x_start, int filter_x_end, bool interior) {
+        for (int c0 = 0; c0 < depth; c0 += kDepthwiseChannelBlock) {
+            const int block = std::min(kDepthwiseChannelBlock, depth - c0);
+            int fl_row_stride;
+            int fl_col_stride;
+            const int8_t *fl = block_filter(c0, block, &fl_row_stride, &fl_col_stride);
+            if (interior && filter_height == 3 && filter_width == 3) {
+                DepthwiseAccumulateBlock<3, 3>(
+                    in_origin + c0, fl, block, 0, 3, 0, 3,
+                    dilation_height_factor * input_row_stride,
+                    dilation_width_factor * input_col_stride, fl_row_stride,
+                    fl_col_stride, acc);
+            } else {
+                DepthwiseAccumulateBlock(
+                    in_origin + c0, fl, block, filter_y_start, filter_y_end,
+                    filter_x_start, filter_x_end,
+                    dilation_height_factor * input_row_stride,
+                    dilation_width_factor * input_col_stride, fl_row_stride,
+                    fl_col_stride, acc);
+            }
+
+            RequantizePerChannel(acc, block, bias + c0, output_multiplier + c0,
+                                 output_shift + c0, output_offset,
+                                 output_activation_min, output_activation_max,
+                                 out + c0);
+        }
+    };
+
+    // Only the border strips can see padding: the interior runs over the full
+    // filter with the folded bias, the border clips the taps per pixel.
+    const optimized_ops::SpatialPartition partition = optimized_ops::PartitionOutput(
+        input_height, input_width, output_height, output_width, filter_height,
+        filter_width, stride_height, stride_width, dilation_height_factor,
+        dilation_width_factor, pad_height, pad_width);
+
+    // Clipped tap range border_bias currently holds, neighbouring border
+    // pixels usually share it.
+    int border_key[4] = {-1, -1, -1, -1};
+
+    // Pointer to tap (0, 0) of an output pixel. For border pixels it may
+    // point outside the image, but only the clipped taps are read.
+    const int input_image_size = input_height * input_row_stride;
+    auto pixel_origin = [&](int batch, int out_y, int out_x) {
+        return input_data + batch * input_image_size +
+               ((out_y * stride_height) - pad_height) * input_row_stride +
+               ((out_x * stride_width) - pad_width) * input_col_stride;
+    };
+
+    // The batch is the innermost loop: each output pixel is computed for
+    // every image back to back, so the filter taps of a channel block are
+    // still in cache (and the border bias still valid) for the next image.
+    optimized_ops::ForEachOutputPixel(
+        partition, output_height, output_width,
+        [&](int out_y, int x_begin, int x_end) {
+            for (int out_x = x_begin; out_x < x_end; ++out_x) {
+                for (int batch = 0; batch < batches; ++batch) {
+                    run_pixel(pixel_origin(batch, out_y, out_x),
+                              output_data + Offset(output_shape, batch, out_y, out_x, 0),
+                              folded_bias, 0, filter_height, 0, filter_width,
+                              /*interior=*/true);
+                }
+            }
+        },
+        [&](int out_y, int out_x) {
+            const int in_y_origin = (out_y * stride_height) - pad_height;
+            const int in_x_origin = (out_x * stride_width) - pad_width;
+            // Clip the filter taps against the image.
+            int filter_y_start = 0;
+            while (filter_y_start < filter_height &&
+                   in_y_origin + dilation_height_factor * filter_y_start < 0) {
+                ++filter_y_start;
+            }
+            int filter_y_end = filter_height;
+            while (filter_y_end > filter_y_start &&
+                   in_y_origin + dilation_height_factor * (filter_y_end - 1) >= input_height) {
+                --filter_y_end;
+            }
+            int filter_x_start = 0;
+            while (filter_x_start < filter_width &&
+                   in_x_origin + dilation_width_factor * filter_x_start < 0) {
+                ++filter_x_start;
+            }
+            int filter_x_end = filter_width;
+            while (filter_x_end > filter_x_start &&
+                   in_x_origin + dilation_width_factor * (filter_x_end - 1) >= input_width) {
+                --filter_x_end;
+            }
+
+            if (border_key[0] != filter_y_start || border_key[1] != filter_y_end ||
+                border_key[2] != filter_x_start || border_key[3] != filter_x_end) {
+                DepthwiseBorderBias(filter_data, depth, filter_height,
+                                    filter_width, input_offset, folded_bias,
+                                    filter_y_start, filter_y_end,
+                                    filter_x_start, filter_x_end, border_bias);
+                border_key[0] = filter_y_start;
+                border_key[1] = filter_y_end;
+                border_key[2] = filter_x_start;
+                border_key[3] = filter_x_end;
+            }
+            for (int batch = 0; batch < batches; ++batch) {
+                run_pixel(pixel_origin(batch, out_y, out_x),
+                          output_data + Offset(output_shape, batch, out_y, out_x, 0),
+                          border_bias, filter_y_start, filter_y_end,
+                          filter_x_start, filter_x_end, /*interior=*/false);
+            }
+        });
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_DEPTHWISE_CONV_H_
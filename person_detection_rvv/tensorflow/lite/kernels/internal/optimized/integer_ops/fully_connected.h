@@ -0,0 +1,143 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FULLY_CONNECTED_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FULLY_CONNECTED_H_
+
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/requantize.h"
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+namespace tflite {
+namespace optimized_integer_ops {
+
+// Output channels accumulated before one batched requantization.
+constexpr int kFullyConnectedChannelBlock = 64;
+
+#if defined(__riscv_vector)
+// Adds the raw dot product of a and b over [k_begin, k_end), with
+// k_end - k_begin a multiple of vl, to *dot and the sum of b to *b_sum.
+inline void FullyConnectedDotChunk(const int8_t *a, const int8_t *b,
+                                   size_t k_begin, size_t k_end, size_t vl,
+                                   int32_t *dot, int32_t *b_sum)
+{
+    vint32m4_t vec_dot = vmv_v_x_i32m4(0, vl);
+    vint32m4_t vec_sum = vmv_v_x_i32m4(0, vl);
+    for (size_t k = k_begin; k < k_end; k += vl) {
+        // Input Vector
+        vint8m1_t vec_in = vle8_v_i8m1(a + k, vl);
+        // Input Filter
+        vint8m1_t vec_fl = vle8_v_i8m1(b + k, vl);
+        vec_dot = vwadd_wv_i32m4(vec_dot, vwmul_vv_i16m2(vec_in, vec_fl, vl), vl);
+        vec_sum = vwadd_wv_i32m4(vec_sum, vwmul_vx_i16m2(vec_fl, 1, vl), vl);
+    }
+    vint32m1_t zero = vmv_v_x_i32m1(0, vl);
+    *dot += vmv_x_s_i32m1_i32(vredsum_vs_i32m4_i32m1(zero, vec_dot, zero, vl));
+    *b_sum += vmv_x_s_i32m1_i32(vredsum_vs_i32m4_i32m1(zero, vec_sum, zero, vl));
+}
+#endif
+
+// Raw dot product of two int8 vectors together with the sum of b, from which
+// the caller applies the zero point offsets.
+inline int32_t FullyConnectedDot(const int8_t *a, const int8_t *b, int depth,
+                                 int32_t *b_sum)
+{
+    int32_t dot = 0;
+    *b_sum = 0;
+#if defined(__riscv_vector)
+    // The tail chunk is reduced on its own, as in PointwiseMicroKernel.
+    const size_t vlmax = vsetvl_e8m1(depth);
+    const size_t full = (depth / vlmax) * vlmax;
+    if (full > 0) {
+        FullyConnectedDotChunk(a, b, 0, full, vlmax, &dot, b_sum);
+    }
+    if (full < (size_t)depth) {
+        const size_t vl = vsetvl_e8m1(depth - full);
+        FullyConnectedDotChunk(a, b, full, depth, vl, &dot, b_sum);
+    }
+#else
+    for (int k = 0; k < depth; ++k) {
+        dot += a[k] * b[k];
+        *b_sum += b[k];
+    }
+#endif
+    return dot;
+}
+
+// int8 fully connected layer with per-tensor quantization. Produces the same
+// output as reference_integer_ops::FullyConnected:
+//   sum (f + fo) * (x + io) = sum f * x + io * sum f + fo * sum x + depth * fo * io
+// so the inner loop only multiplies raw int8 values, and a block of output
+// channels is requantized as one batch.
+inline void FullyConnected(const FullyConnectedParams &params,
+                           const RuntimeShape &input_shape,
+                           const int8_t *input_data,
+                           const RuntimeShape &filter_shape,
+                           const int8_t *filter_data,
+                           const RuntimeShape &bias_shape,
+                           const int32_t *bias_data,
+                           const RuntimeShape &output_shape,
+                           int8_t *output_data)
+{
+    const int32_t input_offset = params.input_offset;
+    const int32_t filter_offset = params.weights_offset;
+    const int32_t output_offset = params.output_offset;
+    const int32_t output_multiplier = params.output_multiplier;
+    const int output_shift = params.output_shift;
+    const int32_t output_activation_min = params.quantized_activation_min;
+    const int32_t output_activation_max = params.quantized_activation_max;
+    TFLITE_DCHECK_GE(filter_shape.DimensionsCount(), 2);
+    TFLITE_DCHECK_EQ(output_shape.DimensionsCount(), 2);
+
+    TFLITE_DCHECK_LE(output_activation_min, output_activation_max);
+    const int filter_dim_count = filter_shape.DimensionsCount();
+    const int batches = output_shape.Dims(0);
+    const int output_depth = output_shape.Dims(1);
+    TFLITE_DCHECK_LE(output_depth, filter_shape.Dims(filter_dim_count - 2));
+    const int accum_depth = filter_shape.Dims(filter_dim_count - 1);
+
+    int32_t acc[kFullyConnectedChannelBlock];
+    for (int b = 0; b < batches; ++b) {
+        const int8_t *input = input_data + b * accum_depth;
+        int32_t input_sum = 0;
+        for (int d = 0; d < accum_depth; ++d) {
+            input_sum += input[d];
+        }
+        const int32_t constant_term =
+            filter_offset * input_sum + accum_depth * filter_offset * input_offset;
+
+        for (int c0 = 0; c0 < output_depth; c0 += kFullyConnectedChannelBlock) {
+            const int block = std::min(kFullyConnectedChannelBlock, output_depth - c0);
+            for (int c = 0; c < block; ++c) {
+                int32_t filter_sum;
+                const int32_t dot = FullyConnectedDot(
+                    input, filter_data + (c0 + c) * accum_depth, accum_depth,
+                    &filter_sum);
+                acc[c] = dot + input_offset * filter_sum + constant_term +
+                         (bias_data ? bias_data[c0 + c] : 0);
+            }
+            RequantizeChannel(acc, 1, block, 0, output_multiplier, output_shift,
+                              output_offset, output_activation_min,
+                              output_activation_max,
+                              output_data + b * output_depth + c0, 1);
+        }
+    }
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_FULLY_CONNECTED_H_
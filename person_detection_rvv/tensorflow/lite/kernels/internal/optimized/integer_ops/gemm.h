@@ -0,0 +1,209 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_GEMM_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_GEMM_H_
+
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/requantize.h"
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+namespace tflite {
+namespace optimized_integer_ops {
+
+// Output channels computed per micro-kernel pass. Each one holds a full
+// vector of 32 bit accumulators, so four keeps the RVV kernel at 16 of the
+// 32 vector registers with LMUL=4 accumulators.
+constexpr int kGemmBlockCols = 4;
+
+// Output pixels per GEMM tile. Bounds the on-stack accumulator tile and the
+// im2col scratch buffer (kGemmBlockRows * filter depth bytes).
+constexpr int kGemmBlockRows = 32;
+
+// Size in bytes of an [output_depth][depth] filter matrix packed by
+// GemmPackFilter(). The last block of output channels is padded to
+// kGemmBlockCols.
+inline int GemmPackedFilterSize(int output_depth, int depth)
+{
+    return ((output_depth + kGemmBlockCols - 1) / kGemmBlockCols) *
+           kGemmBlockCols * depth;
+}
+
+// Repacks a row-major [output_depth][depth] filter matrix (OHWI flattened)
+// into the blocked layout the micro-kernels stream through: blocks of
+// kGemmBlockCols output channels, each stored as consecutive depth chunks,
+// each chunk holding its kGemmBlockCols rows back to back. With chunk == 1
+// this is O/4-HWI-4, one filter value per channel and depth step; with the
+// vector length as chunk every vector load of a block is contiguous. A
+// shorter last chunk covers the depth tail, channels past output_depth are
+// zero.
+inline void GemmPackFilter(const int8_t *filter_data, int output_depth,
+                           int depth, int chunk, int8_t *packed)
+{
+    for (int channel = 0; channel < output_depth; channel += kGemmBlockCols) {
+        for (int k0 = 0; k0 < depth; k0 += chunk) {
+            const int len = std::min(chunk, depth - k0);
+            for (int n = 0; n < kGemmBlockCols; ++n) {
+                const int8_t *src = filter_data + (channel + n) * depth + k0;
+                for (int i = 0; i < len; ++i) {
+                    *packed++ = (channel + n < output_depth) ? src[i] : 0;
+                }
+            }
+        }
+    }
+}
+
+// Register-blocked int8 x int8 -> int32 micro-kernel.
+//
+// Computes, for m < rows and n < cols (cols <= kGemmBlockCols):
+//   acc[m * kGemmBlockCols + n] = sum_k A(m, k) * B[n][k]
+// on the raw int8 values; the input offset is folded into the bias by the
+// caller (see ConvFoldInputOffset). Here
+//   A(m, k) = lhs[m * lhs_row_stride + k * lhs_depth_stride]
+//   B[n][k] = rhs[n * rhs_stride + k * rhs_depth_stride]
+// The strides let the same kernel read packed im2col tiles (depth-major,
+// lhs_row_stride == 1) and the input tensor directly (pixel-major,
+// lhs_depth_stride == 1) for 1x1 filters, and the filter either as OHWI rows
+// (rhs_stride == depth, rhs_depth_stride == 1) or packed by GemmPackFilter()
+// with chunk 1 (rhs_stride == 1, rhs_depth_stride == kGemmBlockCols).
+inline void GemmInt8MicroKernel(const int8_t *lhs, int lhs_row_stride,
+                                int lhs_depth_stride, const int8_t *rhs,
+                                int rhs_stride, int rhs_depth_stride, int rows,
+                                int cols, int depth, int32_t *acc)
+{
+    TFLITE_DCHECK_LE(cols, kGemmBlockCols);
+    TFLITE_DCHECK_LE(rows, kGemmBlockRows);
+
+    // Unused columns alias the first filter row and are never stored.
+    const int8_t *b0 = rhs;
+    const int8_t *b1 = (cols > 1) ? rhs + rhs_stride : rhs;
+    const int8_t *b2 = (cols > 2) ? rhs + 2 * rhs_stride : rhs;
+    const int8_t *b3 = (cols > 3) ? rhs + 3 * rhs_stride : rhs;
+    const int ks = rhs_depth_stride;
+
+#if defined(__riscv_vector)
+    // Vectorized across output pixels: every filter value is broadcast
+    // against a vector of pixels, so no horizontal reduction is needed.
+    for (size_t vl, m = 0; m < (size_t)rows; m += vl) {
+        // Set Vector length. e8m1 and e32m4 have the same VLMAX.
+        vl = vsetvl_e32m4(rows - m);
+        vint32m4_t acc0 = vmv_v_x_i32m4(0, vl);
+        vint32m4_t acc1 = vmv_v_x_i32m4(0, vl);
+        vint32m4_t acc2 = vmv_v_x_i32m4(0, vl);
+        vint32m4_t acc3 = vmv_v_x_i32m4(0, vl);
+        const int8_t *a = lhs + m * lhs_row_stride;
+        for (int k = 0; k < depth; ++k, a += lhs_depth_stride) {
+            // Input Vector
+            vint8m1_t vec_in = (lhs_row_stride == 1)
+                                   ? vle8_v_i8m1(a, vl)
+                                   : vlse8_v_i8m1(a, lhs_row_stride, vl);
+            // Broadcast one filter value per output channel: the 16 bit
+            // product of two int8 values is exact, then widen-add it into
+            // the 32 bit accumulators.
+            acc0 = vwadd_wv_i32m4(acc0, vwmul_vx_i16m2(vec_in, b0[k * ks], vl), vl);
+            acc1 = vwadd_wv_i32m4(acc1, vwmul_vx_i16m2(vec_in, b1[k * ks], vl), vl);
+            acc2 = vwadd_wv_i32m4(acc2, vwmul_vx_i16m2(vec_in, b2[k * ks], vl), vl);
+            acc3 = vwadd_wv_i32m4(acc3, vwmul_vx_i16m2(vec_in, b3[k * ks], vl), vl);
+        }
+        // Scatter the columns into the row-major accumulator tile.
+        const ptrdiff_t tile_stride = kGemmBlockCols * sizeof(int32_t);
+        vsse32_v_i32m4(acc + m * kGemmBlockCols + 0, tile_stride, acc0, vl);
+        vsse32_v_i32m4(acc + m * kGemmBlockCols + 1, tile_stride, acc1, vl);
+        vsse32_v_i32m4(acc + m * kGemmBlockCols + 2, tile_stride, acc2, vl);
+        vsse32_v_i32m4(acc + m * kGemmBlockCols + 3, tile_stride, acc3, vl);
+    }
+#else
+    // Portable path: 2 pixels x 4 output channels per pass, so each input
+    // and filter load feeds several multiply-accumulates.
+    int m = 0;
+    for (; m + 2 <= rows; m += 2) {
+        const int8_t *a0 = lhs + m * lhs_row_stride;
+        const int8_t *a1 = a0 + lhs_row_stride;
+        int32_t c00 = 0, c01 = 0, c02 = 0, c03 = 0;
+        int32_t c10 = 0, c11 = 0, c12 = 0, c13 = 0;
+        for (int k = 0; k < depth; ++k) {
+            const int32_t x0 = a0[k * lhs_depth_stride];
+            const int32_t x1 = a1[k * lhs_depth_stride];
+            const int32_t w0 = b0[k * ks];
+            const int32_t w1 = b1[k * ks];
+            const int32_t w2 = b2[k * ks];
+            const int32_t w3 = b3[k * ks];
+            c00 += x0 * w0;
+            c01 += x0 * w1;
+            c02 += x0 * w2;
+            c03 += x0 * w3;
+            c10 += x1 * w0;
+            c11 += x1 * w1;
+            c12 += x1 * w2;
+            c13 += x1 * w3;
+        }
+        int32_t *out = acc + m * kGemmBlockCols;
+        out[0] = c00;
+        out[1] = c01;
+        out[2] = c02;
+        out[3] = c03;
+        out[4] = c10;
+        out[5] = c11;
+        out[6] = c12;
+        out[7] = c13;
+    }
+    for (; m < rows; ++m) {
+        const int8_t *a0 = lhs + m * lhs_row_stride;
+        int32_t c00 = 0, c01 = 0, c02 = 0, c03 = 0;
+        for (int k = 0; k < depth; ++k) {
+            const int32_t x0 = a0[k * lhs_depth_stride];
+            c00 += x0 * b0[k * ks];
+            c01 += x0 * b1[k * ks];
+            c02 += x0 * b2[k * ks];
+            c03 += x0 * b3[k * ks];
+        }
+        int32_t *out = acc + m * kGemmBlockCols;
+        out[0] = c00;
+        out[1] = c01;
+        out[2] = c02;
+        out[3] = c03;
+    }
+#endif
+}
+
+// Adds the bias to a tile produced by GemmInt8MicroKernel, requantizes it with
+// the per-channel multipliers and writes it to rows of the NHWC output.
+// channel is the first output channel of the tile, output_depth the channel
+// stride of the output. Each column shares one channel's parameters, so it is
+// requantized as one strided batch.
+inline void GemmRequantizeTile(const int32_t *acc, int rows, int cols,
+                               int channel, const int32_t *bias_data,
+                               const int32_t *output_multiplier,
+                               const int32_t *output_shift,
+                               int32_t output_offset,
+                               int32_t output_activation_min,
+                               int32_t output_activation_max,
+                               int8_t *output_data, int output_depth)
+{
+    for (int n = 0; n < cols; ++n) {
+        RequantizeChannel(acc + n, kGemmBlockCols, rows,
+                          bias_data ? bias_data[channel + n] : 0,
+                          output_multiplier[channel + n],
+                          output_shift[channel + n], output_offset,
+                          output_activation_min, output_activation_max,
+                          output_data + channel + n, output_depth);
+    }
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_GEMM_H_
@@ -0,0 +1,263 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_POOLING_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_POOLING_H_
+
+#include <limits>
+
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/spatial_partition.h"
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+namespace tflite {
+namespace optimized_integer_ops {
+
+// Channels pooled per pass; bounds the on-stack accumulators.
+constexpr int kPoolChannelBlock = 64;
+
+// Sums one block of channels over the window taps [filter_y_start,
+// filter_y_end) x [filter_x_start, filter_x_end). input_data points at the
+// first channel of the block at tap (0, 0).
+inline void PoolSumBlock(const int8_t *input_data, int block,
+                         int filter_y_start, int filter_y_end,
+                         int filter_x_start, int filter_x_end,
+                         int input_row_stride, int input_col_stride,
+                         int32_t *acc)
+{
+#if defined(__riscv_vector)
+    for (size_t vl, c = 0; c < (size_t)block; c += vl) {
+        // Set Vector length
+        vl = vsetvl_e8m1(block - c);
+        vint32m4_t vec_acc = vmv_v_x_i32m4(0, vl);
+        for (int filter_y = filter_y_start; filter_y < filter_y_end; ++filter_y) {
+            const int8_t *in_row = input_data + filter_y * input_row_stride + c;
+            for (int filter_x = filter_x_start; filter_x < filter_x_end; ++filter_x) {
+                // Input Vector
+                vint8m1_t vec_in = vle8_v_i8m1(in_row + filter_x * input_col_stride, vl);
+                // Sign-extend to 16 bit (multiply by one), then widen-add.
+                vec_acc = vwadd_wv_i32m4(vec_acc, vwmul_vx_i16m2(vec_in, 1, vl), vl);
+            }
+        }
+        vse32_v_i32m4(acc + c, vec_acc, vl);
+    }
+#else
+    for (int c = 0; c < block; ++c) {
+        acc[c] = 0;
+    }
+    for (int filter_y = filter_y_start; filter_y < filter_y_end; ++filter_y) {
+        const int8_t *in_row = input_data + filter_y * input_row_stride;
+        for (int filter_x = filter_x_start; filter_x < filter_x_end; ++filter_x) {
+            const int8_t *in = in_row + filter_x * input_col_stride;
+            for (int c = 0; c < block; ++c) {
+                acc[c] += in[c];
+            }
+        }
+    }
+#endif
+}
+
+// Maximum of one block of channels over the window taps, clamped to the
+// activation range and written to output_data.
+inline void PoolMaxBlock(const int8_t *input_data, int block,
+                         int filter_y_start, int filter_y_end,
+                         int filter_x_start, int filter_x_end,
+                         int input_row_stride, int input_col_stride,
+                         int8_t activation_min, int8_t activation_max,
+                         int8_t *output_data)
+{
+#if defined(__riscv_vector)
+    for (size_t vl, c = 0; c < (size_t)block; c += vl) {
+        // Set Vector length
+        vl = vsetvl_e8m1(block - c);
+        vint8m1_t vec_max = vmv_v_x_i8m1(std::numeric_limits<int8_t>::lowest(), vl);
+        for (int filter_y = filter_y_start; filter_y < filter_y_end; ++filter_y) {
+            const int8_t *in_row = input_data + filter_y * input_row_stride + c;
+            for (int filter_x = filter_x_start; filter_x < filter_x_end; ++filter_x) {
+                vint8m1_t vec_in = vle8_v_i8m1(in_row + filter_x * input_col_stride, vl);
+                vec_max = vmax_vv_i8m1(vec_max, vec_in, vl);
+            }
+        }
+        vec_max = vmax_vx_i8m1(vec_max, activation_min, vl);
+        vec_max = vmin_vx_i8m1(vec_max, activation_max, vl);
+        vse8_v_i8m1(output_data + c, vec_max, vl);
+    }
+#else
+    int8_t max[kPoolChannelBlock];
+    for (int c = 0; c < block; ++c) {
+        max[c] = std::numeric_limits<int8_t>::lowest();
+    }
+    for (int filter_y = filter_y_start; filter_y < filter_y_end; ++filter_y) {
+        const int8_t *in_row = input_data + filter_y * input_row_stride;
+        for (int filter_x = filter_x_start; filter_x < filter_x_end; ++filter_x) {
+            const int8_t *in = in_row + filter_x * input_col_stride;
+            for (int c = 0; c < block; ++c) {
+                max[c] = std::max(max[c], in[c]);
+            }
+        }
+    }
+    for (int c = 0; c < block; ++c) {
+        output_data[c] = std::min(std::max(max[c], activation_min), activation_max);
+    }
+#endif
+}
+
+// Walks the output of a pooling op with the window clipped against the
+// image. Interior pixels always see the full filter_height x filter_width
+// window, so only the border strips compute the clipped tap range.
+// pool(in_origin, out, filter_y_start, filter_y_end, filter_x_start,
+// filter_x_end) handles all channels of one output pixel; in_origin is the
+// input at tap (0, 0) of the window.
+template <typename PoolFn>
+inline void ForEachPoolWindow(const PoolParams &params,
+                              const RuntimeShape &input_shape,
+                              const int8_t *input_data,
+                              const RuntimeShape &output_shape,
+                              int8_t *output_data, PoolFn &&pool)
+{
+    TFLITE_DCHECK_EQ(input_shape.DimensionsCount(), 4);
+    TFLITE_DCHECK_EQ(output_shape.DimensionsCount(), 4);
+    const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+    const int depth = MatchingDim(input_shape, 3, output_shape, 3);
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int output_height = output_shape.Dims(1);
+    const int output_width = output_shape.Dims(2);
+    const int stride_height = params.stride_height;
+    const int stride_width = params.stride_width;
+    const int filter_height = params.filter_height;
+    const int filter_width = params.filter_width;
+    const int pad_height = params.padding_values.height;
+    const int pad_width = params.padding_values.width;
+
+    const optimized_ops::SpatialPartition partition = optimized_ops::PartitionOutput(
+        input_height, input_width, output_height, output_width, filter_height,
+        filter_width, stride_height, stride_width, 1, 1, pad_height, pad_width);
+
+    for (int batch = 0; batch < batches; ++batch) {
+        const int8_t *input_batch = input_data + batch * input_height * input_width * depth;
+        int8_t *output_batch = output_data + batch * output_height * output_width * depth;
+        // Window origin of an output pixel. For border pixels it may point
+        // outside the image, but only the clipped taps are read.
+        auto pixel_origin = [&](int out_y, int out_x) {
+            return input_batch +
+                   (((out_y * stride_height) - pad_height) * input_width +
+                    ((out_x * stride_width) - pad_width)) *
+                       depth;
+        };
+
+        optimized_ops::ForEachOutputPixel(
+            partition, output_height, output_width,
+            [&](int out_y, int x_begin, int x_end) {
+                for (int out_x = x_begin; out_x < x_end; ++out_x) {
+                    pool(pixel_origin(out_y, out_x),
+                         output_batch + (out_y * output_width + out_x) * depth, 0,
+                         filter_height, 0, filter_width);
+                }
+            },
+            [&](int out_y, int out_x) {
+                const int in_x_origin = (out_x * stride_width) - pad_width;
+                const int in_y_origin = (out_y * stride_height) - pad_height;
+                // Compute the boundaries of the filter region clamped so as to
+                // ensure that the filter window fits in the input array.
+                const int filter_x_start = std::max(0, -in_x_origin);
+                const int filter_x_end = std::min(filter_width, input_width - in_x_origin);
+                const int filter_y_start = std::max(0, -in_y_origin);
+                const int filter_y_end = std::min(filter_height, input_height - in_y_origin);
+                pool(pixel_origin(out_y, out_x),
+                     output_batch + (out_y * output_width + out_x) * depth,
+                     filter_y_start, filter_y_end, filter_x_start, filter_x_end);
+            });
+    }
+}
+
+// int8 average pooling vectorized across channels. Produces the same output
+// as reference_integer_ops::AveragePool, including its round-half-away-from-
+// zero division by the number of taps inside the image.
+inline void AveragePool(const PoolParams &params,
+                        const RuntimeShape &input_shape,
+                        const int8_t *input_data,
+                        const RuntimeShape &output_shape, int8_t *output_data)
+{
+    TFLITE_DCHECK_LE(params.quantized_activation_min,
+                     params.quantized_activation_max);
+    const int depth = MatchingDim(input_shape, 3, output_shape, 3);
+    const int input_col_stride = depth;
+    const int input_row_stride = input_shape.Dims(2) * depth;
+    const int32_t activation_min = params.quantized_activation_min;
+    const int32_t activation_max = params.quantized_activation_max;
+
+    int32_t acc[kPoolChannelBlock];
+    ForEachPoolWindow(
+        params, input_shape, input_data, output_shape, output_data,
+        [&](const int8_t *in_origin, int8_t *out, int filter_y_start,
+            int filter_y_end, int filter_x_start, int filter_x_end) {
+            const int filter_count =
+                (filter_y_end - filter_y_start) * (filter_x_end - filter_x_start);
+            for (int c0 = 0; c0 < depth; c0 += kPoolChannelBlock) {
+                const int block = std::min(kPoolChannelBlock, depth - c0);
+                PoolSumBlock(in_origin + c0, block, filter_y_start, filter_y_end,
+                             filter_x_start, filter_x_end, input_row_stride,
+                             input_col_stride, acc);
+                for (int c = 0; c < block; ++c) {
+                    int32_t value = acc[c];
+                    // Round to the closest integer value.
+                    value = value > 0 ? (value + filter_count / 2) / filter_count
+                                      : (value - filter_count / 2) / filter_count;
+                    value = std::max(value, activation_min);
+                    value = std::min(value, activation_max);
+                    out[c0 + c] = static_cast<int8_t>(value);
+                }
+            }
+        });
+}
+
+// int8 max pooling vectorized across channels. Produces the same output as
+// reference_integer_ops::MaxPool.
+inline void MaxPool(const PoolParams &params, const RuntimeShape &input_shape,
+                    const int8_t *input_data, const RuntimeShape &output_shape,
+                    int8_t *output_data)
+{
+    TFLITE_DCHECK_LE(params.quantized_activation_min,
+                     params.quantized_activation_max);
+    TFLITE_DCHECK_GE(params.quantized_activation_min,
+                     std::numeric_limits<int8_t>::min());
+    TFLITE_DCHECK_LE(params.quantized_activation_max,
+                     std::numeric_limits<int8_t>::max());
+    const int depth = MatchingDim(input_shape, 3, output_shape, 3);
+    const int input_col_stride = depth;
+    const int input_row_stride = input_shape.Dims(2) * depth;
+    const int8_t activation_min = static_cast<int8_t>(params.quantized_activation_min);
+    const int8_t activation_max = static_cast<int8_t>(params.quantized_activation_max);
+
+    ForEachPoolWindow(
+        params, input_shape, input_data, output_shape, output_data,
+        [&](const int8_t *in_origin, int8_t *out, int filter_y_start,
+            int filter_y_end, int filter_x_start, int filter_x_end) {
+            for (int c0 = 0; c0 < depth; c0 += kPoolChannelBlock) {
+                const int block = std::min(kPoolChannelBlock, depth - c0);
+                PoolMaxBlock(in_origin + c0, block, filter_y_start, filter_y_end,
+                             filter_x_start, filter_x_end, input_row_stride,
+                             input_col_stride, activation_min, activation_max,
+                             out + c0);
+            }
+        });
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_POOLING_H_
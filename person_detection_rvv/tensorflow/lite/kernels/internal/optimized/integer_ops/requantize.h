@@ -0,0 +1,185 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_REQUANTIZE_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_REQUANTIZE_H_
+
+#include "tensorflow/lite/kernels/internal/common.h"
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#endif
+
+namespace tflite {
+namespace optimized_integer_ops {
+
+// Batched form of the requantization tail of the int8 kernels:
+//   out = clamp(MultiplyByQuantizedMultiplier(acc + bias, multiplier, shift)
+//               + output_offset, activation_min, activation_max)
+// bit-exact with the scalar gemmlowp arithmetic, for the non-negative
+// multipliers QuantizeMultiplier() produces. Both steps are written without
+// branches:
+//
+// SaturatingRoundingDoublingHighMul(a, b) is (a * b + 2^30) >> 31. Its
+// nudge of 1 - 2^30 and truncating division for negative products round to
+// the same value, and with b >= 0 the product never needs saturating. On
+// RVV the 64 bit product is split into vmulh (high word) and vmul (low
+// word): the result is 2 * high plus bits 31 and 30 of the low word.
+//
+// RoundingDivideByPOT(x, e) is (x >> e) + (remainder > threshold), with
+// threshold = (mask >> 1) + (x < 0); the comparison is the sign of
+// threshold - remainder, which cannot overflow.
+
+// Scalar reference form of the above, used by the portable paths.
+inline int32_t RequantizeMultiply(int32_t x, int32_t multiplier, int32_t shift)
+{
+    const int left_shift = shift > 0 ? shift : 0;
+    const int right_shift = shift > 0 ? 0 : -shift;
+    const int32_t shifted = static_cast<int32_t>(static_cast<uint32_t>(x) << left_shift);
+    const int64_t product = static_cast<int64_t>(shifted) * multiplier;
+    const int32_t high = static_cast<int32_t>((product + (int64_t(1) << 30)) >> 31);
+    const int32_t mask = static_cast<int32_t>((int64_t(1) << right_shift) - 1);
+    const int32_t remainder = high & mask;
+    const int32_t threshold = (mask >> 1) - (high >> 31);
+    return (high >> right_shift) - ((threshold - remainder) >> 31);
+}
+
+#if defined(__riscv_vector)
+// Vector form of RequantizeMultiply() with per-lane parameters. left_shift
+// and right_shift are max(shift, 0) and max(-shift, 0), mask is
+// (1 << right_shift) - 1.
+inline vint32m4_t RequantizeMultiplyVector(vint32m4_t x, vint32m4_t multiplier,
+                                           vuint32m4_t left_shift,
+                                           vuint32m4_t right_shift,
+                                           vint32m4_t mask, size_t vl)
+{
+    x = vsll_vv_i32m4(x, left_shift, vl);
+    // 2 * high + ((low >>> 30) + 1) / 2 adds bits 31 and 30 of the low word.
+    vint32m4_t high = vmulh_vv_i32m4(x, multiplier, vl);
+    vuint32m4_t low = vreinterpret_v_i32m4_u32m4(vmul_vv_i32m4(x, multiplier, vl));
+    low = vsrl_vx_u32m4(vadd_vx_u32m4(vsrl_vx_u32m4(low, 30, vl), 1, vl), 1, vl);
+    high = vadd_vv_i32m4(vsll_vx_i32m4(high, 1, vl),
+                         vreinterpret_v_u32m4_i32m4(low), vl);
+    // Rounding divide by 2^right_shift, ties away from zero.
+    vint32m4_t remainder = vand_vv_i32m4(high, mask, vl);
+    vint32m4_t threshold = vsub_vv_i32m4(vsra_vx_i32m4(mask, 1, vl),
+                                         vsra_vx_i32m4(high, 31, vl), vl);
+    vint32m4_t round = vsra_vx_i32m4(vsub_vv_i32m4(threshold, remainder, vl), 31, vl);
+    return vsub_vv_i32m4(vsra_vv_i32m4(high, right_shift, vl), round, vl);
+}
+
+// Adds the output offset, clamps to the activation range and narrows to
+// int8. After the clamp the value fits, so the narrowing shifts are exact.
+inline vint8m1_t RequantizeNarrow(vint32m4_t x, int32_t output_offset,
+                                  int32_t activation_min,
+                                  int32_t activation_max, size_t vl)
+{
+    x = vadd_vx_i32m4(x, output_offset, vl);
+    x = vmax_vx_i32m4(x, activation_min, vl);
+    x = vmin_vx_i32m4(x, activation_max, vl);
+    return vnsra_wx_i8m1(vnsra_wx_i16m2(x, 0, vl), 0, vl);
+}
+#endif
+
+// Requantizes count accumulators of consecutive output channels: element i
+// uses bias[i] (bias may be null), multiplier[i] and shift[i].
+inline void RequantizePerChannel(const int32_t *acc, int count,
+                                 const int32_t *bias,
+                                 const int32_t *multiplier,
+                                 const int32_t *shift, int32_t output_offset,
+                                 int32_t activation_min,
+                                 int32_t activation_max, int8_t *output)
+{
+#if defined(__riscv_vector)
+    for (size_t vl, i = 0; i < (size_t)count; i += vl) {
+        // Set Vector length
+        vl = vsetvl_e32m4(count - i);
+        vint32m4_t x = vle32_v_i32m4(acc + i, vl);
+        if (bias) {
+            x = vadd_vv_i32m4(x, vle32_v_i32m4(bias + i, vl), vl);
+        }
+        vint32m4_t vec_shift = vle32_v_i32m4(shift + i, vl);
+        vint32m4_t left = vmax_vx_i32m4(vec_shift, 0, vl);
+        vint32m4_t right = vmax_vx_i32m4(vneg_v_i32m4(vec_shift, vl), 0, vl);
+        vuint32m4_t right_u = vreinterpret_v_i32m4_u32m4(right);
+        vint32m4_t mask = vsub_vx_i32m4(
+            vsll_vv_i32m4(vmv_v_x_i32m4(1, vl), right_u, vl), 1, vl);
+        x = RequantizeMultiplyVector(x, vle32_v_i32m4(multiplier + i, vl),
+                                     vreinterpret_v_i32m4_u32m4(left), right_u,
+                                     mask, vl);
+        vse8_v_i8m1(output + i,
+                    RequantizeNarrow(x, output_offset, activation_min,
+                                     activation_max, vl),
+                    vl);
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        int32_t value = acc[i] + (bias ? bias[i] : 0);
+        value = RequantizeMultiply(value, multiplier[i], shift[i]);
+        value += output_offset;
+        value = std::max(value, activation_min);
+        value = std::min(value, activation_max);
+        output[i] = static_cast<int8_t>(value);
+    }
+#endif
+}
+
+// Requantizes count accumulators of a single output channel, for example one
+// column of a GEMM tile or a per-tensor quantized layer. Accumulator i is
+// read from acc[i * acc_stride] and written to output[i * output_stride].
+inline void RequantizeChannel(const int32_t *acc, int acc_stride, int count,
+                              int32_t bias, int32_t multiplier, int32_t shift,
+                              int32_t output_offset, int32_t activation_min,
+                              int32_t activation_max, int8_t *output,
+                              int output_stride)
+{
+#if defined(__riscv_vector)
+    const uint32_t left = shift > 0 ? shift : 0;
+    const uint32_t right = shift > 0 ? 0 : -shift;
+    const int32_t mask = static_cast<int32_t>((int64_t(1) << right) - 1);
+    for (size_t vl, i = 0; i < (size_t)count; i += vl) {
+        // Set Vector length
+        vl = vsetvl_e32m4(count - i);
+        vint32m4_t x = (acc_stride == 1)
+                           ? vle32_v_i32m4(acc + i, vl)
+                           : vlse32_v_i32m4(acc + i * acc_stride,
+                                            acc_stride * sizeof(int32_t), vl);
+        x = vadd_vx_i32m4(x, bias, vl);
+        x = RequantizeMultiplyVector(x, vmv_v_x_i32m4(multiplier, vl),
+                                     vmv_v_x_u32m4(left, vl),
+                                     vmv_v_x_u32m4(right, vl),
+                                     vmv_v_x_i32m4(mask, vl), vl);
+        vint8m1_t out = RequantizeNarrow(x, output_offset, activation_min,
+                                         activation_max, vl);
+        if (output_stride == 1) {
+            vse8_v_i8m1(output + i, out, vl);
+        } else {
+            vsse8_v_i8m1(output + i * output_stride, output_stride, out, vl);
+        }
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        int32_t value = acc[i * acc_stride] + bias;
+        value = RequantizeMultiply(value, multiplier, shift);
+        value += output_offset;
+        value = std::max(value, activation_min);
+        value = std::min(value, activation_max);
+        output[i * output_stride] = static_cast<int8_t>(value);
+    }
+#endif
+}
+
+} // namespace optimized_integer_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_INTEGER_OPS_REQUANTIZE_H_
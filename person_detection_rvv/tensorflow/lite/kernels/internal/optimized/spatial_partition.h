@@ -0,0 +1,105 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPATIAL_PARTITION_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPATIAL_PARTITION_H_
+
+#include <algorithm>
+
+namespace tflite {
+namespace optimized_ops {
+
+// Output pixels of a windowed op (convolution, depthwise convolution,
+// pooling) split into the interior, whose receptive field lies entirely
+// inside the input, and the border strips around it that touch padding.
+// Interior pixels are [y_begin, y_end) x [x_begin, x_end); either range may
+// be empty for small images.
+struct SpatialPartition {
+    int y_begin;
+    int y_end;
+    int x_begin;
+    int x_end;
+
+    bool IsInterior(int out_y, int out_x) const
+    {
+        return out_y >= y_begin && out_y < y_end && out_x >= x_begin && out_x < x_end;
+    }
+};
+
+// Range [begin, end) of output positions along one axis whose window
+// [o * stride - pad, o * stride - pad + dilation * (filter_size - 1)] lies
+// inside [0, input_size).
+inline void InteriorRange(int input_size, int output_size, int filter_size,
+                          int stride, int dilation, int pad, int *begin,
+                          int *end)
+{
+    const int extent = dilation * (filter_size - 1);
+    // First output whose window starts at or after 0.
+    int first = (pad + stride - 1) / stride;
+    // Last input position the window may start at and still end inside.
+    const int last_origin = input_size - 1 - extent + pad;
+    int last_end = (last_origin >= 0) ? last_origin / stride + 1 : 0;
+    first = std::min(first, output_size);
+    last_end = std::min(last_end, output_size);
+    *begin = first;
+    *end = std::max(first, last_end);
+}
+
+inline SpatialPartition PartitionOutput(int input_height, int input_width,
+                                        int output_height, int output_width,
+                                        int filter_height, int filter_width,
+                                        int stride_height, int stride_width,
+                                        int dilation_height, int dilation_width,
+                                        int pad_height, int pad_width)
+{
+    SpatialPartition partition;
+    InteriorRange(input_height, output_height, filter_height, stride_height,
+                  dilation_height, pad_height, &partition.y_begin, &partition.y_end);
+    InteriorRange(input_width, output_width, filter_width, stride_width,
+                  dilation_width, pad_width, &partition.x_begin, &partition.x_end);
+    return partition;
+}
+
+// Visits every output pixel of one image in raster order. Each run of
+// interior pixels of a row is passed as one call interior(out_y, x_begin,
+// x_end), so the kernel can process it without any bounds checks; every other
+// pixel goes to border(out_y, out_x).
+template <typename InteriorFn, typename BorderFn>
+inline void ForEachOutputPixel(const SpatialPartition &partition,
+                               int output_height, int output_width,
+                               InteriorFn &&interior, BorderFn &&border)
+{
+    for (int out_y = 0; out_y < output_height; ++out_y) {
+        const bool interior_row = out_y >= partition.y_begin && out_y < partition.y_end &&
+                                  partition.x_begin < partition.x_end;
+        if (!interior_row) {
+            for (int out_x = 0; out_x < output_width; ++out_x) {
+                border(out_y, out_x);
+            }
+            continue;
+        }
+        for (int out_x = 0; out_x < partition.x_begin; ++out_x) {
+            border(out_y, out_x);
+        }
+        interior(out_y, partition.x_begin, partition.x_end);
+        for (int out_x = partition.x_end; out_x < output_width; ++out_x) {
+            border(out_y, out_x);
+        }
+    }
+}
+
+} // namespace optimized_ops
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPATIAL_PARTITION_H_
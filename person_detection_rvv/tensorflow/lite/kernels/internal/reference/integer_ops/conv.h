@@ -17,7 +17,9 @@ limitations under the License.
 
 #include "tensorflow/lite/kernels/internal/common.h"
 #include <stdio.h>
+#if defined(__riscv_vector)
 #include <riscv_vector.h>
+#endif
 
 namespace tflite {
 namespace reference_integer_ops {
@@ -87,6 +89,7 @@ inline void ConvPerChannel(
                             if (!is_point_inside_image) {
                                 continue;
                             }
+#if defined(__riscv_vector)
                             // start the input data from 0 index of input channel
                             int8_t *temp_in = (int8_t*) &input_data[Offset(input_shape, batch, in_y, in_x, 0)];
                             int8_t *temp_fl = (int8_t*) &filter_data[Offset(filter_shape, out_channel,
@@ -133,6 +136,15 @@ inline void ConvPerChannel(
                                 vse32_v_i32m1(&sum, result, vl);
                                 acc += sum;
                             }
+#else
+                            // Portable path used by the host build.
+                            const int8_t *temp_in = &input_data[Offset(input_shape, batch, in_y, in_x, 0)];
+                            const int8_t *temp_fl = &filter_data[Offset(filter_shape, out_channel,
+                                                                        filter_y, filter_x, 0)];
+                            for (int in_channel = 0; in_channel < input_depth; ++in_channel) {
+                                acc += temp_fl[in_channel] * (temp_in[in_channel] + input_offset);
+                            }
+#endif
                         }
                     }
 
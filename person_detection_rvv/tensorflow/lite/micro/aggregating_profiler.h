@@ -0,0 +1,100 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_AGGREGATING_PROFILER_H_
+#define TENSORFLOW_LITE_MICRO_AGGREGATING_PROFILER_H_
+
+#include <cstdint>
+
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/micro_profiler.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+
+// MicroProfiler that aggregates the per-operator events of many Invoke()
+// calls instead of keeping the last raw events. For every node of the main
+// subgraph it tracks count, total, min and max ticks, and it knows the
+// number of multiply-accumulates of conv, depthwise conv and fully connected
+// nodes from their tensor shapes, so the reports show MACs per tick (per
+// core cycle with the RISC-V rdcycle timer).
+//
+// The interpreter emits one event per operator, in graph order, so the n-th
+// event of an invoke belongs to node n. Init() must be called with the model
+// the interpreter runs before the first Invoke(). Control flow ops that
+// invoke other subgraphs are not supported.
+class AggregatingProfiler : public MicroProfiler {
+public:
+    static constexpr int kMaxNodes = 64;
+
+    struct NodeStats {
+        const char *tag;
+        BuiltinOperator op;
+        int32_t count;
+        int64_t total_ticks;
+        int32_t min_ticks;
+        int32_t max_ticks;
+        // 0 for ops without a MAC estimate.
+        int64_t macs;
+    };
+
+    AggregatingProfiler() = default;
+
+    // Reads the operators of subgraph 0 of model and computes their MAC
+    // counts. Also clears all statistics.
+    void Init(const Model *model);
+
+    uint32_t BeginEvent(const char *tag) override;
+    void EndEvent(uint32_t event_handle) override;
+
+    // Clears the statistics but keeps the node information from Init().
+    void Reset();
+
+    int num_nodes() const
+    {
+        return num_nodes_;
+    }
+    // Number of complete Invoke() calls recorded.
+    int32_t num_invokes() const
+    {
+        return num_invokes_;
+    }
+    const NodeStats &node(int index) const
+    {
+        return nodes_[index];
+    }
+
+    // Mean ticks of a node per recorded event, 0 if it never ran.
+    int32_t MeanTicks(int index) const;
+
+    // Prints a per-node table followed by a per-op-type summary through
+    // DebugLog.
+    void LogTable() const;
+
+    // Prints the per-node statistics as CSV through DebugLog.
+    void LogCsv() const;
+
+private:
+    NodeStats nodes_[kMaxNodes];
+    int32_t start_ticks_[kMaxNodes];
+    int num_nodes_ = 0;
+    int next_node_ = 0;
+    int32_t num_invokes_ = 0;
+
+    TF_LITE_REMOVE_VIRTUAL_DELETE;
+};
+
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_MICRO_AGGREGATING_PROFILER_H_
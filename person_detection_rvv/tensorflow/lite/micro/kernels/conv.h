@@ -44,6 +44,27 @@ struct OpDataConv {
     // uint8_t these would be 0 and 255.
     int32_t output_activation_min;
     int32_t output_activation_max;
+
+    // Index of the im2col scratch buffer used by the int8 GEMM kernel, or -1
+    // if the layer does not need one.
+    int im2col_scratch_index;
+
+    // True for 1x1 filters without padding, which the int8 kernel runs as a
+    // GEMM straight on the input tensor.
+    bool pointwise;
+
+    // Per-channel bias with the input offset folded in, so the optimized int8
+    // kernels multiply the raw inputs. Null if those kernels are not used.
+    int32_t *folded_bias;
+
+    // Index of the scratch buffer for the per-channel bias of the border
+    // pixels of an int8 depthwise convolution, or -1.
+    int border_bias_scratch_index;
+
+    // Int8 filter repacked into the blocked layout of the optimized kernel.
+    // Null when TF_LITE_MICRO_NO_FILTER_PACKING is defined, in which case the
+    // kernel reads the weights from the model.
+    int8_t *packed_filter;
 };
 
 extern const int kConvInputTensor;
@@ -71,21 +92,19 @@ TfLiteStatus CalculateOpDataConv(TfLiteContext *context, TfLiteNode *node,
 
 TfLiteStatus ConvPrepare(TfLiteContext *context, TfLiteNode *node);
 
+// Prepare of the INT8REF registration: int8 layers get no folded bias,
+// packed filter or scratch buffers of the optimized kernel.
+TfLiteStatus ConvPrepareInt8Reference(TfLiteContext *context, TfLiteNode *node);
+
 // This is the most generic TfLiteRegistration. The actual supported types may
 // still be target dependent. The only requirement is that every implementation
 // (reference or optimized) must define this function.
 TfLiteRegistration Register_CONV_2D();
 
-#if defined(XTENSA)
-// Returns a TfLiteRegistration struct for kernel variant that only supports
-// int8 inputs and outputs.
+// Returns a TfLiteRegistration struct for the kernel variant that evaluates
+// int8 inputs with the reference kernel instead of the im2col + GEMM kernel.
+// Useful for checking and benchmarking the optimized kernel.
 TfLiteRegistration Register_CONV_2D_INT8REF();
-#else
-inline TfLiteRegistration Register_CONV_2D_INT8REF()
-{
-    return Register_CONV_2D();
-}
-#endif
 
 } // namespace tflite
 
@@ -48,6 +48,19 @@ TfLiteStatus CalculateOpDataDepthwiseConv(
 
 TfLiteStatus DepthwiseConvPrepare(TfLiteContext *context, TfLiteNode *node);
 
+// Prepare of the INT8REF registration: int8 layers get no folded bias,
+// packed filter or scratch buffers of the optimized kernel.
+TfLiteStatus DepthwiseConvPrepareInt8Reference(TfLiteContext *context, TfLiteNode *node);
+
+// This is the most generic TfLiteRegistration. Int8 inputs are evaluated with
+// the channel-vectorized kernel from optimized/integer_ops/depthwise_conv.h.
+TfLiteRegistration Register_DEPTHWISE_CONV_2D();
+
+// Returns a TfLiteRegistration struct for the kernel variant that evaluates
+// int8 inputs with the reference kernel. Useful for checking and benchmarking
+// the optimized kernel against the original implementation.
+TfLiteRegistration Register_DEPTHWISE_CONV_2D_INT8REF();
+
 } // namespace tflite
 
 #endif // TENSORFLOW_LITE_MICRO_KERNELS_DEPTHWISE_CONV_H_
@@ -0,0 +1,190 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_MEMORY_PLANNER_SEARCH_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_MICRO_MEMORY_PLANNER_SEARCH_MEMORY_PLANNER_H_
+
+#include <stdint.h>
+
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
+#include "tensorflow/lite/micro/memory_planner/memory_planner.h"
+
+namespace tflite {
+
+// A memory planner that searches for a smaller arena than the
+// GreedyMemoryPlanner finds, at the cost of more planning time.
+//
+// The algorithm works like this:
+//  - Offline planned buffers keep their offsets and are placed first.
+//  - The other buffers are laid out in several orders: by size, by lifetime,
+//    by area (size times lifetime), by the bytes of the buffers they share
+//    time with, and by first use. Each order is laid out twice, placing
+//    every buffer at the lowest offset it fits (as the greedy planner does)
+//    and in the tightest gap it fits, and the smallest layout is kept.
+//  - A branch and bound search then revisits the placements of the order
+//    that gave the smallest layout: every buffer may go at offset 0 or at the
+//    end of any buffer placed before it that it shares time with, lowest
+//    first, and a branch is dropped as soon as it reaches the size of the
+//    best layout found so far.
+//  - The search stops when it has placed search_steps buffers, or when the
+//    layout needs no more than the bytes alive at the busiest time, which no
+//    layout can beat.
+//
+// Planning takes O(N^2) per buffer placement, so for N buffers the
+// heuristic layouts cost O(N^3) and the search O(search_steps * N^2).
+class SearchMemoryPlanner : public MemoryPlanner {
+public:
+    // Buffer placements the branch and bound search tries by default.
+    static constexpr int kDefaultSearchSteps = 4096;
+
+    // The scratch buffer works as for the GreedyMemoryPlanner: it must outlive
+    // the planner, and bounds the number of buffers to about
+    // scratch_buffer_size / per_buffer_size(). A search_steps of 0 keeps the
+    // best heuristic layout.
+    SearchMemoryPlanner(unsigned char *scratch_buffer, int scratch_buffer_size,
+                        int search_steps = kDefaultSearchSteps);
+    ~SearchMemoryPlanner() override;
+
+    // Record details of a buffer we want to place.
+    TfLiteStatus AddBuffer(ErrorReporter *error_reporter, int size,
+                           int first_time_used, int last_time_used) override;
+
+    // Record details of an offline planned buffer offset we want to place.
+    // offline_offset is the buffer offset from the start of the arena.
+    TfLiteStatus AddBuffer(ErrorReporter *error_reporter, int size,
+                           int first_time_used, int last_time_used,
+                           int offline_offset);
+
+    // Returns the high-water mark of used memory. This is the minimum size of a
+    // memory arena you'd need to allocate to hold these buffers.
+    size_t GetMaximumMemorySize() override;
+
+    // How many buffers have been recorded.
+    int GetBufferCount() override;
+
+    // Where a given buffer should be placed in the memory arena.
+    TfLiteStatus GetOffsetForBuffer(ErrorReporter *error_reporter,
+                                    int buffer_index, int *offset) override;
+
+    // Most bytes of buffers alive at the same time: no plan needs less.
+    size_t GetLowerBound();
+
+    // Buffer placements the last plan's branch and bound search made.
+    int search_steps_used();
+
+    // Debug method to check whether any buffer allocations are overlapping. This
+    // is an O(N^2) complexity operation, so only use for testing.
+    bool DoAnyBuffersOverlap(ErrorReporter *error_reporter);
+
+    // Number of bytes required in order to plan a buffer.
+    static size_t per_buffer_size()
+    {
+        const int per_buffer_size =
+            sizeof(BufferRequirements) + // requirements_
+            sizeof(int) +                // offsets_
+            sizeof(int) +                // best_offsets_
+            sizeof(int) +                // order_
+            sizeof(int) +                // shared_bytes_
+            sizeof(int) +                // tried_
+            sizeof(int);                 // peaks_
+        return per_buffer_size;
+    }
+
+private:
+    // Orders of the online planned buffers laid out before the search.
+    enum Order {
+        kBySize,
+        kByLifetime,
+        kByArea,
+        kBySharedBytes,
+        kByFirstUse,
+        kOrderCount,
+    };
+
+    // Whether two buffers are active at the same time.
+    bool OverlapInTime(int a, int b) const;
+
+    // Key buffers are sorted on, in descending order, for an Order.
+    int64_t OrderKey(Order order, int buffer) const;
+
+    // Sorts the online planned buffers of order_ for an Order.
+    void SortOrder(Order order);
+
+    // Lowest offset above after at which buffer fits next to the first
+    // placed buffers of order_, or -1 if none below limit does.
+    int NextFit(int buffer, int placed, int after, int limit) const;
+
+    // Offset of the tightest gap buffer fits in next to the first placed
+    // buffers of order_, or of the top of them if it fits in no gap.
+    int BestFit(int buffer, int placed) const;
+
+    // Places the online planned buffers in the order of order_ and returns
+    // the size of the layout.
+    int LayOut(bool best_fit);
+
+    // Branch and bound search below best_size_, in the order of order_.
+    void Search();
+
+    // If there isn't an up to date plan, calculate a new one.
+    void CalculateOffsetsIfNeeded();
+
+    // How many buffers we can plan for, based on the arena size we're given in
+    // the constructor.
+    int max_buffer_count_;
+
+    // The number of buffers added so far.
+    int buffer_count_;
+
+    // Offline planned buffers, first in order_.
+    int offline_count_;
+
+    int search_steps_;
+    int search_steps_used_;
+
+    // Size of the best layout found and the lower bound of the search.
+    int best_size_;
+    int lower_bound_;
+
+    // Records the client-provided information about each buffer.
+    struct BufferRequirements {
+        int size;
+        int offline_offset;
+        int first_time_used;
+        int last_time_used;
+    };
+
+    // Working arrays used during the layout algorithm.
+    BufferRequirements *requirements_;
+    // Offsets of the layout being built and of the best layout found.
+    int *offsets_;
+    int *best_offsets_;
+    // Buffer ids in placement order: offline planned buffers, then online
+    // planned buffers.
+    int *order_;
+    // Sum of the sizes of the other buffers alive at the same time.
+    int *shared_bytes_;
+    // Per search depth: last offset tried and layout size so far.
+    int *tried_;
+    int *peaks_;
+
+    // Whether buffers have been added since the last plan was calculated.
+    bool need_to_calculate_offsets_;
+
+    TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_MICRO_MEMORY_PLANNER_SEARCH_MEMORY_PLANNER_H_
@@ -23,10 +23,35 @@ limitations under the License.
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/flatbuffer_conversions.h"
 #include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/offline_memory_plan.h"
+#include "tensorflow/lite/micro/patch_plan.h"
 #include "tensorflow/lite/micro/simple_memory_allocator.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 
 namespace tflite {
+
+// Memory planners CommitStaticMemoryPlan() can lay out the head with, see
+// MicroAllocator::SetMemoryPlanner().
+enum class MemoryPlannerType {
+    // GreedyMemoryPlanner, the default: one layout, planned quickly.
+    kGreedy,
+    // SearchMemoryPlanner: tries several layouts and a bounded search for a
+    // smaller head, planning takes longer.
+    kSearch,
+};
+
+// What MicroAllocator::SetSlowMemoryRegion() moves out of the arena. The
+// head, with the activations and scratch buffers, and variable tensors
+// always stay in the arena.
+enum class SlowMemoryPolicy {
+    // The metadata of the allocator: eval tensors, nodes and registrations,
+    // builtin data, quantization, scratch buffer handles and the patch plan.
+    kMetadata,
+    // The metadata and the persistent buffers of the kernels: op data,
+    // folded biases and repacked filters.
+    kMetadataAndKernelData,
+};
+
 namespace internal {
 // Sets up all of the data structure members for a TfLiteTensor based on the
 // contents of a serialized tensor in the flatbuffer.
@@ -194,6 +219,68 @@ public:
     // `FinishModelAllocation`. Otherwise, it will return 0.
     size_t used_bytes() const;
 
+    // Runs the model on batch_size images at once. Every activation tensor
+    // whose leading dimension is 1 in the flatbuffer gets batch_size
+    // instead, so the memory plan, the kernels and the input and output
+    // tensors all see the batched shapes; weights are left as they are.
+    // Must be called before StartModelAllocation().
+    TfLiteStatus SetBatchSize(int batch_size);
+    int batch_size() const
+    {
+        return batch_size_;
+    }
+
+    // Runs the first num_ops operators of subgraph 0 in patches of
+    // patch_rows output rows instead of layer by layer (see PatchPlan): the
+    // tensors between those operators are planned for one band each, which
+    // lowers the peak of the memory plan when they are the largest ones.
+    // Not available with a batch size above 1; an offline memory plan of the
+    // model is ignored. Must be called before StartModelAllocation().
+    TfLiteStatus SetPatchExecution(int num_ops, int patch_rows);
+
+    // The plan of SetPatchExecution() once the model is allocated, nullptr
+    // if the model runs layer by layer.
+    const PatchPlan *patch_plan() const
+    {
+        return patch_plan_;
+    }
+
+    // Selects the planner of the memory plan of the head. Must be called
+    // before StartModelAllocation().
+    TfLiteStatus SetMemoryPlanner(MemoryPlannerType planner_type);
+    MemoryPlannerType memory_planner() const
+    {
+        return planner_type_;
+    }
+
+    // Records the memory plan of subgraph 0 into record when it is committed,
+    // so that tools can embed it in the model as a complete offline plan (see
+    // offline_memory_plan.h). record must outlive the model allocation. Must
+    // be called before StartModelAllocation().
+    TfLiteStatus SetMemoryPlanRecord(MemoryPlanRecord *record);
+
+    // True once subgraph 0 was placed by the complete offline memory plan of
+    // the model, without lifetime analysis or planning. Models that carry one
+    // still plan online with a batch size above 1 or patch execution, which
+    // change the buffers, or if the kernels requested scratch buffers the
+    // plan has no room for.
+    bool offline_memory_plan_used() const
+    {
+        return offline_memory_plan_used_;
+    }
+
+    // Allocates the persistent data of the model that policy selects from
+    // the size bytes at buffer instead of the tail of the arena, which then
+    // only needs to hold the buffers the kernels access the most. With the
+    // arena in on-chip RAM, buffer can be in slower external RAM. Must be
+    // called before StartModelAllocation().
+    TfLiteStatus SetSlowMemoryRegion(uint8_t *buffer, size_t size,
+                                     SlowMemoryPolicy policy);
+
+    // Bytes allocated from the region of SetSlowMemoryRegion(), 0 without
+    // one. Not part of used_bytes().
+    size_t slow_region_used_bytes() const;
+
     // Converts a flatbuffer int32_t array to a TfLiteIntArray, accounting for
     // endiannes.
     TfLiteStatus FlatBufferVectorToTfLiteTypeArray(
@@ -250,6 +337,17 @@ private:
         const Model *model, TfLiteEvalTensor *eval_tensors,
         ScratchBufferHandle *scratch_buffer_handles, int subgraph_idx);
 
+    // Places every buffer of subgraph 0 at the offsets of a complete offline
+    // memory plan. Returns false, without placing anything, if the plan does
+    // not hold the tensors and the requested scratch buffers or does not fit
+    // in the arena.
+    bool CommitOfflineMemoryPlan(const OfflineMemoryPlan &plan, const SubGraph *subgraph,
+                                 TfLiteEvalTensor *eval_tensors,
+                                 ScratchBufferHandle *scratch_buffer_handles);
+
+    // Grows the head to hold a memory plan of head_usage bytes.
+    TfLiteStatus CommitHeadUsage(size_t head_usage);
+
     // Allocates an array of ScratchBufferHandle structs in the tail section for a
     // given number of handles.
     virtual TfLiteStatus AllocateScratchBufferHandles(
@@ -273,6 +371,25 @@ private:
     ErrorReporter *error_reporter_;
     bool model_is_allocating_;
 
+    // Leading dimension of the activation tensors, see SetBatchSize().
+    int batch_size_ = 1;
+
+    // Patch execution requested by SetPatchExecution(), 0 ops if off, and
+    // its plan, allocated from the tail when the memory plan is made.
+    int patch_ops_ = 0;
+    int patch_rows_ = 0;
+    PatchPlan *patch_plan_ = nullptr;
+
+    // Planner of CommitStaticMemoryPlan(), see SetMemoryPlanner().
+    MemoryPlannerType planner_type_ = MemoryPlannerType::kGreedy;
+
+    // Region of AllocatePersistentBuffer(), see SetSlowMemoryRegion().
+    MemoryRegion kernel_data_region_ = MemoryRegion::kFast;
+
+    // See SetMemoryPlanRecord() and offline_memory_plan_used().
+    MemoryPlanRecord *plan_record_ = nullptr;
+    bool offline_memory_plan_used_ = false;
+
     // Holds the number of ScratchBufferRequest instances stored in the head
     // section when a model is allocating.
     size_t scratch_buffer_request_count_ = 0;
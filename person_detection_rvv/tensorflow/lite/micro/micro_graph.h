@@ -87,6 +87,9 @@ public:
     }
 
 private:
+    // Runs the operator chain of a patch plan on subgraph 0, band by band.
+    TfLiteStatus InvokePatches(const PatchPlan &plan);
+
     TfLiteContext *context_;
     const Model *model_;
     MicroAllocator *allocator_;
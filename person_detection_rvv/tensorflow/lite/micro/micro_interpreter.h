@@ -63,12 +63,61 @@ public:
     // intermediate tensors.
     TfLiteStatus AllocateTensors();
 
+    // Makes every Invoke() classify batch_size images: the input and output
+    // tensors and all activations get batch_size as their leading dimension
+    // and the memory plan is made for the batched shapes, so the arena must
+    // be large enough for them. Must be called before AllocateTensors().
+    TfLiteStatus SetBatchSize(int batch_size);
+
+    // Runs the first num_ops operators, a chain of conv and depthwise conv
+    // layers, in patches of patch_rows rows of the chain output with their
+    // halos recomputed, so the full size tensors between those layers are
+    // never allocated and the arena can be smaller. Results are the same as
+    // layer by layer. 0 ops turns it off. Must be called before
+    // AllocateTensors().
+    TfLiteStatus SetPatchExecution(int num_ops, int patch_rows);
+
+    // Plans the arena with planner_type instead of the greedy planner; the
+    // search planner can find a smaller arena but AllocateTensors() takes
+    // longer. Must be called before AllocateTensors().
+    TfLiteStatus SetMemoryPlanner(MemoryPlannerType planner_type);
+
+    // Records the memory plan of the model into record when AllocateTensors()
+    // commits it, see MicroAllocator::SetMemoryPlanRecord(). Must be called
+    // before AllocateTensors().
+    TfLiteStatus SetMemoryPlanRecord(MemoryPlanRecord *record);
+
+    // Keeps the persistent data policy selects in the size bytes at buffer
+    // instead of the arena, see MicroAllocator::SetSlowMemoryRegion(). Must
+    // be called before AllocateTensors().
+    TfLiteStatus SetSlowMemoryRegion(uint8_t *buffer, size_t size,
+                                     SlowMemoryPolicy policy);
+
+    // Bytes AllocateTensors() placed in the region of SetSlowMemoryRegion().
+    size_t slow_region_used_bytes() const
+    {
+        return allocator_.slow_region_used_bytes();
+    }
+
+    // True if AllocateTensors() placed the buffers by the complete offline
+    // memory plan of the model instead of planning them.
+    bool offline_memory_plan_used() const
+    {
+        return allocator_.offline_memory_plan_used();
+    }
+
     // In order to support partial graph runs for strided models, this can return
     // values other than kTfLiteOk and kTfLiteError.
     // TODO(b/149795762): Add this to the TfLiteStatus enum.
     TfLiteStatus Invoke();
 
     TfLiteTensor *input(size_t index);
+    // Points input `index` at `data` for the following Invoke() calls, so
+    // several caller-owned buffers can take turns as the model input without
+    // copying. `data` must hold the tensor's bytes and stay valid while it is
+    // bound; passing the original input(index)->data.raw binds the arena
+    // buffer again. Must be called after AllocateTensors().
+    TfLiteStatus SetInputBuffer(size_t index, void *data);
     size_t inputs_size() const
     {
         return model_->subgraphs()->Get(0)->inputs()->size();
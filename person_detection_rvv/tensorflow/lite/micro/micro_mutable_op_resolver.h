@@ -212,10 +212,11 @@ public:
                           tflite::Register_DEPTH_TO_SPACE(), ParseDepthToSpace);
     }
 
-    TfLiteStatus AddDepthwiseConv2D()
+    TfLiteStatus AddDepthwiseConv2D(
+        const TfLiteRegistration &registration = Register_DEPTHWISE_CONV_2D())
     {
-        return AddBuiltin(BuiltinOperator_DEPTHWISE_CONV_2D,
-                          Register_DEPTHWISE_CONV_2D(), ParseDepthwiseConv2D);
+        return AddBuiltin(BuiltinOperator_DEPTHWISE_CONV_2D, registration,
+                          ParseDepthwiseConv2D);
     }
 
     TfLiteStatus AddDequantize()
@@ -20,6 +20,13 @@ limitations under the License.
 
 #include "tensorflow/lite/micro/compatibility.h"
 
+// Profiling is compiled in unless error strings are stripped. Release builds
+// that strip them can keep the per-op profiling hooks with
+// -DTF_LITE_MICRO_ENABLE_PROFILER.
+#if !defined(TF_LITE_STRIP_ERROR_STRINGS) || defined(TF_LITE_MICRO_ENABLE_PROFILER)
+#define TF_LITE_MICRO_PROFILER_ENABLED
+#endif
+
 namespace tflite {
 // MicroProfiler creates a common way to gain fine-grained insight into runtime
 // performance. Bottleck operators can be identified along with slow code
@@ -72,7 +79,7 @@ private:
     TF_LITE_REMOVE_VIRTUAL_DELETE;
 };
 
-#if defined(TF_LITE_STRIP_ERROR_STRINGS)
+#if !defined(TF_LITE_MICRO_PROFILER_ENABLED)
 // For release builds, the ScopedMicroProfiler is a noop.
 //
 // This is done because the ScipedProfiler is used as part of the
@@ -117,7 +124,7 @@ private:
     uint32_t event_handle_ = 0;
     MicroProfiler *profiler_ = nullptr;
 };
-#endif // !defined(NDEBUG)
+#endif // !defined(TF_LITE_MICRO_PROFILER_ENABLED)
 
 } // namespace tflite
 
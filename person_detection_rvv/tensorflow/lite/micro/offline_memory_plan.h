@@ -0,0 +1,83 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_OFFLINE_MEMORY_PLAN_H_
+#define TENSORFLOW_LITE_MICRO_OFFLINE_MEMORY_PLAN_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+
+// Layout of the "OfflineMemoryAllocation" metadata buffer of a model, in
+// 32 bit words. TFLite Micro reads
+//   [version 1, subgraph 0, tensor count N, N tensor offsets]
+// where a tensor offset is the place of the tensor in the arena head, or -1
+// to plan it online. A complete plan continues with
+//   [kOfflineMemoryPlanMagic, head bytes, scratch buffer count M,
+//    M pairs of scratch buffer offset and bytes]
+// which also places the scratch buffers the kernels request, in request
+// order. With it MicroAllocator places every buffer without computing
+// lifetimes or running a planner. Readers that only know the first part
+// ignore the rest.
+constexpr char kOfflineMemoryPlanMetadata[] = "OfflineMemoryAllocation";
+constexpr uint32_t kOfflineMemoryPlanVersion = 1;
+constexpr uint32_t kOfflineMemoryPlanMagic = 0x50444d50; // "PMDP"
+
+// Words of the metadata buffer of a complete plan.
+inline size_t OfflineMemoryPlanWords(int tensor_count, int scratch_count)
+{
+    return 3 + tensor_count + 3 + 2 * scratch_count;
+}
+
+// The offline memory plan of subgraph 0, pointing into the model.
+struct OfflineMemoryPlan {
+    int tensor_count;
+    const int32_t *tensor_offsets;
+    // Set if the plan also places the scratch buffers; the fields below are
+    // only valid then.
+    bool complete;
+    int head_bytes;
+    int scratch_count;
+    // Offset and bytes of every scratch buffer.
+    const int32_t *scratch_buffers;
+};
+
+// Finds the offline memory plan in the metadata of model. Returns false if
+// the model has none or it is not a version 1 plan of subgraph 0 with an
+// offset for every tensor.
+bool GetOfflineMemoryPlan(const Model *model, OfflineMemoryPlan *plan);
+
+// Caller-owned storage the MicroAllocator records the memory plan of
+// subgraph 0 into when it commits it, for tools that embed the plan in the
+// model (see MicroAllocator::SetMemoryPlanRecord()).
+struct MemoryPlanRecord {
+    // One offset per tensor, -1 for the tensors outside the head.
+    int32_t *tensor_offsets;
+    int tensor_capacity;
+    // Offset and bytes of every scratch buffer.
+    int32_t *scratch_buffers;
+    int scratch_capacity;
+
+    // Filled in by the allocator.
+    int tensor_count;
+    int scratch_count;
+    int head_bytes;
+};
+
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_MICRO_OFFLINE_MEMORY_PLAN_H_
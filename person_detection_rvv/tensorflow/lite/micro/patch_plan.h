@@ -0,0 +1,116 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_PATCH_PLAN_H_
+#define TENSORFLOW_LITE_MICRO_PATCH_PLAN_H_
+
+#include <cstddef>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+
+// Row geometry of patch (depth-first) execution: the first num_ops operators
+// of subgraph 0, a chain of CONV_2D and DEPTHWISE_CONV_2D ops that each feed
+// the next one, run band by band instead of layer by layer. A patch is
+// patch_rows rows of the output of the last op of the chain; every op of the
+// chain computes only the rows the next op needs for them, halo rows
+// included, so the tensors between the ops only ever hold one band and the
+// memory planner sizes them for the largest band. Rows of the halo are
+// computed again by the next patch.
+//
+// The chain input is read and the chain output written in place, so both
+// stay allocated for the whole chain. The kernels of the chain run on views
+// of their tensors, which works for the conv and depthwise kernels because
+// they clip taps to the input they are given and take the top padding from
+// OpDataConv, which the graph adjusts per band.
+class PatchPlan {
+public:
+    static constexpr int kMaxOps = 8;
+
+    PatchPlan() = default;
+
+    // Checks that the first num_ops operators of the model form a chain that
+    // can run in patches and computes the band sizes. The eval tensors must
+    // have their final shapes.
+    TfLiteStatus Init(const Model *model, const TfLiteEvalTensor *eval_tensors,
+                      int num_ops, int patch_rows, ErrorReporter *error_reporter);
+
+    int num_ops() const
+    {
+        return num_ops_;
+    }
+    int patch_rows() const
+    {
+        return patch_rows_;
+    }
+    int num_patches() const
+    {
+        return num_patches_;
+    }
+
+    // Tensor at a level of the chain: level 0 is the input of op 0 and level
+    // op + 1 the output of op.
+    int tensor(int level) const
+    {
+        return levels_[level].tensor;
+    }
+    size_t row_bytes(int level) const
+    {
+        return levels_[level].row_bytes;
+    }
+
+    // Bytes the memory planner reserves for the tensor of a level: one band
+    // between the ops, the full tensor at both ends of the chain.
+    size_t BufferBytes(int level) const;
+
+    // Stores the rows [rows[level][0], rows[level][1]) of every level of the
+    // chain that patch reads or computes.
+    void Rows(int patch, int rows[kMaxOps + 1][2]) const;
+
+    // Top padding of op for a band of its output starting at output_row and
+    // read from a band of its input starting at input_row.
+    int PadTop(int op, int input_row, int output_row) const
+    {
+        return ops_[op].pad_top + input_row - output_row * ops_[op].stride;
+    }
+
+private:
+    struct Op {
+        int stride;
+        // Rows one output row reads: (filter_height - 1) * dilation + 1.
+        int extent;
+        int pad_top;
+    };
+
+    struct Level {
+        int tensor;
+        int height;
+        size_t row_bytes;
+        // Most rows any patch needs of this level.
+        int max_rows;
+    };
+
+    Op ops_[kMaxOps] = {};
+    Level levels_[kMaxOps + 1] = {};
+    int num_ops_ = 0;
+    int patch_rows_ = 0;
+    int num_patches_ = 0;
+};
+
+} // namespace tflite
+
+#endif // TENSORFLOW_LITE_MICRO_PATCH_PLAN_H_
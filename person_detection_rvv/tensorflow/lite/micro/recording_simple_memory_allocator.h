@@ -47,7 +47,9 @@ public:
     size_t GetAllocatedCount() const;
 
     TfLiteStatus SetHeadBufferSize(size_t size, size_t alignment) override;
-    uint8_t *AllocateFromTail(size_t size, size_t alignment) override;
+    using SimpleMemoryAllocator::AllocateFromTail;
+    uint8_t *AllocateFromTail(size_t size, size_t alignment,
+                              MemoryRegion region) override;
 
 private:
     size_t requested_head_bytes_;
@@ -24,6 +24,16 @@ limitations under the License.
 #include "tensorflow/lite/micro/compatibility.h"
 
 namespace tflite {
+
+// Where a persistent allocation goes when the allocator has a slow region
+// besides the arena, see SimpleMemoryAllocator::SetSlowRegion().
+enum class MemoryRegion {
+    // The tail of the arena, next to the activations in the head.
+    kFast,
+    // The slow region, or the tail of the arena if there is none.
+    kSlow,
+};
+
 // TODO(petewarden): This allocator never frees up or reuses  any memory, even
 // though we have enough information about lifetimes of the tensors to do so.
 // This makes it pretty wasteful, so we should use a more intelligent method.
@@ -50,9 +60,23 @@ public:
     // ResetTempAllocations().
     virtual TfLiteStatus SetHeadBufferSize(size_t size, size_t alignment);
 
-    // Allocates memory starting at the tail of the arena (highest address and
-    // moving downwards).
-    virtual uint8_t *AllocateFromTail(size_t size, size_t alignment);
+    // Adds a second region of size bytes at buffer for persistent data, for
+    // example external RAM next to an arena in on-chip RAM. The head and the
+    // temporary allocations stay in the arena. Fails if the allocator already
+    // has a slow region.
+    TfLiteStatus SetSlowRegion(uint8_t *buffer, size_t size);
+
+    // Allocates persistent memory: from the slow region if there is one,
+    // else from the tail of the arena (highest address and moving downwards).
+    uint8_t *AllocateFromTail(size_t size, size_t alignment)
+    {
+        return AllocateFromTail(size, alignment, MemoryRegion::kSlow);
+    }
+
+    // Allocates persistent memory from region; the slow region, like the
+    // tail, is allocated from its highest address downwards.
+    virtual uint8_t *AllocateFromTail(size_t size, size_t alignment,
+                                      MemoryRegion region);
 
     // Allocates a temporary buffer from the head of the arena (lowest address and
     // moving upwards) but does not update the actual head allocation size or
@@ -78,12 +102,16 @@ public:
     // Returns the size of all allocations in the tail section in bytes.
     size_t GetTailUsedBytes() const;
 
+    // Returns the size of all allocations in the slow region in bytes, 0
+    // without one.
+    size_t GetSlowUsedBytes() const;
+
     // Returns the number of bytes available with a given alignment. This number
     // takes in account any temporary allocations.
     size_t GetAvailableMemory(size_t alignment) const;
 
     // Returns the number of used bytes in the allocator. This number takes in
-    // account any temporary allocations.
+    // account any temporary allocations. The slow region is not included.
     size_t GetUsedBytes() const;
 
 protected:
@@ -93,6 +121,10 @@ protected:
     // Returns a pointer to the current end of the tail buffer.
     uint8_t *tail() const;
 
+    // Returns a pointer to the current end of the slow region, nullptr
+    // without one.
+    uint8_t *slow_tail() const;
+
 private:
     size_t GetBufferSize() const;
 
@@ -102,6 +134,10 @@ private:
     uint8_t *head_;
     uint8_t *tail_;
     uint8_t *temp_;
+    // The slow region of SetSlowRegion(), all nullptr without one.
+    uint8_t *slow_head_ = nullptr;
+    uint8_t *slow_buffer_tail_ = nullptr;
+    uint8_t *slow_tail_ = nullptr;
 
     TF_LITE_REMOVE_VIRTUAL_DELETE
 };
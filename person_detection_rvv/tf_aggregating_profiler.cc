@@ -0,0 +1,330 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/aggregating_profiler.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "tensorflow/lite/micro/debug_log.h"
+#include "tensorflow/lite/micro/micro_string.h"
+#include "tensorflow/lite/micro/micro_time.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+
+namespace tflite {
+namespace {
+
+constexpr uint32_t kInvalidHandle = AggregatingProfiler::kMaxNodes;
+
+// Product of the dimensions of a tensor, 0 if its shape is unknown.
+int64_t FlatSize(const flatbuffers::Vector<flatbuffers::Offset<Tensor>> *tensors,
+                 int32_t index)
+{
+    if (index < 0 || tensors == nullptr || static_cast<uint32_t>(index) >= tensors->size()) {
+        return 0;
+    }
+    const flatbuffers::Vector<int32_t> *shape = tensors->Get(index)->shape();
+    if (shape == nullptr) {
+        return 0;
+    }
+    int64_t size = 1;
+    for (uint32_t i = 0; i < shape->size(); ++i) {
+        size *= shape->Get(i);
+    }
+    return size;
+}
+
+int32_t Dim(const flatbuffers::Vector<flatbuffers::Offset<Tensor>> *tensors,
+            int32_t index, int dim)
+{
+    const flatbuffers::Vector<int32_t> *shape = tensors->Get(index)->shape();
+    return (shape != nullptr && static_cast<uint32_t>(dim) < shape->size()) ? shape->Get(dim) : 0;
+}
+
+// Multiply-accumulates of one operator: output elements times the filter
+// taps that feed each of them.
+int64_t OperatorMacs(BuiltinOperator op, const Operator *op_data,
+                     const flatbuffers::Vector<flatbuffers::Offset<Tensor>> *tensors)
+{
+    const flatbuffers::Vector<int32_t> *inputs = op_data->inputs();
+    const flatbuffers::Vector<int32_t> *outputs = op_data->outputs();
+    if (inputs == nullptr || outputs == nullptr || inputs->size() < 2 || outputs->size() < 1) {
+        return 0;
+    }
+    const int32_t filter = inputs->Get(1);
+    const int64_t output_size = FlatSize(tensors, outputs->Get(0));
+    if (filter < 0) {
+        return 0;
+    }
+    switch (op) {
+        case BuiltinOperator_CONV_2D:
+            // OHWI filter: every output sees H * W * I inputs.
+            return output_size * Dim(tensors, filter, 1) * Dim(tensors, filter, 2) *
+                   Dim(tensors, filter, 3);
+        case BuiltinOperator_DEPTHWISE_CONV_2D:
+            // 1HWC filter: every output sees H * W inputs.
+            return output_size * Dim(tensors, filter, 1) * Dim(tensors, filter, 2);
+        case BuiltinOperator_FULLY_CONNECTED: {
+            const flatbuffers::Vector<int32_t> *shape = tensors->Get(filter)->shape();
+            return (shape != nullptr && shape->size() > 0)
+                       ? output_size * shape->Get(shape->size() - 1)
+                       : 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Builds one line of text with left or right aligned fields, since
+// MicroSnprintf has no field widths.
+class LineBuilder {
+public:
+    LineBuilder()
+    {
+        line_[0] = '\0';
+    }
+
+    void Field(const char *text, int width, bool right_align = true)
+    {
+        const int len = static_cast<int>(strlen(text));
+        if (right_align) {
+            Pad(width - len);
+        }
+        Append(text);
+        if (!right_align) {
+            Pad(width - len);
+        }
+    }
+
+    void Int(int32_t value, int width)
+    {
+        char text[16];
+        MicroSnprintf(text, sizeof(text), "%d", value);
+        Field(text, width);
+    }
+
+    // value / 100 with two decimals.
+    void Fixed2(int64_t hundredths, int width)
+    {
+        char text[24];
+        MicroSnprintf(text, sizeof(text), "%d.%d%d", static_cast<int32_t>(hundredths / 100),
+                      static_cast<int32_t>((hundredths / 10) % 10),
+                      static_cast<int32_t>(hundredths % 10));
+        Field(text, width);
+    }
+
+    void Append(const char *text)
+    {
+        while (*text != '\0' && length_ < kMaxLength - 2) {
+            line_[length_++] = *text++;
+        }
+        line_[length_] = '\0';
+    }
+
+    void Flush()
+    {
+        line_[length_++] = '\n';
+        line_[length_] = '\0';
+        DebugLog(line_);
+        length_ = 0;
+        line_[0] = '\0';
+    }
+
+private:
+    void Pad(int count)
+    {
+        for (; count > 0 && length_ < kMaxLength - 2; --count) {
+            line_[length_++] = ' ';
+        }
+        line_[length_] = '\0';
+    }
+
+    static constexpr int kMaxLength = 128;
+    char line_[kMaxLength];
+    int length_ = 0;
+};
+
+// MACs per tick in hundredths.
+int64_t MacsPerTick100(int64_t macs, int64_t ticks)
+{
+    return ticks > 0 ? (macs * 100) / ticks : 0;
+}
+
+} // namespace
+
+void AggregatingProfiler::Init(const Model *model)
+{
+    num_nodes_ = 0;
+    const SubGraph *subgraph = model->subgraphs()->Get(0);
+    const flatbuffers::Vector<flatbuffers::Offset<Operator>> *operators = subgraph->operators();
+    const int count = (operators != nullptr) ? static_cast<int>(operators->size()) : 0;
+    for (int i = 0; i < count && i < kMaxNodes; ++i) {
+        const Operator *op_data = operators->Get(i);
+        const BuiltinOperator op =
+            GetBuiltinCode(model->operator_codes()->Get(op_data->opcode_index()));
+        nodes_[i].op = op;
+        nodes_[i].tag = EnumNameBuiltinOperator(op);
+        nodes_[i].macs = OperatorMacs(op, op_data, subgraph->tensors());
+        ++num_nodes_;
+    }
+    Reset();
+}
+
+void AggregatingProfiler::Reset()
+{
+    for (int i = 0; i < num_nodes_; ++i) {
+        nodes_[i].count = 0;
+        nodes_[i].total_ticks = 0;
+        nodes_[i].min_ticks = INT32_MAX;
+        nodes_[i].max_ticks = 0;
+    }
+    next_node_ = 0;
+    num_invokes_ = 0;
+}
+
+uint32_t AggregatingProfiler::BeginEvent(const char *tag)
+{
+    if (num_nodes_ == 0) {
+        return kInvalidHandle;
+    }
+    const int node = next_node_;
+    next_node_ = (next_node_ + 1 == num_nodes_) ? 0 : next_node_ + 1;
+    nodes_[node].tag = tag;
+    start_ticks_[node] = GetCurrentTimeTicks();
+    return node;
+}
+
+void AggregatingProfiler::EndEvent(uint32_t event_handle)
+{
+    if (event_handle >= static_cast<uint32_t>(num_nodes_)) {
+        return;
+    }
+    const int32_t ticks = GetCurrentTimeTicks() - start_ticks_[event_handle];
+    NodeStats &stats = nodes_[event_handle];
+    ++stats.count;
+    stats.total_ticks += ticks;
+    stats.min_ticks = (ticks < stats.min_ticks) ? ticks : stats.min_ticks;
+    stats.max_ticks = (ticks > stats.max_ticks) ? ticks : stats.max_ticks;
+    if (static_cast<int>(event_handle) == num_nodes_ - 1) {
+        ++num_invokes_;
+    }
+}
+
+int32_t AggregatingProfiler::MeanTicks(int index) const
+{
+    const NodeStats &stats = nodes_[index];
+    return stats.count > 0 ? static_cast<int32_t>(stats.total_ticks / stats.count) : 0;
+}
+
+void AggregatingProfiler::LogTable() const
+{
+    LineBuilder line;
+    line.Append("invokes: ");
+    line.Int(num_invokes_, 0);
+    line.Append(", ticks per second: ");
+    line.Int(ticks_per_second(), 0);
+    line.Flush();
+
+    line.Field("node", 4);
+    line.Append(" ");
+    line.Field("op", 18, false);
+    line.Field("mean", 10);
+    line.Field("min", 10);
+    line.Field("max", 10);
+    line.Field("kMACs", 8);
+    line.Field("MAC/tick", 9);
+    line.Flush();
+
+    int64_t total_ticks = 0;
+    int64_t total_macs = 0;
+    for (int i = 0; i < num_nodes_; ++i) {
+        const NodeStats &stats = nodes_[i];
+        const int32_t mean = MeanTicks(i);
+        total_ticks += mean;
+        total_macs += stats.macs;
+        line.Int(i, 4);
+        line.Append(" ");
+        line.Field(stats.tag, 18, false);
+        line.Int(mean, 10);
+        line.Int(stats.count > 0 ? stats.min_ticks : 0, 10);
+        line.Int(stats.max_ticks, 10);
+        line.Int(static_cast<int32_t>(stats.macs / 1000), 8);
+        line.Fixed2(MacsPerTick100(stats.macs, mean), 9);
+        line.Flush();
+    }
+
+    // Per op type: sum of the node means, i.e. the share of one invoke.
+    line.Flush();
+    line.Field("op", 23, false);
+    line.Field("nodes", 6);
+    line.Field("ticks", 10);
+    line.Field("share%", 8);
+    line.Field("kMACs", 8);
+    line.Field("MAC/tick", 9);
+    line.Flush();
+    for (int i = 0; i < num_nodes_; ++i) {
+        bool seen = false;
+        for (int j = 0; j < i && !seen; ++j) {
+            seen = nodes_[j].op == nodes_[i].op;
+        }
+        if (seen) {
+            continue;
+        }
+        int32_t nodes = 0;
+        int64_t ticks = 0;
+        int64_t macs = 0;
+        for (int j = i; j < num_nodes_; ++j) {
+            if (nodes_[j].op == nodes_[i].op) {
+                ++nodes;
+                ticks += MeanTicks(j);
+                macs += nodes_[j].macs;
+            }
+        }
+        line.Field(nodes_[i].tag, 23, false);
+        line.Int(nodes, 6);
+        line.Int(static_cast<int32_t>(ticks), 10);
+        line.Fixed2(total_ticks > 0 ? (ticks * 10000) / total_ticks : 0, 8);
+        line.Int(static_cast<int32_t>(macs / 1000), 8);
+        line.Fixed2(MacsPerTick100(macs, ticks), 9);
+        line.Flush();
+    }
+    line.Field("total", 23, false);
+    line.Int(num_nodes_, 6);
+    line.Int(static_cast<int32_t>(total_ticks), 10);
+    line.Field("100.00", 8);
+    line.Int(static_cast<int32_t>(total_macs / 1000), 8);
+    line.Fixed2(MacsPerTick100(total_macs, total_ticks), 9);
+    line.Flush();
+}
+
+void AggregatingProfiler::LogCsv() const
+{
+    LineBuilder line;
+    line.Append("node,op,count,mean_ticks,min_ticks,max_ticks,macs,macs_per_tick_x100");
+    line.Flush();
+    for (int i = 0; i < num_nodes_; ++i) {
+        const NodeStats &stats = nodes_[i];
+        const int32_t mean = MeanTicks(i);
+        char text[112];
+        MicroSnprintf(text, sizeof(text), "%d,%s,%d,%d,%d,%d,%d,%d", i, stats.tag,
+                      stats.count, mean, stats.count > 0 ? stats.min_ticks : 0,
+                      stats.max_ticks, static_cast<int32_t>(stats.macs),
+                      static_cast<int32_t>(MacsPerTick100(stats.macs, mean)));
+        line.Append(text);
+        line.Flush();
+    }
+}
+
+} // namespace tflite
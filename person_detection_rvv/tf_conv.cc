@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/conv.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
 #include "tensorflow/lite/kernels/internal/reference/conv.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
@@ -35,7 +36,7 @@ void *Init(TfLiteContext *context, const char *buffer, size_t length)
     return context->AllocatePersistentBuffer(context, sizeof(OpDataConv));
 }
 
-TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+TfLiteStatus EvalImpl(TfLiteContext *context, TfLiteNode *node, bool use_reference)
 {
     const TfLiteEvalTensor *input =
         tflite::micro::GetEvalInput(context, node, kConvInputTensor);
@@ -87,6 +88,37 @@ TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
             break;
         }
         case kTfLiteInt8: {
+            if (!use_reference && data.pointwise) {
+                optimized_integer_ops::PointwiseConvPerChannel(
+                    ConvParamsQuantized(params, data), data.per_channel_output_multiplier,
+                    data.per_channel_output_shift, tflite::micro::GetTensorShape(input),
+                    tflite::micro::GetTensorData<int8_t>(input),
+                    tflite::micro::GetTensorShape(filter),
+                    tflite::micro::GetTensorData<int8_t>(filter),
+                    tflite::micro::GetTensorShape(bias), data.folded_bias,
+                    tflite::micro::GetTensorShape(output),
+                    tflite::micro::GetTensorData<int8_t>(output),
+                    data.packed_filter);
+                break;
+            }
+            if (!use_reference) {
+                int8_t *im2col_data =
+                    (data.im2col_scratch_index >= 0)
+                        ? static_cast<int8_t *>(context->GetScratchBuffer(
+                              context, data.im2col_scratch_index))
+                        : nullptr;
+                optimized_integer_ops::ConvPerChannel(
+                    ConvParamsQuantized(params, data), data.per_channel_output_multiplier,
+                    data.per_channel_output_shift, tflite::micro::GetTensorShape(input),
+                    tflite::micro::GetTensorData<int8_t>(input),
+                    tflite::micro::GetTensorShape(filter),
+                    tflite::micro::GetTensorData<int8_t>(filter),
+                    tflite::micro::GetTensorShape(bias), data.folded_bias,
+                    tflite::micro::GetTensorShape(output),
+                    tflite::micro::GetTensorData<int8_t>(output), im2col_data,
+                    data.packed_filter);
+                break;
+            }
             reference_integer_ops::ConvPerChannel(
                 ConvParamsQuantized(params, data), data.per_channel_output_multiplier,
                 data.per_channel_output_shift, tflite::micro::GetTensorShape(input),
@@ -107,6 +139,16 @@ TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
     return kTfLiteOk;
 }
 
+TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+{
+    return EvalImpl(context, node, /*use_reference=*/false);
+}
+
+TfLiteStatus EvalInt8Reference(TfLiteContext *context, TfLiteNode *node)
+{
+    return EvalImpl(context, node, /*use_reference=*/true);
+}
+
 } // namespace
 
 TfLiteRegistration Register_CONV_2D()
@@ -121,4 +163,16 @@ TfLiteRegistration Register_CONV_2D()
              /*version=*/0 };
 }
 
+TfLiteRegistration Register_CONV_2D_INT8REF()
+{
+    return { /*init=*/Init,
+             /*free=*/nullptr,
+             /*prepare=*/ConvPrepareInt8Reference,
+             /*invoke=*/EvalInt8Reference,
+             /*profiling_string=*/nullptr,
+             /*builtin_code=*/0,
+             /*custom_name=*/nullptr,
+             /*version=*/0 };
+}
+
 } // namespace tflite
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/conv.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
 #include "tensorflow/lite/kernels/internal/reference/conv.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
@@ -125,7 +126,9 @@ TfLiteStatus CalculateOpDataConv(TfLiteContext *context, TfLiteNode *node,
     return kTfLiteOk;
 }
 
-TfLiteStatus ConvPrepare(TfLiteContext *context, TfLiteNode *node)
+namespace {
+
+TfLiteStatus PrepareImpl(TfLiteContext *context, TfLiteNode *node, bool use_reference)
 {
     TFLITE_DCHECK(node->user_data != nullptr);
     TFLITE_DCHECK(node->builtin_data != nullptr);
@@ -180,6 +183,62 @@ TfLiteStatus ConvPrepare(TfLiteContext *context, TfLiteNode *node)
         context, node, params, input_width, input_height, filter_width,
         filter_height, output_width, output_height, input->type, data));
 
+    // Pointwise layers read the input in place, every other int8 layer packs
+    // tiles of input patches (im2col) for the GEMM kernel. The filter is
+    // constant, so its per-channel sums are folded into the bias once here.
+    // The reference kernel reads the weights and bias from the model and
+    // needs none of it.
+    data->im2col_scratch_index = -1;
+    data->pointwise = false;
+    data->folded_bias = nullptr;
+    data->border_bias_scratch_index = -1;
+    data->packed_filter = nullptr;
+    if (input->type == kTfLiteInt8 && !use_reference) {
+        const ConvParams op_params = ConvParamsQuantized(params, *data);
+        const TfLiteTensor *bias =
+            GetOptionalInputTensor(context, node, kConvBiasTensor);
+        data->folded_bias = static_cast<int32_t *>(
+            context->AllocatePersistentBuffer(context, num_channels * sizeof(int32_t)));
+        TF_LITE_ENSURE(context, data->folded_bias != nullptr);
+        optimized_integer_ops::ConvFoldInputOffset(
+            op_params.input_offset, GetTensorShape(filter),
+            GetTensorData<int8_t>(filter), GetTensorData<int32_t>(bias),
+            data->folded_bias);
+
+        data->pointwise = optimized_integer_ops::IsPointwiseConv(
+            op_params, GetTensorShape(filter));
+
+#if !defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+        // Repacking trades a copy of the weights in the arena for one
+        // contiguous filter stream per block of output channels.
+        data->packed_filter = static_cast<int8_t *>(context->AllocatePersistentBuffer(
+            context, optimized_integer_ops::ConvPackedFilterSize(GetTensorShape(filter))));
+        TF_LITE_ENSURE(context, data->packed_filter != nullptr);
+        optimized_integer_ops::ConvPackFilter(op_params, GetTensorShape(filter),
+                                              GetTensorData<int8_t>(filter),
+                                              data->packed_filter);
+#endif
+        const int im2col_size = optimized_integer_ops::ConvIm2colBufferSize(
+            op_params, GetTensorShape(filter));
+        if (!data->pointwise && im2col_size > 0) {
+            TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(
+                context, im2col_size, &data->im2col_scratch_index));
+        }
+    }
+
     return kTfLiteOk;
 }
+
+} // namespace
+
+TfLiteStatus ConvPrepare(TfLiteContext *context, TfLiteNode *node)
+{
+    return PrepareImpl(context, node, /*use_reference=*/false);
+}
+
+TfLiteStatus ConvPrepareInt8Reference(TfLiteContext *context, TfLiteNode *node)
+{
+    return PrepareImpl(context, node, /*use_reference=*/true);
+}
+
 } // namespace tflite
@@ -36,17 +36,19 @@ limitations under the License.
 
 #include "tensorflow/lite/micro/debug_log.h"
 
-#ifndef TF_LITE_STRIP_ERROR_STRINGS
-#include <cstdio>
+#if !defined(TF_LITE_STRIP_ERROR_STRINGS) || defined(TF_LITE_MICRO_ENABLE_PROFILER)
+#include "deferred_log.h"
 #endif
 
 extern "C" void DebugLog(const char *s)
 {
-#ifndef TF_LITE_STRIP_ERROR_STRINGS
+#if !defined(TF_LITE_STRIP_ERROR_STRINGS) || defined(TF_LITE_MICRO_ENABLE_PROFILER)
     // Reusing TF_LITE_STRIP_ERROR_STRINGS to disable DebugLog completely to get
     // maximum reduction in binary size. This is because we have DebugLog calls
     // via TF_LITE_CHECK that are not stubbed out by TF_LITE_REPORT_ERROR.
-    //fprintf(stderr, "%s", s);
-    printf("%s", s);
+    // Profiling builds keep it, the profiler reports are written through it.
+    // The string is copied into the deferred log, so the caller does not wait
+    // for the UART; the log task of main.c writes it out.
+    deferred_log_text(s);
 #endif
 }
@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/depthwise_conv.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
 #include "tensorflow/lite/kernels/internal/reference/depthwiseconv_float.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/depthwise_conv.h"
@@ -35,7 +36,7 @@ void *Init(TfLiteContext *context, const char *buffer, size_t length)
     return context->AllocatePersistentBuffer(context, sizeof(OpDataConv));
 }
 
-TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+TfLiteStatus EvalImpl(TfLiteContext *context, TfLiteNode *node, bool use_reference)
 {
     TFLITE_DCHECK(node->user_data != nullptr);
     TFLITE_DCHECK(node->builtin_data != nullptr);
@@ -68,17 +69,35 @@ TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
             break;
         }
         case kTfLiteInt8: {
-            reference_integer_ops::DepthwiseConvPerChannel(
+            // Layers with depth_multiplier != 1 have no folded bias and
+            // always run the reference kernel.
+            if (use_reference || data.folded_bias == nullptr) {
+                reference_integer_ops::DepthwiseConvPerChannel(
+                    DepthwiseConvParamsQuantized(params, data),
+                    data.per_channel_output_multiplier, data.per_channel_output_shift,
+                    tflite::micro::GetTensorShape(input),
+                    tflite::micro::GetTensorData<int8_t>(input),
+                    tflite::micro::GetTensorShape(filter),
+                    tflite::micro::GetTensorData<int8_t>(filter),
+                    tflite::micro::GetTensorShape(bias),
+                    tflite::micro::GetTensorData<int32_t>(bias),
+                    tflite::micro::GetTensorShape(output),
+                    tflite::micro::GetTensorData<int8_t>(output));
+                break;
+            }
+            optimized_integer_ops::DepthwiseConvPerChannel(
                 DepthwiseConvParamsQuantized(params, data),
                 data.per_channel_output_multiplier, data.per_channel_output_shift,
                 tflite::micro::GetTensorShape(input),
                 tflite::micro::GetTensorData<int8_t>(input),
                 tflite::micro::GetTensorShape(filter),
                 tflite::micro::GetTensorData<int8_t>(filter),
-                tflite::micro::GetTensorShape(bias),
-                tflite::micro::GetTensorData<int32_t>(bias),
+                tflite::micro::GetTensorShape(bias), data.folded_bias,
                 tflite::micro::GetTensorShape(output),
-                tflite::micro::GetTensorData<int8_t>(output));
+                tflite::micro::GetTensorData<int8_t>(output),
+                static_cast<int32_t *>(context->GetScratchBuffer(
+                    context, data.border_bias_scratch_index)),
+                data.packed_filter);
             break;
         }
         default:
@@ -89,6 +108,16 @@ TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
     return kTfLiteOk;
 }
 
+TfLiteStatus Eval(TfLiteContext *context, TfLiteNode *node)
+{
+    return EvalImpl(context, node, /*use_reference=*/false);
+}
+
+TfLiteStatus EvalInt8Reference(TfLiteContext *context, TfLiteNode *node)
+{
+    return EvalImpl(context, node, /*use_reference=*/true);
+}
+
 } // namespace
 
 TfLiteRegistration Register_DEPTHWISE_CONV_2D()
@@ -103,4 +132,16 @@ TfLiteRegistration Register_DEPTHWISE_CONV_2D()
              /*version=*/0 };
 }
 
+TfLiteRegistration Register_DEPTHWISE_CONV_2D_INT8REF()
+{
+    return { /*init=*/Init,
+             /*free=*/nullptr,
+             /*prepare=*/DepthwiseConvPrepareInt8Reference,
+             /*invoke=*/EvalInt8Reference,
+             /*profiling_string=*/nullptr,
+             /*builtin_code=*/0,
+             /*custom_name=*/nullptr,
+             /*version=*/0 };
+}
+
 } // namespace tflite
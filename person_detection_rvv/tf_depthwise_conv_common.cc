@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/depthwise_conv.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
 #include "tensorflow/lite/kernels/internal/reference/depthwiseconv_float.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/depthwise_conv.h"
@@ -126,7 +127,9 @@ TfLiteStatus CalculateOpDataDepthwiseConv(
     return kTfLiteOk;
 }
 
-TfLiteStatus DepthwiseConvPrepare(TfLiteContext *context, TfLiteNode *node)
+namespace {
+
+TfLiteStatus PrepareImpl(TfLiteContext *context, TfLiteNode *node, bool use_reference)
 {
     TFLITE_DCHECK(node->user_data != nullptr);
     TFLITE_DCHECK(node->builtin_data != nullptr);
@@ -184,7 +187,51 @@ TfLiteStatus DepthwiseConvPrepare(TfLiteContext *context, TfLiteNode *node)
         context, node, params, input_width, input_height, filter_width,
         filter_height, output_width, output_height, input->type, data));
 
+    // The optimized int8 kernel multiplies the raw inputs: the filter is
+    // constant, so its per-channel sums are folded into the bias once here.
+    // Border pixels see fewer taps and get their bias corrected in a scratch
+    // buffer at Eval time.
+    // The reference kernel needs none of it.
+    data->folded_bias = nullptr;
+    data->border_bias_scratch_index = -1;
+    data->packed_filter = nullptr;
+    if (input->type == kTfLiteInt8 && params.depth_multiplier == 1 && !use_reference) {
+        const TfLiteTensor *bias =
+            GetOptionalInputTensor(context, node, kDepthwiseConvBiasTensor);
+        data->folded_bias = static_cast<int32_t *>(
+            context->AllocatePersistentBuffer(context, num_channels * sizeof(int32_t)));
+        TF_LITE_ENSURE(context, data->folded_bias != nullptr);
+        optimized_integer_ops::DepthwiseConvFoldInputOffset(
+            -data->input_zero_point, GetTensorShape(filter),
+            GetTensorData<int8_t>(filter), GetTensorData<int32_t>(bias),
+            data->folded_bias);
+        TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(
+            context, num_channels * sizeof(int32_t),
+            &data->border_bias_scratch_index));
+
+#if !defined(TF_LITE_MICRO_NO_FILTER_PACKING)
+        data->packed_filter = static_cast<int8_t *>(context->AllocatePersistentBuffer(
+            context, GetTensorShape(filter).FlatSize()));
+        TF_LITE_ENSURE(context, data->packed_filter != nullptr);
+        optimized_integer_ops::DepthwiseConvPackFilter(
+            GetTensorShape(filter), GetTensorData<int8_t>(filter),
+            data->packed_filter);
+#endif
+    }
+
     return kTfLiteOk;
 }
 
+} // namespace
+
+TfLiteStatus DepthwiseConvPrepare(TfLiteContext *context, TfLiteNode *node)
+{
+    return PrepareImpl(context, node, /*use_reference=*/false);
+}
+
+TfLiteStatus DepthwiseConvPrepareInt8Reference(TfLiteContext *context, TfLiteNode *node)
+{
+    return PrepareImpl(context, node, /*use_reference=*/true);
+}
+
 } // namespace tflite
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "third_party/flatbuffers/include/flatbuffers/flatbuffers.h" // from @flatbuffers
 #include "tensorflow/lite/c/common.h"
@@ -29,7 +30,9 @@ limitations under the License.
 #include "tensorflow/lite/micro/memory_helpers.h"
 #include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
 #include "tensorflow/lite/micro/memory_planner/memory_planner.h"
+#include "tensorflow/lite/micro/memory_planner/search_memory_planner.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/offline_memory_plan.h"
 #include "tensorflow/lite/micro/simple_memory_allocator.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 #include "tensorflow/lite/schema/schema_utils.h"
@@ -184,6 +187,11 @@ public:
         internal::ScratchBufferRequest *scratch_buffer_requests,
         ScratchBufferHandle *scratch_buffer_handles);
 
+    // Shrinks the tensors between the operators of a patch chain to one band
+    // and keeps everything the chain touches allocated while it runs, since
+    // its operators take turns band by band. Must be called after Add*.
+    void AddPatchPlan(const PatchPlan &plan);
+
     // Returns a pointer to the built AllocationInfo array.
     const AllocationInfo *Finish() const
     {
@@ -311,8 +319,30 @@ TfLiteStatus AllocationInfoBuilder::AddScratchBuffers(
     return kTfLiteOk;
 }
 
-TfLiteStatus CreatePlan(ErrorReporter *error_reporter,
-                        GreedyMemoryPlanner *planner,
+void AllocationInfoBuilder::AddPatchPlan(const PatchPlan &plan)
+{
+    const int last_op = plan.num_ops() - 1;
+    for (int level = 0; level <= plan.num_ops(); ++level) {
+        AllocationInfo *current = &info_[plan.tensor(level)];
+        current->bytes = plan.BufferBytes(level);
+        current->first_created = 0;
+        if (current->last_used < last_op) {
+            current->last_used = last_op;
+        }
+    }
+    for (size_t i = tensor_count_; i < tensor_count_ + buffer_count_; ++i) {
+        AllocationInfo *current = &info_[i];
+        if (current->first_created >= 0 && current->first_created <= last_op) {
+            current->first_created = 0;
+            current->last_used = last_op;
+        }
+    }
+}
+
+// Planner is GreedyMemoryPlanner or SearchMemoryPlanner, which take offline
+// planned offsets.
+template <typename Planner>
+TfLiteStatus CreatePlan(ErrorReporter *error_reporter, Planner *planner,
                         const AllocationInfo *allocation_info,
                         size_t allocation_info_size)
 {
@@ -681,7 +711,8 @@ TfLiteStatus MicroAllocator::FinishModelAllocation(
 
 void *MicroAllocator::AllocatePersistentBuffer(size_t bytes)
 {
-    return memory_allocator_->AllocateFromTail(bytes, kBufferAlignment);
+    return memory_allocator_->AllocateFromTail(bytes, kBufferAlignment,
+                                               kernel_data_region_);
 }
 
 TfLiteStatus MicroAllocator::RequestScratchBufferInArena(size_t bytes,
@@ -762,6 +793,77 @@ size_t MicroAllocator::used_bytes() const
     return memory_allocator_->GetUsedBytes();
 }
 
+TfLiteStatus MicroAllocator::SetBatchSize(int batch_size)
+{
+    if (model_is_allocating_ || batch_size < 1) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "MicroAllocator: Cannot set batch size %d",
+                             batch_size);
+        return kTfLiteError;
+    }
+    batch_size_ = batch_size;
+    return kTfLiteOk;
+}
+
+TfLiteStatus MicroAllocator::SetPatchExecution(int num_ops, int patch_rows)
+{
+    if (model_is_allocating_ || num_ops < 0 || num_ops > PatchPlan::kMaxOps ||
+        (num_ops > 0 && patch_rows < 1)) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "MicroAllocator: Cannot run %d ops in patches of %d rows",
+                             num_ops, patch_rows);
+        return kTfLiteError;
+    }
+    patch_ops_ = num_ops;
+    patch_rows_ = patch_rows;
+    return kTfLiteOk;
+}
+
+TfLiteStatus MicroAllocator::SetMemoryPlanner(MemoryPlannerType planner_type)
+{
+    if (model_is_allocating_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "MicroAllocator: Cannot change the memory planner "
+                             "while a model is allocating");
+        return kTfLiteError;
+    }
+    planner_type_ = planner_type;
+    return kTfLiteOk;
+}
+
+TfLiteStatus MicroAllocator::SetMemoryPlanRecord(MemoryPlanRecord *record)
+{
+    if (model_is_allocating_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "MicroAllocator: Cannot record the memory plan of a "
+                             "model that is allocating");
+        return kTfLiteError;
+    }
+    plan_record_ = record;
+    return kTfLiteOk;
+}
+
+TfLiteStatus MicroAllocator::SetSlowMemoryRegion(uint8_t *buffer, size_t size,
+                                                 SlowMemoryPolicy policy)
+{
+    if (model_is_allocating_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "MicroAllocator: Cannot add a slow memory region "
+                             "while a model is allocating");
+        return kTfLiteError;
+    }
+    TF_LITE_ENSURE_STATUS(memory_allocator_->SetSlowRegion(buffer, size));
+    kernel_data_region_ = policy == SlowMemoryPolicy::kMetadataAndKernelData ?
+                              MemoryRegion::kSlow :
+                              MemoryRegion::kFast;
+    return kTfLiteOk;
+}
+
+size_t MicroAllocator::slow_region_used_bytes() const
+{
+    return memory_allocator_->GetSlowUsedBytes();
+}
+
 TfLiteStatus MicroAllocator::AllocateNodeAndRegistrations(
     const Model *model, SubgraphAllocations *subgraph_allocations)
 {
@@ -821,6 +923,13 @@ TfLiteTensor *MicroAllocator::AllocatePersistentTfLiteTensor(
         // TfLiteTensor dims.
         tensor->dims =
             subgraph_allocations[subgraph_index].tensors[tensor_index].dims;
+        // The flatbuffer only knows the size of a single image.
+        if (batch_size_ > 1 &&
+            TfLiteEvalTensorByteLength(
+                &subgraph_allocations[subgraph_index].tensors[tensor_index],
+                &tensor->bytes) != kTfLiteOk) {
+            return nullptr;
+        }
     }
     return tensor;
 }
@@ -862,6 +971,13 @@ TfLiteTensor *MicroAllocator::AllocateTempTfLiteTensor(
         // TfLiteTensor dims.
         tensor->dims =
             subgraph_allocations[subgraph_index].tensors[tensor_index].dims;
+        // The flatbuffer only knows the size of a single image.
+        if (batch_size_ > 1 &&
+            TfLiteEvalTensorByteLength(
+                &subgraph_allocations[subgraph_index].tensors[tensor_index],
+                &tensor->bytes) != kTfLiteOk) {
+            return nullptr;
+        }
     }
     return tensor;
 }
@@ -903,6 +1019,28 @@ TfLiteStatus MicroAllocator::AllocateTfLiteEvalTensors(
                                      i);
                 return kTfLiteError;
             }
+            // The dims of a batch-1 activation may alias the read-only
+            // flatbuffer, so the batched shape is a copy in the tail.
+            TfLiteIntArray *dims = tensors[i].dims;
+            if (batch_size_ > 1 && tensors[i].data.data == nullptr &&
+                dims->size > 0 && dims->data[0] == 1) {
+                TfLiteIntArray *batched = reinterpret_cast<TfLiteIntArray *>(
+                    memory_allocator_->AllocateFromTail(
+                        TfLiteIntArrayGetSizeInBytes(dims->size),
+                        alignof(TfLiteIntArray)));
+                if (batched == nullptr) {
+                    TF_LITE_REPORT_ERROR(error_reporter_,
+                                         "Failed to allocate batched dims of tensor %d",
+                                         i);
+                    return kTfLiteError;
+                }
+                batched->size = dims->size;
+                for (int d = 0; d < dims->size; ++d) {
+                    batched->data[d] = dims->data[d];
+                }
+                batched->data[0] = batch_size_;
+                tensors[i].dims = batched;
+            }
         }
         subgraph_allocations[subgraph_idx].tensors = tensors;
     }
@@ -918,8 +1056,10 @@ TfLiteStatus MicroAllocator::AllocateVariables(const SubGraph *subgraph,
             TF_LITE_ENSURE_STATUS(
                 TfLiteEvalTensorByteLength(&eval_tensors[i], &buffer_size));
 
-            eval_tensors[i].data.data =
-                memory_allocator_->AllocateFromTail(buffer_size, kBufferAlignment);
+            // Variables are read and written on every invoke like the
+            // activations, so they stay in the arena.
+            eval_tensors[i].data.data = memory_allocator_->AllocateFromTail(
+                buffer_size, kBufferAlignment, MemoryRegion::kFast);
 
             if (eval_tensors[i].data.data == nullptr) {
                 TF_LITE_REPORT_ERROR(error_reporter_,
@@ -972,6 +1112,57 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
     // function.
 
     const SubGraph *subgraph = model->subgraphs()->Get(subgraph_idx);
+    const bool patched = (subgraph_idx == 0) && (patch_ops_ > 0);
+    if (patched) {
+        if (batch_size_ > 1) {
+            TF_LITE_REPORT_ERROR(error_reporter_,
+                                 "Patch execution needs a batch size of 1");
+            return kTfLiteError;
+        }
+        if (patch_plan_ == nullptr) {
+            void *plan_buffer = memory_allocator_->AllocateFromTail(
+                sizeof(PatchPlan), alignof(PatchPlan));
+            if (plan_buffer == nullptr) {
+                TF_LITE_REPORT_ERROR(error_reporter_,
+                                     "Failed to allocate memory for the patch plan");
+                return kTfLiteError;
+            }
+            patch_plan_ = new (plan_buffer) PatchPlan();
+        }
+        TF_LITE_ENSURE_STATUS(patch_plan_->Init(model, eval_tensors, patch_ops_,
+                                                patch_rows_, error_reporter_));
+    }
+
+    // An offline plan of the model describes its buffers as stored: one
+    // image, layer by layer. A complete one places every buffer right away.
+    const bool use_offline_plan = (subgraph_idx == 0) && !patched && (batch_size_ == 1);
+    if (subgraph_idx == 0) {
+        offline_memory_plan_used_ = false;
+    }
+    OfflineMemoryPlan offline_plan;
+    if (use_offline_plan && GetOfflineMemoryPlan(model, &offline_plan) &&
+        offline_plan.complete &&
+        CommitOfflineMemoryPlan(offline_plan, subgraph, eval_tensors,
+                                scratch_buffer_handles)) {
+        offline_memory_plan_used_ = true;
+        if (plan_record_ != nullptr) {
+            if (plan_record_->tensor_capacity < offline_plan.tensor_count ||
+                plan_record_->scratch_capacity < offline_plan.scratch_count) {
+                TF_LITE_REPORT_ERROR(error_reporter_,
+                                     "Memory plan record is too small");
+                return kTfLiteError;
+            }
+            memcpy(plan_record_->tensor_offsets, offline_plan.tensor_offsets,
+                   sizeof(int32_t) * offline_plan.tensor_count);
+            memcpy(plan_record_->scratch_buffers, offline_plan.scratch_buffers,
+                   2 * sizeof(int32_t) * offline_plan.scratch_count);
+            plan_record_->tensor_count = offline_plan.tensor_count;
+            plan_record_->scratch_count = offline_plan.scratch_count;
+            plan_record_->head_bytes = offline_plan.head_bytes;
+        }
+        return CommitHeadUsage(offline_plan.head_bytes);
+    }
+
     size_t allocation_info_count =
         subgraph->tensors()->size() + scratch_buffer_request_count_;
     size_t bytes = sizeof(AllocationInfo) * allocation_info_count;
@@ -994,8 +1185,10 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
                                   scratch_buffer_request_count_, error_reporter_);
 
     const int32_t *offline_planner_offsets = nullptr;
-    TF_LITE_ENSURE_STATUS(
-        builder.GetOfflinePlannedOffsets(model, &offline_planner_offsets));
+    if (use_offline_plan) {
+        TF_LITE_ENSURE_STATUS(
+            builder.GetOfflinePlannedOffsets(model, &offline_planner_offsets));
+    }
     TF_LITE_ENSURE_STATUS(
         builder.AddTensors(subgraph, offline_planner_offsets, eval_tensors));
 
@@ -1004,6 +1197,9 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
 
     TF_LITE_ENSURE_STATUS(builder.AddScratchBuffers(scratch_buffer_requests,
                                                     scratch_buffer_handles));
+    if (patched) {
+        builder.AddPatchPlan(*patch_plan_);
+    }
 
     // Remaining arena size that memory planner can use for calculating offsets.
     size_t remaining_arena_size =
@@ -1011,9 +1207,19 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
     uint8_t *planner_arena =
         memory_allocator_->AllocateTemp(remaining_arena_size, kBufferAlignment);
     TF_LITE_ENSURE(error_reporter_, planner_arena != nullptr);
-    GreedyMemoryPlanner planner(planner_arena, remaining_arena_size);
-    TF_LITE_ENSURE_STATUS(CreatePlan(error_reporter_, &planner, allocation_info,
-                                     allocation_info_count));
+    // Both planners lay out their arrays in planner_arena when constructed,
+    // only the selected one is used.
+    GreedyMemoryPlanner greedy_planner(planner_arena, remaining_arena_size);
+    SearchMemoryPlanner search_planner(planner_arena, remaining_arena_size);
+    MemoryPlanner *planner = &greedy_planner;
+    if (planner_type_ == MemoryPlannerType::kSearch) {
+        planner = &search_planner;
+        TF_LITE_ENSURE_STATUS(CreatePlan(error_reporter_, &search_planner,
+                                         allocation_info, allocation_info_count));
+    } else {
+        TF_LITE_ENSURE_STATUS(CreatePlan(error_reporter_, &greedy_planner,
+                                         allocation_info, allocation_info_count));
+    }
 
     // Reset all temp allocations used above:
     memory_allocator_->ResetTempAllocations();
@@ -1022,23 +1228,105 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
         memory_allocator_->GetAvailableMemory(kBufferAlignment);
 
     // Make sure we have enough arena size.
-    if (planner.GetMaximumMemorySize() > actual_available_arena_size) {
+    if (planner->GetMaximumMemorySize() > actual_available_arena_size) {
         TF_LITE_REPORT_ERROR(
             error_reporter_,
             "Arena size is too small for all buffers. Needed %u but only "
             "%u was available.",
-            planner.GetMaximumMemorySize(), actual_available_arena_size);
+            planner->GetMaximumMemorySize(), actual_available_arena_size);
         return kTfLiteError;
     }
     // Commit the plan.
-    TF_LITE_ENSURE_STATUS(CommitPlan(error_reporter_, &planner,
+    TF_LITE_ENSURE_STATUS(CommitPlan(error_reporter_, planner,
                                      memory_allocator_->GetHeadBuffer(),
                                      allocation_info, allocation_info_count));
+    if (subgraph_idx == 0 && plan_record_ != nullptr) {
+        const int tensor_count = subgraph->tensors()->size();
+        if (plan_record_->tensor_capacity < tensor_count ||
+            plan_record_->scratch_capacity <
+                static_cast<int>(scratch_buffer_request_count_)) {
+            TF_LITE_REPORT_ERROR(error_reporter_, "Memory plan record is too small");
+            return kTfLiteError;
+        }
+        uint8_t *head = memory_allocator_->GetHeadBuffer();
+        for (size_t i = 0; i < allocation_info_count; ++i) {
+            const AllocationInfo *current = &allocation_info[i];
+            const int32_t offset =
+                current->needs_allocating
+                    ? static_cast<int32_t>(static_cast<uint8_t *>(*current->output_ptr) - head)
+                    : kOnlinePlannedBuffer;
+            if (i < static_cast<size_t>(tensor_count)) {
+                plan_record_->tensor_offsets[i] = offset;
+            } else {
+                int32_t *scratch = &plan_record_->scratch_buffers[2 * (i - tensor_count)];
+                scratch[0] = offset;
+                scratch[1] = AlignSizeUp(current->bytes, kBufferAlignment);
+            }
+        }
+        plan_record_->tensor_count = tensor_count;
+        plan_record_->scratch_count = scratch_buffer_request_count_;
+        plan_record_->head_bytes = planner->GetMaximumMemorySize();
+    }
 #ifdef TF_LITE_SHOW_MEMORY_USE
-    planner.PrintMemoryPlan();
+    if (planner == &greedy_planner) {
+        greedy_planner.PrintMemoryPlan();
+    }
 #endif
-    head_usage = planner.GetMaximumMemorySize();
+    head_usage = planner->GetMaximumMemorySize();
+    return CommitHeadUsage(head_usage);
+}
 
+bool MicroAllocator::CommitOfflineMemoryPlan(const OfflineMemoryPlan &plan,
+                                             const SubGraph *subgraph,
+                                             TfLiteEvalTensor *eval_tensors,
+                                             ScratchBufferHandle *scratch_buffer_handles)
+{
+    const int32_t head_bytes = plan.head_bytes;
+    if (head_bytes < 0 ||
+        static_cast<size_t>(head_bytes) >
+            memory_allocator_->GetAvailableMemory(kBufferAlignment) ||
+        plan.scratch_count != static_cast<int>(scratch_buffer_request_count_)) {
+        return false;
+    }
+    // Check everything first, so that a plan that does not match the kernels
+    // leaves the buffers to the online planner.
+    const internal::ScratchBufferRequest *requests = GetScratchBufferRequests();
+    for (int i = 0; i < plan.scratch_count; ++i) {
+        const int32_t offset = plan.scratch_buffers[2 * i];
+        const int32_t bytes = plan.scratch_buffers[2 * i + 1];
+        if (offset < 0 || offset % kBufferAlignment != 0 ||
+            requests[i].bytes > static_cast<size_t>(bytes) || bytes > head_bytes - offset) {
+            return false;
+        }
+    }
+    for (int i = 0; i < plan.tensor_count; ++i) {
+        if (eval_tensors[i].data.data != nullptr || subgraph->tensors()->Get(i)->is_variable()) {
+            continue;
+        }
+        const int32_t offset = plan.tensor_offsets[i];
+        size_t bytes = 0;
+        if (offset < 0 || offset % kBufferAlignment != 0 ||
+            TfLiteEvalTensorByteLength(&eval_tensors[i], &bytes) != kTfLiteOk ||
+            bytes > static_cast<size_t>(head_bytes - offset)) {
+            return false;
+        }
+    }
+
+    uint8_t *head = memory_allocator_->GetHeadBuffer();
+    for (int i = 0; i < plan.tensor_count; ++i) {
+        if (eval_tensors[i].data.data == nullptr &&
+            !subgraph->tensors()->Get(i)->is_variable()) {
+            eval_tensors[i].data.data = head + plan.tensor_offsets[i];
+        }
+    }
+    for (int i = 0; i < plan.scratch_count; ++i) {
+        scratch_buffer_handles[i].data = head + plan.scratch_buffers[2 * i];
+    }
+    return true;
+}
+
+TfLiteStatus MicroAllocator::CommitHeadUsage(size_t head_usage)
+{
     // The head is used to store memory plans for one model at a time during the
     // model preparation stage, and is re-purposed to store scratch buffer handles
     // during model invocation. The head must be as large as the greater of the
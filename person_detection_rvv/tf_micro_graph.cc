@@ -18,6 +18,7 @@ limitations under the License.
 #include "third_party/flatbuffers/include/flatbuffers/flatbuffers.h" // from @flatbuffers
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
 #include "tensorflow/lite/micro/memory_helpers.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 #include "tensorflow/lite/micro/micro_profiler.h"
@@ -26,7 +27,7 @@ limitations under the License.
 namespace tflite {
 namespace {
 
-#ifndef TF_LITE_STRIP_ERROR_STRINGS
+#if defined(TF_LITE_MICRO_PROFILER_ENABLED)
 const char *OpNameFromRegistration(const TfLiteRegistration *registration)
 {
     if (registration->builtin_code == BuiltinOperator_CUSTOM) {
@@ -35,7 +36,7 @@ const char *OpNameFromRegistration(const TfLiteRegistration *registration)
         return EnumNameBuiltinOperator(BuiltinOperator(registration->builtin_code));
     }
 }
-#endif // !defined(TF_LITE_STRIP_ERROR_STRINGS)
+#endif // defined(TF_LITE_MICRO_PROFILER_ENABLED)
 
 } // namespace
 
@@ -162,17 +163,28 @@ TfLiteStatus MicroGraph::InvokeSubgraph(int subgraph_idx)
     }
     const SubGraph *subgraph = (*subgraphs_)[subgraph_idx];
 
-    for (size_t i = 0; i < subgraph->operators()->size(); ++i) {
+    // The operators of a patch chain run band by band first.
+    size_t first_op = 0;
+    const PatchPlan *plan = allocator_->patch_plan();
+    if (subgraph_idx == 0 && plan != nullptr && plan->num_ops() > 0) {
+        TfLiteStatus invoke_status = InvokePatches(*plan);
+        if (invoke_status != kTfLiteOk) {
+            return invoke_status;
+        }
+        first_op = plan->num_ops();
+    }
+
+    for (size_t i = first_op; i < subgraph->operators()->size(); ++i) {
         TfLiteNode *node =
             &(subgraph_allocations_[subgraph_idx].node_and_registrations[i].node);
         const TfLiteRegistration *registration = subgraph_allocations_[subgraph_idx]
                                                      .node_and_registrations[i]
                                                      .registration;
 
-// This ifdef is needed (even though ScopedMicroProfiler itself is a no-op with
-// -DTF_LITE_STRIP_ERROR_STRINGS) because the function OpNameFromRegistration is
-// only defined for builds with the error strings.
-#if !defined(TF_LITE_STRIP_ERROR_STRINGS)
+// This ifdef is needed (even though ScopedMicroProfiler itself is a no-op
+// without profiling) because the function OpNameFromRegistration is only
+// defined for builds with error strings or TF_LITE_MICRO_ENABLE_PROFILER.
+#if defined(TF_LITE_MICRO_PROFILER_ENABLED)
         ScopedMicroProfiler scoped_profiler(
             OpNameFromRegistration(registration),
             reinterpret_cast<MicroProfiler *>(context_->profiler));
@@ -199,6 +211,85 @@ TfLiteStatus MicroGraph::InvokeSubgraph(int subgraph_idx)
     return kTfLiteOk;
 }
 
+TfLiteStatus MicroGraph::InvokePatches(const PatchPlan &plan)
+{
+    const int num_ops = plan.num_ops();
+    TfLiteEvalTensor *tensors = subgraph_allocations_[0].tensors;
+    NodeAndRegistration *nodes = subgraph_allocations_[0].node_and_registrations;
+
+    // The kernels see every tensor of the chain as a band of rows. The shape
+    // of a band lives in a plain int array, as TfLiteIntArray ends in a
+    // flexible array member; the tensors between the ops hold just the band,
+    // the chain input and output are viewed in place.
+    TfLiteEvalTensor full[PatchPlan::kMaxOps + 1];
+    int band_dims[PatchPlan::kMaxOps + 1][5];
+    for (int level = 0; level <= num_ops; ++level) {
+        full[level] = tensors[plan.tensor(level)];
+        band_dims[level][0] = 4;
+        for (int d = 0; d < 4; ++d) {
+            band_dims[level][d + 1] = full[level].dims->data[d];
+        }
+        tensors[plan.tensor(level)].dims = reinterpret_cast<TfLiteIntArray *>(band_dims[level]);
+    }
+    // Conv and depthwise conv keep their padding in OpDataConv; the top
+    // padding of a band depends on where it starts.
+    OpDataConv *op_data[PatchPlan::kMaxOps];
+    TfLitePaddingValues padding[PatchPlan::kMaxOps];
+    for (int op = 0; op < num_ops; ++op) {
+        op_data[op] = static_cast<OpDataConv *>(nodes[op].node.user_data);
+        padding[op] = op_data[op]->padding;
+    }
+
+    TfLiteStatus invoke_status = kTfLiteOk;
+    {
+        // Profilers expect one event per node: the chain is timed as a whole
+        // on its first node and the other nodes of the chain get empty events.
+#if defined(TF_LITE_MICRO_PROFILER_ENABLED)
+        ScopedMicroProfiler scoped_profiler(
+            OpNameFromRegistration(nodes[0].registration),
+            reinterpret_cast<MicroProfiler *>(context_->profiler));
+#endif
+        int rows[PatchPlan::kMaxOps + 1][2];
+        for (int patch = 0; patch < plan.num_patches() && invoke_status == kTfLiteOk;
+             ++patch) {
+            plan.Rows(patch, rows);
+            for (int level = 0; level <= num_ops; ++level) {
+                band_dims[level][2] = rows[level][1] - rows[level][0];
+                if (level == 0 || level == num_ops) {
+                    tensors[plan.tensor(level)].data.raw =
+                        full[level].data.raw + rows[level][0] * plan.row_bytes(level);
+                }
+            }
+            for (int op = 0; op < num_ops && invoke_status == kTfLiteOk; ++op) {
+                op_data[op]->padding.height = plan.PadTop(op, rows[op][0], rows[op + 1][0]);
+                const TfLiteRegistration *registration = nodes[op].registration;
+                TFLITE_DCHECK(registration->invoke);
+                invoke_status = registration->invoke(context_, &nodes[op].node);
+                allocator_->ResetTempAllocations();
+                if (invoke_status == kTfLiteError) {
+                    MicroPrintf("Node %s (number %d) failed to invoke in patch %d",
+                                OpNameFromRegistration(registration), op, patch);
+                }
+            }
+        }
+    }
+#if defined(TF_LITE_MICRO_PROFILER_ENABLED)
+    for (int op = 1; op < num_ops; ++op) {
+        ScopedMicroProfiler scoped_profiler(
+            OpNameFromRegistration(nodes[op].registration),
+            reinterpret_cast<MicroProfiler *>(context_->profiler));
+    }
+#endif
+
+    for (int level = 0; level <= num_ops; ++level) {
+        tensors[plan.tensor(level)] = full[level];
+    }
+    for (int op = 0; op < num_ops; ++op) {
+        op_data[op]->padding = padding[op];
+    }
+    return invoke_status;
+}
+
 TfLiteStatus MicroGraph::ResetVariableTensors()
 {
     for (size_t subgraph_idx = 0; subgraph_idx < subgraphs_->size();
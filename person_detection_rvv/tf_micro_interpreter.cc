@@ -290,6 +290,57 @@ TfLiteStatus MicroInterpreter::Invoke()
     return graph_.InvokeSubgraph(0);
 }
 
+TfLiteStatus MicroInterpreter::SetBatchSize(int batch_size)
+{
+    if (tensors_allocated_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "Batch size must be set before AllocateTensors()");
+        return kTfLiteError;
+    }
+    return allocator_.SetBatchSize(batch_size);
+}
+
+TfLiteStatus MicroInterpreter::SetPatchExecution(int num_ops, int patch_rows)
+{
+    if (tensors_allocated_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "Patch execution must be set before AllocateTensors()");
+        return kTfLiteError;
+    }
+    return allocator_.SetPatchExecution(num_ops, patch_rows);
+}
+
+TfLiteStatus MicroInterpreter::SetMemoryPlanner(MemoryPlannerType planner_type)
+{
+    if (tensors_allocated_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "Memory planner must be set before AllocateTensors()");
+        return kTfLiteError;
+    }
+    return allocator_.SetMemoryPlanner(planner_type);
+}
+
+TfLiteStatus MicroInterpreter::SetMemoryPlanRecord(MemoryPlanRecord *record)
+{
+    if (tensors_allocated_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "Memory plan record must be set before AllocateTensors()");
+        return kTfLiteError;
+    }
+    return allocator_.SetMemoryPlanRecord(record);
+}
+
+TfLiteStatus MicroInterpreter::SetSlowMemoryRegion(uint8_t *buffer, size_t size,
+                                                   SlowMemoryPolicy policy)
+{
+    if (tensors_allocated_) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "Slow memory region must be set before AllocateTensors()");
+        return kTfLiteError;
+    }
+    return allocator_.SetSlowMemoryRegion(buffer, size, policy);
+}
+
 TfLiteTensor *MicroInterpreter::input(size_t index)
 {
     const size_t length = inputs_size();
@@ -302,6 +353,19 @@ TfLiteTensor *MicroInterpreter::input(size_t index)
     return input_tensors_[index];
 }
 
+TfLiteStatus MicroInterpreter::SetInputBuffer(size_t index, void *data)
+{
+    if (!tensors_allocated_ || index >= inputs_size() || data == nullptr) {
+        TF_LITE_REPORT_ERROR(error_reporter_, "Cannot bind input %d", index);
+        return kTfLiteError;
+    }
+    // Kernels read the eval tensor; the TfLiteTensor is what input() returns.
+    graph_.GetAllocations()[0].tensors[inputs().Get(index)].data.raw =
+        static_cast<char *>(data);
+    input_tensors_[index]->data.raw = static_cast<char *>(data);
+    return kTfLiteOk;
+}
+
 TfLiteTensor *MicroInterpreter::output(size_t index)
 {
     const size_t length = outputs_size();
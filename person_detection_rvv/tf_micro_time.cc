@@ -31,9 +31,50 @@ limitations under the License.
 #include <ctime>
 #endif
 
+// On RISC-V the ticks come from the user-level counters: the cycle counter
+// (rdcycle) by default, so per-op timings are in core clock cycles, or the
+// wall-clock timer (rdtime) with TF_LITE_MICRO_USE_RDTIME. Their rates are
+// not discoverable from user code and are set at build time; the defaults
+// are those of the BL808 D0 core (C906 at 480 MHz, 1 MHz machine timer).
+// Define TF_LITE_MICRO_NO_RISCV_TIMER to get the stub implementation back.
+#if defined(__riscv) && !defined(TF_LITE_USE_CTIME) && \
+    !defined(TF_LITE_MICRO_NO_RISCV_TIMER)
+#define TF_LITE_MICRO_RISCV_TIMER
+#if !defined(TF_LITE_MICRO_CYCLES_PER_SECOND)
+#define TF_LITE_MICRO_CYCLES_PER_SECOND 480000000
+#endif
+#if !defined(TF_LITE_MICRO_TIMER_TICKS_PER_SECOND)
+#define TF_LITE_MICRO_TIMER_TICKS_PER_SECOND 1000000
+#endif
+#endif
+
 namespace tflite {
 
-#if !defined(TF_LITE_USE_CTIME)
+#if defined(TF_LITE_MICRO_RISCV_TIMER)
+
+int32_t ticks_per_second()
+{
+#if defined(TF_LITE_MICRO_USE_RDTIME)
+    return TF_LITE_MICRO_TIMER_TICKS_PER_SECOND;
+#else
+    return TF_LITE_MICRO_CYCLES_PER_SECOND;
+#endif
+}
+
+// Only the low 32 bits are returned. At 480 MHz they wrap every ~9 s, which
+// is harmless as long as callers only use differences of nearby ticks.
+int32_t GetCurrentTimeTicks()
+{
+    unsigned long ticks;
+#if defined(TF_LITE_MICRO_USE_RDTIME)
+    __asm__ volatile("rdtime %0" : "=r"(ticks));
+#else
+    __asm__ volatile("rdcycle %0" : "=r"(ticks));
+#endif
+    return static_cast<int32_t>(static_cast<uint32_t>(ticks));
+}
+
+#elif !defined(TF_LITE_USE_CTIME)
 
 // Reference implementation of the ticks_per_second() function that's required
 // for a platform to support Tensorflow Lite for Microcontrollers profiling.
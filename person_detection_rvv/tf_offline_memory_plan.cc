@@ -0,0 +1,65 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/offline_memory_plan.h"
+
+#include <string.h>
+
+namespace tflite {
+
+bool GetOfflineMemoryPlan(const Model *model, OfflineMemoryPlan *plan)
+{
+    plan->complete = false;
+    if (model->metadata() == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < model->metadata()->size(); ++i) {
+        const Metadata *metadata = model->metadata()->Get(i);
+        if (metadata->name() == nullptr ||
+            strncmp(metadata->name()->c_str(), kOfflineMemoryPlanMetadata,
+                    strlen(kOfflineMemoryPlanMetadata)) != 0 ||
+            metadata->buffer() >= model->buffers()->size()) {
+            continue;
+        }
+        const flatbuffers::Vector<uint8_t> *data =
+            model->buffers()->Get(metadata->buffer())->data();
+        if (data == nullptr || data->size() < 3 * sizeof(uint32_t)) {
+            return false;
+        }
+        const uint32_t *words = reinterpret_cast<const uint32_t *>(data->data());
+        const size_t word_count = data->size() / sizeof(uint32_t);
+        const size_t tensor_count = model->subgraphs()->Get(0)->tensors()->size();
+        if (words[0] != kOfflineMemoryPlanVersion || words[1] != 0 ||
+            words[2] != tensor_count || word_count < 3 + tensor_count) {
+            return false;
+        }
+        plan->tensor_count = static_cast<int>(tensor_count);
+        plan->tensor_offsets = reinterpret_cast<const int32_t *>(&words[3]);
+
+        const uint32_t *extension = &words[3 + tensor_count];
+        const size_t extension_words = word_count - 3 - tensor_count;
+        if (extension_words >= 3 && extension[0] == kOfflineMemoryPlanMagic &&
+            extension_words >= 3 + 2 * static_cast<size_t>(extension[2])) {
+            plan->complete = true;
+            plan->head_bytes = static_cast<int>(extension[1]);
+            plan->scratch_count = static_cast<int>(extension[2]);
+            plan->scratch_buffers = reinterpret_cast<const int32_t *>(&extension[3]);
+        }
+        return true;
+    }
+    return false;
+}
+
+} // namespace tflite
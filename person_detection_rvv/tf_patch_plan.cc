@@ -0,0 +1,202 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/patch_plan.h"
+
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+
+namespace tflite {
+namespace {
+
+// True if the tensor is read by an operator other than op, or by op through
+// another input than the first, or is an output of the subgraph.
+bool UsedOutsideChain(const SubGraph *subgraph, int tensor, int op)
+{
+    for (size_t i = 0; i < subgraph->outputs()->size(); ++i) {
+        if (subgraph->outputs()->Get(i) == tensor) {
+            return true;
+        }
+    }
+    for (size_t i = 0; i < subgraph->operators()->size(); ++i) {
+        const Operator *other = subgraph->operators()->Get(i);
+        for (size_t n = 0; n < other->inputs()->size(); ++n) {
+            if (other->inputs()->Get(n) == tensor &&
+                (static_cast<int>(i) != op || n != 0)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// A [1, height, width, channels] tensor.
+bool IsSingleImage(const TfLiteEvalTensor &tensor)
+{
+    return tensor.dims != nullptr && tensor.dims->size == 4 && tensor.dims->data[0] == 1;
+}
+
+} // namespace
+
+TfLiteStatus PatchPlan::Init(const Model *model, const TfLiteEvalTensor *eval_tensors,
+                             int num_ops, int patch_rows, ErrorReporter *error_reporter)
+{
+    num_ops_ = 0;
+    const SubGraph *subgraph = model->subgraphs()->Get(0);
+    if (num_ops < 2 || num_ops > kMaxOps ||
+        num_ops > static_cast<int>(subgraph->operators()->size()) || patch_rows < 1) {
+        TF_LITE_REPORT_ERROR(error_reporter,
+                             "Cannot run %d ops in patches of %d rows", num_ops,
+                             patch_rows);
+        return kTfLiteError;
+    }
+
+    for (int i = 0; i < num_ops; ++i) {
+        const Operator *op = subgraph->operators()->Get(i);
+        const BuiltinOperator code =
+            GetBuiltinCode(model->operator_codes()->Get(op->opcode_index()));
+        int stride = 0;
+        int dilation = 0;
+        Padding padding = Padding_SAME;
+        if (code == BuiltinOperator_CONV_2D && op->builtin_options_as_Conv2DOptions()) {
+            const Conv2DOptions *options = op->builtin_options_as_Conv2DOptions();
+            stride = options->stride_h();
+            dilation = options->dilation_h_factor();
+            padding = options->padding();
+        } else if (code == BuiltinOperator_DEPTHWISE_CONV_2D &&
+                   op->builtin_options_as_DepthwiseConv2DOptions()) {
+            const DepthwiseConv2DOptions *options =
+                op->builtin_options_as_DepthwiseConv2DOptions();
+            stride = options->stride_h();
+            dilation = options->dilation_h_factor();
+            padding = options->padding();
+        } else {
+            TF_LITE_REPORT_ERROR(error_reporter,
+                                 "Op %d is not a conv or depthwise conv and cannot "
+                                 "run in patches",
+                                 i);
+            return kTfLiteError;
+        }
+        if (op->inputs()->size() < 2 || op->outputs()->size() != 1 ||
+            (i > 0 && op->inputs()->Get(0) != levels_[i].tensor)) {
+            TF_LITE_REPORT_ERROR(error_reporter,
+                                 "Op %d does not continue the patch chain", i);
+            return kTfLiteError;
+        }
+        if (i > 0 && UsedOutsideChain(subgraph, levels_[i].tensor, i)) {
+            TF_LITE_REPORT_ERROR(error_reporter,
+                                 "Tensor %d is used outside the patch chain",
+                                 levels_[i].tensor);
+            return kTfLiteError;
+        }
+
+        const int input_index = op->inputs()->Get(0);
+        const int output_index = op->outputs()->Get(0);
+        const TfLiteEvalTensor &input = eval_tensors[input_index];
+        const TfLiteEvalTensor &filter = eval_tensors[op->inputs()->Get(1)];
+        const TfLiteEvalTensor &output = eval_tensors[output_index];
+        if (!IsSingleImage(input) || !IsSingleImage(output) || filter.dims == nullptr ||
+            filter.dims->size != 4) {
+            TF_LITE_REPORT_ERROR(error_reporter,
+                                 "Op %d needs single image NHWC tensors to run in "
+                                 "patches",
+                                 i);
+            return kTfLiteError;
+        }
+
+        int out_height = 0;
+        int out_width = 0;
+        const TfLitePaddingValues values = ComputePaddingHeightWidth(
+            stride, 1, dilation, 1, input.dims->data[1], input.dims->data[2],
+            filter.dims->data[1], 1,
+            padding == Padding_VALID ? kTfLitePaddingValid : kTfLitePaddingSame,
+            &out_height, &out_width);
+        if (out_height != output.dims->data[1]) {
+            TF_LITE_REPORT_ERROR(error_reporter, "Op %d has an unexpected output height",
+                                 i);
+            return kTfLiteError;
+        }
+        ops_[i].stride = stride;
+        ops_[i].extent = (filter.dims->data[1] - 1) * dilation + 1;
+        ops_[i].pad_top = values.height;
+
+        size_t bytes = 0;
+        if (i == 0) {
+            TF_LITE_ENSURE_STATUS(TfLiteEvalTensorByteLength(&input, &bytes));
+            levels_[0].tensor = input_index;
+            levels_[0].height = input.dims->data[1];
+            levels_[0].row_bytes = bytes / levels_[0].height;
+        }
+        TF_LITE_ENSURE_STATUS(TfLiteEvalTensorByteLength(&output, &bytes));
+        levels_[i + 1].tensor = output_index;
+        levels_[i + 1].height = out_height;
+        levels_[i + 1].row_bytes = bytes / out_height;
+    }
+
+    num_ops_ = num_ops;
+    patch_rows_ = patch_rows;
+    num_patches_ = (levels_[num_ops].height + patch_rows - 1) / patch_rows;
+    for (int level = 0; level <= num_ops; ++level) {
+        levels_[level].max_rows = 0;
+    }
+    int rows[kMaxOps + 1][2];
+    for (int patch = 0; patch < num_patches_; ++patch) {
+        Rows(patch, rows);
+        for (int level = 0; level <= num_ops; ++level) {
+            const int count = rows[level][1] - rows[level][0];
+            if (count > levels_[level].max_rows) {
+                levels_[level].max_rows = count;
+            }
+        }
+    }
+    return kTfLiteOk;
+}
+
+size_t PatchPlan::BufferBytes(int level) const
+{
+    const Level &current = levels_[level];
+    if (level == 0 || level == num_ops_) {
+        return current.row_bytes * current.height;
+    }
+    return current.row_bytes * current.max_rows;
+}
+
+void PatchPlan::Rows(int patch, int rows[kMaxOps + 1][2]) const
+{
+    int begin = patch * patch_rows_;
+    int end = begin + patch_rows_;
+    if (end > levels_[num_ops_].height) {
+        end = levels_[num_ops_].height;
+    }
+    rows[num_ops_][0] = begin;
+    rows[num_ops_][1] = end;
+    // The input rows an op reads for its output rows, clipped to the tensor:
+    // rows outside it are the op's padding.
+    for (int op = num_ops_ - 1; op >= 0; --op) {
+        begin = begin * ops_[op].stride - ops_[op].pad_top;
+        end = (end - 1) * ops_[op].stride - ops_[op].pad_top + ops_[op].extent;
+        if (begin < 0) {
+            begin = 0;
+        }
+        if (end > levels_[op].height) {
+            end = levels_[op].height;
+        }
+        rows[op][0] = begin;
+        rows[op][1] = end;
+    }
+}
+
+} // namespace tflite
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/optimized/integer_ops/pooling.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/pooling.h"
 #include "tensorflow/lite/kernels/internal/reference/pooling.h"
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
@@ -116,7 +117,7 @@ void AveragePoolingEvalQuantized(TfLiteContext *context, const TfLiteNode *node,
     op_params.quantized_activation_min = data->activation_min;
     op_params.quantized_activation_max = data->activation_max;
 
-    reference_integer_ops::AveragePool(
+    optimized_integer_ops::AveragePool(
         op_params, tflite::micro::GetTensorShape(input),
         tflite::micro::GetTensorData<int8_t>(input),
         tflite::micro::GetTensorShape(output),
@@ -159,7 +160,7 @@ void MaxPoolingEvalQuantized(TfLiteContext *context, TfLiteNode *node,
     op_params.quantized_activation_min = data->activation_min;
     op_params.quantized_activation_max = data->activation_max;
 
-    reference_integer_ops::MaxPool(op_params,
+    optimized_integer_ops::MaxPool(op_params,
                                    tflite::micro::GetTensorShape(input),
                                    tflite::micro::GetTensorData<int8_t>(input),
                                    tflite::micro::GetTensorShape(output),
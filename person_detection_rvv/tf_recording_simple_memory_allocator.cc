@@ -79,12 +79,15 @@ TfLiteStatus RecordingSimpleMemoryAllocator::SetHeadBufferSize(
 }
 
 uint8_t *RecordingSimpleMemoryAllocator::AllocateFromTail(size_t size,
-                                                          size_t alignment)
+                                                          size_t alignment,
+                                                          MemoryRegion region)
 {
     const uint8_t *previous_tail = tail();
-    uint8_t *result = SimpleMemoryAllocator::AllocateFromTail(size, alignment);
+    const uint8_t *previous_slow_tail = slow_tail();
+    uint8_t *result =
+        SimpleMemoryAllocator::AllocateFromTail(size, alignment, region);
     if (result != nullptr) {
-        used_bytes_ += previous_tail - tail();
+        used_bytes_ += (previous_tail - tail()) + (previous_slow_tail - slow_tail());
         requested_tail_bytes_ += size;
         alloc_count_++;
     }
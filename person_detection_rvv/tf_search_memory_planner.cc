@@ -0,0 +1,400 @@
+/* Copyright 2024 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/memory_planner/search_memory_planner.h"
+
+#include <limits.h>
+
+#include <algorithm>
+
+namespace tflite {
+
+SearchMemoryPlanner::SearchMemoryPlanner(unsigned char *scratch_buffer,
+                                         int scratch_buffer_size, int search_steps)
+    : buffer_count_(0), offline_count_(0), search_steps_(search_steps),
+      search_steps_used_(0), best_size_(0), lower_bound_(0),
+      need_to_calculate_offsets_(true)
+{
+    // Allocate the arrays we need within the scratch buffer arena. peaks_
+    // holds one more entry than there are buffers.
+    max_buffer_count_ = 0;
+    if (scratch_buffer_size > static_cast<int>(sizeof(int))) {
+        max_buffer_count_ = (scratch_buffer_size - sizeof(int)) / per_buffer_size();
+    }
+
+    unsigned char *next_free = scratch_buffer;
+    requirements_ = reinterpret_cast<BufferRequirements *>(next_free);
+    next_free += sizeof(BufferRequirements) * max_buffer_count_;
+
+    offsets_ = reinterpret_cast<int *>(next_free);
+    next_free += sizeof(int) * max_buffer_count_;
+
+    best_offsets_ = reinterpret_cast<int *>(next_free);
+    next_free += sizeof(int) * max_buffer_count_;
+
+    order_ = reinterpret_cast<int *>(next_free);
+    next_free += sizeof(int) * max_buffer_count_;
+
+    shared_bytes_ = reinterpret_cast<int *>(next_free);
+    next_free += sizeof(int) * max_buffer_count_;
+
+    tried_ = reinterpret_cast<int *>(next_free);
+    next_free += sizeof(int) * max_buffer_count_;
+
+    peaks_ = reinterpret_cast<int *>(next_free);
+}
+
+SearchMemoryPlanner::~SearchMemoryPlanner()
+{
+    // We don't own the scratch buffer, so don't deallocate anything.
+}
+
+TfLiteStatus SearchMemoryPlanner::AddBuffer(tflite::ErrorReporter *error_reporter,
+                                            int size, int first_time_used,
+                                            int last_time_used)
+{
+    if (buffer_count_ >= max_buffer_count_) {
+        TF_LITE_REPORT_ERROR(error_reporter, "Too many buffers (max is %d)",
+                             max_buffer_count_);
+        return kTfLiteError;
+    }
+    BufferRequirements *current = &requirements_[buffer_count_];
+    current->size = size;
+    current->first_time_used = first_time_used;
+    current->last_time_used = last_time_used;
+    current->offline_offset = kOnlinePlannedBuffer;
+    ++buffer_count_;
+    need_to_calculate_offsets_ = true;
+    return kTfLiteOk;
+}
+
+TfLiteStatus SearchMemoryPlanner::AddBuffer(tflite::ErrorReporter *error_reporter,
+                                            int size, int first_time_used,
+                                            int last_time_used, int offline_offset)
+{
+    BufferRequirements *current = &requirements_[buffer_count_];
+    if (AddBuffer(error_reporter, size, first_time_used, last_time_used) !=
+        kTfLiteOk) {
+        return kTfLiteError;
+    }
+    current->offline_offset = offline_offset;
+    return kTfLiteOk;
+}
+
+bool SearchMemoryPlanner::OverlapInTime(int a, int b) const
+{
+    return requirements_[a].first_time_used <= requirements_[b].last_time_used &&
+           requirements_[b].first_time_used <= requirements_[a].last_time_used;
+}
+
+int64_t SearchMemoryPlanner::OrderKey(Order order, int buffer) const
+{
+    const BufferRequirements &requirements = requirements_[buffer];
+    const int64_t lifetime =
+        requirements.last_time_used - requirements.first_time_used + 1;
+    switch (order) {
+    case kBySize:
+        return requirements.size;
+    case kByLifetime:
+        return lifetime;
+    case kByArea:
+        return lifetime * requirements.size;
+    case kBySharedBytes:
+        return shared_bytes_[buffer];
+    case kByFirstUse:
+    default:
+        return -requirements.first_time_used;
+    }
+}
+
+void SearchMemoryPlanner::SortOrder(Order order)
+{
+    // Descending key, then descending size, then descending id: kBySize is
+    // then the order of the GreedyMemoryPlanner, which lists the online
+    // planned buffers backwards before its stable sort.
+    std::sort(order_ + offline_count_, order_ + buffer_count_, [this, order](int a, int b) {
+        const int64_t key_a = OrderKey(order, a);
+        const int64_t key_b = OrderKey(order, b);
+        if (key_a != key_b) {
+            return key_a > key_b;
+        }
+        if (requirements_[a].size != requirements_[b].size) {
+            return requirements_[a].size > requirements_[b].size;
+        }
+        return a > b;
+    });
+}
+
+int SearchMemoryPlanner::NextFit(int buffer, int placed, int after, int limit) const
+{
+    const int size = requirements_[buffer].size;
+    int result = -1;
+    // Candidates are offset 0 (i == -1) and the ends of the placed buffers
+    // that share time with this one.
+    for (int i = -1; i < placed; ++i) {
+        int candidate = 0;
+        if (i >= 0) {
+            const int other = order_[i];
+            if (!OverlapInTime(buffer, other)) {
+                continue;
+            }
+            candidate = offsets_[other] + requirements_[other].size;
+        }
+        if (candidate <= after || candidate >= limit ||
+            (result >= 0 && candidate >= result)) {
+            continue;
+        }
+        bool fits = true;
+        for (int j = 0; j < placed && fits; ++j) {
+            const int other = order_[j];
+            fits = !OverlapInTime(buffer, other) ||
+                   offsets_[other] >= candidate + size ||
+                   offsets_[other] + requirements_[other].size <= candidate;
+        }
+        if (fits) {
+            result = candidate;
+        }
+    }
+    return result;
+}
+
+int SearchMemoryPlanner::BestFit(int buffer, int placed) const
+{
+    const int size = requirements_[buffer].size;
+    int result = -1;
+    int result_slack = INT_MAX;
+    for (int i = -1; i < placed; ++i) {
+        int candidate = 0;
+        if (i >= 0) {
+            const int other = order_[i];
+            if (!OverlapInTime(buffer, other)) {
+                continue;
+            }
+            candidate = offsets_[other] + requirements_[other].size;
+        }
+        // The candidate fits if every buffer sharing time with this one ends
+        // below it or starts above it; the lowest start above bounds the gap.
+        bool fits = true;
+        int gap_end = INT_MAX;
+        for (int j = 0; j < placed && fits; ++j) {
+            const int other = order_[j];
+            if (!OverlapInTime(buffer, other)) {
+                continue;
+            }
+            if (offsets_[other] >= candidate + size) {
+                gap_end = std::min(gap_end, offsets_[other]);
+            } else {
+                fits = offsets_[other] + requirements_[other].size <= candidate;
+            }
+        }
+        if (!fits) {
+            continue;
+        }
+        const int slack = (gap_end == INT_MAX) ? INT_MAX : gap_end - candidate - size;
+        if (result < 0 || slack < result_slack ||
+            (slack == result_slack && candidate < result)) {
+            result = candidate;
+            result_slack = slack;
+        }
+    }
+    return result;
+}
+
+int SearchMemoryPlanner::LayOut(bool best_fit)
+{
+    int size = peaks_[0];
+    for (int i = offline_count_; i < buffer_count_; ++i) {
+        const int buffer = order_[i];
+        const int offset = best_fit ? BestFit(buffer, i) : NextFit(buffer, i, -1, INT_MAX);
+        offsets_[buffer] = offset;
+        size = std::max(size, offset + requirements_[buffer].size);
+    }
+    return size;
+}
+
+void SearchMemoryPlanner::Search()
+{
+    const int online_count = buffer_count_ - offline_count_;
+    int depth = 0;
+    tried_[0] = -1;
+    while (search_steps_used_ < search_steps_) {
+        if (depth == online_count) {
+            // Every placement stayed below best_size_, so this layout is better.
+            best_size_ = peaks_[depth];
+            for (int i = 0; i < buffer_count_; ++i) {
+                best_offsets_[i] = offsets_[i];
+            }
+            if (best_size_ <= lower_bound_) {
+                break;
+            }
+            --depth;
+            continue;
+        }
+        const int buffer = order_[offline_count_ + depth];
+        const int size = requirements_[buffer].size;
+        const int offset =
+            NextFit(buffer, offline_count_ + depth, tried_[depth], best_size_ - size);
+        if (offset < 0) {
+            if (depth == 0) {
+                break;
+            }
+            --depth;
+            continue;
+        }
+        tried_[depth] = offset;
+        offsets_[buffer] = offset;
+        peaks_[depth + 1] = std::max(peaks_[depth], offset + size);
+        ++search_steps_used_;
+        ++depth;
+        if (depth < online_count) {
+            tried_[depth] = -1;
+        }
+    }
+}
+
+void SearchMemoryPlanner::CalculateOffsetsIfNeeded()
+{
+    if (!need_to_calculate_offsets_) {
+        return;
+    }
+    need_to_calculate_offsets_ = false;
+    search_steps_used_ = 0;
+    best_size_ = 0;
+    lower_bound_ = 0;
+    if (buffer_count_ == 0) {
+        return;
+    }
+
+    // Offline planned buffers first, at their offsets; peaks_[0] is the size
+    // they need.
+    offline_count_ = 0;
+    peaks_[0] = 0;
+    for (int i = 0; i < buffer_count_; ++i) {
+        if (requirements_[i].offline_offset != kOnlinePlannedBuffer) {
+            order_[offline_count_++] = i;
+            offsets_[i] = requirements_[i].offline_offset;
+            peaks_[0] = std::max(peaks_[0], offsets_[i] + requirements_[i].size);
+        }
+    }
+    int next_online = offline_count_;
+    for (int i = 0; i < buffer_count_; ++i) {
+        if (requirements_[i].offline_offset == kOnlinePlannedBuffer) {
+            order_[next_online++] = i;
+        }
+    }
+
+    // The bytes alive together are largest when some buffer starts.
+    lower_bound_ = peaks_[0];
+    for (int i = 0; i < buffer_count_; ++i) {
+        shared_bytes_[i] = 0;
+        int alive = 0;
+        const int time = requirements_[i].first_time_used;
+        for (int j = 0; j < buffer_count_; ++j) {
+            if (j != i && OverlapInTime(i, j)) {
+                shared_bytes_[i] += requirements_[j].size;
+            }
+            if (requirements_[j].first_time_used <= time &&
+                requirements_[j].last_time_used >= time) {
+                alive += requirements_[j].size;
+            }
+        }
+        lower_bound_ = std::max(lower_bound_, alive);
+    }
+
+    best_size_ = INT_MAX;
+    Order best_order = kBySize;
+    for (int order = kBySize; order < kOrderCount && best_size_ > lower_bound_; ++order) {
+        SortOrder(static_cast<Order>(order));
+        for (int best_fit = 0; best_fit < 2; ++best_fit) {
+            const int size = LayOut(best_fit != 0);
+            if (size < best_size_) {
+                best_size_ = size;
+                best_order = static_cast<Order>(order);
+                for (int i = 0; i < buffer_count_; ++i) {
+                    best_offsets_[i] = offsets_[i];
+                }
+            }
+        }
+    }
+
+    if (best_size_ > lower_bound_ && search_steps_ > 0 && buffer_count_ > offline_count_) {
+        SortOrder(best_order);
+        Search();
+    }
+}
+
+size_t SearchMemoryPlanner::GetMaximumMemorySize()
+{
+    CalculateOffsetsIfNeeded();
+    return best_size_;
+}
+
+size_t SearchMemoryPlanner::GetLowerBound()
+{
+    CalculateOffsetsIfNeeded();
+    return lower_bound_;
+}
+
+int SearchMemoryPlanner::search_steps_used()
+{
+    CalculateOffsetsIfNeeded();
+    return search_steps_used_;
+}
+
+int SearchMemoryPlanner::GetBufferCount()
+{
+    return buffer_count_;
+}
+
+TfLiteStatus SearchMemoryPlanner::GetOffsetForBuffer(
+    tflite::ErrorReporter *error_reporter, int buffer_index, int *offset)
+{
+    CalculateOffsetsIfNeeded();
+    if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+        TF_LITE_REPORT_ERROR(error_reporter,
+                             "buffer index %d is outside range 0 to %d",
+                             buffer_index, buffer_count_);
+        return kTfLiteError;
+    }
+    *offset = best_offsets_[buffer_index];
+    return kTfLiteOk;
+}
+
+bool SearchMemoryPlanner::DoAnyBuffersOverlap(ErrorReporter *error_reporter)
+{
+    CalculateOffsetsIfNeeded();
+    bool were_overlaps_found = false;
+    for (int i = 0; i < buffer_count_; ++i) {
+        for (int j = i + 1; j < buffer_count_; ++j) {
+            if (!OverlapInTime(i, j)) {
+                continue;
+            }
+            const int a_start_offset = best_offsets_[i];
+            const int a_end_offset = a_start_offset + requirements_[i].size;
+            const int b_start_offset = best_offsets_[j];
+            const int b_end_offset = b_start_offset + requirements_[j].size;
+            if ((a_start_offset >= b_end_offset) || (b_start_offset >= a_end_offset)) {
+                continue;
+            }
+            were_overlaps_found = true;
+            TF_LITE_REPORT_ERROR(error_reporter, "Overlap: %d (%d->%d) vs %d (%d->%d)", i,
+                                 a_start_offset, a_end_offset, j, b_start_offset,
+                                 b_end_offset);
+        }
+    }
+    return were_overlaps_found;
+}
+
+} // namespace tflite
@@ -93,9 +93,46 @@ TfLiteStatus SimpleMemoryAllocator::SetHeadBufferSize(size_t size,
     return kTfLiteOk;
 }
 
-uint8_t *SimpleMemoryAllocator::AllocateFromTail(size_t size,
-                                                 size_t alignment)
+TfLiteStatus SimpleMemoryAllocator::SetSlowRegion(uint8_t *buffer, size_t size)
 {
+    if (slow_head_ != nullptr) {
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "The allocator already has a slow region");
+        return kTfLiteError;
+    }
+    if (buffer == nullptr || size == 0) {
+        TF_LITE_REPORT_ERROR(error_reporter_, "Invalid slow region");
+        return kTfLiteError;
+    }
+    slow_head_ = buffer;
+    slow_buffer_tail_ = buffer + size;
+    slow_tail_ = slow_buffer_tail_;
+    return kTfLiteOk;
+}
+
+uint8_t *SimpleMemoryAllocator::AllocateFromTail(size_t size, size_t alignment,
+                                                 MemoryRegion region)
+{
+    if (region == MemoryRegion::kSlow && slow_head_ != nullptr) {
+        // Checked before the subtraction, which must stay inside the region.
+        const size_t available = slow_tail_ - slow_head_;
+        if (size <= available) {
+            uint8_t *const aligned_result =
+                AlignPointerDown(slow_tail_ - size, alignment);
+            if (aligned_result >= slow_head_) {
+                slow_tail_ = aligned_result;
+                return aligned_result;
+            }
+        }
+#ifndef TF_LITE_STRIP_ERROR_STRINGS
+        TF_LITE_REPORT_ERROR(error_reporter_,
+                             "Failed to allocate slow region memory. "
+                             "Requested: %u, available %u",
+                             size, available);
+#endif
+        return nullptr;
+    }
+
     uint8_t *const aligned_result = AlignPointerDown(tail_ - size, alignment);
     if (aligned_result < head_) {
 #ifndef TF_LITE_STRIP_ERROR_STRINGS
@@ -146,6 +183,11 @@ size_t SimpleMemoryAllocator::GetTailUsedBytes() const
     return buffer_tail_ - tail_;
 }
 
+size_t SimpleMemoryAllocator::GetSlowUsedBytes() const
+{
+    return slow_buffer_tail_ - slow_tail_;
+}
+
 size_t SimpleMemoryAllocator::GetAvailableMemory(size_t alignment) const
 {
     uint8_t *const aligned_temp = AlignPointerUp(temp_, alignment);
@@ -173,4 +215,9 @@ uint8_t *SimpleMemoryAllocator::tail() const
     return tail_;
 }
 
+uint8_t *SimpleMemoryAllocator::slow_tail() const
+{
+    return slow_tail_;
+}
+
 } // namespace tflite
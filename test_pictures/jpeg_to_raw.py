@@ -1,5 +1,6 @@
 '''
 python script.py input.jpg output.c
+python script.py input.jpg output.pgm
 '''
 
 import argparse
@@ -22,6 +23,14 @@ def process_image(input_file, output_file):
     # Flatten the 2D array into a 1D array
     flat_data = image_data.flatten()
 
+    # A .pgm output is a binary grayscale image for the host offline runner
+    if output_file.endswith(".pgm"):
+        with open(output_file, "wb") as pgm_file:
+            pgm_file.write(b"P5\n96 96\n255\n")
+            pgm_file.write(flat_data.astype(np.uint8).tobytes())
+        print(f"The image has been processed and saved in '{output_file}'.")
+        return
+
     # Open the C file to write the data
     with open(output_file, "w") as c_file:
         c_file.write("#include \"test_image_data.h\"\n\n")
@@ -42,7 +51,7 @@ if __name__ == "__main__":
     # Create argument parser
     parser = argparse.ArgumentParser(description="Convert a JPEG image to greyscale, resize it, and save it as a C array.")
     parser.add_argument("input_file", help="Input JPEG file path")
-    parser.add_argument("output_file", help="Output C file path to save the array")
+    parser.add_argument("output_file", help="Output C file path to save the array, or .pgm file path to save a binary PGM")
 
     # Parse the arguments
     args = parser.parse_args()